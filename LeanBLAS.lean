@@ -12,4 +12,18 @@ import LeanBLAS.ComplexFloat
 import LeanBLAS.BLAS
 import LeanBLAS.ComplexArray
 import LeanBLAS.TestUtils
-
+import LeanBLAS.FFI.Backend
+import LeanBLAS.FFI.Reproducible
+import LeanBLAS.FFI.PerfCounters
+import LeanBLAS.FFI.Trace
+import LeanBLAS.FFI.AllocProfile
+import LeanBLAS.FFI.CBLASAsyncFloat64
+import LeanBLAS.FFI.Element
+import LeanBLAS.FFI.Npy
+import LeanBLAS.FFI.MatrixMarket
+import LeanBLAS.FFI.Checkpoint
+import LeanBLAS.FFI.Safetensors
+import LeanBLAS.FFI.Stream
+import LeanBLAS.CallGraph
+import LeanBLAS.Matrix
+import LeanBLAS.Lazy
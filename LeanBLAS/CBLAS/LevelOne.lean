@@ -63,6 +63,7 @@ instance : LevelOneDataExt Float64Array Float Float where
   sum N X offX incX := dsum N.toUSize X offX.toUSize incX.toUSize
   axpby N a X offX incX b Y offY incY := daxpby N.toUSize a X offX.toUSize incX.toUSize b Y offY.toUSize incY.toUSize
   scaladd N a X offX incX b := dscaladd N.toUSize a X offX.toUSize incX.toUSize b
+  copyWithin N X offX incX offY incY := dcopyWithin N.toUSize X offX.toUSize incX.toUSize offY.toUSize incY.toUSize
 
   imaxRe N X offX incX h := (dimaxRe N.toUSize X offX.toUSize incX.toUSize).toNat
   imaxIm N X offX incX h := offX
@@ -129,6 +129,9 @@ instance : LevelOneDataExt ComplexFloat64Array Float ComplexFloat where
       if i % 2 = 0 then b.re else b.im)
     let bVec := ComplexFloatArray.toComplexFloat64Array { data := floatArrB }
     zaxpy N.toUSize ComplexFloat.one bVec 0 1 Y'' 0 1
+
+  copyWithin N X offX incX offY incY :=
+    zcopyWithin N.toUSize X offX.toUSize incX.toUSize offY.toUSize incY.toUSize
     
   imaxRe N X offX incX _ :=
     -- Find index with maximum real part
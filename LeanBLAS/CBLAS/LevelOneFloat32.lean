@@ -51,6 +51,7 @@ instance : LevelOneDataExt Float32Array Float Float where
   sum N X offX incX := ssum N.toUSize X offX.toUSize incX.toUSize
   axpby N a X offX incX b Y offY incY := saxpby N.toUSize a X offX.toUSize incX.toUSize b Y offY.toUSize incY.toUSize
   scaladd N a X offX incX b := sscaladd N.toUSize a X offX.toUSize incX.toUSize b
+  copyWithin N X offX incX offY incY := scopyWithin N.toUSize X offX.toUSize incX.toUSize offY.toUSize incY.toUSize
 
   imaxRe N X offX incX h := (simaxRe N.toUSize X offX.toUSize incX.toUSize).toNat
   imaxIm N X offX incX h := offX
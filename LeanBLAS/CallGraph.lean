@@ -0,0 +1,342 @@
+import LeanBLAS.FFI.FloatArray
+import LeanBLAS.Spec.LevelTwo
+
+set_option autoImplicit false
+
+namespace BLAS.CallGraph
+
+/-! # BLAS Call-Graph Capture and Replay
+
+Loops that issue the same sequence of Float64 BLAS calls on every iteration can
+record the sequence once and replay it with a single FFI call per iteration.
+Operations are recorded against buffer handles instead of arrays: *arguments*
+are bound to arrays at replay, and *temporaries* live inside the graph.
+
+```lean
+let (graph, dot) ← CallGraph.capture do
+  let A ← arg (n * n)
+  let x ← arg n
+  let t ← temp n
+  dgemv .ColMajor .NoTrans n n 1.0 A 0 n x 0 1 0.0 t 0 1
+  daxpy n 2.0 x 0 1 t 0 1
+  dscal n 0.5 t 0 1
+  ddot n t 0 1 x 0 1
+for _ in [:iters] do
+  let (args, scalars) ← graph.replay #[A, x]
+  ... scalars[dot.id]! ...
+```
+
+Compiling the recording (in `c/graph.c`):
+* fuses runs of adjacent elementwise Level 1 nodes of the same length, so they
+  sweep their vectors once in cache-sized chunks;
+* lets temporaries whose lifetimes do not overlap share storage, allocated once
+  and reused by every replay;
+* orders the nodes by their buffer dependencies and runs independent nodes in
+  parallel on the native thread pool.
+
+Temporaries read as zero until they are first written. Replays of one graph
+run one at a time. `ddot`, `dnrm2`, `dasum`, `dsum`, `dgemv` and `dgemm` honour
+the mode of `BLAS.Reproducible`.
+-/
+
+/-- A buffer of a recording: an argument or a temporary. -/
+structure Buf where
+  id : Nat
+deriving Inhabited, BEq, Repr
+
+/-- The result of a recorded reduction; `scalars[s.id]!` after a replay. -/
+structure Scalar where
+  id : Nat
+deriving Inhabited, BEq, Repr
+
+/-- Recorded operations, in the order of the opcodes in `c/graph.c`. -/
+inductive Op where
+  | copy | axpy | scal | axpby | scaladd | const | mul
+  | abs | sqrt | exp | log | sin | cos | inv
+  | dot | nrm2 | asum | sum
+  | gemv | ger | trmv | trsv
+  | gemm | symm | syrk | trmm | trsm
+deriving Inhabited, BEq, Repr
+
+/-- An array operand: offset of the first element, leading dimension (increment
+for vectors) and one past the last element it touches. -/
+structure Operand where
+  buf : Buf
+  off : USize
+  ld : USize
+  extent : Nat
+
+structure Node where
+  op : Op
+  order : Order := .ColMajor
+  side : Side := .Left
+  uplo : UpLo := .Upper
+  transA : Transpose := .NoTrans
+  transB : Transpose := .NoTrans
+  diag : Diag := .NonUnit
+  M : USize := 0
+  N : USize := 0
+  K : USize := 0
+  alpha : Float := 0
+  beta : Float := 0
+  /-- Array operands in BLAS argument order. -/
+  operands : Array Operand
+  result : Option Scalar := none
+
+structure BufInfo where
+  size : Nat
+  /-- Position in the argument list, `none` for temporaries. -/
+  arg : Option Nat
+
+structure Recording where
+  bufs : Array BufInfo := #[]
+  args : Nat := 0
+  nodes : Array Node := #[]
+  scalars : Nat := 0
+
+abbrev CaptureM := StateM Recording
+
+/-- Declares an argument of `size` elements. Arguments are bound at replay in
+the order they were declared. -/
+def arg (size : Nat) : CaptureM Buf := modifyGet fun r =>
+  (⟨r.bufs.size⟩, { r with bufs := r.bufs.push { size, arg := some r.args }, args := r.args + 1 })
+
+/-- Declares a temporary of `size` elements, owned by the graph. -/
+def temp (size : Nat) : CaptureM Buf := modifyGet fun r =>
+  (⟨r.bufs.size⟩, { r with bufs := r.bufs.push { size, arg := none } })
+
+private def record (node : Node) : CaptureM Unit :=
+  modify fun r => { r with nodes := r.nodes.push node }
+
+private def recordScalar (node : Node) : CaptureM Scalar := modifyGet fun r =>
+  (⟨r.scalars⟩, { r with nodes := r.nodes.push { node with result := some ⟨r.scalars⟩ }, scalars := r.scalars + 1 })
+
+private def vec (X : Buf) (N off inc : USize) : Operand :=
+  { buf := X, off, ld := inc,
+    extent := if N == 0 then 0 else off.toNat + (N.toNat - 1) * inc.toNat + 1 }
+
+/-- A `rows × cols` matrix. -/
+private def mat (order : Order) (A : Buf) (rows cols off ld : USize) : Operand :=
+  { buf := A, off, ld,
+    extent :=
+      if rows == 0 || cols == 0 then 0
+      else match order with
+        | .ColMajor => off.toNat + (cols.toNat - 1) * ld.toNat + rows.toNat
+        | .RowMajor => off.toNat + (rows.toNat - 1) * ld.toNat + cols.toNat }
+
+/-! ## Level 1 -/
+
+/-- Y := X -/
+def dcopy (N : USize) (X : Buf) (offX incX : USize) (Y : Buf) (offY incY : USize) : CaptureM Unit :=
+  record { op := .copy, N, operands := #[vec X N offX incX, vec Y N offY incY] }
+
+/-- Y := αX + Y -/
+def daxpy (N : USize) (alpha : Float) (X : Buf) (offX incX : USize) (Y : Buf) (offY incY : USize) :
+    CaptureM Unit :=
+  record { op := .axpy, N, alpha, operands := #[vec X N offX incX, vec Y N offY incY] }
+
+/-- X := αX -/
+def dscal (N : USize) (alpha : Float) (X : Buf) (offX incX : USize) : CaptureM Unit :=
+  record { op := .scal, N, alpha, operands := #[vec X N offX incX] }
+
+/-- Y := αX + βY -/
+def daxpby (N : USize) (alpha : Float) (X : Buf) (offX incX : USize)
+    (beta : Float) (Y : Buf) (offY incY : USize) : CaptureM Unit :=
+  record { op := .axpby, N, alpha, beta, operands := #[vec X N offX incX, vec Y N offY incY] }
+
+/-- X := αX + β -/
+def dscaladd (N : USize) (alpha : Float) (X : Buf) (offX incX : USize) (beta : Float) : CaptureM Unit :=
+  record { op := .scaladd, N, alpha, beta, operands := #[vec X N offX incX] }
+
+/-- X := α -/
+def dconst (N : USize) (alpha : Float) (X : Buf) (offX incX : USize) : CaptureM Unit :=
+  record { op := .const, N, alpha, operands := #[vec X N offX incX] }
+
+/-- Y[i] := X[i]·Y[i] -/
+def dmul (N : USize) (X : Buf) (offX incX : USize) (Y : Buf) (offY incY : USize) : CaptureM Unit :=
+  record { op := .mul, N, operands := #[vec X N offX incX, vec Y N offY incY] }
+
+private def unary (op : Op) (N : USize) (X : Buf) (offX incX : USize) : CaptureM Unit :=
+  record { op, N, operands := #[vec X N offX incX] }
+
+/-- X[i] := |X[i]| -/
+def dabs := unary .abs
+/-- X[i] := √X[i] -/
+def dsqrt := unary .sqrt
+/-- X[i] := eˣ⁽ⁱ⁾ -/
+def dexp := unary .exp
+/-- X[i] := ln(X[i]) -/
+def dlog := unary .log
+/-- X[i] := sin(X[i]) -/
+def dsin := unary .sin
+/-- X[i] := cos(X[i]) -/
+def dcos := unary .cos
+/-- X[i] := 1/X[i] -/
+def dinv := unary .inv
+
+/-- XᵀY -/
+def ddot (N : USize) (X : Buf) (offX incX : USize) (Y : Buf) (offY incY : USize) : CaptureM Scalar :=
+  recordScalar { op := .dot, N, operands := #[vec X N offX incX, vec Y N offY incY] }
+
+/-- ‖X‖₂ -/
+def dnrm2 (N : USize) (X : Buf) (offX incX : USize) : CaptureM Scalar :=
+  recordScalar { op := .nrm2, N, operands := #[vec X N offX incX] }
+
+/-- Σ|X[i]| -/
+def dasum (N : USize) (X : Buf) (offX incX : USize) : CaptureM Scalar :=
+  recordScalar { op := .asum, N, operands := #[vec X N offX incX] }
+
+/-- ΣX[i] -/
+def dsum (N : USize) (X : Buf) (offX incX : USize) : CaptureM Scalar :=
+  recordScalar { op := .sum, N, operands := #[vec X N offX incX] }
+
+/-! ## Level 2 -/
+
+/-- Y := α op(A) X + βY -/
+def dgemv (order : Order) (transA : Transpose) (M N : USize) (alpha : Float)
+    (A : Buf) (offA lda : USize) (X : Buf) (offX incX : USize) (beta : Float)
+    (Y : Buf) (offY incY : USize) : CaptureM Unit :=
+  let (lx, ly) := if transA == .NoTrans then (N, M) else (M, N)
+  record { op := .gemv, order, transA, M, N, alpha, beta,
+           operands := #[mat order A M N offA lda, vec X lx offX incX, vec Y ly offY incY] }
+
+/-- A := αXYᵀ + A -/
+def dger (order : Order) (M N : USize) (alpha : Float) (X : Buf) (offX incX : USize)
+    (Y : Buf) (offY incY : USize) (A : Buf) (offA lda : USize) : CaptureM Unit :=
+  record { op := .ger, order, M, N, alpha,
+           operands := #[vec X M offX incX, vec Y N offY incY, mat order A M N offA lda] }
+
+/-- X := op(A)X with A triangular -/
+def dtrmv (order : Order) (uplo : UpLo) (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Buf) (offA lda : USize) (X : Buf) (offX incX : USize) : CaptureM Unit :=
+  record { op := .trmv, order, uplo, transA, diag, N,
+           operands := #[mat order A N N offA lda, vec X N offX incX] }
+
+/-- Solves op(A)X = B for X, with B given in X -/
+def dtrsv (order : Order) (uplo : UpLo) (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Buf) (offA lda : USize) (X : Buf) (offX incX : USize) : CaptureM Unit :=
+  record { op := .trsv, order, uplo, transA, diag, N,
+           operands := #[mat order A N N offA lda, vec X N offX incX] }
+
+/-! ## Level 3 -/
+
+/-- C := α op(A) op(B) + βC -/
+def dgemm (order : Order) (transA transB : Transpose) (M N K : USize) (alpha : Float)
+    (A : Buf) (offA lda : USize) (B : Buf) (offB ldb : USize) (beta : Float)
+    (C : Buf) (offC ldc : USize) : CaptureM Unit :=
+  let (ra, ca) := if transA == .NoTrans then (M, K) else (K, M)
+  let (rb, cb) := if transB == .NoTrans then (K, N) else (N, K)
+  record { op := .gemm, order, transA, transB, M, N, K, alpha, beta,
+           operands := #[mat order A ra ca offA lda, mat order B rb cb offB ldb, mat order C M N offC ldc] }
+
+/-- C := αAB + βC or C := αBA + βC with A symmetric -/
+def dsymm (order : Order) (side : Side) (uplo : UpLo) (M N : USize) (alpha : Float)
+    (A : Buf) (offA lda : USize) (B : Buf) (offB ldb : USize) (beta : Float)
+    (C : Buf) (offC ldc : USize) : CaptureM Unit :=
+  let ka := if side == .Left then M else N
+  record { op := .symm, order, side, uplo, M, N, alpha, beta,
+           operands := #[mat order A ka ka offA lda, mat order B M N offB ldb, mat order C M N offC ldc] }
+
+/-- C := αAAᵀ + βC or C := αAᵀA + βC -/
+def dsyrk (order : Order) (uplo : UpLo) (transA : Transpose) (N K : USize) (alpha : Float)
+    (A : Buf) (offA lda : USize) (beta : Float) (C : Buf) (offC ldc : USize) : CaptureM Unit :=
+  let (ra, ca) := if transA == .NoTrans then (N, K) else (K, N)
+  record { op := .syrk, order, uplo, transA, N, K, alpha, beta,
+           operands := #[mat order A ra ca offA lda, mat order C N N offC ldc] }
+
+/-- B := α op(A) B or B := α B op(A) with A triangular -/
+def dtrmm (order : Order) (side : Side) (uplo : UpLo) (transA : Transpose) (diag : Diag)
+    (M N : USize) (alpha : Float) (A : Buf) (offA lda : USize) (B : Buf) (offB ldb : USize) :
+    CaptureM Unit :=
+  let ka := if side == .Left then M else N
+  record { op := .trmm, order, side, uplo, transA, diag, M, N, alpha,
+           operands := #[mat order A ka ka offA lda, mat order B M N offB ldb] }
+
+/-- Solves op(A) X = αB or X op(A) = αB for X, with B overwritten -/
+def dtrsm (order : Order) (side : Side) (uplo : UpLo) (transA : Transpose) (diag : Diag)
+    (M N : USize) (alpha : Float) (A : Buf) (offA lda : USize) (B : Buf) (offB ldb : USize) :
+    CaptureM Unit :=
+  let ka := if side == .Left then M else N
+  record { op := .trsm, order, side, uplo, transA, diag, M, N, alpha,
+           operands := #[mat order A ka ka offA lda, mat order B M N offB ldb] }
+
+/-! ## Compilation and Replay -/
+
+opaque GraphPointed : NonemptyType
+
+/-- A compiled recording. -/
+def Graph : Type := GraphPointed.type
+
+instance : Nonempty Graph := GraphPointed.property
+
+@[extern "leanblas_graph_compile"]
+private opaque compileRaw (code : @& Array USize) (consts : @& FloatArray)
+    (bufSizes bufArgs : @& Array USize) (nscalars : USize) : IO Graph
+
+private def opCode : Op → USize
+  | .copy => 0 | .axpy => 1 | .scal => 2 | .axpby => 3 | .scaladd => 4 | .const => 5 | .mul => 6
+  | .abs => 7 | .sqrt => 8 | .exp => 9 | .log => 10 | .sin => 11 | .cos => 12 | .inv => 13
+  | .dot => 14 | .nrm2 => 15 | .asum => 16 | .sum => 17
+  | .gemv => 18 | .ger => 19 | .trmv => 20 | .trsv => 21
+  | .gemm => 22 | .symm => 23 | .syrk => 24 | .trmm => 25 | .trsm => 26
+
+-- Constructor indices, as the C wrappers expect them.
+private def orderCode : Order → USize | .RowMajor => 0 | .ColMajor => 1
+private def sideCode : Side → USize | .Left => 0 | .Right => 1
+private def uploCode : UpLo → USize | .Upper => 0 | .Lower => 1
+private def transCode : Transpose → USize | .NoTrans => 0 | .Trans => 1 | .ConjTrans => 2
+private def diagCode : Diag → USize | .NonUnit => 0 | .Unit => 1
+
+/-- Checks that every access lies inside its buffer and builds the plan. -/
+def Recording.compile (r : Recording) : IO Graph := do
+  let mut code : Array USize := Array.mkEmpty (20 * r.nodes.size)
+  let mut consts : FloatArray := FloatArray.mkEmpty (2 * r.nodes.size)
+  for node in r.nodes do
+    for x in node.operands do
+      let some info := r.bufs[x.buf.id]?
+        | throw <| IO.userError s!"call graph: {repr node.op} uses an undeclared buffer"
+      if x.extent > info.size then
+        throw <| IO.userError
+          s!"call graph: {repr node.op} accesses {x.extent} elements of a buffer of {info.size}"
+    code := code ++ #[opCode node.op, orderCode node.order, sideCode node.side, uploCode node.uplo,
+      transCode node.transA, transCode node.transB, diagCode node.diag, node.M, node.N, node.K]
+    for i in [0:3] do
+      match node.operands[i]? with
+      | some x => code := code ++ #[(x.buf.id + 1).toUSize, x.off, x.ld]
+      | none => code := code ++ #[0, 0, 0]
+    code := code.push (match node.result with | some s => (s.id + 1).toUSize | none => 0)
+    consts := (consts.push node.alpha).push node.beta
+  let bufArgs := r.bufs.map fun b => match b.arg with | some i => (i + 1).toUSize | none => 0
+  compileRaw code consts (r.bufs.map (·.size.toUSize)) bufArgs r.scalars.toUSize
+
+/-- Records `body` and compiles it. -/
+def capture {α : Type} (body : CaptureM α) : IO (Graph × α) := do
+  let (a, r) := body.run {}
+  return (← r.compile, a)
+
+/-- Runs the graph on `args`, one array per `arg` in declaration order. Returns
+the arguments after the run, written ones copied first if they were shared,
+and the scalar results indexed by `Scalar.id`. -/
+@[extern "leanblas_graph_replay"]
+opaque Graph.replay (g : @& Graph) (args : Array Float64Array) : IO (Array Float64Array × FloatArray)
+
+structure Info where
+  nodes : Nat
+  /-- Nodes left after fusing elementwise runs. -/
+  groups : Nat
+  /-- Steps of the schedule; the groups of one level run in parallel. -/
+  levels : Nat
+  /-- Storage slots shared by the temporaries. -/
+  tempSlots : Nat
+  tempBytes : Nat
+deriving Repr
+
+/-- `#[nodes, groups, levels, temporary slots, temporary bytes]` -/
+@[extern "leanblas_graph_info"]
+private opaque infoRaw (g : @& Graph) : Array Nat
+
+def Graph.info (g : Graph) : Info :=
+  let a := infoRaw g
+  { nodes := a[0]!, groups := a[1]!, levels := a[2]!, tempSlots := a[3]!, tempBytes := a[4]! }
+
+end BLAS.CallGraph
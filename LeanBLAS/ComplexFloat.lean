@@ -41,6 +41,9 @@ instance : HMul Float ComplexFloat ComplexFloat where
 instance : Neg ComplexFloat where
   neg a := ⟨-a.re, -a.im⟩
 
+instance {n : Nat} : OfNat ComplexFloat n where
+  ofNat := ⟨n.toFloat, 0⟩
+
 def ComplexFloat.zero : ComplexFloat := ⟨0, 0⟩
 
 def ComplexFloat.one : ComplexFloat := ⟨1, 0⟩
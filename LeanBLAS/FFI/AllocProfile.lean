@@ -0,0 +1,92 @@
+set_option autoImplicit false
+
+namespace BLAS.AllocProfile
+
+/-! # Allocation Profile
+
+Counts the objects the C wrappers allocate, per operation: the arrays and
+tuples they return (`dconst`, `drotg`, the pairs of `dswap`, …) and the copies
+of output arrays that were still shared when the call needed to write them
+(copy-on-write). A loop whose arrays are all used linearly should show no
+allocations at all once its buffers exist:
+
+```
+let (_, ops) ← BLAS.AllocProfile.measure do
+  for _ in [0:100] do s ← cgStep s
+IO.println (BLAS.AllocProfile.report ops)
+```
+
+Only allocations made inside the wrappers are seen; boxing done by compiled
+Lean code around them is not. Frees happen when Lean drops the last reference,
+outside of any wrapper, so instead of live bytes the profile reports the
+largest number of bytes a single call allocated (`peakBytes`), the footprint a
+call adds on top of its arguments.
+
+Counting shares the scopes of `BLAS.Trace` and costs nothing extra while off;
+`lake build -K trace=off` removes both. Counts are per thread and merged when
+read, so read them after the calls of interest have returned.
+-/
+
+/-- Counts for one operation, e.g. `daxpy` or `copy` for a copy made outside of
+any wrapper. -/
+structure OpStats where
+  op : String
+  calls : Nat := 0
+  allocations : Nat := 0
+  bytes : Nat := 0
+  /-- bytes allocated by the most expensive single call -/
+  peakBytes : Nat := 0
+  /-- copies of shared output arrays, included in `allocations` -/
+  copies : Nat := 0
+  copyBytes : Nat := 0
+  deriving Repr, Inhabited
+
+/-- Whether allocations are being counted. -/
+@[extern "leanblas_alloc_profile_is_enabled"]
+opaque isEnabled : IO Bool
+
+@[extern "leanblas_alloc_profile_set_enabled"]
+opaque setEnabled (on : Bool) : IO Unit
+
+/-- Drops the counts collected so far. -/
+@[extern "leanblas_alloc_profile_clear"]
+opaque clear : IO Unit
+
+@[extern "leanblas_alloc_profile_stats"]
+opaque statsRaw : IO (Array (String × Array Nat))
+
+/-- The counts since the last `clear`, by operation. -/
+def stats : IO (Array OpStats) := do
+  let raw ← statsRaw
+  let ops := raw.map fun (op, c) =>
+    { op, calls := c[0]!, allocations := c[1]!, bytes := c[2]!, peakBytes := c[3]!,
+      copies := c[4]!, copyBytes := c[5]! : OpStats }
+  return ops.qsort (·.op < ·.op)
+
+/-- All operations together. -/
+def total (ops : Array OpStats) : OpStats :=
+  ops.foldl (init := { op := "total" }) fun t s =>
+    { t with calls := t.calls + s.calls, allocations := t.allocations + s.allocations,
+             bytes := t.bytes + s.bytes, peakBytes := max t.peakBytes s.peakBytes,
+             copies := t.copies + s.copies, copyBytes := t.copyBytes + s.copyBytes }
+
+/-- Counts allocations while `act` runs and restores the previous state afterwards. -/
+def withEnabled {α : Type} (act : IO α) : IO α := do
+  let before ← isEnabled
+  setEnabled true
+  try act finally setEnabled before
+
+/-- The result of `act` and the allocations of the calls it made. -/
+def measure {α : Type} (act : IO α) : IO (α × Array OpStats) := do
+  clear
+  let a ← withEnabled act
+  return (a, ← stats)
+
+/-- One line per operation that allocated, then the total. -/
+def report (ops : Array OpStats) : String :=
+  let line (s : OpStats) :=
+    s!"{s.op}\t{s.calls}\t{s.allocations}\t{s.bytes}\t{s.peakBytes}\t{s.copies}\t{s.copyBytes}\n"
+  "op\tcalls\tallocations\tbytes\tpeak bytes\tcopies\tcopy bytes\n" ++
+    String.join ((ops.filter (·.allocations > 0)).toList.map line) ++ line (total ops)
+
+end BLAS.AllocProfile
@@ -0,0 +1,120 @@
+set_option autoImplicit false
+
+namespace BLAS.Backend
+
+/-! # Backend and CPU Dispatch Information
+
+Reports which BLAS the C bindings were built against (`"system"`, or
+`"native"` for `lake build -K blas=native`), what the CPU supports and which
+variant each family of native kernels picked at run time. The values are fixed
+for the lifetime of the process, so `summary` is meant to be logged once at
+startup.
+-/
+
+/-- `"native"` or `"system"`. -/
+@[extern "leanblas_backend_name"]
+opaque backendName : Unit → String
+
+@[extern "leanblas_cpu_vendor"]
+opaque cpuVendor : Unit → String
+
+/-- Detected CPU features that the OS also enables, e.g. `#["sse4_1", "avx2", "fma"]`. -/
+@[extern "leanblas_cpu_features"]
+opaque cpuFeatures : Unit → Array String
+
+/-- `#[l1d, l2, l3]` cache sizes in bytes, `0` where unknown. -/
+@[extern "leanblas_cpu_caches"]
+opaque cpuCaches : Unit → Array Nat
+
+/-- `#[logical CPUs, physical cores, packages]` available to this process. -/
+@[extern "leanblas_cpu_topology"]
+opaque cpuTopology : Unit → Array Nat
+
+/-- `(family, variant)` for every native kernel family, e.g. `("dgemm", "avx512")`. -/
+@[extern "leanblas_kernel_selections"]
+opaque kernelSelections : Unit → Array (String × String)
+
+/-- Number of threads the native kernels and the reproducible mode use. -/
+@[extern "leanblas_native_threads"]
+opaque nativeThreads : IO USize
+
+/-- Overrides `LEANBLAS_NUM_THREADS` (and the default of one per physical core). -/
+@[extern "leanblas_set_native_threads"]
+opaque setNativeThreads (n : USize) : IO Unit
+
+/-- Threads of the system BLAS when it is OpenBLAS, 0 otherwise. -/
+@[extern "leanblas_system_threads"]
+opaque systemThreads : IO USize
+
+/-- Sets the threads of the system BLAS; `false` if it is not OpenBLAS. -/
+@[extern "leanblas_set_system_threads"]
+opaque setSystemThreads (n : USize) : IO Bool
+
+/-- Whether call graph replays and async `dgemv`/`dgemm` currently use the
+bitwise-reproducible routines, see `BLAS.Reproducible`. -/
+@[extern "leanblas_reproducible_enabled"]
+opaque reproducibleEnabled : IO Bool
+
+@[extern "leanblas_set_reproducible_enabled"]
+opaque setReproducibleEnabled (on : Bool) : IO Unit
+
+/-- CPU description as seen by the kernel dispatcher. -/
+structure CpuInfo where
+  vendor : String
+  features : Array String
+  l1dCache : Nat
+  l2Cache : Nat
+  l3Cache : Nat
+  logicalCpus : Nat
+  physicalCores : Nat
+  packages : Nat
+deriving Repr
+
+def cpuInfo : IO CpuInfo := do
+  let caches := cpuCaches ()
+  let topo := cpuTopology ()
+  return {
+    vendor := cpuVendor ()
+    features := cpuFeatures ()
+    l1dCache := caches[0]!
+    l2Cache := caches[1]!
+    l3Cache := caches[2]!
+    logicalCpus := topo[0]!
+    physicalCores := topo[1]!
+    packages := topo[2]!
+  }
+
+private def formatBytes (n : Nat) : String :=
+  if n == 0 then "?"
+  else if n % (1024 * 1024) == 0 then s!"{n / (1024 * 1024)}M"
+  else if n % 1024 == 0 then s!"{n / 1024}K"
+  else s!"{n}"
+
+/-- One line for startup logs, e.g.
+`backend=native cpu=GenuineIntel features=avx2,fma caches=48K/2M/32M cores=8/16 threads=8 reproducible=off kernels=dgemm:avx2,...` -/
+def summary : IO String := do
+  let cpu ← cpuInfo
+  let threads ← nativeThreads
+  let repro := if (← reproducibleEnabled) then "on" else "off"
+  let kernels := (kernelSelections ()).toList.map fun (f, v) => s!"{f}:{v}"
+  return s!"backend={backendName ()} cpu={cpu.vendor} features={",".intercalate cpu.features.toList} " ++
+    s!"caches={formatBytes cpu.l1dCache}/{formatBytes cpu.l2Cache}/{formatBytes cpu.l3Cache} " ++
+    s!"cores={cpu.physicalCores}/{cpu.logicalCpus} threads={threads} " ++
+    s!"reproducible={repro} " ++
+    s!"kernels={",".intercalate kernels}"
+
+/-- Threads the BLAS calls of this build run on: the native pool, or the system
+BLAS threads if it reports them. -/
+def blasThreads : IO (Option Nat) := do
+  if backendName () == "native" then return some (← nativeThreads).toNat
+  let n ← systemThreads
+  return if n == 0 then none else some n.toNat
+
+/-- Sets the threads of the BLAS this build calls; `false` if it cannot be set. -/
+def setBlasThreads (n : Nat) : IO Bool := do
+  if backendName () == "native" then
+    setNativeThreads n.toUSize
+    return true
+  setSystemThreads n.toUSize
+
+end BLAS.Backend
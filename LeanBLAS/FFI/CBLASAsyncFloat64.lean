@@ -0,0 +1,223 @@
+import LeanBLAS.FFI.FloatArray
+import LeanBLAS.Spec.LevelTwo
+
+set_option autoImplicit false
+
+namespace BLAS.CBLAS
+
+/-! # Asynchronous CBLAS Level 2/3 FFI Bindings for Float64
+
+Each `<op>Async` takes the arguments of the synchronous binding of the same name.
+It queues the call for a pool of C worker threads and returns at once with a
+`Task` that resolves to the output array, so independent BLAS calls can overlap
+with each other and with Lean-side work.
+
+* Inputs are taken by value: the job keeps them alive until the call finishes,
+  even if the caller drops its references.
+* The output array moves into the job. If it is shared, it is copied on
+  submission, so the caller's copy is never written to.
+* The queue is bounded (see `BLAS.Async.setQueueCapacity`). Submitting to a
+  full queue blocks until a worker picks up a job.
+* The task is the result of a promise that the worker resolves, so a pending
+  call holds no Lean thread.
+
+`dgemvAsync` and `dgemmAsync` honour the mode of `BLAS.Reproducible` as it was
+when the call was submitted.
+-/
+
+/-- Hands `f` a new promise for the output and returns the promise's task, which
+resolves when a worker finishes the job. -/
+private def submit (f : IO.Promise Float64Array → IO Unit) : IO (Task Float64Array) := do
+  let promise ← IO.Promise.new
+  f promise
+  return promise.result!
+
+@[extern "leanblas_async_dgemv"]
+private opaque dgemvSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (transA : Transpose) (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) (beta : Float)
+    (Y : Float64Array) (offY incY : USize) : IO Unit
+
+/-- General matrix-vector: Y := αAX + βY -/
+def dgemvAsync (order : Order) (transA : Transpose) (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) (beta : Float)
+    (Y : Float64Array) (offY incY : USize) : IO (Task Float64Array) :=
+  submit (dgemvSubmit · order transA M N alpha A offA lda X offX incX beta Y offY incY)
+
+@[extern "leanblas_async_dtrmv"]
+private opaque dtrmvSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) : IO Unit
+
+/-- Triangular matrix-vector multiply: X := op(A)X -/
+def dtrmvAsync (order : Order) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) : IO (Task Float64Array) :=
+  submit (dtrmvSubmit · order uplo transA diag N A offA lda X offX incX)
+
+@[extern "leanblas_async_dtrsv"]
+private opaque dtrsvSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) : IO Unit
+
+/-- Triangular solve: solve op(A)X = B for X, result stored in X. -/
+def dtrsvAsync (order : Order) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag) (N : USize)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (X : Float64Array) (offX incX : USize) : IO (Task Float64Array) :=
+  submit (dtrsvSubmit · order uplo transA diag N A offA lda X offX incX)
+
+@[extern "leanblas_async_dger"]
+private opaque dgerSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (M : USize) (N : USize) (alpha : Float)
+    (X : Float64Array) (offX incX : USize)
+    (Y : Float64Array) (offY incY : USize)
+    (A : Float64Array) (offA : USize) (lda : USize) : IO Unit
+
+/-- General rank-1 update: A := αXYᵀ + A -/
+def dgerAsync (order : Order) (M : USize) (N : USize) (alpha : Float)
+    (X : Float64Array) (offX incX : USize)
+    (Y : Float64Array) (offY incY : USize)
+    (A : Float64Array) (offA : USize) (lda : USize) : IO (Task Float64Array) :=
+  submit (dgerSubmit · order M N alpha X offX incX Y offY incY A offA lda)
+
+@[extern "leanblas_async_dgemm"]
+private opaque dgemmSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (transA : Transpose) (transB : Transpose)
+    (M : USize) (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO Unit
+
+/-- General matrix-matrix multiply: C := α*op(A)*op(B) + β*C -/
+def dgemmAsync (order : Order) (transA : Transpose) (transB : Transpose)
+    (M : USize) (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO (Task Float64Array) :=
+  submit (dgemmSubmit · order transA transB M N K alpha A offA lda B offB ldb beta C offC ldc)
+
+@[extern "leanblas_async_dsymm"]
+private opaque dsymmSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (side : Side) (uplo : UpLo)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO Unit
+
+/-- Symmetric matrix-matrix multiply: C := α*A*B + β*C or C := α*B*A + β*C -/
+def dsymmAsync (order : Order) (side : Side) (uplo : UpLo)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO (Task Float64Array) :=
+  submit (dsymmSubmit · order side uplo M N alpha A offA lda B offB ldb beta C offC ldc)
+
+@[extern "leanblas_async_dsyrk"]
+private opaque dsyrkSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (uplo : UpLo) (transA : Transpose)
+    (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO Unit
+
+/-- Symmetric rank-k update: C := α*A*Aᵀ + β*C or C := α*Aᵀ*A + β*C -/
+def dsyrkAsync (order : Order) (uplo : UpLo) (transA : Transpose)
+    (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO (Task Float64Array) :=
+  submit (dsyrkSubmit · order uplo transA N K alpha A offA lda beta C offC ldc)
+
+@[extern "leanblas_async_dsyr2k"]
+private opaque dsyr2kSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (uplo : UpLo) (transA : Transpose)
+    (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO Unit
+
+/-- Symmetric rank-2k update: C := α*A*Bᵀ + α*B*Aᵀ + β*C -/
+def dsyr2kAsync (order : Order) (uplo : UpLo) (transA : Transpose)
+    (N : USize) (K : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : IO (Task Float64Array) :=
+  submit (dsyr2kSubmit · order uplo transA N K alpha A offA lda B offB ldb beta C offC ldc)
+
+@[extern "leanblas_async_dtrmm"]
+private opaque dtrmmSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (side : Side) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) : IO Unit
+
+/-- Triangular matrix-matrix multiply: B := α*op(A)*B or B := α*B*op(A) -/
+def dtrmmAsync (order : Order) (side : Side) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) : IO (Task Float64Array) :=
+  submit (dtrmmSubmit · order side uplo transA diag M N alpha A offA lda B offB ldb)
+
+@[extern "leanblas_async_dtrsm"]
+private opaque dtrsmSubmit (promise : IO.Promise Float64Array)
+    (order : Order) (side : Side) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) : IO Unit
+
+/-- Triangular solve: solve op(A)*X = α*B or X*op(A) = α*B for X.
+    Solution overwrites B. -/
+def dtrsmAsync (order : Order) (side : Side) (uplo : UpLo)
+    (transA : Transpose) (diag : Diag)
+    (M : USize) (N : USize) (alpha : Float)
+    (A : Float64Array) (offA : USize) (lda : USize)
+    (B : Float64Array) (offB : USize) (ldb : USize) : IO (Task Float64Array) :=
+  submit (dtrsmSubmit · order side uplo transA diag M N alpha A offA lda B offB ldb)
+
+end BLAS.CBLAS
+
+namespace BLAS.Async
+
+/-! ## Worker Pool Configuration
+
+The pool starts with `LEANBLAS_ASYNC_THREADS` workers (default 2) and a queue of
+`LEANBLAS_ASYNC_QUEUE` jobs (default 16). Each job's BLAS call still uses the
+backend's own threads, so more workers mostly help when many small calls are
+in flight.
+-/
+
+structure Stats where
+  /-- Jobs waiting for a worker. -/
+  queued : Nat
+  /-- Jobs inside a BLAS call. -/
+  running : Nat
+  capacity : Nat
+  workers : Nat
+deriving Repr
+
+/-- `#[queued, running, capacity, workers]` -/
+@[extern "leanblas_async_stats"]
+opaque statsRaw : IO (Array Nat)
+
+def stats : IO Stats := do
+  let s ← statsRaw
+  return { queued := s[0]!, running := s[1]!, capacity := s[2]!, workers := s[3]! }
+
+/-- Maximum number of queued jobs before submissions block (at least 1). -/
+@[extern "leanblas_async_set_queue_capacity"]
+opaque setQueueCapacity (n : USize) : IO Unit
+
+/-- Number of worker threads (1 to 64). Extra workers exit once idle. -/
+@[extern "leanblas_async_set_workers"]
+opaque setWorkers (n : USize) : IO Unit
+
+end BLAS.Async
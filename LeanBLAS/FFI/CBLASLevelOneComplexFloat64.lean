@@ -43,6 +43,10 @@ opaque zswap (N : USize) (X : ComplexFloat64Array) (offX incX : USize)
 opaque zcopy (N : USize) (X : @& ComplexFloat64Array) (offX incX : USize)
              (Y : ComplexFloat64Array) (offY incY : USize) : ComplexFloat64Array
 
+/-- Copy within one vector: X[offY + i*incY] := X[offX + i*incX], views must not overlap -/
+@[extern "leanblas_cblas_zcopy_within"]
+opaque zcopyWithin (N : USize) (X : ComplexFloat64Array) (offX incX offY incY : USize) : ComplexFloat64Array
+
 /-- Scaled addition: Y := αX + Y -/
 @[extern "leanblas_cblas_zaxpy"]
 opaque zaxpy (N : USize) (alpha : ComplexFloat) (X : @& ComplexFloat64Array) (offX incX : USize)
@@ -76,6 +76,10 @@ opaque saxpby (N : USize) (alpha : Float) (X : Float32Array) (offX : USize) (inc
 @[extern "leanblas_cblas_sscaladd"]
 opaque sscaladd (N : USize) (alpha : Float) (X : Float32Array) (offX : USize) (incX : USize) (beta : Float) : Float32Array
 
+/-- Copy within one vector: X[offY + i*incY] := X[offX + i*incX], views must not overlap (single precision) -/
+@[extern "leanblas_cblas_scopy_within"]
+opaque scopyWithin (N : USize) (X : Float32Array) (offX incX offY incY : USize) : Float32Array
+
 /-- Index of max real value (single precision) -/
 @[extern "leanblas_cblas_simax_re"]
 opaque simaxRe (N : USize) (X : @&Float32Array) (offX : USize) (incX : USize) : USize
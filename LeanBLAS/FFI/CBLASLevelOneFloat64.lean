@@ -73,6 +73,10 @@ opaque daxpby (N : USize) (alpha : Float) (X : Float64Array) (offX : USize) (inc
 @[extern "leanblas_cblas_dscaladd"]
 opaque dscaladd (N : USize) (alpha : Float) (X : Float64Array) (offX : USize) (incX : USize) (beta : Float) : Float64Array
 
+/-- Copy within one vector: X[offY + i*incY] := X[offX + i*incX], views must not overlap -/
+@[extern "leanblas_cblas_dcopy_within"]
+opaque dcopyWithin (N : USize) (X : Float64Array) (offX incX offY incY : USize) : Float64Array
+
 /-- Index of max real value -/
 @[extern "leanblas_cblas_dimax_re"]
 opaque dimaxRe (N : USize) (X : @&Float64Array) (offX : USize) (incX : USize) : USize
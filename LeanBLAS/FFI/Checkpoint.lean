@@ -0,0 +1,97 @@
+import LeanBLAS.FFI.Npy
+
+set_option autoImplicit false
+
+namespace BLAS.Checkpoint
+
+/-! # Checkpoint Files
+
+A container for solver state: named `Float32Array`, `Float64Array` and
+`ComplexFloat64Array` buffers with their shape and order, written one by one
+and loaded all at once:
+
+```
+BLAS.Checkpoint.write "state.ckpt" fun w => do
+  w.add "x" ⟨x, #[n], .RowMajor⟩
+  w.add "A" ⟨A, #[m, n], .ColMajor⟩
+let f ← BLAS.Checkpoint.load "state.ckpt"
+let x ← f.get (α := Float64Array) "x"
+```
+
+`Writer.add` streams each payload to disk at once, so a checkpoint never has to
+fit in memory twice. Every payload starts on a 64-byte boundary and carries an
+XXH64 checksum, as does the index at the end of the file. The file is written
+as `PATH.tmp` and renamed by `Writer.finish`; a writer dropped without
+finishing removes it, so `PATH` always holds the last complete checkpoint.
+
+**Zero-copy loads.** With `mmap := true` (the default) the file is mapped
+privately and each `ByteArray` is built in place, as in `BLAS.Npy.load`: the
+arrays are persistent, the first write through any wrapper copies, and the
+mapping stays until the process exits. `verify := true` checks every payload's
+checksum, which reads the whole file; the index is always checked. Payloads are
+stored in native byte order, and a checkpoint written on a machine of the other
+byte order is rejected.
+-/
+
+open BLAS.Npy
+
+opaque WriterPointed : NonemptyType
+
+/-- A checkpoint being written. -/
+def Writer : Type := WriterPointed.type
+
+instance : Nonempty Writer := WriterPointed.property
+
+/-- Starts a checkpoint at `path`, writing to `path ++ ".tmp"` until `finish`. -/
+@[extern "leanblas_checkpoint_create"]
+opaque Writer.new (path : @& String) : IO Writer
+
+/-- Appends an array; names must be unique. -/
+@[extern "leanblas_checkpoint_add"]
+opaque Writer.addRaw (w : @& Writer) (name : @& String) (raw : @& Raw) : IO Unit
+
+/-- Writes the index and renames the file into place. -/
+@[extern "leanblas_checkpoint_finish"]
+opaque Writer.finish (w : @& Writer) : IO Unit
+
+def Writer.add {α : Type} [Element α] (w : Writer) (name : String) (a : NpyArray α) : IO Unit :=
+  w.addRaw name a.toRaw
+
+/-- Runs `f` on a new writer and finishes the checkpoint if it succeeds. -/
+def write {β : Type} (path : System.FilePath) (f : Writer → IO β) : IO β := do
+  let w ← Writer.new path.toString
+  let b ← f w
+  w.finish
+  return b
+
+/-- Writes a checkpoint of arrays of any types, via `NpyArray.toRaw`. -/
+def save (path : System.FilePath) (entries : Array (String × Raw)) : IO Unit :=
+  write path fun w => entries.forM fun (name, raw) => w.addRaw name raw
+
+@[extern "leanblas_checkpoint_load"]
+opaque loadRaw (path : @& String) (mmap verify : Bool) : IO (Array (String × Raw))
+
+/-- The arrays of a checkpoint, in the order they were written. -/
+structure File where
+  path : String
+  arrays : Array (String × Raw)
+
+def load (path : System.FilePath) (mmap := true) (verify := true) : IO File := do
+  return { path := path.toString, arrays := ← loadRaw path.toString mmap verify }
+
+def File.names (f : File) : Array String := f.arrays.map (·.1)
+
+def File.getRaw? (f : File) (name : String) : Option Raw :=
+  (f.arrays.find? (·.1 == name)).map (·.2)
+
+def File.get {α : Type} [Element α] (f : File) (name : String) : IO (NpyArray α) := do
+  let some r := f.getRaw? name
+    | throw $ IO.userError s!"{f.path}: no array '{name}'"
+  NpyArray.ofRaw s!"{f.path}: {name}" r
+
+/-- Whether the data of `a` starts on a 64-byte boundary, as every non-empty
+array of a checkpoint loaded with `mmap := true` does. -/
+@[extern "leanblas_checkpoint_is_aligned"]
+opaque isAligned (a : @& ByteArray) : Bool
+
+end BLAS.Checkpoint
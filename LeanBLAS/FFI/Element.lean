@@ -0,0 +1,38 @@
+import LeanBLAS.FFI.FloatArray
+
+set_option autoImplicit false
+
+namespace BLAS
+
+/-! # Array Element Types
+
+The array types the file readers and writers (`BLAS.Npy`, `BLAS.MatrixMarket`,
+`BLAS.Checkpoint`, `BLAS.Safetensors`) load into and save from. Each format
+maps the NumPy dtype code to its own type names and rejects the types it
+cannot store.
+-/
+
+/-- An array type stored as a `ByteArray` of native elements. -/
+class Element (α : Type) where
+  /-- NumPy dtype code of an element: `"f4"`, `"f8"` or `"c16"`. -/
+  dtype : String
+  /-- `none` if the size is not a multiple of the element size. -/
+  ofBytes? : ByteArray → Option α
+  toBytes : α → ByteArray
+
+instance : Element Float64Array where
+  dtype := "f8"
+  ofBytes? b := if h : b.size % 8 = 0 then some ⟨b, h⟩ else none
+  toBytes a := a.data
+
+instance : Element Float32Array where
+  dtype := "f4"
+  ofBytes? b := if h : b.size % 4 = 0 then some ⟨b, h⟩ else none
+  toBytes a := a.data
+
+instance : Element ComplexFloat64Array where
+  dtype := "c16"
+  ofBytes? b := if h : b.size % 16 = 0 then some ⟨b, h⟩ else none
+  toBytes a := a.data
+
+end BLAS
@@ -0,0 +1,133 @@
+import LeanBLAS.FFI.Element
+import LeanBLAS.Spec.LevelTwo
+
+set_option autoImplicit false
+
+namespace BLAS.MatrixMarket
+
+/-! # Matrix Market Files
+
+Reads and writes Matrix Market (`.mtx`) files, dense (`array`) and sparse
+(`coordinate`), as `Float64Array` or `ComplexFloat64Array`:
+
+```
+let A ← BLAS.MatrixMarket.readDense (α := Float64Array) "A.mtx" (order := .ColMajor)
+let S ← BLAS.MatrixMarket.readCSR (α := Float64Array) "S.mtx"
+BLAS.MatrixMarket.writeCSR "T.mtx" S
+```
+
+Either kind of file can be read either way: a `coordinate` file read dense is
+scattered into a zero matrix, and an `array` file read as CSR keeps its nonzero
+entries. Symmetric, skew-symmetric and Hermitian files are expanded to the full
+matrix, duplicate entries are summed, and `pattern` entries read as 1. Real and
+integer files can be read into `ComplexFloat64Array`; complex files only into
+`ComplexFloat64Array`. Files are written as `general` with every value
+round-tripping exactly.
+
+The entries are parsed in parallel chunks on the native thread pool (see
+`BLAS.Backend.setNativeThreads`) from a mapping of the file, and written the
+same way.
+-/
+
+/-- The banner and size line of a file. -/
+structure Header where
+  /-- `"coordinate"` or `"array"` -/
+  format : String
+  /-- `"real"`, `"integer"`, `"complex"` or `"pattern"` -/
+  field : String
+  /-- `"general"`, `"symmetric"`, `"skew-symmetric"` or `"hermitian"` -/
+  symmetry : String
+  rows : Nat
+  cols : Nat
+  /-- Entries stored in the file, before expanding symmetric matrices. -/
+  entries : Nat
+deriving Repr, BEq
+
+/-- Native `UInt64` indices, as used by `CSR`. -/
+structure IndexArray where
+  data : ByteArray
+  h_size : data.size % 8 = 0
+
+def IndexArray.size (a : IndexArray) : Nat := a.data.size / 8
+
+/-- Entry `i`, or `0` past the end. -/
+@[extern "leanblas_index_array_get"]
+opaque IndexArray.get (a : @& IndexArray) (i : USize) : UInt64
+
+def IndexArray.toArray (a : IndexArray) : Array Nat :=
+  (Array.range a.size).map fun i => (a.get i.toUSize).toNat
+
+/-- Compressed sparse rows: the entries of row `i` are `rowPtr[i]` up to
+`rowPtr[i+1]`, with 0-based column indices in `colIdx` and values in `values`. -/
+structure CSR (α : Type) where
+  rows : Nat
+  cols : Nat
+  rowPtr : IndexArray
+  colIdx : IndexArray
+  values : α
+
+/-- A dense `rows × cols` matrix stored without padding in `order`. -/
+structure Dense (α : Type) where
+  rows : Nat
+  cols : Nat
+  data : α
+  order : Order := .ColMajor
+
+structure RawCSR where
+  header : Header
+  rowPtr : ByteArray
+  colIdx : ByteArray
+  values : ByteArray
+
+@[extern "leanblas_mm_read_header"]
+opaque readHeader (path : @& String) : IO Header
+
+@[extern "leanblas_mm_read_dense"]
+opaque readDenseRaw (path : @& String) (complex : Bool) (order : Order) : IO (Header × ByteArray)
+
+@[extern "leanblas_mm_read_csr"]
+opaque readCSRRaw (path : @& String) (complex : Bool) : IO RawCSR
+
+@[extern "leanblas_mm_write_dense"]
+opaque writeDenseRaw (path : @& String) (rows cols : @& Nat) (order : Order) (data : @& ByteArray)
+  (complex : Bool) : IO Unit
+
+@[extern "leanblas_mm_write_csr"]
+opaque writeCSRRaw (path : @& String) (rows cols : @& Nat) (rowPtr colIdx values : @& ByteArray)
+  (complex : Bool) : IO Unit
+
+/-- Whether `α` holds complex values; Matrix Market arrays are `Float64Array` or
+`ComplexFloat64Array`. -/
+private def complex (α : Type) [Element α] (what : String) : IO Bool :=
+  match Element.dtype α with
+  | "f8" => pure false
+  | "c16" => pure true
+  | d => throw $ IO.userError s!"{what}: Matrix Market values are read as f8 or c16, not {d}"
+
+private def ofBytes {α : Type} [Element α] (what : String) (b : ByteArray) : IO α :=
+  match Element.ofBytes? b with
+  | some a => pure a
+  | none => throw $ IO.userError s!"{what}: data size is not a multiple of the element size"
+
+private def indices (what : String) (b : ByteArray) : IO IndexArray :=
+  if h : b.size % 8 = 0 then pure ⟨b, h⟩
+  else throw $ IO.userError s!"{what}: index size is not a multiple of 8"
+
+def readDense {α : Type} [Element α] (path : System.FilePath) (order : Order := .ColMajor) : IO (Dense α) := do
+  let (h, data) ← readDenseRaw path.toString (← complex α path.toString) order
+  return { rows := h.rows, cols := h.cols, data := ← ofBytes path.toString data, order }
+
+def readCSR {α : Type} [Element α] (path : System.FilePath) : IO (CSR α) := do
+  let r ← readCSRRaw path.toString (← complex α path.toString)
+  return { rows := r.header.rows, cols := r.header.cols,
+           rowPtr := ← indices path.toString r.rowPtr, colIdx := ← indices path.toString r.colIdx,
+           values := ← ofBytes path.toString r.values }
+
+def writeDense {α : Type} [Element α] (path : System.FilePath) (A : Dense α) : IO Unit := do
+  writeDenseRaw path.toString A.rows A.cols A.order (Element.toBytes A.data) (← complex α path.toString)
+
+def writeCSR {α : Type} [Element α] (path : System.FilePath) (A : CSR α) : IO Unit := do
+  writeCSRRaw path.toString A.rows A.cols A.rowPtr.data A.colIdx.data (Element.toBytes A.values)
+    (← complex α path.toString)
+
+end BLAS.MatrixMarket
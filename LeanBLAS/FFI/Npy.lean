@@ -0,0 +1,100 @@
+import LeanBLAS.FFI.Element
+import LeanBLAS.Spec.LevelTwo
+
+set_option autoImplicit false
+
+namespace BLAS.Npy
+
+/-! # NumPy `.npy` and `.npz` Files
+
+Reads and writes `Float32Array`, `Float64Array` and `ComplexFloat64Array` in
+NumPy's formats, so data moves between Lean and Python without conversion:
+
+```
+let A ← BLAS.Npy.load (α := Float64Array) "A.npy"     -- np.save("A.npy", a)
+BLAS.Npy.save "x.npy" ⟨x, #[n], .RowMajor⟩             -- np.load("x.npy")
+let names ← BLAS.Npy.npzNames "data.npz"               -- np.savez("data.npz", A=a, b=b)
+let b ← BLAS.Npy.loadNpz (α := Float64Array) "data.npz" "b"
+```
+
+The dtype must be `float32`, `float64` or `complex128` and match the requested
+array type; arrays in the other byte order are swapped on load. `fortran_order`
+maps to `Order`: `True` is `.ColMajor` and `False` is `.RowMajor`. Files are
+always written in native byte order.
+
+**Zero-copy loads.** With `mmap := true` (the default) an uncompressed array in
+native byte order is not read but mapped: the `ByteArray` lives in a private
+mapping of the file and pages are read on first access. The array is
+persistent, so the first write through any wrapper copies it, and the file is
+never modified. The mapping stays until the process exits, and the file must
+not be truncated while it is in use. `.npz` entries are mapped when stored
+uncompressed at an 8-byte-aligned offset; others are read or inflated.
+Compressed archives (`np.savez_compressed`) need zlib, which `blas=native`
+builds leave out unless built with `-K zlib=on` (see `compressionAvailable`).
+-/
+
+/-- An array as stored in a `.npy` file, with its data in native byte order. -/
+structure Raw where
+  /-- `"f4"`, `"f8"` or `"c16"` -/
+  dtype : String
+  shape : Array Nat
+  data : ByteArray
+  fortranOrder : Bool
+
+@[extern "leanblas_npy_read"]
+opaque readRaw (path : @& String) (mmap : Bool) : IO Raw
+
+@[extern "leanblas_npy_write"]
+opaque writeRaw (path : @& String) (raw : @& Raw) : IO Unit
+
+/-- Names of the arrays in an `.npz` archive, without the `.npy` suffix. -/
+@[extern "leanblas_npz_names"]
+opaque npzNames (path : @& String) : IO (Array String)
+
+@[extern "leanblas_npz_read"]
+opaque readNpzRaw (path : @& String) (name : @& String) (mmap : Bool) : IO Raw
+
+/-- Whether this build can read and write compressed `.npz` archives. -/
+@[extern "leanblas_npz_compression_available"]
+opaque compressionAvailable : Unit → Bool
+
+@[extern "leanblas_npz_write"]
+opaque writeNpzRaw (path : @& String) (entries : @& Array (String × Raw)) (compress : Bool) : IO Unit
+
+/-- An array with its shape and memory order. -/
+structure NpyArray (α : Type) where
+  data : α
+  shape : Array Nat
+  order : Order := .RowMajor
+
+def orderOf (fortranOrder : Bool) : Order :=
+  if fortranOrder then .ColMajor else .RowMajor
+
+def NpyArray.toRaw {α : Type} [Element α] (a : NpyArray α) : Raw :=
+  { dtype := Element.dtype α, shape := a.shape, data := Element.toBytes a.data,
+    fortranOrder := a.order == .ColMajor }
+
+def NpyArray.ofRaw {α : Type} [Element α] (what : String) (r : Raw) : IO (NpyArray α) := do
+  unless r.dtype == Element.dtype α do
+    throw $ IO.userError s!"{what}: dtype is {r.dtype}, expected {Element.dtype α}"
+  let some data := Element.ofBytes? r.data
+    | throw $ IO.userError s!"{what}: data size is not a multiple of the element size"
+  return { data, shape := r.shape, order := orderOf r.fortranOrder }
+
+def load {α : Type} [Element α] (path : System.FilePath) (mmap := true) : IO (NpyArray α) := do
+  NpyArray.ofRaw path.toString (← readRaw path.toString mmap)
+
+def save {α : Type} [Element α] (path : System.FilePath) (a : NpyArray α) : IO Unit :=
+  writeRaw path.toString a.toRaw
+
+/-- The array `name` of an `.npz` archive. -/
+def loadNpz {α : Type} [Element α] (path : System.FilePath) (name : String) (mmap := true) :
+    IO (NpyArray α) := do
+  NpyArray.ofRaw s!"{path}: {name}" (← readNpzRaw path.toString name mmap)
+
+/-- Writes an `.npz` archive, deflated if `compress` (as `np.savez_compressed`).
+Arrays of different types go in together via `NpyArray.toRaw`. -/
+def saveNpz (path : System.FilePath) (entries : Array (String × Raw)) (compress := false) : IO Unit :=
+  writeNpzRaw path.toString entries compress
+
+end BLAS.Npy
@@ -0,0 +1,119 @@
+set_option autoImplicit false
+
+namespace BLAS.Perf
+
+/-! # Hardware Performance Counters
+
+Counts cycles, instructions, last-level cache misses, data TLB misses and
+retired floating point operations around a region of code with Linux
+`perf_event_open`, for the calling thread only. Work a threaded call hands to
+the native or OpenBLAS thread pool is not counted, so measure with one thread
+(`BLAS.Backend.setNativeThreads 1`, `BLAS.Backend.setSystemThreads 1`) to
+count a whole call.
+
+Each event is optional: it reads as `none` if the CPU does not have it, the
+kernel does not expose it (e.g. in most containers and VMs, or with a
+restrictive `/proc/sys/kernel/perf_event_paranoid`), or on other systems.
+Nothing fails when counters are unavailable, so measurements can stay in
+place everywhere.
+
+```
+let (y, c) ← BLAS.Perf.measure do
+  return LevelTwoData.gemv .RowMajor .NoTrans m n 1.0 A 0 n x 0 1 0.0 y 0 1
+IO.println c
+```
+
+`fpOps` counts retired floating point operations on AMD and retired FP
+arithmetic instructions on Intel, where one packed instruction counts once
+whatever its width, so compare it with the flop count only on AMD.
+-/
+
+opaque SessionPointed : NonemptyType
+
+/-- Open counters, closed when the session is freed. -/
+def Session : Type := SessionPointed.type
+
+instance : Nonempty Session := SessionPointed.property
+
+/-- Opens every event this machine allows; stopped until `Session.start`. -/
+@[extern "leanblas_perf_session_open"]
+opaque Session.new : IO Session
+
+/-- Resets the counters and starts counting. -/
+@[extern "leanblas_perf_session_start"]
+opaque Session.start (s : @& Session) : IO Unit
+
+/-- Number of events the session could open, out of five. -/
+@[extern "leanblas_perf_session_events"]
+opaque Session.events (s : @& Session) : IO USize
+
+/-- Stops counting and returns cycles, instructions, LLC misses, dTLB misses
+and FP operations since `start`. -/
+@[extern "leanblas_perf_session_stop"]
+opaque Session.stopRaw (s : @& Session) : IO (Array (Option UInt64))
+
+structure Counters where
+  cycles : Option Nat := none
+  instructions : Option Nat := none
+  llcMisses : Option Nat := none
+  dtlbMisses : Option Nat := none
+  fpOps : Option Nat := none
+  /-- Wall-clock time of the region. -/
+  elapsedNs : Nat := 0
+deriving Repr, Inhabited
+
+namespace Counters
+
+/-- Whether at least one event was counted. -/
+def any (c : Counters) : Bool :=
+  c.cycles.isSome || c.instructions.isSome || c.llcMisses.isSome || c.dtlbMisses.isSome || c.fpOps.isSome
+
+/-- Instructions per cycle. -/
+def ipc (c : Counters) : Option Float := do
+  let cyc ← c.cycles
+  let ins ← c.instructions
+  if cyc == 0 then none else pure (ins.toFloat / cyc.toFloat)
+
+/-- Average clock frequency while the region ran. -/
+def ghz (c : Counters) : Option Float := do
+  let cyc ← c.cycles
+  if c.elapsedNs == 0 then none else pure (cyc.toFloat / c.elapsedNs.toFloat)
+
+/-- Every count divided by `n`, e.g. per call of a loop of `n` calls. -/
+def perCall (c : Counters) (n : Nat) : Counters :=
+  let d := fun (x : Option Nat) => x.map (· / max n 1)
+  { cycles := d c.cycles, instructions := d c.instructions, llcMisses := d c.llcMisses
+    dtlbMisses := d c.dtlbMisses, fpOps := d c.fpOps, elapsedNs := c.elapsedNs / max n 1 }
+
+instance : ToString Counters where
+  toString c :=
+    let item := fun (name : String) (x : Option Nat) => x.map (s!"{name} {·}")
+    let parts := [item "cycles" c.cycles, item "instructions" c.instructions,
+      c.ipc.map (s!"IPC {·}"), item "LLC misses" c.llcMisses, item "dTLB misses" c.dtlbMisses,
+      item "FP ops" c.fpOps, c.ghz.map (s!"{·} GHz")].filterMap id
+    if parts.isEmpty then "counters unavailable" else ", ".intercalate parts
+
+end Counters
+
+/-- Stops the session and returns the counts since `start`, with `elapsedNs` set by the caller. -/
+def Session.stop (s : Session) (elapsedNs : Nat := 0) : IO Counters := do
+  let v := (← s.stopRaw).map (·.map UInt64.toNat)
+  let get := fun (i : Nat) => (v[i]?).bind id
+  return { cycles := get 0, instructions := get 1, llcMisses := get 2, dtlbMisses := get 3
+           fpOps := get 4, elapsedNs }
+
+/-- Counts around `x` with a fresh session. -/
+def measure {α : Type} (x : IO α) : IO (α × Counters) := do
+  let s ← Session.new
+  s.start
+  let t0 ← IO.monoNanosNow
+  let a ← x
+  let t1 ← IO.monoNanosNow
+  let c ← s.stop (t1 - t0)
+  return (a, c)
+
+/-- Whether any counter can be read on this machine. -/
+def available : IO Bool := do
+  return (← (← Session.new).events) > 0
+
+end BLAS.Perf
@@ -0,0 +1,75 @@
+import LeanBLAS.FFI.Backend
+import LeanBLAS.FFI.FloatArray
+import LeanBLAS.Spec.LevelTwo
+
+set_option autoImplicit false
+
+namespace BLAS.Reproducible
+
+/-! # Bitwise-Reproducible Operations
+
+`ddot`, `dsum`, `dasum`, `dnrm2`, `dgemv` and `dgemm` below take the arguments of
+the `BLAS.CBLAS` bindings of the same name and return results that depend only
+on their inputs. They do not change with the thread count, the selected SIMD
+kernels or the BLAS backend, so convergence checks and regression comparisons
+stay stable across machines.
+
+* The Level 1 reductions use binned summation (in the style of ReproBLAS). The
+  result is the same for any order of the elements, and no less accurate than a
+  plain sequential sum.
+* `dgemv` and `dgemm` compute every output element as `alpha` times the sequential
+  sum over the inner index, with no FMA contraction, plus `beta` times the old
+  value.
+
+Expect roughly 2-3× the time of the optimized routines.
+
+## Reproducible Mode
+
+The `BLAS.CBLAS` bindings are pure and always use the backend. The process-wide
+mode set by `setEnabled` (or `LEANBLAS_REPRODUCIBLE=1` at startup) only switches
+the `IO` entry points that run these operations to the reproducible routines:
+`BLAS.CallGraph.Graph.replay` and `dgemvAsync`/`dgemmAsync`. It is off by default.
+-/
+
+/-- Dot product: result = X · Y -/
+@[extern "leanblas_reproducible_ddot"]
+opaque ddot (N : USize) (X : @& Float64Array) (offX incX : USize) (Y : @& Float64Array) (offY incY : USize) : Float
+
+/-- Sum of elements: result = Σ X[i] -/
+@[extern "leanblas_reproducible_dsum"]
+opaque dsum (N : USize) (X : @& Float64Array) (offX incX : USize) : Float
+
+/-- Sum of absolute values: result = Σ|X[i]| -/
+@[extern "leanblas_reproducible_dasum"]
+opaque dasum (N : USize) (X : @& Float64Array) (offX incX : USize) : Float
+
+/-- Euclidean norm: result = ||X||₂ -/
+@[extern "leanblas_reproducible_dnrm2"]
+opaque dnrm2 (N : USize) (X : @& Float64Array) (offX incX : USize) : Float
+
+/-- General matrix-vector multiply: Y := αAX + βY -/
+@[extern "leanblas_reproducible_dgemv"]
+opaque dgemv (order : Order) (transA : Transpose) (M : USize) (N : USize) (alpha : Float)
+    (A : @& Float64Array) (offA : USize) (lda : USize)
+    (X : @& Float64Array) (offX incX : USize) (beta : Float)
+    (Y : Float64Array) (offY incY : USize) : Float64Array
+
+/-- General matrix-matrix multiply: C := α*op(A)*op(B) + β*C -/
+@[extern "leanblas_reproducible_dgemm"]
+opaque dgemm (order : Order) (transA : Transpose) (transB : Transpose)
+    (M : USize) (N : USize) (K : USize) (alpha : Float)
+    (A : @& Float64Array) (offA : USize) (lda : USize)
+    (B : @& Float64Array) (offB : USize) (ldb : USize) (beta : Float)
+    (C : Float64Array) (offC : USize) (ldc : USize) : Float64Array
+
+def isEnabled : IO Bool := BLAS.Backend.reproducibleEnabled
+
+def setEnabled (on : Bool) : IO Unit := BLAS.Backend.setReproducibleEnabled on
+
+/-- Runs `act` in reproducible mode and restores the previous mode afterwards. -/
+def withEnabled {α : Type} (act : IO α) : IO α := do
+  let before ← isEnabled
+  setEnabled true
+  try act finally setEnabled before
+
+end BLAS.Reproducible
@@ -0,0 +1,126 @@
+import LeanBLAS.FFI.Npy
+
+set_option autoImplicit false
+
+namespace BLAS.Safetensors
+
+/-! # Safetensors Files
+
+Reads and writes `.safetensors` model weights as `Float32Array` and
+`Float64Array`:
+
+```
+let f ← BLAS.Safetensors.load "model.safetensors"
+let W ← f.get (α := Float32Array) "layers.0.attn.q_proj.weight"   -- W.data, W.shape
+BLAS.Safetensors.save "out.safetensors" #[("W", W)] (metadata := #[("format", "pt")])
+```
+
+**Zero-copy loads.** With `mmap := true` (the default) every `F32` and `F64`
+tensor is a `ByteArray` built in place in a private mapping of the file, so
+loading costs the header parse and one `mmap` per tensor whatever the size of
+the model; pages are read on first access. The arrays are persistent, the first
+write through any wrapper copies, and the mappings stay until the process
+exits. `F16` and `BF16` tensors are widened to `F32` on load (on the native
+thread pool) and read as `Float32Array`. Tensors of other dtypes keep their
+bytes and dtype, for `File.getRaw?`.
+
+Tensors are row-major and little-endian, and are only read on little-endian
+machines. `Writer` streams a file tensor by tensor after declaring every name,
+dtype and shape up front (the header comes first in the file); it writes
+`PATH.tmp` and renames it when complete.
+-/
+
+open BLAS.Npy
+
+/-- A tensor as read: its dtype in the file, its shape, and its bytes, with
+`F16` and `BF16` already widened to `F32` (and `dtype` set to `"F32"`). -/
+structure Tensor where
+  /-- `"F64"`, `"F32"`, `"I64"`, `"U8"`, ... -/
+  dtype : String
+  shape : Array Nat
+  data : ByteArray
+
+/-- A tensor to be written. -/
+structure Info where
+  dtype : String
+  shape : Array Nat
+
+@[extern "leanblas_safetensors_read"]
+opaque readRaw (path : @& String) (mmap : Bool) : IO (Array (String × Tensor) × Array (String × String))
+
+/-- The safetensors dtype of `α`: tensors are read into and written from
+`Float32Array` and `Float64Array`. -/
+private def dtypeOf (α : Type) [Element α] (what : String) : IO String :=
+  match Element.dtype α with
+  | "f4" => pure "F32"
+  | "f8" => pure "F64"
+  | d => throw $ IO.userError s!"{what}: no safetensors dtype for {d}"
+
+/-- The tensors of a file, in file order, and its `__metadata__`. -/
+structure File where
+  path : String
+  tensors : Array (String × Tensor)
+  metadata : Array (String × String)
+
+def load (path : System.FilePath) (mmap := true) : IO File := do
+  let (tensors, metadata) ← readRaw path.toString mmap
+  return { path := path.toString, tensors, metadata }
+
+def File.names (f : File) : Array String := f.tensors.map (·.1)
+
+def File.getRaw? (f : File) (name : String) : Option Tensor :=
+  (f.tensors.find? (·.1 == name)).map (·.2)
+
+/-- Tensor `name` as a row-major array. -/
+def File.get {α : Type} [Element α] (f : File) (name : String) : IO (NpyArray α) := do
+  let some t := f.getRaw? name
+    | throw $ IO.userError s!"{f.path}: no tensor '{name}'"
+  let dtype ← dtypeOf α s!"{f.path}: {name}"
+  unless t.dtype == dtype do
+    throw $ IO.userError s!"{f.path}: {name}: dtype is {t.dtype}, expected {dtype}"
+  let some data := Element.ofBytes? t.data
+    | throw $ IO.userError s!"{f.path}: {name}: data size is not a multiple of the element size"
+  return { data, shape := t.shape, order := .RowMajor }
+
+opaque WriterPointed : NonemptyType
+
+/-- A file being written. -/
+def Writer : Type := WriterPointed.type
+
+instance : Nonempty Writer := WriterPointed.property
+
+/-- Starts a file holding `tensors`, to be written in this order. -/
+@[extern "leanblas_safetensors_create"]
+opaque Writer.new (path : @& String) (tensors : @& Array (String × Info))
+  (metadata : @& Array (String × String)) : IO Writer
+
+/-- Writes the bytes of the next tensor, which must be `name`. -/
+@[extern "leanblas_safetensors_add"]
+opaque Writer.addBytes (w : @& Writer) (name : @& String) (data : @& ByteArray) : IO Unit
+
+/-- Checks that every tensor was written and renames the file into place. -/
+@[extern "leanblas_safetensors_finish"]
+opaque Writer.finish (w : @& Writer) : IO Unit
+
+def Writer.add {α : Type} [Element α] (w : Writer) (name : String) (a : α) : IO Unit :=
+  w.addBytes name (Element.toBytes a)
+
+/-- Runs `f` on a new writer and finishes the file if it succeeds. -/
+def write {β : Type} (path : System.FilePath) (tensors : Array (String × Info))
+    (metadata : Array (String × String) := #[]) (f : Writer → IO β) : IO β := do
+  let w ← Writer.new path.toString tensors metadata
+  let b ← f w
+  w.finish
+  return b
+
+/-- Writes row-major arrays of one type. -/
+def save {α : Type} [Element α] (path : System.FilePath) (tensors : Array (String × NpyArray α))
+    (metadata : Array (String × String) := #[]) : IO Unit := do
+  for (name, a) in tensors do
+    unless a.order == .RowMajor do
+      throw $ IO.userError s!"{path}: {name}: safetensors tensors are row-major"
+  let dtype ← dtypeOf α path.toString
+  let infos := tensors.map fun (name, a) => (name, { dtype, shape := a.shape : Info })
+  write path infos metadata fun w => tensors.forM fun (name, a) => w.add name a.data
+
+end BLAS.Safetensors
@@ -0,0 +1,136 @@
+set_option autoImplicit false
+
+namespace BLAS.Stream
+
+/-! # Streaming Level 1 Pipelines
+
+Runs Level 1 steps over vectors stored in raw binary files (native-endian
+`Float64` values with no header, as written by `IO.FS.writeBinFile path
+a.data` for a `Float64Array a`), one chunk at a time, so the vectors never
+have to fit in memory:
+
+```
+-- ‖x‖, x·y and y ← 2x + y, written to z.bin, in one pass over the files
+let r ← BLAS.Stream.run { x := "x.bin", y := some "y.bin", output := some (.y, "z.bin")
+                          steps := #[.nrm2 .x, .dot, .axpy 2.0] }
+-- r = #[‖x‖, x·y]
+```
+
+A pipeline reads `x` and optionally `y` (which reads as zeros when absent) in
+chunks of `chunk` elements. A background thread prefetches the next chunk into
+a second buffer while the current one is processed and writes the previous one
+back, so I/O and compute overlap. Each chunk is split across the native thread
+pool (see `BLAS.Backend.setNativeThreads`), and every task applies all steps,
+in order, to cache-sized blocks.
+
+Reductions (`dot`, `nrm2`, `asum`, `sum`) accumulate across chunks and return
+their results in step order; `nrm2` is scaled so that it does not overflow.
+Results are deterministic for a given chunk size and thread count. The output
+can be one of the inputs, in which case it is updated in place.
+-/
+
+/-- Which vector a step applies to. -/
+inductive Vec where
+  | x | y
+deriving Inhabited, BEq, Repr
+
+/-- Pipeline steps, in the order of the opcodes in `c/stream.c`. -/
+inductive Step where
+  /-- y ← x -/
+  | copy
+  /-- y ← αx + y -/
+  | axpy (alpha : Float)
+  /-- v ← αv -/
+  | scal (v : Vec) (alpha : Float)
+  /-- y ← αx + βy -/
+  | axpby (alpha beta : Float)
+  /-- v ← αv + β -/
+  | scaladd (v : Vec) (alpha beta : Float)
+  /-- v ← α -/
+  | const (v : Vec) (alpha : Float)
+  /-- y ← x ⊙ y -/
+  | mul
+  | abs (v : Vec)
+  | sqrt (v : Vec)
+  | exp (v : Vec)
+  | log (v : Vec)
+  | sin (v : Vec)
+  | cos (v : Vec)
+  /-- v ← 1 / v -/
+  | inv (v : Vec)
+  /-- x · y -/
+  | dot
+  | nrm2 (v : Vec)
+  | asum (v : Vec)
+  | sum (v : Vec)
+deriving Inhabited, Repr
+
+private def Vec.code : Vec → USize
+  | .x => 0
+  | .y => 1
+
+/-- Opcode, vector, alpha and beta. -/
+private def Step.encode : Step → USize × Vec × Float × Float
+  | .copy => (0, .x, 0, 0)
+  | .axpy a => (1, .x, a, 0)
+  | .scal v a => (2, v, a, 0)
+  | .axpby a b => (3, .x, a, b)
+  | .scaladd v a b => (4, v, a, b)
+  | .const v a => (5, v, a, 0)
+  | .mul => (6, .x, 0, 0)
+  | .abs v => (7, v, 0, 0)
+  | .sqrt v => (8, v, 0, 0)
+  | .exp v => (9, v, 0, 0)
+  | .log v => (10, v, 0, 0)
+  | .sin v => (11, v, 0, 0)
+  | .cos v => (12, v, 0, 0)
+  | .inv v => (13, v, 0, 0)
+  | .dot => (14, .x, 0, 0)
+  | .nrm2 v => (15, v, 0, 0)
+  | .asum v => (16, v, 0, 0)
+  | .sum v => (17, v, 0, 0)
+
+structure Pipeline where
+  x : System.FilePath
+  /-- Must have the same size as `x`; zeros if `none`. -/
+  y : Option System.FilePath := none
+  steps : Array Step
+  /-- Where to write `x` or `y` after the steps; may be `x` or `y` itself. -/
+  output : Option (Vec × System.FilePath) := none
+  /-- Elements per chunk; two chunks of `x` and of `y` are in memory at once. -/
+  chunk : Nat := 1 <<< 20
+
+@[extern "leanblas_stream_run"]
+private opaque runRaw (paths : @& Array String) (outVec : Bool) (code : @& Array USize) (consts : @& FloatArray)
+  (chunk : USize) : IO FloatArray
+
+/-- Runs the pipeline and returns the results of its reduction steps, in order. -/
+def run (p : Pipeline) : IO (Array Float) := do
+  let steps := p.steps.map Step.encode
+  let code := steps.foldl (fun c (op, v, _, _) => c.push op |>.push v.code) #[]
+  let consts := steps.foldl (fun c (_, _, a, b) => c.push a |>.push b) FloatArray.empty
+  let paths := #[p.x.toString, (p.y.map (·.toString)).getD "", (p.output.map (·.2.toString)).getD ""]
+  let outVec := (p.output.map (·.1 == .y)).getD false
+  return (← runRaw paths outVec code consts p.chunk.toUSize).data
+
+private def reduce (x : System.FilePath) (y : Option System.FilePath) (step : Step) (chunk : Nat) :
+    IO Float := do
+  return (← run { x, y, steps := #[step], chunk })[0]!
+
+def dot (x y : System.FilePath) (chunk : Nat := 1 <<< 20) : IO Float := reduce x (some y) .dot chunk
+
+def nrm2 (x : System.FilePath) (chunk : Nat := 1 <<< 20) : IO Float := reduce x none (.nrm2 .x) chunk
+
+def asum (x : System.FilePath) (chunk : Nat := 1 <<< 20) : IO Float := reduce x none (.asum .x) chunk
+
+/-- `out ← αx`, in place by default. -/
+def scal (alpha : Float) (x : System.FilePath) (out : System.FilePath := x) (chunk : Nat := 1 <<< 20) :
+    IO Unit := do
+  let _ ← run { x, steps := #[.scal .x alpha], output := some (.x, out), chunk }
+
+/-- `out ← αx + y`, into `y` by default. -/
+def axpy (alpha : Float) (x y : System.FilePath) (out : System.FilePath := y) (chunk : Nat := 1 <<< 20) :
+    IO Unit := do
+  let _ ← run { x, y := some y, steps := #[.axpy alpha], output := some (.y, out), chunk }
+
+end BLAS.Stream
@@ -0,0 +1,62 @@
+set_option autoImplicit false
+
+namespace BLAS.Trace
+
+/-! # Per-Call Tracing
+
+Records every call of the C wrappers, i.e. every BLAS call made through
+`BLAS.CBLAS` or the `LevelOneData`/`LevelTwoData`/`LevelThreeData` instances,
+with its name, its size and stride arguments and its duration. Copies of
+output arrays that were still shared (copy-on-write) show up as `copy` events
+with their size in bytes, nested inside the call that made them.
+
+The events are exported in the Chrome trace event format, which
+`chrome://tracing` and <https://ui.perfetto.dev> open directly, with one track
+per thread:
+
+```
+BLAS.Trace.withEnabled do
+  let C := dgemm .RowMajor .NoTrans .NoTrans m n k 1.0 A 0 k B 0 n 0.0 C 0 n
+  ...
+BLAS.Trace.writeChrome "blas.trace.json"
+```
+
+Tracing is off by default and costs one predictable branch per call while off.
+`LEANBLAS_TRACE=FILE` turns it on at startup and writes the trace to `FILE`
+when the process exits, so an existing program can be traced unchanged.
+`lake build -K trace=off` removes it from the wrappers entirely.
+
+Each thread keeps its last 16384 events; older ones are overwritten and
+reported as `dropped_events`.
+-/
+
+/-- Whether calls are being recorded. -/
+@[extern "leanblas_trace_is_enabled"]
+opaque isEnabled : IO Bool
+
+@[extern "leanblas_trace_set_enabled"]
+opaque setEnabled (on : Bool) : IO Unit
+
+/-- Whether the wrappers were built with tracing, i.e. without `-K trace=off`. -/
+@[extern "leanblas_trace_compiled"]
+opaque compiled : Unit → Bool
+
+/-- Drops the events recorded so far, including those of calls still running;
+safe while other threads are calling BLAS. -/
+@[extern "leanblas_trace_clear"]
+opaque clear : IO Unit
+
+/-- The recorded events as Chrome trace JSON. -/
+@[extern "leanblas_trace_chrome_json"]
+opaque chromeJson : IO String
+
+def writeChrome (path : System.FilePath) : IO Unit := do
+  IO.FS.writeFile path (← chromeJson)
+
+/-- Records the calls made by `act` and restores the previous state afterwards. -/
+def withEnabled {α : Type} (act : IO α) : IO α := do
+  let before ← isEnabled
+  setEnabled true
+  try act finally setEnabled before
+
+end BLAS.Trace
@@ -0,0 +1,267 @@
+import LeanBLAS.BLAS
+import LeanBLAS.Matrix
+
+set_option autoImplicit false
+
+namespace BLAS.Lazy
+
+/-! # Lazy Matrix Expressions
+
+Writing `transpose (scale 2 A) * B + C` eagerly materializes `Aᵀ`, then `2Aᵀ`,
+then the product, then the sum. `MatExpr` records the expression instead, and
+`compile` rewrites it into the calls a hand-written BLAS program would make:
+
+* transposes become `Matrix.transpose` views, which the calls pass with
+  `Transpose` flags, and `(AB)ᵀ` becomes `BᵀAᵀ`;
+* scalings are folded into `alpha`;
+* a plain matrix term of a sum becomes the output, so `… + βC` is the `beta * C`
+  of the first product and the other products accumulate with `beta = 1`;
+* a product with a one-column (or one-row) side becomes a `gemv`, and `A * Aᵀ`
+  or `Aᵀ * A` into a fresh output becomes a `syrk`.
+
+```lean
+open BLAS.Lazy in
+let e : MatExpr Float64Array Float := transpose (scale 2 A) * B + C
+match eval e with
+| .ok D => ... D.data ...        -- one `gemm` with `beta = 1`, written into `C`
+| .error msg => ...
+```
+
+A temporary is only created for a product factor that is itself a sum or a
+product, e.g. `(A + B) * C` or `(A * B) * C`. `Plan.calls` and
+`Plan.temps` show what an expression compiles to.
+-/
+
+/-- A lazily evaluated matrix expression over views of arrays `α` with scalars `K`. -/
+inductive MatExpr (α K : Type) where
+  | leaf (A : Matrix α)
+  | transpose (e : MatExpr α K)
+  | scale (a : K) (e : MatExpr α K)
+  | add (e f : MatExpr α K)
+  | mul (e f : MatExpr α K)
+
+section Syntax
+
+variable {α K : Type}
+
+instance : Coe (Matrix α) (MatExpr α K) := ⟨.leaf⟩
+instance : Add (MatExpr α K) := ⟨.add⟩
+instance : Mul (MatExpr α K) := ⟨.mul⟩
+
+def mat (A : Matrix α) : MatExpr α K := .leaf A
+def transpose (e : MatExpr α K) : MatExpr α K := .transpose e
+def scale (a : K) (e : MatExpr α K) : MatExpr α K := .scale a e
+
+end Syntax
+
+/-- `(rows, cols)` of `e`, or why its shapes do not fit together. -/
+def MatExpr.shape {α K : Type} : MatExpr α K → Except String (Nat × Nat)
+  | .leaf A => do
+    if A.rows * A.cols != 0 && A.ld < A.lineLength then
+      throw s!"leading dimension {A.ld} is smaller than {A.lineLength}"
+    return (A.rows, A.cols)
+  | .transpose e => do
+    let (r, c) ← e.shape
+    return (c, r)
+  | .scale _ e => e.shape
+  | .add e f => do
+    let (r, c) ← e.shape
+    let (r', c') ← f.shape
+    unless r == r' && c == c' do throw s!"cannot add {r}×{c} and {r'}×{c'}"
+    return (r, c)
+  | .mul e f => do
+    let (m, k) ← e.shape
+    let (k', n) ← f.shape
+    unless k == k' do throw s!"cannot multiply {m}×{k} by {k'}×{n}"
+    return (m, n)
+
+/-- Where the elements of a call operand live. -/
+inductive Src (α : Type) where
+  | input (data : α)
+  /-- The result of `Plan.temps[id]`. -/
+  | temp (id : Nat)
+
+/-- One BLAS call writing the output `C` of its block. -/
+inductive Call (α K : Type) where
+  /-- `C := alpha * A * B + beta * C` -/
+  | gemm (alpha : K) (A B : Matrix (Src α)) (beta : K)
+  /-- `C := alpha * A * x + beta * C` for vectors `x` and `C`. -/
+  | gemv (alpha : K) (A x : Matrix (Src α)) (beta : K)
+  /-- `C := alpha * A * Aᵀ + beta * C`, computed on the lower triangle and mirrored. -/
+  | syrk (alpha : K) (A : Matrix (Src α)) (beta : K)
+  /-- `C := alpha * C` -/
+  | scal (alpha : K)
+  /-- `C := alpha * X + C` -/
+  | axpy (alpha : K) (X : Matrix (Src α))
+
+def Call.name {α K : Type} : Call α K → String
+  | .gemm .. => "gemm" | .gemv .. => "gemv" | .syrk .. => "syrk"
+  | .scal .. => "scal" | .axpy .. => "axpy"
+
+/-- How the output of a block starts out. -/
+inductive Init (α : Type) where
+  /-- A fresh zero matrix. -/
+  | zeros
+  /-- A matrix of the expression that is accumulated into. -/
+  | input (data : α)
+
+/-- The calls evaluating one (sub)expression into `target`. -/
+structure Block (α K : Type) where
+  target : Matrix (Init α)
+  calls : Array (Call α K)
+
+structure Plan (α K : Type) where
+  /-- Subexpressions evaluated before `result`, referenced by `Src.temp`. -/
+  temps : Array (Block α K)
+  result : Block α K
+
+def Plan.calls {α K : Type} (p : Plan α K) : Array (Call α K) :=
+  p.temps.foldr (fun b cs => b.calls ++ cs) p.result.calls
+
+/-! ## Compilation -/
+
+/-- A factor of a product: a matrix of the expression, or a subexpression that
+has to be evaluated first. -/
+private inductive Factor (α K : Type) where
+  | dense (A : Matrix α)
+  | sub (e : MatExpr α K)
+
+private inductive Term (α K : Type) where
+  | leaf (c : K) (A : Matrix α)
+  | prod (c : K) (F G : Factor α K)
+
+section Compile
+
+variable {α K : Type} [Mul K] [OfNat K 0] [OfNat K 1] [BEq K]
+
+/-- Peels the scalings and transposes off a factor of `c * eᵀ` (`t`) or `c * e`. -/
+private def factor : MatExpr α K → Bool → K → K × Factor α K
+  | .leaf A, t, c => (c, .dense (if t then A.transpose else A))
+  | .transpose e, t, c => factor e (!t) c
+  | .scale a e, t, c => factor e t (c * a)
+  | e, t, c => (c, .sub (if t then .transpose e else e))
+
+/-- `c * eᵀ` (`t`) or `c * e` as a sum of scaled matrices and scaled products. -/
+private def terms : MatExpr α K → Bool → K → List (Term α K)
+  | .leaf A, t, c => [.leaf c (if t then A.transpose else A)]
+  | .transpose e, t, c => terms e (!t) c
+  | .scale a e, t, c => terms e t (c * a)
+  | .add e f, t, c => terms e t c ++ terms f t c
+  | .mul e f, t, c =>
+    -- (EF)ᵀ = FᵀEᵀ
+    let (e, f) := if t then (f, e) else (e, f)
+    let (a, F) := factor e t c
+    let (b, G) := factor f t a
+    [.prod b F G]
+
+private unsafe def sameDataUnsafe (a b : α) : Bool := ptrAddrUnsafe a == ptrAddrUnsafe b
+
+/-- Whether `a` and `b` are the same object. This only decides between `syrk`
+and `gemm`, so the reference implementation can always say no. -/
+@[implemented_by sameDataUnsafe]
+private def sameData (_ _ : α) : Bool := false
+
+private def Src.same : Src α → Src α → Bool
+  | .input a, .input b => sameData a b
+  | .temp i, .temp j => i == j
+  | _, _ => false
+
+private def sameView (A B : Matrix (Src α)) : Bool :=
+  A.data.same B.data && A.order == B.order && A.rows == B.rows && A.cols == B.cols &&
+    A.off == B.off && A.ld == B.ld
+
+/-- The call computing `alpha * F * G + beta * C`. -/
+private def productCall (alpha : K) (F G : Matrix (Src α)) (beta : K) (allowSyrk : Bool) :
+    Call α K :=
+  if G.cols == 1 then
+    .gemv alpha F G beta
+  else if F.rows == 1 then
+    -- Cᵀ := alpha * Gᵀ * Fᵀ + beta * Cᵀ, and a vector reads the same either way
+    .gemv alpha G.transpose F beta
+  else if allowSyrk && sameView F G.transpose then
+    .syrk alpha F beta
+  else
+    .gemm alpha F G beta
+
+private abbrev CompileM (α K : Type) := StateT (Array (Block α K)) (Except String)
+
+private instance {β : Type} : Inhabited (CompileM α K β) := ⟨throw "unreachable"⟩
+
+/-- Compiles `e` into a block; the blocks of its subexpressions go to the state. -/
+private partial def compileBlock (e : MatExpr α K) : CompileM α K (Block α K) := do
+  let (rows, cols) ← (e.shape : Except String _)
+  let resolve : Factor α K → CompileM α K (Matrix (Src α))
+    | .dense A => pure (A.map .input)
+    | .sub e => do
+      let b ← compileBlock e
+      let id := (← get).size
+      modify (·.push b)
+      pure (b.target.map fun _ => .temp id)
+  let mut leaves : Array (K × Matrix α) := #[]
+  let mut prods : Array (K × Matrix (Src α) × Matrix (Src α)) := #[]
+  for t in terms e false 1 do
+    match t with
+    | .leaf c A => leaves := leaves.push (c, A)
+    | .prod c F G => prods := prods.push (c, ← resolve F, ← resolve G)
+  -- The first plain matrix of the sum is accumulated into; otherwise start from zeros.
+  let (target, beta) := (match leaves[0]? with
+    | some (c, A) => (A.map .input, c)
+    | none => (⟨.zeros, .ColMajor, rows, cols, 0, max rows 1⟩, 0) : Matrix (Init α) × K)
+  let fresh := leaves.isEmpty
+  -- `syrk` only writes one triangle, so it has to be the first call into a fresh output.
+  if fresh then
+    let isGram := fun ((_, F, G) : K × Matrix (Src α) × Matrix (Src α)) => sameView F G.transpose
+    prods := prods.filter isGram ++ prods.filter (!isGram ·)
+  let mut calls : Array (Call α K) := #[]
+  for (c, F, G) in prods do
+    let first := calls.isEmpty
+    calls := calls.push (productCall c F G (if first then beta else 1) (fresh && first))
+  if prods.isEmpty && !(beta == 1) then
+    calls := calls.push (.scal beta)
+  for (c, A) in leaves.extract 1 leaves.size do
+    calls := calls.push (.axpy c (A.map .input))
+  return { target, calls }
+
+/-- Rewrites `e` into BLAS calls, or explains why its shapes do not fit together. -/
+def compile (e : MatExpr α K) : Except String (Plan α K) := do
+  let (result, temps) ← (compileBlock e).run #[]
+  return { temps, result }
+
+end Compile
+
+/-! ## Evaluation -/
+
+section Run
+
+variable {α R K : Type} [BLAS α R K] [Inhabited α] [OfNat K 0] [Mul K] [OfNat K 1] [BEq K]
+
+private def Src.get (temps : Array α) : Src α → α
+  | .input data => data
+  | .temp id => temps[id]!
+
+private def Call.run (temps : Array α) (C : Matrix α) : Call α K → Matrix α
+  | .gemm alpha A B beta => Matrix.gemm alpha (A.map (·.get temps)) (B.map (·.get temps)) beta C
+  | .gemv alpha A x beta => Matrix.gemv alpha (A.map (·.get temps)) (x.map (·.get temps)) beta C
+  | .syrk alpha A beta =>
+    (Matrix.syrk .Lower alpha (A.map (·.get temps)) beta C).symmetrize .Lower
+  | .scal alpha => Matrix.scal alpha C
+  | .axpy alpha X => Matrix.axpy alpha (X.map (·.get temps)) C
+
+private def Block.run (b : Block α K) (temps : Array α) : Matrix α :=
+  let C : Matrix α := b.target.map fun
+    | .zeros => LevelOneDataExt.const (b.target.rows * b.target.cols) 0
+    | .input data => data
+  b.calls.foldl (fun C call => call.run temps C) C
+
+/-- Runs the calls of `p`. The result has the layout of the matrix it was
+accumulated into, or is column-major if it started from zeros. -/
+def Plan.run (p : Plan α K) : Matrix α :=
+  let temps := p.temps.foldl (fun temps b => temps.push (b.run temps).data) #[]
+  p.result.run temps
+
+def eval (e : MatExpr α K) : Except String (Matrix α) :=
+  return (← compile e).run
+
+end Run
+
+end BLAS.Lazy
@@ -0,0 +1,292 @@
+import LeanBLAS.Spec.LevelOne
+import LeanBLAS.Spec.LevelThree
+
+set_option autoImplicit false
+
+namespace BLAS
+
+/-! # Matrix Views
+
+`Matrix α` is a rows × cols window onto an array `α` (`Float64Array`,
+`Float32Array`, `ComplexFloat64Array`, …) that carries its own storage order,
+offset and leading dimension. Submatrices, blocks, rows, columns and transposes
+are new views of the same array, built in O(1) without copying:
+
+```lean
+let A := Matrix.colMajor a n n
+let A₁₂ := A.submatrix 0 k k (n - k)   -- top-right block
+let Aᵀ := A.transpose                  -- same elements, read row-major
+```
+
+The Level 2/3 operations below take views and work out the `order`, `Transpose`,
+`UpLo`, offset and leading-dimension arguments of the `LevelTwoData` and
+`LevelThreeData` calls from them. Each returns its output view with the data
+updated. To update a block of a larger matrix in place, use `modifySubmatrix`,
+which hands the block the matrix's only reference to the array, so blocked
+algorithms do not copy.
+-/
+
+/-- A matrix stored in `data`: entry `(i, j)` is at `off + i + j * ld`
+(`ColMajor`) or `off + i * ld + j` (`RowMajor`). -/
+structure Matrix (α : Type) where
+  data : α
+  order : Order
+  rows : Nat
+  cols : Nat
+  off : Nat
+  ld : Nat
+
+namespace Matrix
+
+variable {α β : Type}
+
+/-- The contiguous column-major `rows × cols` matrix at the start of `data`. -/
+def colMajor (data : α) (rows cols : Nat) : Matrix α := ⟨data, .ColMajor, rows, cols, 0, max rows 1⟩
+
+/-- The contiguous row-major `rows × cols` matrix at the start of `data`. -/
+def rowMajor (data : α) (rows cols : Nat) : Matrix α := ⟨data, .RowMajor, rows, cols, 0, max cols 1⟩
+
+/-- The column vector `data[off], data[off + inc], …` of length `n`. -/
+def vec (data : α) (n : Nat) (off : Nat := 0) (inc : Nat := 1) : Matrix α :=
+  ⟨data, .RowMajor, n, 1, off, inc⟩
+
+def map (f : α → β) (A : Matrix α) : Matrix β := { A with data := f A.data }
+
+/-- Distance between entries `(i, j)` and `(i + 1, j)`. -/
+def rowStride (A : Matrix α) : Nat := if A.order == .ColMajor then 1 else A.ld
+
+/-- Distance between entries `(i, j)` and `(i, j + 1)`. -/
+def colStride (A : Matrix α) : Nat := if A.order == .ColMajor then A.ld else 1
+
+/-- Position of entry `(i, j)` in `data`. -/
+def index (A : Matrix α) (i j : Nat) : Nat := A.off + i * A.rowStride + j * A.colStride
+
+/-- Increment between the elements of a one-column or one-row matrix. -/
+def vecInc (A : Matrix α) : Nat := if A.cols == 1 then A.rowStride else A.colStride
+
+/-- Length of a column (`ColMajor`) or row (`RowMajor`), the contiguous direction. -/
+def lineLength (A : Matrix α) : Nat := if A.order == .ColMajor then A.rows else A.cols
+
+/-! ## Views -/
+
+/-- `Aᵀ`: the same elements read in the other storage order. -/
+def transpose (A : Matrix α) : Matrix α :=
+  { A with
+    order := if A.order == .ColMajor then .RowMajor else .ColMajor
+    rows := A.cols, cols := A.rows }
+
+/-- The `rows × cols` block of `A` whose top-left entry is `(i, j)`, clipped to `A`. -/
+def submatrix (A : Matrix α) (i j rows cols : Nat) : Matrix α :=
+  { A with off := A.index i j, rows := min rows (A.rows - i), cols := min cols (A.cols - j) }
+
+/-- Block `(bi, bj)` of `A` cut into `mb × nb` blocks; blocks on the last block
+row and column may be smaller. -/
+def block (A : Matrix α) (bi bj mb nb : Nat) : Matrix α := A.submatrix (bi * mb) (bj * nb) mb nb
+
+/-- Row `i` as a `1 × cols` matrix. -/
+def row (A : Matrix α) (i : Nat) : Matrix α := A.submatrix i 0 1 A.cols
+
+/-- Column `j` as a `rows × 1` matrix. -/
+def col (A : Matrix α) (j : Nat) : Matrix α := A.submatrix 0 j A.rows 1
+
+/-- Replaces the block `A.submatrix i j rows cols` with `f` of it and returns `A`.
+`f` receives the only reference to `A.data` that this function holds, so its
+BLAS calls update the array in place when `A` was not shared. -/
+@[inline] def modifySubmatrix (A : Matrix α) (i j rows cols : Nat) (f : Matrix α → Matrix α) :
+    Matrix α :=
+  let ⟨data, order, r, c, off, ld⟩ := A
+  let S : Matrix α := ⟨data, order, r, c, off, ld⟩
+  let B := f (S.submatrix i j rows cols)
+  ⟨B.data, order, r, c, off, ld⟩
+
+/-- The transpose flag under which `A` is passed to a call in `order`: a view in
+the other order is the transpose of a matrix stored in `order`. -/
+def transFor (A : Matrix α) (order : Order) : Transpose :=
+  if A.order == order then .NoTrans else .Trans
+
+private def flipUpLo : UpLo → UpLo
+  | .Upper => .Lower
+  | .Lower => .Upper
+
+/-- `uplo` of the logical matrix `A` as seen by a call in `order`. -/
+def uploFor (A : Matrix α) (order : Order) (uplo : UpLo) : UpLo :=
+  if A.order == order then uplo else flipUpLo uplo
+
+/-! ## Elementwise Operations -/
+
+/-- Calls `f acc n offA incA offB incB` for matching lines of `A` and `B`, which
+have the same shape, following the contiguous direction of `B`. Vectors and
+contiguous matrices of the same order are a single line. -/
+def foldLines {γ δ : Type} (A : Matrix γ) (B : Matrix δ) (init : β)
+    (f : β → Nat → Nat → Nat → Nat → Nat → β) : β := Id.run do
+  if B.rows == 1 || B.cols == 1 then
+    return f init (B.rows * B.cols) A.off A.vecInc B.off B.vecInc
+  if A.order == B.order && A.ld == A.lineLength && B.ld == B.lineLength then
+    return f init (B.rows * B.cols) A.off 1 B.off 1
+  let mut acc := init
+  if B.order == .ColMajor then
+    for j in [0:B.cols] do
+      acc := f acc B.rows (A.index 0 j) A.rowStride (B.index 0 j) 1
+  else
+    for i in [0:B.rows] do
+      acc := f acc B.cols (A.index i 0) A.colStride (B.index i 0) 1
+  return acc
+
+section LevelOne
+
+variable {R K : Type} [LevelOneData α R K]
+
+/-- Entry `(i, j)` of `A`. -/
+def get (A : Matrix α) (i j : Nat) : K := LevelOneData.get A.data (A.index i j)
+
+/-- `B := A` entrywise. -/
+def copy (A B : Matrix α) : Matrix α :=
+  let ⟨b, order, rows, cols, off, ld⟩ := B
+  let B : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  let b := foldLines A B b fun b n offA incA offB incB =>
+    LevelOneData.copy n A.data offA incA b offB incB
+  ⟨b, order, rows, cols, off, ld⟩
+
+/-- `B := alpha * A + B` -/
+def axpy (alpha : K) (A B : Matrix α) : Matrix α :=
+  let ⟨b, order, rows, cols, off, ld⟩ := B
+  let B : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  let b := foldLines A B b fun b n offA incA offB incB =>
+    LevelOneData.axpy n alpha A.data offA incA b offB incB
+  ⟨b, order, rows, cols, off, ld⟩
+
+/-- `A := alpha * A` -/
+def scal (alpha : K) (A : Matrix α) : Matrix α :=
+  let ⟨a, order, rows, cols, off, ld⟩ := A
+  let A : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  let a := foldLines A A a fun a n _ _ offA incA => LevelOneData.scal n alpha a offA incA
+  ⟨a, order, rows, cols, off, ld⟩
+
+variable [LevelOneDataExt α R K]
+
+/-- Copies the `uplo` triangle of the square matrix `A` onto the other one, in
+place when `A` is exclusive. -/
+def symmetrize (uplo : UpLo) (A : Matrix α) : Matrix α := Id.run do
+  let ⟨a, order, n, cols, off, ld⟩ := A
+  let A : Matrix Unit := ⟨(), order, n, cols, off, ld⟩
+  let mut a := a
+  for j in [0:n] do
+    -- column j below the diagonal and row j right of it
+    let below := A.index (j + 1) j
+    let right := A.index j (j + 1)
+    a := match uplo with
+      | .Lower => LevelOneDataExt.copyWithin (n - j - 1) a below A.rowStride right A.colStride
+      | .Upper => LevelOneDataExt.copyWithin (n - j - 1) a right A.colStride below A.rowStride
+  return ⟨a, order, n, cols, off, ld⟩
+
+variable [OfNat K 0]
+
+/-- A `rows × cols` zero matrix stored in `order`. -/
+def zeros (order : Order) (rows cols : Nat) : Matrix α :=
+  let data := LevelOneDataExt.const (rows * cols) (0 : K)
+  if order == .ColMajor then colMajor data rows cols else rowMajor data rows cols
+
+/-- A contiguous copy of `A` stored in `order`. -/
+def compact (A : Matrix α) (order : Order := A.order) : Matrix α :=
+  A.copy (zeros (K := K) order A.rows A.cols)
+
+end LevelOne
+
+/-! ## Level 2 -/
+
+section LevelTwo
+
+variable {R K : Type} [LevelTwoData α R K]
+
+/-- `y := alpha * A * x + beta * y` for vectors `x` and `y` (one row or one column). -/
+def gemv (alpha : K) (A x : Matrix α) (beta : K) (y : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := y
+  let y : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  ⟨LevelTwoData.gemv A.order .NoTrans A.rows A.cols alpha A.data A.off A.ld
+    x.data x.off x.vecInc beta data off y.vecInc, order, rows, cols, off, ld⟩
+
+/-- `A := alpha * x * yᵀ + A` -/
+def ger (alpha : K) (x y A : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := A
+  ⟨LevelTwoData.ger order rows cols alpha x.data x.off x.vecInc y.data y.off y.vecInc data off ld,
+    order, rows, cols, off, ld⟩
+
+/-- `x := A * x` for `A` triangular with its entries in the `uplo` triangle;
+`unit` means a unit diagonal that is not read. -/
+def trmv (uplo : UpLo) (unit : Bool) (A x : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := x
+  let x : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  ⟨LevelTwoData.trmv A.order uplo .NoTrans unit A.rows A.data A.off A.ld data off x.vecInc,
+    order, rows, cols, off, ld⟩
+
+/-- Solves `A * x' = x` for triangular `A` and returns `x'` in the view of `x`. -/
+def trsv (uplo : UpLo) (unit : Bool) (A x : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := x
+  let x : Matrix Unit := ⟨(), order, rows, cols, off, ld⟩
+  ⟨LevelTwoData.trsv A.order uplo .NoTrans unit A.rows A.data A.off A.ld data off x.vecInc,
+    order, rows, cols, off, ld⟩
+
+end LevelTwo
+
+/-! ## Level 3
+
+The output's storage order is the `order` of the call. Operands stored the other
+way are passed with `Trans` (or, for symmetric ones, the other `uplo`). -/
+
+section LevelThree
+
+variable {R K : Type} [LevelThreeData α R K]
+
+/-- `C := alpha * A * B + beta * C` -/
+def gemm (alpha : K) (A B : Matrix α) (beta : K) (C : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := C
+  ⟨LevelThreeData.gemm order (A.transFor order) (B.transFor order) rows cols A.cols alpha
+    A.data A.off A.ld B.data B.off B.ld beta data off ld, order, rows, cols, off, ld⟩
+
+/-- The `uplo` triangle of `C := alpha * A * Aᵀ + beta * C`. -/
+def syrk (uplo : UpLo) (alpha : K) (A : Matrix α) (beta : K) (C : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := C
+  ⟨LevelThreeData.syrk order uplo (A.transFor order) rows A.cols alpha A.data A.off A.ld
+    beta data off ld, order, rows, cols, off, ld⟩
+
+/-- `B := alpha * A * B` (`Left`) or `B := alpha * B * A` (`Right`) for `A`
+triangular with its entries in the `uplo` triangle. -/
+def trmm (side : Side) (uplo : UpLo) (unit : Bool) (alpha : K) (A B : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := B
+  ⟨LevelThreeData.trmm order side (A.uploFor order uplo) (A.transFor order) unit rows cols alpha
+    A.data A.off A.ld data off ld, order, rows, cols, off, ld⟩
+
+/-- Solves `A * X = alpha * B` (`Left`) or `X * A = alpha * B` (`Right`) for
+triangular `A` and returns `X` in the view of `B`. -/
+def trsm (side : Side) (uplo : UpLo) (unit : Bool) (alpha : K) (A B : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := B
+  ⟨LevelThreeData.trsm order side (A.uploFor order uplo) (A.transFor order) unit rows cols alpha
+    A.data A.off A.ld data off ld, order, rows, cols, off, ld⟩
+
+variable [LevelOneData α R K] [LevelOneDataExt α R K] [OfNat K 0]
+
+/-- `C := alpha * A * B + beta * C` (`Left`) or `C := alpha * B * A + beta * C`
+(`Right`) for `A` symmetric with its entries in the `uplo` triangle. `symm` has
+no transpose flag for `B`, so a `B` stored in the other order than `C` is
+copied first. -/
+def symm (side : Side) (uplo : UpLo) (alpha : K) (A B : Matrix α) (beta : K) (C : Matrix α) :
+    Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := C
+  let B := if B.order == order then B else B.compact (K := K) order
+  ⟨LevelThreeData.symm order side (A.uploFor order uplo) rows cols alpha A.data A.off A.ld
+    B.data B.off B.ld beta data off ld, order, rows, cols, off, ld⟩
+
+/-- The `uplo` triangle of `C := alpha * A * Bᵀ + alpha * B * Aᵀ + beta * C`.
+`A` and `B` share one transpose flag, so a `B` stored in the other order than
+`A` is copied first. -/
+def syr2k (uplo : UpLo) (alpha : K) (A B : Matrix α) (beta : K) (C : Matrix α) : Matrix α :=
+  let ⟨data, order, rows, cols, off, ld⟩ := C
+  let B := if B.order == A.order then B else B.compact (K := K) A.order
+  ⟨LevelThreeData.syr2k order uplo (A.transFor order) rows A.cols alpha A.data A.off A.ld
+    B.data B.off B.ld beta data off ld, order, rows, cols, off, ld⟩
+
+end LevelThree
+
+end Matrix
+
+end BLAS
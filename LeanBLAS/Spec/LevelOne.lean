@@ -181,6 +181,9 @@ class LevelOneDataExt (Array : Type*) (R K : outParam Type*) where
   axpby (N : Nat) (a : K) (X : Array) (offX incX : Nat) (b : K)  (Y : Array) (offY incY : Nat) : Array
   /-- return `a•x + b` -/
   scaladd (N : Nat) (a : K) (X : Array) (offX incX : Nat) (b : K) : Array
+  /-- Copy within one vector: `x[offY + i*incY] := x[offX + i*incX]` for views that do
+  not overlap. Unlike `copy`, an exclusive `X` is updated in place. -/
+  copyWithin (N : Nat) (X : Array) (offX incX offY incY : Nat) : Array
 
   /-- Index of element with maximum real part (requires non-empty vector). -/
   imaxRe (N : Nat) (X : Array) (offX incX : Nat) (h : N ≠ 0) : Nat
@@ -0,0 +1,119 @@
+import LeanBLAS
+import LeanBLAS.FFI.AllocProfile
+import LeanBLAS.Matrix
+import LeanBLASTest.BenchmarkSuite
+
+/-!
+# Allocation Profile Tests
+
+Checks that `BLAS.AllocProfile` counts the arrays the wrappers return and the
+copies of shared outputs, attributes a copy to the call that made it, counts
+nothing while disabled, that `Matrix.symmetrize` mirrors an exclusive matrix
+without copying it, and that a warmed-up conjugate gradient loop over linearly
+used arrays makes no allocations at all.
+-/
+
+open BLAS CBLAS BLAS.Test.Bench
+
+namespace BLAS.Test.AllocProfile
+
+/-- Sizes are read back from a reference so that the calls below happen while
+profiling is in the intended state, instead of being hoisted as constants. -/
+structure Sizes where
+  n : USize
+
+def filled (n : Nat) (v : Float) : Float64Array := (FloatArray.mk (Array.replicate n v)).toFloat64Array
+
+def find (ops : Array BLAS.AllocProfile.OpStats) (op : String) : IO BLAS.AllocProfile.OpStats := do
+  let some s := ops.find? (·.op == op) | throw $ IO.userError s!"no counts for {op}"
+  return s
+
+def test_disabled (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Allocation profile: nothing counted while disabled"
+  BLAS.AllocProfile.setEnabled false
+  BLAS.AllocProfile.clear
+  let ⟨n⟩ ← sizes.get
+  let x := dconst n 1.0
+  if x.size != n.toNat then throw $ IO.userError s!"dconst returned {x.size} elements"
+  let ops ← BLAS.AllocProfile.stats
+  unless ops.isEmpty do
+    throw $ IO.userError s!"counted while disabled:\n{BLAS.AllocProfile.report ops}"
+  IO.println "✓ no counts"
+
+def test_results (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Allocation profile: returned arrays"
+  let (_, ops) ← BLAS.AllocProfile.measure do
+    let ⟨n⟩ ← sizes.get
+    let x := dconst n 1.0
+    let y := dconst n 2.0
+    if x.size + y.size != 2 * n.toNat then throw $ IO.userError "dconst returned the wrong size"
+  let ⟨n⟩ ← sizes.get
+  let s ← find ops "dconst"
+  unless s.calls == 2 && s.allocations == 2 && s.bytes ≥ 16 * n.toNat && s.copies == 0 do
+    throw $ IO.userError s!"dconst counts: {repr s}"
+  unless s.peakBytes ≥ 8 * n.toNat && 2 * s.peakBytes ≤ s.bytes + 64 do
+    throw $ IO.userError s!"dconst peak: {repr s}"
+  IO.println s!"✓ {s.allocations} allocations, {s.bytes} bytes, peak {s.peakBytes}"
+
+def test_copy (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Allocation profile: copy of a shared output"
+  let ⟨n⟩ ← sizes.get
+  let y := filled n.toNat 1.0
+  let (y', ops) ← BLAS.AllocProfile.measure do
+    return daxpy n 1.0 (filled n.toNat 1.0) 0 1 y 0 1
+  -- `y` is still used here, so `daxpy` had to copy it
+  if y.toFloatArray.get! 0 != 1.0 || y'.toFloatArray.get! 0 != 2.0 then
+    throw $ IO.userError "daxpy modified its shared input"
+  let s ← find ops "daxpy"
+  unless s.copies == 1 && s.copyBytes ≥ 8 * n.toNat && s.allocations == 1 do
+    throw $ IO.userError s!"daxpy counts: {repr s}"
+  IO.println s!"✓ one copy of {s.copyBytes} bytes in daxpy"
+
+def test_in_place (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Allocation profile: in-place updates"
+  let ⟨n⟩ ← sizes.get
+  let x := filled n.toNat 1.0
+  let body ← inPlace (filled n.toNat 0.0) fun i y =>
+    let y := daxpy n (alternateSign i 0.5) x 0 1 y 0 1
+    (y, y.toFloatArray.get! 0)
+  let (ops, _) ← allocations 1 100 body
+  let s ← find ops "daxpy"
+  unless s.calls == 100 && s.allocations == 0 do
+    throw $ IO.userError s!"daxpy counts: {repr s}"
+  IO.println s!"✓ {s.calls} calls, no allocations"
+
+def test_symmetrize (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Allocation profile: symmetrize in place"
+  let (S, ops) ← BLAS.AllocProfile.measure do
+    let k := (← sizes.get).n.toNat / 25
+    -- 2 on and below the diagonal, 1 above it
+    let a := FloatArray.mk (Array.ofFn (n := k * k) fun p => if p.val % k ≥ p.val / k then 2.0 else 1.0)
+    return (Matrix.colMajor a.toFloat64Array k k).symmetrize .Lower
+  let k := (← sizes.get).n.toNat / 25
+  if S.get 0 (k - 1) != 2.0 then throw $ IO.userError "symmetrize did not mirror the lower triangle"
+  let s ← find ops "dcopy_within"
+  unless s.calls == k && (BLAS.AllocProfile.total ops).allocations == 0 do
+    throw $ IO.userError s!"symmetrize counts:\n{BLAS.AllocProfile.report ops}"
+  IO.println s!"✓ {s.calls} calls, no copies"
+
+def test_cg_steady_state : IO Unit := do
+  IO.println "Allocation profile: conjugate gradient after warm-up"
+  assertNoAllocations "cg f64" 5 100 (← BenchmarkSuite.cg BenchmarkSuite.f64 200).body
+  assertNoAllocations "cg f32" 5 100 (← BenchmarkSuite.cg BenchmarkSuite.f32 200).body
+  IO.println "✓ no allocations in 100 iterations"
+
+def main : IO Unit := do
+  unless BLAS.Trace.compiled () do
+    IO.println "Allocation profiling is compiled out (-K trace=off), skipping"
+    return
+  let sizes ← IO.mkRef { n := 1000 : Sizes }
+  test_disabled sizes
+  test_results sizes
+  test_copy sizes
+  test_in_place sizes
+  test_symmetrize sizes
+  test_cg_steady_state
+  if (← BLAS.AllocProfile.isEnabled) then
+    throw $ IO.userError "withEnabled did not restore the previous state"
+
+end BLAS.Test.AllocProfile
@@ -0,0 +1,4 @@
+import LeanBLASTest.AllocProfile
+
+def main : IO Unit :=
+  BLAS.Test.AllocProfile.main
@@ -0,0 +1,114 @@
+import LeanBLAS
+import LeanBLAS.CBLAS.LevelThree
+import LeanBLAS.FFI.CBLASAsyncFloat64
+
+/-!
+# Asynchronous BLAS Tests
+
+Checks that the `…Async` bindings give the same bits as their synchronous
+counterparts, never write to a shared output array, and apply backpressure
+once the job queue is full.
+-/
+
+open BLAS CBLAS
+
+namespace BLAS.Test.Async
+
+def values (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n) fun i => Float.sin (Float.ofNat i.val * 0.37 + phase))).toFloat64Array
+
+/-- A well-conditioned lower triangular matrix for the solves. -/
+def lowerTriangular (n : Nat) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n * n) fun i =>
+    let r := i.val % n
+    let c := i.val / n
+    if r == c then 4.0 + Float.ofNat r * 0.01
+    else if r > c then Float.sin (Float.ofNat i.val) * 0.1
+    else 0.0)).toFloat64Array
+
+def bits (x : Float64Array) : Array UInt64 := x.toFloatArray.data.map Float.toBits
+
+def expectSame (name : String) (async sync : Float64Array) : IO Unit := do
+  if bits async != bits sync then
+    throw $ IO.userError s!"{name}: async result differs from the synchronous call"
+  IO.println s!"✓ {name}"
+
+def test_results : IO Unit := do
+  IO.println "Async calls match the synchronous bindings"
+  let n : USize := 96
+  let a := values (n * n).toNat 0.0
+  let b := values (n * n).toNat 1.0
+  let c := values (n * n).toNat 2.0
+  let x := values n.toNat 3.0
+  let y := values n.toNat 4.0
+  let l := lowerTriangular n.toNat
+  -- Submit everything first so the jobs overlap, then collect.
+  let tGemm ← dgemmAsync Order.ColMajor Transpose.NoTrans Transpose.Trans n n n 1.5 a 0 n b 0 n 0.5 c 0 n
+  let tGemv ← dgemvAsync Order.RowMajor Transpose.NoTrans n n 0.5 a 0 n x 0 1 0.25 y 0 1
+  let tGer ← dgerAsync Order.ColMajor n n 2.0 x 0 1 y 0 1 a 0 n
+  let tSymm ← dsymmAsync Order.ColMajor Side.Left UpLo.Upper n n 1.0 a 0 n b 0 n 0.0 c 0 n
+  let tSyrk ← dsyrkAsync Order.ColMajor UpLo.Lower Transpose.NoTrans n n 1.0 a 0 n 1.0 c 0 n
+  let tSyr2k ← dsyr2kAsync Order.RowMajor UpLo.Upper Transpose.Trans n n 0.5 a 0 n b 0 n 2.0 c 0 n
+  let tTrmv ← dtrmvAsync Order.ColMajor UpLo.Lower Transpose.Trans Diag.NonUnit n l 0 n x 0 1
+  let tTrsv ← dtrsvAsync Order.ColMajor UpLo.Lower Transpose.NoTrans Diag.NonUnit n l 0 n x 0 1
+  let tTrmm ← dtrmmAsync Order.ColMajor Side.Right UpLo.Lower Transpose.NoTrans Diag.Unit n n 2.0 l 0 n b 0 n
+  let tTrsm ← dtrsmAsync Order.ColMajor Side.Left UpLo.Lower Transpose.NoTrans Diag.NonUnit n n 1.0 l 0 n b 0 n
+  expectSame "dgemm" (← IO.wait tGemm)
+    (dgemm Order.ColMajor Transpose.NoTrans Transpose.Trans n n n 1.5 a 0 n b 0 n 0.5 c 0 n)
+  expectSame "dgemv" (← IO.wait tGemv) (dgemv Order.RowMajor Transpose.NoTrans n n 0.5 a 0 n x 0 1 0.25 y 0 1)
+  expectSame "dger" (← IO.wait tGer) (dger Order.ColMajor n n 2.0 x 0 1 y 0 1 a 0 n)
+  expectSame "dsymm" (← IO.wait tSymm) (dsymm Order.ColMajor Side.Left UpLo.Upper n n 1.0 a 0 n b 0 n 0.0 c 0 n)
+  expectSame "dsyrk" (← IO.wait tSyrk) (dsyrk Order.ColMajor UpLo.Lower Transpose.NoTrans n n 1.0 a 0 n 1.0 c 0 n)
+  expectSame "dsyr2k" (← IO.wait tSyr2k)
+    (dsyr2k Order.RowMajor UpLo.Upper Transpose.Trans n n 0.5 a 0 n b 0 n 2.0 c 0 n)
+  expectSame "dtrmv" (← IO.wait tTrmv) (dtrmv Order.ColMajor UpLo.Lower Transpose.Trans Diag.NonUnit n l 0 n x 0 1)
+  expectSame "dtrsv" (← IO.wait tTrsv) (dtrsv Order.ColMajor UpLo.Lower Transpose.NoTrans Diag.NonUnit n l 0 n x 0 1)
+  expectSame "dtrmm" (← IO.wait tTrmm)
+    (dtrmm Order.ColMajor Side.Right UpLo.Lower Transpose.NoTrans Diag.Unit n n 2.0 l 0 n b 0 n)
+  expectSame "dtrsm" (← IO.wait tTrsm)
+    (dtrsm Order.ColMajor Side.Left UpLo.Lower Transpose.NoTrans Diag.NonUnit n n 1.0 l 0 n b 0 n)
+
+def test_ownership : IO Unit := do
+  IO.println "Async calls leave shared arrays untouched"
+  let n : USize := 64
+  let a := values (n * n).toNat 0.0
+  let c := values (n * n).toNat 1.0
+  let before := bits c
+  let t ← dgemmAsync Order.ColMajor Transpose.NoTrans Transpose.NoTrans n n n 1.0 a 0 n a 0 n 1.0 c 0 n
+  let r ← IO.wait t
+  if bits c != before then
+    throw $ IO.userError "the caller's output array was modified"
+  if bits r == before then
+    throw $ IO.userError "the result was not computed"
+  IO.println "✓ output copied on submission"
+
+def test_backpressure : IO Unit := do
+  IO.println "Async queue applies backpressure"
+  let saved ← BLAS.Async.stats
+  BLAS.Async.setWorkers 1
+  BLAS.Async.setQueueCapacity 1
+  let n : USize := 160
+  let a := values (n * n).toNat 0.0
+  let mut tasks : Array (Task Float64Array) := #[]
+  for i in [:8] do
+    let c := values (n * n).toNat (Float.ofNat i)
+    tasks := tasks.push (← dgemmAsync Order.ColMajor Transpose.NoTrans Transpose.NoTrans n n n 1.0 a 0 n a 0 n 1.0 c 0 n)
+    let s ← BLAS.Async.stats
+    if s.queued > 1 then
+      throw $ IO.userError s!"{s.queued} jobs queued with capacity 1"
+  for i in [:8] do
+    let c := values (n * n).toNat (Float.ofNat i)
+    expectSame s!"dgemm job {i}" (← IO.wait tasks[i]!)
+      (dgemm Order.ColMajor Transpose.NoTrans Transpose.NoTrans n n n 1.0 a 0 n a 0 n 1.0 c 0 n)
+  BLAS.Async.setQueueCapacity saved.capacity.toUSize
+  BLAS.Async.setWorkers saved.workers.toUSize
+
+def main : IO Unit := do
+  test_results
+  test_ownership
+  test_backpressure
+  let s ← BLAS.Async.stats
+  if s.queued != 0 || s.running != 0 then
+    throw $ IO.userError s!"jobs left behind: {repr s}"
+
+end BLAS.Test.Async
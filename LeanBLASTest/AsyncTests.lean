@@ -0,0 +1,4 @@
+import LeanBLASTest.Async
+
+def main : IO Unit :=
+  BLAS.Test.Async.main
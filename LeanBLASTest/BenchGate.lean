@@ -0,0 +1,162 @@
+import Lean.Data.Json
+import LeanBLASTest.BenchHarness
+
+/-!
+# Benchmark Regression Gate
+
+Compares the results of a benchmark run with a baseline file in the JSON
+format of `Bench.toJson`, matched by operation, precision and shape, and
+fails when a case got slower beyond the noise:
+
+* the median time per call grew by more than `tolerance` (10% by default), and
+* the 95% confidence intervals of the two medians do not overlap.
+
+Results measured from a single sample have no interval, so only the tolerance
+applies to them. Every benchmark executable accepts
+
+```
+--json FILE           write this run's results
+--save-baseline FILE  write them as the new baseline
+--compare FILE        compare with a baseline, exit with 1 on a regression
+--tolerance X         relative slowdown allowed, e.g. 0.15
+--counters            add hardware counters per call (`BLAS.Perf`)
+```
+-/
+
+open Lean
+
+namespace BLAS.Test.Bench
+
+structure GateOptions where
+  json : Option String := none
+  saveBaseline : Option String := none
+  compare : Option String := none
+  tolerance : Float := 0.10
+  counters : Bool := false
+
+/-- Takes the gate's own flags out of `args`, leaving the others for the benchmark. -/
+def GateOptions.parse : List String → Except String (GateOptions × List String)
+  | [] => .ok ({}, [])
+  | "--json" :: path :: rest => do
+    let (o, r) ← GateOptions.parse rest; pure ({ o with json := some path }, r)
+  | "--save-baseline" :: path :: rest => do
+    let (o, r) ← GateOptions.parse rest; pure ({ o with saveBaseline := some path }, r)
+  | "--compare" :: path :: rest => do
+    let (o, r) ← GateOptions.parse rest; pure ({ o with compare := some path }, r)
+  | "--tolerance" :: x :: rest => do
+    let some t := parseFloat x | throw s!"--tolerance expects a number, got {x}"
+    let (o, r) ← GateOptions.parse rest; pure ({ o with tolerance := t }, r)
+  | "--counters" :: rest => do
+    let (o, r) ← GateOptions.parse rest; pure ({ o with counters := true }, r)
+  | arg :: rest => do
+    let (o, r) ← GateOptions.parse rest; pure (o, arg :: r)
+
+private def field (j : Json) (k : String) : Except String Float :=
+  match j.getObjVal? k with
+  | .ok .null => pure 0.0
+  | .ok v => fromJson? v
+  | .error e => throw e
+
+/-- `none` for a missing or `null` field. -/
+private def optField (j : Json) (k : String) : Except String (Option Nat) :=
+  match j.getObjVal? k with
+  | .ok .null | .error _ => pure none
+  | .ok v => some <$> fromJson? v
+
+private def countersFromJson (j : Json) : Except String (Option Perf.Counters) := do
+  let f := optField j
+  let c : Perf.Counters := {
+    cycles := ← f "cycles", instructions := ← f "instructions", llcMisses := ← f "llc_misses"
+    dtlbMisses := ← f "dtlb_misses", fpOps := ← f "fp_ops" }
+  -- `elapsedNs` only feeds `ghz`; recover it from the recorded frequency
+  let elapsedNs := match c.cycles, j.getObjValAs? Float "ghz" with
+    | some cyc, .ok g => if g > 0.0 then (cyc.toFloat / g).round.toUInt64.toNat else 0
+    | _, _ => 0
+  return if c.any then some { c with elapsedNs } else none
+
+def Result.fromJson (j : Json) : Except String Result := do
+  let f := field j
+  return {
+    op := ← j.getObjValAs? String "op"
+    precision := ← j.getObjValAs? String "precision"
+    shape := ← j.getObjValAs? String "shape"
+    model := ⟨← f "flops", ← f "bytes"⟩
+    stats := {
+      trials := ← j.getObjValAs? Nat "trials", batch := ← j.getObjValAs? Nat "batch"
+      warmup := ← j.getObjValAs? Nat "warmup"
+      mean := ← f "mean_ns", stddev := ← f "stddev_ns", min := ← f "min_ns"
+      median := ← f "median_ns", p90 := ← f "p90_ns", p99 := ← f "p99_ns", max := ← f "max_ns"
+      ciLow := ← f "ci95_low_ns", ciHigh := ← f "ci95_high_ns"
+      counters := ← countersFromJson j }
+    checksum := ← f "checksum" }
+
+def readResults (path : String) : IO (Array Result) := do
+  let j ← IO.ofExcept (Json.parse (← IO.FS.readFile path))
+  let rs ← IO.ofExcept (j.getObjValAs? (Array Json) "results")
+  rs.mapM fun r => IO.ofExcept (Result.fromJson r |>.mapError (s!"{path}: " ++ ·))
+
+inductive Verdict where
+  | regression | improvement | unchanged
+deriving BEq
+
+/-- Whether `cur` is slower or faster than `base` beyond `tolerance` and the noise. -/
+def verdict (tolerance : Float) (base cur : Stats) : Verdict :=
+  let change := cur.median / base.median - 1.0
+  if change > tolerance && cur.ciLow > base.ciHigh then .regression
+  else if change < -tolerance && cur.ciHigh < base.ciLow then .improvement
+  else .unchanged
+
+private def key (r : Result) : String × String × String := (r.op, r.precision, r.shape)
+
+private def pad (s : String) (n : Nat) : String := s.pushn ' ' (n - s.length)
+
+/-- Prints one line per case of `base` and `cur` and returns the number of regressions. -/
+def compareResults (tolerance : Float) (base cur : Array Result) : IO Nat := do
+  IO.println s!"\nComparison with baseline (tolerance {tolerance * 100.0}%)"
+  IO.println s!"{pad "op" 10}{pad "precision" 10}{pad "shape" 22}{pad "baseline" 16}{pad "current" 16}change"
+  let mut regressions := 0
+  for c in cur do
+    let line := s!"{pad c.op 10}{pad c.precision 10}{pad c.shape 22}"
+    match base.find? (key · == key c) with
+    | none => IO.println s!"{line}{pad "-" 16}{pad (formatNs c.stats.median) 16}new"
+    | some b =>
+      let change := (c.stats.median / b.stats.median - 1.0) * 100.0
+      let v := verdict tolerance b.stats c.stats
+      let mark := match v with
+        | .regression => "  REGRESSION"
+        | .improvement => "  improved"
+        | .unchanged => ""
+      if v == .regression then regressions := regressions + 1
+      IO.println s!"{line}{pad (formatNs b.stats.median) 16}{pad (formatNs c.stats.median) 16}\
+        {if change ≥ 0.0 then "+" else ""}{change}%{mark}"
+  for b in base do
+    unless cur.any (key · == key b) do
+      IO.println s!"{pad b.op 10}{pad b.precision 10}{pad b.shape 22}{pad (formatNs b.stats.median) 16}{pad "-" 16}missing"
+  return regressions
+
+/-- Runs `bench` with the arguments the gate does not consume, then writes and
+compares everything it recorded or returned. Exits with 1 on a regression. -/
+def gate (target : String) (args : List String) (bench : List String → IO (Array Result)) : IO UInt32 := do
+  let (o, rest) ← match GateOptions.parse args with
+    | .ok r => pure r
+    | .error msg => throw $ IO.userError msg
+  if o.counters then
+    countersEnabled.set true
+    unless (← Perf.available) do
+      IO.eprintln s!"{target}: hardware counters unavailable (perf_event_open), measuring times only"
+  let returned ← bench rest
+  let results := (← recorded.get) ++ returned
+  let backend := BLAS.Backend.backendName ()
+  for path in [o.json, o.saveBaseline].filterMap id do
+    if let some dir := (path : System.FilePath).parent then IO.FS.createDirAll dir
+    IO.FS.writeFile path (toJson backend results)
+    IO.println s!"{target}: wrote {results.size} results to {path}"
+  let some path := o.compare | return 0
+  let regressions ← compareResults o.tolerance (← readResults path) results
+  if regressions == 0 then
+    IO.println s!"{target}: no regressions against {path}"
+    return 0
+  IO.eprintln s!"{target}: {regressions} regression(s) against {path}"
+  return 1
+
+end BLAS.Test.Bench
@@ -0,0 +1,313 @@
+import LeanBLAS
+
+/-!
+# Benchmark Harness
+
+Measures one operation at a time and reports robust statistics:
+
+* warm-up runs until the per-call time settles (the mean of the last `window`
+  calls is within `tolerance` of the `window` before), bounded by a call count
+  and a time budget;
+* every trial repeats the call until it has run for `minTrialNs`, so short calls
+  are not dominated by the clock, and records the time per call;
+* the summary gives mean, standard deviation, median, p90, p99 and a 95%
+  confidence interval of the median from order statistics;
+* a flop and byte `Model` per case turns the median into GFLOP/s and GB/s;
+* with `--counters`, one more trial runs under `BLAS.Perf` hardware counters
+  and adds cycles, instructions, cache and TLB misses and FP operations per call
+  on the calling thread;
+* `allocations` and `assertNoAllocations` count what the wrappers allocate per
+  call once a body is warmed up (`BLAS.AllocProfile`).
+
+Results can be written as JSON or CSV for tracking across commits.
+-/
+
+namespace BLAS.Test.Bench
+
+structure Config where
+  /-- Warm-up always makes at least this many calls... -/
+  minWarmup : Nat := 6
+  /-- ...and at most this many, or as many as fit in `maxWarmupNs`. -/
+  maxWarmup : Nat := 400
+  maxWarmupNs : Nat := 200000000
+  /-- Warm-up ends once two consecutive windows of this many calls have means
+  within `tolerance` (relative) of each other. -/
+  window : Nat := 3
+  tolerance : Float := 0.05
+  trials : Nat := 25
+  /-- Each trial repeats the call until it has run for at least this long. -/
+  minTrialNs : Nat := 2000000
+deriving Repr
+
+/-- Fewer and shorter trials, for smoke runs. -/
+def Config.quick : Config :=
+  { maxWarmup := 50, maxWarmupNs := 20000000, trials := 7, minTrialNs := 200000 }
+
+/-- Floating point operations and bytes of memory traffic of one call. -/
+structure Model where
+  flops : Float
+  bytes : Float
+deriving Repr
+
+/-- Per-call times in nanoseconds. -/
+structure Stats where
+  trials : Nat
+  /-- Calls per trial. -/
+  batch : Nat
+  warmup : Nat
+  mean : Float
+  stddev : Float
+  min : Float
+  median : Float
+  p90 : Float
+  p99 : Float
+  max : Float
+  /-- 95% confidence interval of the median. -/
+  ciLow : Float
+  ciHigh : Float
+  /-- Hardware counters per call, when enabled and available. -/
+  counters : Option Perf.Counters := none
+deriving Repr
+
+structure Result where
+  op : String
+  precision : String
+  /-- e.g. `n=4096` or `m=256 n=256 k=256` -/
+  shape : String
+  model : Model
+  stats : Stats
+  /-- Sum of the values the calls returned, so that they cannot be optimized away. -/
+  checksum : Float
+
+/-- Flops per nanosecond are GFLOP/s. -/
+def Result.gflops (r : Result) : Float := r.model.flops / r.stats.median
+
+def Result.gbps (r : Result) : Float := r.model.bytes / r.stats.median
+
+/-! ## Statistics -/
+
+def mean (xs : Array Float) : Float :=
+  if xs.isEmpty then 0.0 else xs.foldl (· + ·) 0.0 / xs.size.toFloat
+
+def stddev (xs : Array Float) : Float :=
+  if xs.size < 2 then 0.0 else
+    let m := mean xs
+    Float.sqrt (xs.foldl (fun s x => s + (x - m) * (x - m)) 0.0 / (xs.size - 1).toFloat)
+
+/-- The `q`-quantile of sorted `xs`, interpolating between neighbouring samples. -/
+def quantile (xs : Array Float) (q : Float) : Float :=
+  if xs.isEmpty then 0.0 else
+    let pos := q * (xs.size - 1).toFloat
+    let i := pos.floor.toUInt64.toNat
+    let j := min (i + 1) (xs.size - 1)
+    let t := pos - pos.floor
+    xs[i]! * (1.0 - t) + xs[j]! * t
+
+/-- Ranks `n/2 ∓ 1.96·√n/2` of the sorted samples bracket the median with
+about 95% probability, whatever the distribution of the samples. -/
+def medianInterval (xs : Array Float) : Float × Float :=
+  if xs.isEmpty then (0.0, 0.0) else
+    let n := xs.size.toFloat
+    let half := 1.96 * Float.sqrt n / 2.0
+    let lo := (n / 2.0 - half).floor
+    let hi := (n / 2.0 + half).ceil
+    let lo := if lo < 0.0 then 0 else lo.toUInt64.toNat
+    let hi := min (hi.toUInt64.toNat) (xs.size - 1)
+    (xs[lo]!, xs[hi]!)
+
+def summarize (samples : Array Float) (batch warmup : Nat) : Stats :=
+  let xs := samples.qsort (· < ·)
+  let (ciLow, ciHigh) := medianInterval xs
+  { trials := xs.size, batch, warmup
+    mean := mean xs, stddev := stddev xs
+    min := xs[0]?.getD 0.0, max := xs.back?.getD 0.0
+    median := quantile xs 0.5, p90 := quantile xs 0.9, p99 := quantile xs 0.99
+    ciLow, ciHigh }
+
+/-! ## Measurement -/
+
+/-- Whether to measure hardware counters, set by the `--counters` flag of `gate`. -/
+initialize countersEnabled : IO.Ref Bool ← IO.mkRef false
+
+/-- Starts counting if counters are enabled. -/
+def startCounters : IO (Option (Perf.Session × Nat)) := do
+  unless (← countersEnabled.get) do return none
+  let s ← Perf.Session.new
+  s.start
+  return some (s, ← IO.monoNanosNow)
+
+/-- Stops counting and divides by the number of calls made since `startCounters`. -/
+def stopCounters (started : Option (Perf.Session × Nat)) (calls : Nat) : IO (Option Perf.Counters) := do
+  let some (s, t0) := started | return none
+  let t1 ← IO.monoNanosNow
+  let c ← s.stop (t1 - t0)
+  return if c.any then some (c.perCall calls) else none
+
+/-- Times `body i` for `i = 0, 1, 2, …`. `body` returns a value derived from its
+output, which goes into `Result.checksum`; the index lets it alternate its
+arguments so repeated calls stay well-scaled. -/
+def measure (cfg : Config) (body : Nat → IO Float) : IO (Stats × Float) := do
+  let mut sink := 0.0
+  let mut i := 0
+  let mut times : Array Float := #[]
+  let w := max cfg.window 1
+  let start ← IO.monoNanosNow
+  repeat
+    let t0 ← IO.monoNanosNow
+    sink := sink + (← body i)
+    let t1 ← IO.monoNanosNow
+    i := i + 1
+    times := times.push (t1 - t0).toFloat
+    if times.size ≥ cfg.maxWarmup || t1 - start ≥ cfg.maxWarmupNs then break
+    if times.size ≥ max cfg.minWarmup (2 * w) then
+      let recent := mean (times.extract (times.size - w) times.size)
+      let before := mean (times.extract (times.size - 2 * w) (times.size - w))
+      if (recent - before).abs ≤ cfg.tolerance * before then break
+  let perCall := max 1.0 (quantile ((times.extract (times.size - w) times.size).qsort (· < ·)) 0.5)
+  let batch := max 1 (cfg.minTrialNs.toFloat / perCall).ceil.toUInt64.toNat
+  let mut samples : Array Float := #[]
+  for _ in [0:cfg.trials] do
+    let t0 ← IO.monoNanosNow
+    for _ in [0:batch] do
+      sink := sink + (← body i)
+      i := i + 1
+    let t1 ← IO.monoNanosNow
+    samples := samples.push ((t1 - t0).toFloat / batch.toFloat)
+  let counting ← startCounters
+  if counting.isSome then
+    for _ in [0:batch] do
+      sink := sink + (← body i)
+      i := i + 1
+  let counters ← stopCounters counting batch
+  return ({ summarize samples batch times.size with counters }, sink)
+
+/-- A body that updates `init` in place. The reference hands over its array for
+the duration of each call, so the call sees the only reference and does not copy. -/
+def inPlace {α : Type} [Inhabited α] (init : α) (step : Nat → α → α × Float) : IO (Nat → IO Float) := do
+  let r ← IO.mkRef init
+  return fun i => do
+    let (x, v) := step i (← r.swap default)
+    r.set x
+    return v
+
+/-- Results of the current run, for benchmarks whose timing loops are written by hand. -/
+initialize recorded : IO.Ref (Array Result) ← IO.mkRef #[]
+
+def record (r : Result) : IO Unit := recorded.modify (·.push r)
+
+/-- Records a hand-written timing loop from the time of each of its iterations. -/
+def recordSamples (op precision shape : String) (model : Model) (samples : Array Float)
+    (checksum : Float) (counters : Option Perf.Counters := none) : IO Unit :=
+  record { op, precision, shape, model, stats := { summarize samples 1 0 with counters }, checksum }
+
+/-- Alternates between `a` and `1/a`, so repeated scalings neither overflow nor underflow. -/
+def alternate (i : Nat) (a : Float) : Float := if i % 2 == 0 then a else 1.0 / a
+
+/-- Alternates between `a` and `-a`, so repeated updates cancel. -/
+def alternateSign (i : Nat) (a : Float) : Float := if i % 2 == 0 then a else -a
+
+/-- The allocations of the C wrappers during `calls` calls of `body`, made after
+`warmup` calls so that buffers created on first use are not counted. -/
+def allocations (warmup calls : Nat) (body : Nat → IO Float) :
+    IO (Array AllocProfile.OpStats × Float) := do
+  let mut sink := 0.0
+  for i in [0:warmup] do sink := sink + (← body i)
+  let (s, ops) ← AllocProfile.measure do
+    let mut s := 0.0
+    for i in [warmup:warmup + calls] do s := s + (← body i)
+    return s
+  return (ops, sink + s)
+
+/-- Fails if `body` still allocates in the wrappers after `warmup` calls. -/
+def assertNoAllocations (name : String) (warmup calls : Nat) (body : Nat → IO Float) : IO Unit := do
+  let (ops, _) ← allocations warmup calls body
+  let t := AllocProfile.total ops
+  if t.allocations > 0 then
+    throw $ IO.userError s!"{name}: {t.allocations} allocations ({t.bytes} bytes) in {calls} \
+      calls after warm-up\n{AllocProfile.report ops}"
+
+private def natOfDigits (ds : List Char) : Option Nat :=
+  if ds.isEmpty || !ds.all Char.isDigit then none
+  else some (ds.foldl (fun n c => 10 * n + (c.toNat - '0'.toNat)) 0)
+
+/-- Parses a decimal such as `12`, `-0.25` or `1.5e-3`. -/
+def parseFloat (s : String) : Option Float := do
+  let cs := s.toList.filter (!·.isWhitespace)
+  let (neg, cs) := match cs with
+    | '-' :: r => (true, r)
+    | '+' :: r => (false, r)
+    | r => (false, r)
+  let (mant, expo) := cs.span fun c => c != 'e' && c != 'E'
+  let exp : Int ← match expo with
+    | [] => pure 0
+    | _ :: '-' :: ds => do let d ← natOfDigits ds; pure (-(d : Int))
+    | _ :: '+' :: ds => do let d ← natOfDigits ds; pure (d : Int)
+    | _ :: ds => do let d ← natOfDigits ds; pure (d : Int)
+  let (ip, fp) := mant.span (· != '.')
+  let fp := fp.drop 1
+  let digits ← natOfDigits (ip ++ fp)
+  let e := exp - fp.length
+  let x := if e ≥ 0 then Float.ofScientific digits false e.toNat else Float.ofScientific digits true (-e).toNat
+  return if neg then -x else x
+
+/-! ## Output -/
+
+def formatNs (ns : Float) : String :=
+  if ns ≥ 1e9 then s!"{ns / 1e9} s"
+  else if ns ≥ 1e6 then s!"{ns / 1e6} ms"
+  else if ns ≥ 1e3 then s!"{ns / 1e3} µs"
+  else s!"{ns} ns"
+
+def printHeader : IO Unit :=
+  IO.println "op\tprecision\tshape\tmedian\tp90\tp99\t95% CI\tGFLOP/s\tGB/s"
+
+def printResult (r : Result) : IO Unit := do
+  IO.println s!"{r.op}\t{r.precision}\t{r.shape}\t{formatNs r.stats.median}\t{formatNs r.stats.p90}\t\
+    {formatNs r.stats.p99}\t[{formatNs r.stats.ciLow}, {formatNs r.stats.ciHigh}]\t{r.gflops}\t{r.gbps}"
+  if let some c := r.stats.counters then
+    IO.println s!"  per call: {c}"
+
+private def jsonNumber (x : Float) : String :=
+  if x.isNaN || x.isInf then "null" else toString x
+
+private def jsonString (s : String) : String :=
+  "\"" ++ (s.foldl (fun acc c =>
+    if c == '"' then acc ++ "\\\""
+    else if c == '\\' then acc ++ "\\\\"
+    else if c == '\n' then acc ++ "\\n"
+    else acc.push c) "") ++ "\""
+
+private def counterFields (c : Option Perf.Counters) : List (String × String) :=
+  let count := fun (f : Perf.Counters → Option Nat) => ((c.bind f).map toString).getD "null"
+  [("cycles", count (·.cycles)), ("instructions", count (·.instructions)),
+   ("llc_misses", count (·.llcMisses)), ("dtlb_misses", count (·.dtlbMisses)),
+   ("fp_ops", count (·.fpOps)), ("ghz", ((c.bind (·.ghz)).map jsonNumber).getD "null")]
+
+private def fields (r : Result) : List (String × String) :=
+  [("op", jsonString r.op), ("precision", jsonString r.precision), ("shape", jsonString r.shape),
+   ("flops", jsonNumber r.model.flops), ("bytes", jsonNumber r.model.bytes),
+   ("trials", toString r.stats.trials), ("batch", toString r.stats.batch),
+   ("warmup", toString r.stats.warmup),
+   ("mean_ns", jsonNumber r.stats.mean), ("stddev_ns", jsonNumber r.stats.stddev),
+   ("min_ns", jsonNumber r.stats.min), ("median_ns", jsonNumber r.stats.median),
+   ("p90_ns", jsonNumber r.stats.p90), ("p99_ns", jsonNumber r.stats.p99),
+   ("max_ns", jsonNumber r.stats.max),
+   ("ci95_low_ns", jsonNumber r.stats.ciLow), ("ci95_high_ns", jsonNumber r.stats.ciHigh),
+   ("gflops", jsonNumber r.gflops), ("gbps", jsonNumber r.gbps),
+   ("checksum", jsonNumber r.checksum)] ++ counterFields r.stats.counters
+
+/-- `{"backend": …, "results": [{…}, …]}` with one object per result. -/
+def toJson (backend : String) (rs : Array Result) : String :=
+  let obj := fun (r : Result) =>
+    "    {" ++ ", ".intercalate ((fields r).map fun (k, v) => s!"{jsonString k}: {v}") ++ "}"
+  "{\n  \"backend\": " ++ jsonString backend ++ ",\n  \"results\": [\n" ++
+    ",\n".intercalate (rs.toList.map obj) ++ "\n  ]\n}\n"
+
+/-- A header row and one row per result, with the same columns as the JSON objects. -/
+def toCsv (rs : Array Result) : String :=
+  let header := ",".intercalate ((fields { op := "", precision := "", shape := "", model := ⟨0, 0⟩, stats := summarize #[] 0 0, checksum := 0 }).map (·.1))
+  let row := fun (r : Result) => ",".intercalate ((fields r).map fun (_, v) =>
+    if v == "null" then "" else v)
+  header ++ "\n" ++ String.join (rs.toList.map (row · ++ "\n"))
+
+end BLAS.Test.Bench
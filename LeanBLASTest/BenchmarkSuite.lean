@@ -0,0 +1,387 @@
+import LeanBLAS
+import LeanBLASTest.BenchGate
+
+/-!
+# Benchmark Suite
+
+Runs every Level 1/2/3 wrapper of the `LevelOneData`/`LevelTwoData`/
+`LevelThreeData` classes for `Float64Array`, `Float32Array` and
+`ComplexFloat64Array` through `BLAS.Test.Bench.measure`.
+
+```
+lake exe BenchmarkSuite [--quick] [--op gemm]… [--precision f32]… [--csv FILE]
+```
+
+plus the `--json`/`--save-baseline`/`--compare` flags of `BLAS.Test.Bench.gate`.
+
+Flop counts are the usual ones for real data (`2n` for `dot`, `2mnk` for
+`gemm`) times four for complex data; byte counts are the compulsory traffic of
+one call (every operand read once, every output written once). Outputs are
+updated in place with alternating scalars so their values stay bounded; the
+triangular multiplies and solves start from the same vector or matrix every
+call, so their times include one copy of it.
+
+`--allocations` replaces the timings by the allocations the wrappers make per
+call once each case is warmed up (`BLAS.AllocProfile`), and fails if a `cg`
+iteration allocates at all: a steady-state solver loop over linearly used
+arrays must not.
+-/
+
+open BLAS BLAS.Test.Bench
+
+namespace BLAS.Test.BenchmarkSuite
+
+/-- How to build arrays and scalars of one precision. -/
+structure Precision (α K : Type) where
+  name : String
+  elemBytes : Nat
+  /-- Real flops per flop of the real-valued count: 1, or 4 for complex data. -/
+  flopScale : Float
+  ofFn : Nat → (Nat → Float) → α
+  scalar : Float → K
+  /-- A real number derived from a result, for the checksum. -/
+  probe : K → Float
+  /-- Whether `LevelOneData.rot` is implemented. -/
+  hasRot : Bool := true
+  /-- Whether the data is real, so that `probe` loses nothing. -/
+  real : Bool := true
+
+def f64 : Precision Float64Array Float where
+  name := "f64"
+  elemBytes := 8
+  flopScale := 1.0
+  ofFn n f := (FloatArray.mk (Array.ofFn (n := n) fun i => f i.val)).toFloat64Array
+  scalar a := a
+  probe x := x
+
+def f32 : Precision Float32Array Float where
+  name := "f32"
+  elemBytes := 4
+  flopScale := 1.0
+  ofFn n f := Id.run do
+    let mut a := Float32Array.mkZero n
+    for i in [0:n] do
+      a := a.set i (f i)
+    return a
+  scalar a := a
+  probe x := x
+
+def c64 : Precision ComplexFloat64Array ComplexFloat where
+  name := "c64"
+  elemBytes := 16
+  flopScale := 4.0
+  ofFn n f := (ComplexFloatArray.ofArray (Array.ofFn (n := n) fun i =>
+    ⟨f i.val, 0.5 * f (i.val + 1)⟩)).toComplexFloat64Array
+  scalar a := ⟨a, 0⟩
+  probe z := z.re
+  hasRot := false
+  real := false
+
+/-- One operation at one size, with a body for `measure`. -/
+structure Case where
+  op : String
+  shape : String
+  model : Model
+  body : Nat → IO Float
+
+structure Sizes where
+  level1 : List Nat
+  level2 : List Nat
+  level3 : List Nat
+
+def Sizes.full : Sizes := ⟨[1000, 100000, 1000000], [64, 256, 1024], [64, 256, 512]⟩
+def Sizes.quick : Sizes := ⟨[10000], [128], [64]⟩
+
+/-- `n × n` column-major lower triangular matrix with a dominant diagonal. -/
+def lowerTriangular (n : Nat) (i : Nat) : Float :=
+  let r := i % n
+  let c := i / n
+  if r == c then 4.0 else if r > c then 0.1 * Float.sin i.toFloat else 0.0
+
+/-- Column-major band storage of a lower triangular matrix with `k` subdiagonals;
+the diagonal is the first row of every column. -/
+def lowerBand (k : Nat) (i : Nat) : Float :=
+  if i % (k + 1) == 0 then 4.0 else 0.1 * Float.sin i.toFloat
+
+/-- Column-major packed storage of an `n × n` lower triangular matrix. -/
+def lowerPacked (n : Nat) : Array Float := Id.run do
+  let mut a : Array Float := #[]
+  for j in [0:n] do
+    for i in [j:n] do
+      a := a.push (if i == j then 4.0 else 0.1 * Float.sin (i * n + j).toFloat)
+  return a
+
+section Cases
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [LevelThreeData α Float K] [Inhabited α]
+
+def level1 (P : Precision α K) (n : Nat) : IO (Array Case) := do
+  let x := P.ofFn n fun i => Float.sin (i.toFloat * 0.1)
+  let y := P.ofFn n fun i => Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let mk := fun (op : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := s!"n={n}", model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  -- `n - i % 2` keeps the reductions from being hoisted out of the loop
+  let mut cases := #[
+    mk "dot" (2 * N) (2 * N) fun i => pure (P.probe (LevelOneData.dot (n - i % 2) x 0 1 y 0 1)),
+    mk "nrm2" (2 * N) N fun i => pure (LevelOneData.nrm2 (n - i % 2) x 0 1),
+    mk "asum" N N fun i => pure (LevelOneData.asum (n - i % 2) x 0 1),
+    mk "iamax" N N fun i => pure (LevelOneData.iamax (n - i % 2) x 0 1).toFloat,
+    mk "sum" N N fun i => pure (P.probe (LevelOneDataExt.sum (n - i % 2) x 0 1)),
+    mk "copy" 0 (2 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.copy (n - i % 2) x 0 1 y 0 1
+      (y, first y)),
+    mk "swap" 0 (4 * N) (← inPlace (x, y) fun _ (x, y) =>
+      let (x, y) := LevelOneData.swap n x 0 1 y 0 1
+      ((x, y), first x)),
+    mk "axpy" (2 * N) (3 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.axpy n (P.scalar (alternateSign i 0.5)) x 0 1 y 0 1
+      (y, first y)),
+    -- y := x + 2y, then y := -x/2 + y/2 restores y
+    mk "axpby" (3 * N) (3 * N) (← inPlace y fun i y =>
+      let a := if i % 2 == 0 then 1.0 else -0.5
+      let y := LevelOneDataExt.axpby n (P.scalar a) x 0 1 (P.scalar (alternate i 2.0)) y 0 1
+      (y, first y)),
+    mk "scal" N (2 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.scal n (P.scalar (alternate i 2.0)) y 0 1
+      (y, first y))]
+  if P.hasRot then
+    cases := cases.push <| mk "rot" (6 * N) (4 * N) (← inPlace (x, y) fun i (x, y) =>
+      let (x, y) := LevelOneData.rot n x 0 1 y 0 1 (P.scalar 0.6) (P.scalar (alternateSign i 0.8))
+      ((x, y), first x))
+  return cases
+
+/-- The elementwise operations of `LevelOneDataExt`. Flop counts are one per
+element and function; byte counts include the in-place output. -/
+def elementwise (P : Precision α K) (n : Nat) : IO (Array Case) := do
+  let x := P.ofFn n fun i => 1.5 + 0.5 * Float.sin (i.toFloat * 0.1)
+  let xinv := P.ofFn n fun i => 1.0 / (1.5 + 0.5 * Float.sin (i.toFloat * 0.1))
+  let y := P.ofFn n fun i => 1.5 + 0.5 * Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let mk := fun (op : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := s!"n={n}", model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let update (op : String) (flops bytes : Float) (f : Nat → α → α) : IO Case := do
+    return mk op flops bytes (← inPlace y fun i y => let y := f i y; (y, first y))
+  -- each update is undone by the next one (`exp` alternates with `log`), or
+  -- converges, so `y` stays bounded
+  return #[
+    (← update "scaladd" (2 * N) (2 * N) fun i y =>
+      if i % 2 == 0 then LevelOneDataExt.scaladd n (P.scalar 2.0) y 0 1 (P.scalar 1.0)
+      else LevelOneDataExt.scaladd n (P.scalar 0.5) y 0 1 (P.scalar (-0.5))),
+    (← update "mul" N (3 * N) fun i y =>
+      LevelOneDataExt.mul n (if i % 2 == 0 then x else xinv) 0 1 y 0 1),
+    (← update "div" N (3 * N) fun _ y => LevelOneDataExt.div n x 0 1 y 0 1),
+    (← update "inv" N (2 * N) fun _ y => LevelOneDataExt.inv n y 0 1),
+    (← update "abs" N (2 * N) fun _ y => LevelOneDataExt.abs n y 0 1),
+    (← update "sqrt" N (2 * N) fun _ y => LevelOneDataExt.sqrt n y 0 1),
+    (← update "exp" N (2 * N) fun i y =>
+      if i % 2 == 0 then LevelOneDataExt.exp n y 0 1 else LevelOneDataExt.log n y 0 1),
+    (← update "sin" N (2 * N) fun _ y => LevelOneDataExt.sin n y 0 1),
+    (← update "cos" N (2 * N) fun _ y => LevelOneDataExt.cos n y 0 1)]
+
+def level2 (P : Precision α K) (n : Nat) : IO (Array Case) := do
+  let kb := min 16 (n - 1)
+  let A := P.ofFn (n * n) fun i => Float.sin (i.toFloat * 0.01)
+  let L := P.ofFn (n * n) (lowerTriangular n)
+  let band := P.ofFn ((2 * kb + 1) * n) fun i => Float.sin (i.toFloat * 0.01)
+  let Lb := P.ofFn ((kb + 1) * n) (lowerBand kb)
+  let packed := lowerPacked n
+  let Lp := P.ofFn packed.size (packed[·]!)
+  let x := P.ofFn n fun i => Float.sin (i.toFloat * 0.1)
+  let y := P.ofFn n fun i => Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let Kb := kb.toFloat
+  let e := P.elemBytes.toFloat
+  let mk := fun (op : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := s!"n={n}", model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let triangular := fun (op : String) (flops bytes : Float) (call : α → α) =>
+    mk op flops bytes fun _ => pure (first (call x))
+  return #[
+    mk "gemv" (2 * N * N) (N * N + 3 * N) (← inPlace y fun i y =>
+      let y := LevelTwoData.gemv .ColMajor .NoTrans n n (P.scalar (alternate i 2.0)) A 0 n x 0 1
+        (P.scalar 0.0) y 0 1
+      (y, first y)),
+    mk "bmv" (2 * N * (2 * Kb + 1)) ((2 * Kb + 1) * N + 3 * N) (← inPlace y fun i y =>
+      let y := LevelTwoData.bmv .ColMajor .NoTrans n n kb kb (P.scalar (alternate i 2.0))
+        band 0 (2 * kb + 1) x 0 1 (P.scalar 0.0) y 0 1
+      (y, first y)),
+    triangular "trmv" (N * N) (N * N / 2 + 2 * N)
+      (LevelTwoData.trmv .ColMajor .Lower .NoTrans false n L 0 n · 0 1),
+    triangular "tbmv" (N * (2 * Kb + 1)) ((Kb + 1) * N + 2 * N)
+      (LevelTwoData.tbmv .ColMajor .Lower .NoTrans false n kb Lb 0 (kb + 1) · 0 1),
+    triangular "tpmv" (N * N) (N * N / 2 + 2 * N)
+      (LevelTwoData.tpmv .ColMajor .Lower .NoTrans false n Lp 0 · 0 1),
+    triangular "trsv" (N * N) (N * N / 2 + 2 * N)
+      (LevelTwoData.trsv .ColMajor .Lower .NoTrans false n L 0 n · 0 1),
+    triangular "tbsv" (N * (2 * Kb + 1)) ((Kb + 1) * N + 2 * N)
+      (LevelTwoData.tbsv .ColMajor .Lower .NoTrans false n kb Lb 0 (kb + 1) · 0 1),
+    triangular "tpsv" (N * N) (N * N / 2 + 2 * N)
+      (LevelTwoData.tpsv .ColMajor .Lower .NoTrans false n Lp 0 · 0 1),
+    mk "ger" (2 * N * N) (2 * N * N + 2 * N) (← inPlace A fun i A =>
+      let A := LevelTwoData.ger .ColMajor n n (P.scalar (alternateSign i 0.5)) x 0 1 y 0 1 A 0 n
+      (A, first A)),
+    mk "her" (N * N) (N * N + N) (← inPlace A fun i A =>
+      let A := LevelTwoData.her .ColMajor .Lower n (P.scalar (alternateSign i 0.5)) x 0 1 A 0 n
+      (A, first A)),
+    mk "her2" (2 * N * N) (N * N + 2 * N) (← inPlace A fun i A =>
+      let A := LevelTwoData.her2 .ColMajor .Lower n (P.scalar (alternateSign i 0.5)) x 0 1 y 0 1 A 0 n
+      (A, first A))]
+
+/-- One conjugate gradient iteration on a symmetric diagonally dominant `n × n`
+matrix: a `gemv`, a `dot`, two `axpy`, an `nrm2` and an `axpby`, all in place.
+It restarts from `x = 0` once the residual has dropped by `1e-8`, so it keeps
+iterating on meaningful values. Real precisions only. -/
+def cg (P : Precision α K) (n : Nat) : IO Case := do
+  let A := P.ofFn (n * n) fun i =>
+    let r := i % n
+    let c := i / n
+    if r == c then n.toFloat + 1.0 else 1.0 / (1.0 + (r + c).toFloat)
+  let b := P.ofFn n fun i => Float.sin (i.toFloat * 0.1) + 1.0
+  let zero := P.ofFn n fun _ => 0.0
+  let nb := LevelOneData.nrm2 n b 0 1
+  let rr0 := nb * nb
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let one := P.scalar 1.0
+  let body ← inPlace (zero, b, b, zero, rr0) fun _ (x, r, p, q, rr) =>
+    let q := LevelTwoData.gemv .ColMajor .NoTrans n n one A 0 n p 0 1 (P.scalar 0.0) q 0 1
+    let alpha := rr / P.probe (LevelOneData.dot n p 0 1 q 0 1)
+    let x := LevelOneData.axpy n (P.scalar alpha) p 0 1 x 0 1
+    let r := LevelOneData.axpy n (P.scalar (-alpha)) q 0 1 r 0 1
+    let nr := LevelOneData.nrm2 n r 0 1
+    let rr' := nr * nr
+    if rr' < 1e-8 * rr0 then
+      let x := LevelOneData.scal n (P.scalar 0.0) x 0 1
+      let r := LevelOneData.copy n b 0 1 r 0 1
+      let p := LevelOneData.copy n b 0 1 p 0 1
+      ((x, r, p, q, rr0), rr')
+    else
+      let p := LevelOneDataExt.axpby n one r 0 1 (P.scalar (rr' / rr)) p 0 1
+      ((x, r, p, q, rr'), rr')
+  return { op := "cg", shape := s!"n={n}", model := ⟨2 * N * N + 13 * N, e * (N * N + 14 * N)⟩, body }
+
+def level3 (P : Precision α K) (n : Nat) : IO (Array Case) := do
+  let A := P.ofFn (n * n) fun i => Float.sin (i.toFloat * 0.01)
+  let B := P.ofFn (n * n) fun i => Float.cos (i.toFloat * 0.01)
+  let C := P.ofFn (n * n) fun _ => 0.0
+  let L := P.ofFn (n * n) (lowerTriangular n)
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let mk := fun (op : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := s!"m={n} n={n} k={n}", model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let zero := P.scalar 0.0
+  return #[
+    mk "gemm" (2 * N * N * N) (4 * N * N) (← inPlace C fun i C =>
+      let C := LevelThreeData.gemm .ColMajor .NoTrans .NoTrans n n n (P.scalar (alternate i 2.0))
+        A 0 n B 0 n zero C 0 n
+      (C, first C)),
+    mk "symm" (2 * N * N * N) (3.5 * N * N) (← inPlace C fun i C =>
+      let C := LevelThreeData.symm .ColMajor .Left .Lower n n (P.scalar (alternate i 2.0))
+        A 0 n B 0 n zero C 0 n
+      (C, first C)),
+    mk "syrk" (N * N * N) (2 * N * N) (← inPlace C fun i C =>
+      let C := LevelThreeData.syrk .ColMajor .Lower .NoTrans n n (P.scalar (alternate i 2.0))
+        A 0 n zero C 0 n
+      (C, first C)),
+    mk "syr2k" (2 * N * N * N) (3 * N * N) (← inPlace C fun i C =>
+      let C := LevelThreeData.syr2k .ColMajor .Lower .NoTrans n n (P.scalar (alternate i 2.0))
+        A 0 n B 0 n zero C 0 n
+      (C, first C)),
+    mk "trmm" (N * N * N) (2.5 * N * N) fun _ =>
+      pure (first (LevelThreeData.trmm .ColMajor .Left .Lower .NoTrans false n n (P.scalar 1.0)
+        L 0 n B 0 n)),
+    mk "trsm" (N * N * N) (2.5 * N * N) fun _ =>
+      pure (first (LevelThreeData.trsm .ColMajor .Left .Lower .NoTrans false n n (P.scalar 1.0)
+        L 0 n B 0 n))]
+
+/-- The cases of `P` at `sizes` whose operation is in `ops` (all if empty). -/
+def cases (sizes : Sizes) (ops : List String) (P : Precision α K) : IO (Array Case) := do
+  let mut cs := #[]
+  for n in sizes.level1 do cs := cs ++ (← level1 P n) ++ (← elementwise P n)
+  for n in sizes.level2 do
+    cs := cs ++ (← level2 P n)
+    if P.real then cs := cs.push (← cg P n)
+  for n in sizes.level3 do cs := cs ++ (← level3 P n)
+  return cs.filter fun c => ops.isEmpty || ops.contains c.op
+
+/-- Measures the cases of `P` that pass the filters and prints one line per case. -/
+def run (cfg : Config) (sizes : Sizes) (ops : List String) (P : Precision α K) :
+    IO (Array Result) := do
+  let mut results := #[]
+  for c in (← cases sizes ops P) do
+    let (stats, checksum) ← measure cfg c.body
+    let r : Result := { op := c.op, precision := P.name, shape := c.shape, model := c.model, stats, checksum }
+    printResult r
+    results := results.push r
+  return results
+
+/-- Prints the allocations per call of every case that passes the filters, and
+fails if a `cg` iteration allocates once warmed up. -/
+def runAllocations (sizes : Sizes) (ops : List String) (P : Precision α K) : IO Unit := do
+  let calls := 10
+  for c in (← cases sizes ops P) do
+    let name := s!"{c.op} {P.name} {c.shape}"
+    if c.op == "cg" then
+      assertNoAllocations name 5 (5 * calls) c.body
+    let (stats, _) ← allocations 3 calls c.body
+    let t := AllocProfile.total stats
+    IO.println s!"{c.op}\t{P.name}\t{c.shape}\t{t.allocations.toFloat / calls.toFloat}\t\
+      {t.bytes / calls}\t{t.copies.toFloat / calls.toFloat}\t{t.peakBytes}"
+
+end Cases
+
+structure Options where
+  quick : Bool := false
+  ops : List String := []
+  precisions : List String := []
+  csv : Option String := none
+  allocations : Bool := false
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | "--precision" :: p :: rest => parseArgs { o with precisions := o.precisions ++ [p] } rest
+  | "--csv" :: path :: rest => parseArgs { o with csv := some path } rest
+  | "--allocations" :: rest => parseArgs { o with allocations := true } rest
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: BenchmarkSuite [--quick] [--op NAME]… [--precision f64|f32|c64]… [--csv FILE] [--allocations] \
+    [--json FILE] [--save-baseline FILE] [--compare FILE] [--tolerance X]"
+
+def main (args : List String) : IO UInt32 :=
+  gate "BenchmarkSuite" args fun args => do
+    let o ← match parseArgs {} args with
+      | .ok o => pure o
+      | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+    let cfg : Config := if o.quick then Config.quick else {}
+    let sizes := if o.quick then Sizes.quick else Sizes.full
+    let wanted := fun p => o.precisions.isEmpty || o.precisions.contains p
+    if o.allocations then
+      unless BLAS.Trace.compiled () do
+        throw $ IO.userError "allocation profiling is compiled out (-K trace=off)"
+      IO.println "op\tprecision\tshape\tallocations/call\tbytes/call\tcopies/call\tpeak bytes"
+      if wanted f64.name then runAllocations sizes o.ops f64
+      if wanted f32.name then runAllocations sizes o.ops f32
+      if wanted c64.name then runAllocations sizes o.ops c64
+      return #[]
+    IO.println s!"LeanBLAS benchmark suite ({BLAS.Backend.backendName ()} backend)"
+    printHeader
+    let mut results := #[]
+    if wanted f64.name then results := results ++ (← run cfg sizes o.ops f64)
+    if wanted f32.name then results := results ++ (← run cfg sizes o.ops f32)
+    if wanted c64.name then results := results ++ (← run cfg sizes o.ops c64)
+    if let some path := o.csv then
+      IO.FS.writeFile path (toCsv results)
+      IO.println s!"wrote {results.size} results to {path}"
+    return results
+
+end BLAS.Test.BenchmarkSuite
@@ -0,0 +1,4 @@
+import LeanBLASTest.BenchmarkSuite
+
+def main (args : List String) : IO UInt32 :=
+  BLAS.Test.BenchmarkSuite.main args
@@ -1,5 +1,5 @@
 import LeanBLASTest.Benchmarks
 
-def main : IO Unit :=
-  BLAS.Test.Benchmarks.main
+def main (args : List String) : IO UInt32 :=
+  BLAS.Test.Benchmarks.main args
 
@@ -1,4 +1,5 @@
 import LeanBLAS
+import LeanBLASTest.BenchGate
 
 /-!
 # Performance Benchmarking Suite for LeanBLAS
@@ -67,13 +68,20 @@ def benchmarkDot (sizes : List Nat) : IO Unit := do
     let iterations := if size > 1000000 then 10 else if size > 100000 then 50 else if size > 10000 then 100 else 500
     let timer ← Timer.start
     let mut checksum : Float := 0.0
+    let mut samples : Array Float := #[]
+    let counting ← Bench.startCounters
     for i in [:iterations] do
       let n_i := size - i
+      let t0 ← IO.monoNanosNow
       checksum := checksum + ddot n_i.toUSize x i.toUSize 1 y i.toUSize 1
+      let t1 ← IO.monoNanosNow
+      samples := samples.push (t1 - t0).toFloat
     let elapsed ← timer.elapsed
+    let counters ← Bench.stopCounters counting iterations
 
     let time_per_op := elapsed / Float.ofNat iterations
     let flops := Float.ofNat (2 * size)  -- 2 operations per element (multiply + add)
+    Bench.recordSamples "dot" "f64" s!"n={size}" ⟨flops, Float.ofNat (16 * size)⟩ samples checksum counters
     let gflops := flops / (time_per_op * 1e9)
     let ops_per_sec := 1.0 / time_per_op
 
@@ -96,13 +104,20 @@ def benchmarkNorm (sizes : List Nat) : IO Unit := do
     let iterations := if size > 1000000 then 10 else if size > 100000 then 50 else if size > 10000 then 100 else 500
     let timer ← Timer.start
     let mut checksum : Float := 0.0
+    let mut samples : Array Float := #[]
+    let counting ← Bench.startCounters
     for i in [:iterations] do
       let n_i := size - i
+      let t0 ← IO.monoNanosNow
       checksum := checksum + dnrm2 n_i.toUSize x i.toUSize 1
+      let t1 ← IO.monoNanosNow
+      samples := samples.push (t1 - t0).toFloat
     let elapsed ← timer.elapsed
+    let counters ← Bench.stopCounters counting iterations
 
     let time_per_op := elapsed / Float.ofNat iterations
     let flops := Float.ofNat (2 * size + 1)  -- 2 ops per element + sqrt
+    Bench.recordSamples "nrm2" "f64" s!"n={size}" ⟨flops, Float.ofNat (8 * size)⟩ samples checksum counters
     let gflops := flops / (time_per_op * 1e9)
     let ops_per_sec := 1.0 / time_per_op
 
@@ -128,14 +143,21 @@ def benchmarkAxpy (sizes : List Nat) : IO Unit := do
     let timer ← Timer.start
     let mut checksum : Float := 0.0
     let mut y_mut := y
+    let mut samples : Array Float := #[]
+    let counting ← Bench.startCounters
     for i in [:iterations] do
       let n_i := size - i
+      let t0 ← IO.monoNanosNow
       y_mut := daxpy n_i.toUSize alpha x i.toUSize 1 y_mut i.toUSize 1
+      let t1 ← IO.monoNanosNow
+      samples := samples.push (t1 - t0).toFloat
       checksum := checksum + (y_mut.toFloatArray.get! i)
     let elapsed ← timer.elapsed
+    let counters ← Bench.stopCounters counting iterations
 
     let time_per_op := elapsed / Float.ofNat iterations
     let flops := Float.ofNat (2 * size)  -- 2 operations per element
+    Bench.recordSamples "axpy" "f64" s!"n={size}" ⟨flops, Float.ofNat (24 * size)⟩ samples checksum counters
     let gflops := flops / (time_per_op * 1e9)
     let ops_per_sec := 1.0 / time_per_op
 
@@ -160,11 +182,19 @@ def analyzeCachePerformance : IO Unit := do
       let iterations := 1000
       -- accumulate into checksum to avoid optimisation
       let mut acc : Float := 0.0
+      let mut samples : Array Float := #[]
+      let counting ← Bench.startCounters
       for _ in [:iterations] do
+        let t0 ← IO.monoNanosNow
         acc := acc + dnrm2 size.toUSize x (0).toUSize stride.toUSize
+        let t1 ← IO.monoNanosNow
+        samples := samples.push (t1 - t0).toFloat
       let elapsed ← timer.elapsed
+      let counters ← Bench.stopCounters counting iterations
       let avg := elapsed / Float.ofNat iterations
       times := times.push avg
+      Bench.recordSamples "nrm2" "f64" s!"n={size} inc={stride}"
+        ⟨Float.ofNat (2 * size), Float.ofNat (8 * size)⟩ samples acc counters
 
     IO.print s!"{size}\t\t"
     for i in [:times.size] do
@@ -186,12 +216,19 @@ def estimateMemoryBandwidth : IO Unit := do
     let timer ← Timer.start
     let iterations := 1000
     let mut checksum : Float := 0.0
+    let mut samples : Array Float := #[]
+    let counting ← Bench.startCounters
     for _ in [:iterations] do
+      let t0 ← IO.monoNanosNow
       checksum := checksum + dsum size.toUSize x 0 1  -- Simple sum operation (memory bound)
+      let t1 ← IO.monoNanosNow
+      samples := samples.push (t1 - t0).toFloat
     let elapsed ← timer.elapsed
+    let counters ← Bench.stopCounters counting iterations
 
     let time_per_op := elapsed / Float.ofNat iterations
     let bytes_accessed := Float.ofNat size * 8  -- 8 bytes per Float64
+    Bench.recordSamples "sum" "f64" s!"n={size}" ⟨Float.ofNat size, bytes_accessed⟩ samples checksum counters
     let bandwidth := bytes_accessed / (time_per_op * 1e9)
 
     IO.println s!"{size}\t\t{Timer.formatTime time_per_op}\t{Float.toString bandwidth}\tchk:{checksum}"
@@ -270,7 +307,10 @@ def runAll (test_sizes : List Nat) : IO Unit := do
   IO.println "- System load and other running processes"
   IO.println "- Compiler optimizations enabled"
 
-def main : IO Unit :=
-  runAll [10000, 100000, 1000000, 5000000]
+def main (args : List String) : IO UInt32 :=
+  Bench.gate "BenchmarkTests" args fun _ => do
+    IO.println (← BLAS.Backend.summary)
+    runAll [10000, 100000, 1000000, 5000000]
+    return #[]
 
 end BLAS.Test.Benchmarks
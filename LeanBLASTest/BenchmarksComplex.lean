@@ -0,0 +1,184 @@
+import LeanBLAS
+import LeanBLASTest.BenchmarkSuite
+
+/-!
+# Complex Benchmarks
+
+Performance of the `ComplexFloat64Array` code paths, in three parts:
+
+* the complex wrappers `zdotc`, `zaxpy`, `zgemv`, `zhemv`, `zgemm`, `zhemm`
+  and `zherk`, with real-equivalent flop counts: a complex multiply-add is
+  8 real flops, so `zgemm` is `8mnk` and `zherk` `4n²k`;
+* `zgemm` against the four `dgemm` calls of the same size that compute the same
+  product on split real and imaginary parts (`Cr = ArBr - AiBi`,
+  `Ci = ArBi + AiBr`). A ratio below 1 means the complex kernel is worth using;
+* the `LevelOneDataExt` operations, which are mostly Lean code for complex
+  data and call C for real data, as nanoseconds per element next to the `Float64Array`
+  version of the same operation.
+
+```
+lake exe ComplexBenchmarks [--quick]
+```
+
+plus the `--json`/`--save-baseline`/`--compare` flags of `BLAS.Test.Bench.gate`.
+-/
+
+open BLAS BLAS.CBLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.ComplexBenchmarks
+
+def cx (re im : Float) : ComplexFloat := ⟨re, im⟩
+
+def cvec (n : Nat) (phase : Float) : ComplexFloat64Array :=
+  c64.ofFn n fun i => Float.sin (i.toFloat * 0.1 + phase)
+
+def rvec (n : Nat) (phase : Float) : Float64Array :=
+  f64.ofFn n fun i => Float.sin (i.toFloat * 0.1 + phase)
+
+def first (v : ComplexFloat64Array) : Float := (LevelOneData.get v 0 : ComplexFloat).re
+
+def mk (op shape : String) (flops bytes : Float) (body : Nat → IO Float) : Case :=
+  { op, shape, model := ⟨flops, bytes⟩, body }
+
+/-- `zdotc` and `zaxpy` on `n` elements. -/
+def level1 (n : Nat) : IO (Array Case) := do
+  let x := cvec n 0.0
+  let y := cvec n 1.0
+  let N := n.toFloat
+  let shape := s!"n={n}"
+  return #[
+    mk "zdotc" shape (8 * N) (32 * N) fun i =>
+      pure (zdotc (n - i % 2).toUSize x 0 1 y 0 1).re,
+    mk "zaxpy" shape (8 * N) (48 * N) (← inPlace y fun i y =>
+      let y := zaxpy n.toUSize (cx (alternateSign i 0.5) 0.25) x 0 1 y 0 1
+      (y, first y))]
+
+/-- `zgemv` and `zhemv` on `n × n` matrices. -/
+def level2 (n : Nat) : IO (Array Case) := do
+  let A := cvec (n * n) 0.0
+  let x := cvec n 1.0
+  let y := cvec n 2.0
+  let N := n.toFloat
+  let shape := s!"n={n}"
+  return #[
+    mk "zgemv" shape (8 * N * N) (16 * (N * N + 3 * N)) (← inPlace y fun i y =>
+      let y := zgemv .ColMajor .NoTrans n.toUSize n.toUSize (cx (alternate i 2.0) 0.0) A 0 n.toUSize
+        x 0 1 (cx 0.0 0.0) y 0 1
+      (y, first y)),
+    mk "zhemv" shape (8 * N * N) (16 * (N * N / 2 + 3 * N)) (← inPlace y fun i y =>
+      let y := zhemv .ColMajor .Lower n.toUSize (cx (alternate i 2.0) 0.0) A 0 n.toUSize
+        x 0 1 (cx 0.0 0.0) y 0 1
+      (y, first y))]
+
+/-- `zgemm`, `zhemm`, `zherk` and the four-`dgemm` equivalent of `zgemm` on `n × n`
+matrices. -/
+def level3 (n : Nat) : IO (Array Case) := do
+  let A := cvec (n * n) 0.0
+  let B := cvec (n * n) 1.0
+  let C := cvec (n * n) 2.0
+  let (Ar, Ai, Br, Bi) := (rvec (n * n) 0.0, rvec (n * n) 0.5, rvec (n * n) 1.0, rvec (n * n) 1.5)
+  let m := n.toUSize
+  let N := n.toFloat
+  let shape := s!"m={n} n={n} k={n}"
+  let zero := cx 0.0 0.0
+  return #[
+    mk "zgemm" shape (8 * N * N * N) (16 * 4 * N * N) (← inPlace C fun i C =>
+      let C := zgemm .ColMajor .NoTrans .NoTrans m m m (cx (alternate i 2.0) 0.0) A 0 m B 0 m zero C 0 m
+      (C, first C)),
+    mk "zhemm" shape (8 * N * N * N) (16 * 3.5 * N * N) (← inPlace C fun i C =>
+      let C := zhemm .ColMajor .Left .Lower m m (cx (alternate i 2.0) 0.0) A 0 m B 0 m zero C 0 m
+      (C, first C)),
+    mk "zherk" shape (4 * N * N * N) (16 * 2 * N * N) (← inPlace C fun i C =>
+      let C := zherk .ColMajor .Lower .NoTrans m m (alternate i 2.0) A 0 m 0.0 C 0 m
+      (C, first C)),
+    -- the same 8n³ useful flops, on eight real n × n operands
+    mk "dgemm×4" shape (8 * N * N * N) (8 * 8 * N * N) (← inPlace (rvec (n * n) 0.0, rvec (n * n) 0.0)
+      fun i (Cr, Ci) =>
+        let a := alternate i 2.0
+        let Cr := dgemm .ColMajor .NoTrans .NoTrans m m m a Ar 0 m Br 0 m 0.0 Cr 0 m
+        let Cr := dgemm .ColMajor .NoTrans .NoTrans m m m (-a) Ai 0 m Bi 0 m 1.0 Cr 0 m
+        let Ci := dgemm .ColMajor .NoTrans .NoTrans m m m a Ar 0 m Bi 0 m 0.0 Ci 0 m
+        let Ci := dgemm .ColMajor .NoTrans .NoTrans m m m a Ai 0 m Br 0 m 1.0 Ci 0 m
+        ((Cr, Ci), Cr.toFloatArray.get! 0 + Ci.toFloatArray.get! 0))]
+
+section Ext
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K] [Inhabited α]
+
+/-- The `LevelOneDataExt` operations on `n` elements: those of the suite's
+`elementwise` cases, plus `const`, `sum`, `axpby` and `imaxRe`. -/
+def ext (P : Precision α K) (n : Nat) : IO (Array Case) := do
+  let x := P.ofFn n fun i => Float.sin (i.toFloat * 0.1)
+  let y := P.ofFn n fun i => Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let shape := s!"n={n}"
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let own := #[
+    mk "const" shape 0 (e * N) fun i =>
+      pure (first (LevelOneDataExt.const (n - i % 2) (P.scalar 1.0) : α)),
+    mk "sum" shape (if P.real then N else 2 * N) (e * N) fun i =>
+      pure (P.probe (LevelOneDataExt.sum (n - i % 2) x 0 1)),
+    mk "axpby" shape (if P.real then 3 * N else 14 * N) (3 * e * N) (← inPlace y fun i y =>
+      let a := if i % 2 == 0 then 1.0 else -0.5
+      let y := LevelOneDataExt.axpby n (P.scalar a) x 0 1 (P.scalar (alternate i 2.0)) y 0 1
+      (y, first y)),
+    mk "imaxRe" shape 0 (e * N) fun i =>
+      let k := n - i % 2
+      pure (if h : k = 0 then 0.0 else (LevelOneDataExt.imaxRe k x 0 1 h).toFloat)]
+  return own ++ (← elementwise P n)
+
+end Ext
+
+def measureAll (cfg : Config) (precision : String) (cases : Array Case) : IO (Array Result) := do
+  let mut results := #[]
+  for c in cases do
+    let (stats, checksum) ← measure cfg c.body
+    let r : Result := { op := c.op, precision, shape := c.shape, model := c.model, stats, checksum }
+    printResult r
+    results := results.push r
+  return results
+
+def median (rs : Array Result) (op shape : String) : Option Float :=
+  (rs.find? fun r => r.op == op && r.shape == shape).map (·.stats.median)
+
+def main (args : List String) : IO UInt32 :=
+  gate "ComplexBenchmarks" args fun args => do
+    let quick := args.contains "--quick"
+    if let some arg := args.find? (· != "--quick") then
+      throw $ IO.userError s!"unknown argument {arg}\nusage: ComplexBenchmarks [--quick]"
+    let cfg : Config := if quick then Config.quick else {}
+    let sizes := if quick then Sizes.quick else Sizes.full
+    IO.println (← BLAS.Backend.summary)
+    printHeader
+    let mut blas := #[]
+    for n in sizes.level1 do blas := blas ++ (← measureAll cfg "c64" (← level1 n))
+    for n in sizes.level2 do blas := blas ++ (← measureAll cfg "c64" (← level2 n))
+    for n in sizes.level3 do blas := blas ++ (← measureAll cfg "c64" (← level3 n))
+
+    IO.println "\nzgemm against four dgemm calls of the same size"
+    IO.println "shape\tzgemm\t4 × dgemm\tratio"
+    for n in sizes.level3 do
+      let shape := s!"m={n} n={n} k={n}"
+      if let (some z, some d) := (median blas "zgemm" shape, median blas "dgemm×4" shape) then
+        IO.println s!"{shape}\t{formatNs z}\t{formatNs d}\t{z / d}"
+
+    IO.println "\nLevelOneDataExt: mostly Lean code for c64, C for f64"
+    printHeader
+    let mut extResults := #[]
+    let mut rows : Array String := #[]
+    for n in sizes.level1 do
+      let real ← measureAll cfg "f64" (← ext f64 n)
+      let complex ← measureAll cfg "c64" (← ext c64 n)
+      for r in complex do
+        if let some t := median real r.op r.shape then
+          rows := rows.push s!"{r.op}\t{r.shape}\t{t / n.toFloat}\t{r.stats.median / n.toFloat}\t\
+            {r.stats.median / t}"
+      extResults := extResults ++ real ++ complex
+    IO.println "\nop\tshape\tf64 ns/element\tc64 ns/element\tc64 / f64"
+    rows.forM IO.println
+    return blas ++ extResults
+
+end BLAS.Test.ComplexBenchmarks
+
+def main (args : List String) : IO UInt32 := BLAS.Test.ComplexBenchmarks.main args
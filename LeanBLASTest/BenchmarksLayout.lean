@@ -0,0 +1,242 @@
+import LeanBLAS
+import LeanBLASTest.BenchmarkSuite
+import LeanBLASTest.BenchmarksLevel2
+
+/-!
+# Layout Benchmarks
+
+How much the wrappers slow down away from contiguous column-major data:
+
+* Level 1 (`dot`, `nrm2`, `asum`, `iamax`, `copy`, `swap`, `axpy`, `axpby`,
+  `scal`, `rot`) on `n` elements with `incX = incY` in `{1, 2, 4, n}` — the last
+  walks a row of an `n × n` column-major matrix — and offsets 0 and 1;
+* Level 2, every call of `Level2Benchmarks` in both orders with vector strides
+  `{1, 2, 4, n}`;
+* Level 3 (`gemm`, `symm`, `syrk`, `trmm`, `trsm`) on `n × n` matrices in both
+  orders, with every transpose and leading dimensions `n` and `n + 1`.
+
+Each line gives the median time and its ratio to the first (contiguous,
+column-major, untransposed, `inc = 1`, offset 0) measurement of the same
+operation at the same size. The run ends with the combinations at least
+`--threshold` (default 1.5) times slower than that, slowest first: the
+candidates for dedicated kernels. With `inc ≥ 8` every `Float64Array` element
+is on its own cache line, so part of the slowdown of large strides is traffic
+that no kernel can avoid.
+
+```
+lake exe LayoutBenchmarks [--quick] [--level 1|2|3]… [--op NAME]… [--precision f64|f32|c64]… [--threshold X]
+```
+
+plus the `--json`/`--save-baseline`/`--compare` flags of `BLAS.Test.Bench.gate`.
+-/
+
+open BLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.LayoutBenchmarks
+
+open Level2Benchmarks (f64Packed f32Packed dominant orderName transName)
+
+/-- A measurement and its ratio to the contiguous column-major case. -/
+structure Row where
+  result : Result
+  slowdown : Float
+
+def Row.print (r : Row) : IO Unit :=
+  IO.println s!"{r.result.op}\t{r.result.precision}\t{r.result.shape}\t\
+    {formatNs r.result.stats.median}\t{r.result.gbps}\t{r.slowdown}"
+
+/-- `f` over an `n × n` matrix stored with leading dimension `ld ≥ n`; the
+padding is zero. -/
+def padded (n ld : Nat) (f : Nat → Float) (i : Nat) : Float :=
+  if i % ld < n then f (i / ld * n + i % ld) else 0.0
+
+section Cases
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [LevelThreeData α Float K] [Inhabited α]
+
+/-- The Level 1 calls on `n` elements `inc` apart, starting at `off`. -/
+def level1 (P : Precision α K) (n inc off : Nat) : IO (Array Case) := do
+  let len := off + (n - 1) * inc + 1
+  let x := P.ofFn len fun i => Float.sin (i.toFloat * 0.1)
+  let y := P.ofFn len fun i => Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let mk := fun (op : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := s!"n={n} inc={inc} off={off}", model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v off)
+  let mut cases := #[
+    mk "dot" (2 * N) (2 * N) fun i => pure (P.probe (LevelOneData.dot (n - i % 2) x off inc y off inc)),
+    mk "nrm2" (2 * N) N fun i => pure (LevelOneData.nrm2 (n - i % 2) x off inc),
+    mk "asum" N N fun i => pure (LevelOneData.asum (n - i % 2) x off inc),
+    mk "iamax" N N fun i => pure (LevelOneData.iamax (n - i % 2) x off inc).toFloat,
+    mk "copy" 0 (2 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.copy (n - i % 2) x off inc y off inc
+      (y, first y)),
+    mk "swap" 0 (4 * N) (← inPlace (x, y) fun _ (x, y) =>
+      let (x, y) := LevelOneData.swap n x off inc y off inc
+      ((x, y), first x)),
+    mk "axpy" (2 * N) (3 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.axpy n (P.scalar (alternateSign i 0.5)) x off inc y off inc
+      (y, first y)),
+    mk "axpby" (3 * N) (3 * N) (← inPlace y fun i y =>
+      let a := if i % 2 == 0 then 1.0 else -0.5
+      let y := LevelOneDataExt.axpby n (P.scalar a) x off inc (P.scalar (alternate i 2.0)) y off inc
+      (y, first y)),
+    mk "scal" N (2 * N) (← inPlace y fun i y =>
+      let y := LevelOneData.scal n (P.scalar (alternate i 2.0)) y off inc
+      (y, first y))]
+  if P.hasRot then
+    cases := cases.push <| mk "rot" (6 * N) (4 * N) (← inPlace (x, y) fun i (x, y) =>
+      let (x, y) := LevelOneData.rot n x off inc y off inc (P.scalar 0.6) (P.scalar (alternateSign i 0.8))
+      ((x, y), first x))
+  return cases
+
+/-- The Level 3 calls on `n × n` matrices in `order` with leading dimension `ld`,
+for every transpose they take. Triangular matrices are lower triangular. -/
+def level3 (P : Precision α K) (n : Nat) (order : Order) (ld : Nat) : IO (Array Case) := do
+  let A := P.ofFn (ld * n) (padded n ld fun i => Float.sin (i.toFloat * 0.01))
+  let B := P.ofFn (ld * n) (padded n ld fun i => Float.cos (i.toFloat * 0.01))
+  let C := P.ofFn (ld * n) fun _ => 0.0
+  let L := P.ofFn (ld * n) (padded n ld (dominant n))
+  let N := n.toFloat
+  let e := P.elemBytes.toFloat
+  let shape := fun (trans : String) => s!"n={n} order={orderName order} {trans} ld={ld}"
+  let mk := fun (op trans : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := shape trans, model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let zero := P.scalar 0.0
+  let transposes : List Transpose := [.NoTrans, .Trans]
+  let mut cs := #[]
+  for ta in transposes do
+    for tb in transposes do
+      cs := cs.push <| mk "gemm" s!"trans={transName ta}{transName tb}" (2 * N * N * N) (4 * N * N)
+        (← inPlace C fun i C =>
+          let C := LevelThreeData.gemm order ta tb n n n (P.scalar (alternate i 2.0)) A 0 ld B 0 ld zero C 0 ld
+          (C, first C))
+  for side in [Side.Left, .Right] do
+    cs := cs.push <| mk "symm" s!"side={if side == .Left then "L" else "R"}" (2 * N * N * N) (3.5 * N * N)
+      (← inPlace C fun i C =>
+        let C := LevelThreeData.symm order side .Lower n n (P.scalar (alternate i 2.0)) A 0 ld B 0 ld zero C 0 ld
+        (C, first C))
+  for t in transposes do
+    let tr := s!"trans={transName t}"
+    cs := cs ++ #[
+      mk "syrk" tr (N * N * N) (2 * N * N) (← inPlace C fun i C =>
+        let C := LevelThreeData.syrk order .Lower t n n (P.scalar (alternate i 2.0)) A 0 ld zero C 0 ld
+        (C, first C)),
+      mk "trmm" tr (N * N * N) (2.5 * N * N) fun _ =>
+        pure (first (LevelThreeData.trmm order .Left .Lower t false n n (P.scalar 1.0) L 0 ld B 0 ld)),
+      mk "trsm" tr (N * N * N) (2.5 * N * N) fun _ =>
+        pure (first (LevelThreeData.trsm order .Left .Lower t false n n (P.scalar 1.0) L 0 ld B 0 ld))]
+  return cs
+
+end Cases
+
+structure Options where
+  quick : Bool := false
+  levels : List Nat := []
+  ops : List String := []
+  precisions : List String := []
+  threshold : Float := 1.5
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--level" :: l :: rest => match l.toNat? with
+    | some l => parseArgs { o with levels := o.levels ++ [l] } rest
+    | none => .error s!"--level expects 1, 2 or 3, got {l}"
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | "--precision" :: p :: rest => parseArgs { o with precisions := o.precisions ++ [p] } rest
+  | "--threshold" :: x :: rest => match parseFloat x with
+    | some x => parseArgs { o with threshold := x } rest
+    | none => .error s!"--threshold expects a ratio, got {x}"
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: LayoutBenchmarks [--quick] [--level 1|2|3]… [--op NAME]… [--precision f64|f32|c64]… \
+    [--threshold X] [--json FILE] [--save-baseline FILE] [--compare FILE] [--tolerance X]"
+
+/-- Measures the cases of every layout in turn. The first case of an operation
+is the reference for the later ones, so `layouts` starts with the contiguous
+column-major one. Cases are built one layout at a time to bound the memory in use. -/
+def sweep (cfg : Config) (o : Options) (precision : String) (layouts : List (IO (Array Case))) :
+    IO (Array Row) := do
+  let mut rows := #[]
+  let mut reference : Array (String × Float) := #[]
+  for layout in layouts do
+    for c in (← layout) do
+      unless o.ops.isEmpty || o.ops.contains c.op do continue
+      let (stats, checksum) ← measure cfg c.body
+      let result : Result := { op := c.op, precision, shape := c.shape, model := c.model, stats, checksum }
+      let base ← match reference.find? (·.1 == c.op) with
+        | some (_, t) => pure t
+        | none =>
+          reference := reference.push (c.op, stats.median)
+          pure stats.median
+      let row : Row := { result, slowdown := stats.median / base }
+      row.print
+      rows := rows.push row
+  return rows
+
+section Run
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [LevelThreeData α Float K] [Inhabited α]
+
+def run (cfg : Config) (o : Options) (P : Precision α K) (packed : Option (Level2Benchmarks.PackedOps α K)) :
+    IO (Array Row) := do
+  let wanted := fun l => o.levels.isEmpty || o.levels.contains l
+  let orders := [Order.ColMajor, .RowMajor]
+  let mut rows := #[]
+  if wanted 1 then
+    let n := if o.quick then 512 else 2048
+    rows := rows ++ (← sweep cfg o P.name <| Id.run do
+      let mut layouts : List (IO (Array Case)) := []
+      for inc in [1, 2, 4, n] do
+        for off in [0, 1] do
+          layouts := layouts ++ [level1 P n inc off]
+      return layouts)
+  if wanted 2 then
+    let n := if o.quick then 256 else 1024
+    rows := rows ++ (← sweep cfg o P.name <| Id.run do
+      let mut layouts : List (IO (Array Case)) := []
+      for order in orders do
+        for inc in [1, 2, 4, n] do
+          layouts := layouts ++ [Level2Benchmarks.cases P packed n order inc]
+      return layouts)
+  if wanted 3 then
+    let n := if o.quick then 128 else 512
+    rows := rows ++ (← sweep cfg o P.name <| Id.run do
+      let mut layouts : List (IO (Array Case)) := []
+      for order in orders do
+        for ld in [n, n + 1] do
+          layouts := layouts ++ [level3 P n order ld]
+      return layouts)
+  return rows
+
+end Run
+
+def main (args : List String) : IO UInt32 :=
+  gate "LayoutBenchmarks" args fun args => do
+    let o ← match parseArgs {} args with
+      | .ok o => pure o
+      | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+    let cfg : Config := if o.quick then Config.quick else {}
+    IO.println (← BLAS.Backend.summary)
+    IO.println "op\tprecision\tshape\tmedian\tGB/s\tslowdown"
+    let precisions := if o.precisions.isEmpty then ["f64"] else o.precisions
+    let mut rows := #[]
+    if precisions.contains f64.name then rows := rows ++ (← run cfg o f64 (some f64Packed))
+    if precisions.contains f32.name then rows := rows ++ (← run cfg o f32 (some f32Packed))
+    if precisions.contains c64.name then rows := rows ++ (← run cfg o c64 none)
+    let slow := (rows.filter (·.slowdown ≥ o.threshold)).qsort (·.slowdown > ·.slowdown)
+    IO.println s!"\n{slow.size} combinations at least {o.threshold}× slower than contiguous column-major"
+    IO.println "op\tprecision\tshape\tslowdown"
+    for r in slow do
+      IO.println s!"{r.result.op}\t{r.result.precision}\t{r.result.shape}\t{r.slowdown}"
+    return rows.map (·.result)
+
+end BLAS.Test.LayoutBenchmarks
+
+def main (args : List String) : IO UInt32 := BLAS.Test.LayoutBenchmarks.main args
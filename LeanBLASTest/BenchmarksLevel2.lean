@@ -0,0 +1,241 @@
+import LeanBLAS
+import LeanBLASTest.BenchmarkSuite
+import LeanBLASTest.Roofline
+
+/-!
+# Level 2 Benchmarks
+
+Every Level 2 wrapper — `gemv`, `bmv`, the triangular `trmv`/`tbmv`/`tpmv`
+multiplies and `trsv`/`tbsv`/`tpsv` solves, the rank updates `ger`, `her`
+(`syr`) and `her2` (`syr2`), and for real data the packed `gpr`,
+`packedToDense` and `denseToPacked` — for `Float64Array`, `Float32Array` and
+`ComplexFloat64Array`, across
+
+* sizes `n × n`,
+* row- and column-major order,
+* every transpose the operation takes (`ConjTrans` for complex data only),
+* unit and non-unit vector strides (`incX = incY = 2`).
+
+Level 2 calls read every matrix element once and do two flops with it, so
+they run at memory speed: besides the harness statistics, each line gives the
+achieved GB/s as a percentage of the machine's bandwidth, the triad bandwidth
+that `c/bench/roofline_peak.c` measures at the number of BLAS threads (or
+`--bandwidth GBPS`). Byte counts are the compulsory traffic of the elements a
+call touches; a strided vector still moves whole cache lines, which is what the
+stride-2 rows show. Triangular matrices are lower triangular.
+
+```
+lake exe Level2Benchmarks [--quick] [--op gemv]… [--precision f64]… [--size N]… [--bandwidth GBPS] [--peak PATH]
+```
+
+plus the `--json`/`--save-baseline`/`--compare` flags of `BLAS.Test.Bench.gate`.
+-/
+
+open BLAS BLAS.CBLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.Level2Benchmarks
+
+/-- The packed operations outside `LevelTwoData`, for the precisions that have them. -/
+structure PackedOps (α K : Type) where
+  gpr : Order → UpLo → Nat → K → α → Nat → α → Nat → α → α
+  toDense : Nat → UpLo → Order → α → α → Nat → α
+  toPacked : Nat → UpLo → Order → α → Nat → α → α
+
+def f64Packed : PackedOps Float64Array Float where
+  gpr order uplo n a X incX Y incY Ap :=
+    dgpr order uplo n.toUSize a X 0 incX.toUSize Y 0 incY.toUSize Ap 0
+  toDense n uplo order Ap A lda := dpackedToDense n.toUSize uplo order Ap order A 0 lda.toUSize
+  toPacked n uplo order A lda Ap := ddenseToPacked n.toUSize uplo order A 0 lda.toUSize order Ap
+
+def f32Packed : PackedOps Float32Array Float where
+  gpr order uplo n a X incX Y incY Ap :=
+    sgpr order uplo n.toUSize a X 0 incX.toUSize Y 0 incY.toUSize Ap 0
+  toDense n uplo order Ap A lda := spackedToDense n.toUSize uplo order Ap order A 0 lda.toUSize
+  toPacked n uplo order A lda Ap := sdenseToPacked n.toUSize uplo order A 0 lda.toUSize order Ap
+
+/-- `n × n` matrix with 4 on the diagonal and small entries elsewhere, so that
+either triangle in either order is well conditioned. -/
+def dominant (n : Nat) (i : Nat) : Float :=
+  if i % n == i / n then 4.0 else 0.1 * Float.sin i.toFloat
+
+/-- Band storage of a lower triangular matrix with `k` subdiagonals: the diagonal
+is the first entry of each column (column-major) or the last of each row (row-major). -/
+def lowerBand (order : Order) (k : Nat) (i : Nat) : Float :=
+  let d := if order == .ColMajor then 0 else k
+  if i % (k + 1) == d then 4.0 else 0.1 * Float.sin i.toFloat
+
+/-- Packed storage of an `n × n` lower triangular matrix in `order`. -/
+def lowerPacked (order : Order) (n : Nat) : Array Float := Id.run do
+  let mut a : Array Float := #[]
+  for j in [0:n] do
+    -- column `j` (column-major) or row `j` (row-major) of the triangle
+    let (lo, hi) := if order == .ColMajor then (j, n) else (0, j + 1)
+    for i in [lo:hi] do
+      a := a.push (if i == j then 4.0 else 0.1 * Float.sin (i * n + j).toFloat)
+  return a
+
+def orderName : Order → String
+  | .RowMajor => "row"
+  | .ColMajor => "col"
+
+def transName : Transpose → String
+  | .NoTrans => "N"
+  | .Trans => "T"
+  | .ConjTrans => "C"
+
+section Cases
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [Inhabited α]
+
+/-- The cases of one precision, size, order and vector stride. -/
+def cases (P : Precision α K) (packed : Option (PackedOps α K)) (n : Nat) (order : Order)
+    (inc : Nat) : IO (Array Case) := do
+  let kb := min 16 (n - 1)
+  let transposes : List Transpose := if P.real then [.NoTrans, .Trans] else [.NoTrans, .Trans, .ConjTrans]
+  let A := P.ofFn (n * n) (dominant n)
+  let band := P.ofFn ((2 * kb + 1) * n) fun i => Float.sin (i.toFloat * 0.01)
+  let Lb := P.ofFn ((kb + 1) * n) (lowerBand order kb)
+  let packedL := lowerPacked order n
+  let Lp := P.ofFn packedL.size (packedL[·]!)
+  let x := P.ofFn (n * inc) fun i => Float.sin (i.toFloat * 0.1)
+  let y := P.ofFn (n * inc) fun i => Float.cos (i.toFloat * 0.1)
+  let N := n.toFloat
+  let Kb := kb.toFloat
+  let Np := (n * (n + 1) / 2).toFloat
+  let e := P.elemBytes.toFloat
+  let shape := fun (trans : String) => s!"n={n} order={orderName order}{trans} inc={inc}"
+  let mk := fun (op trans : String) (flops bytes : Float) (body : Nat → IO Float) =>
+    ({ op, shape := shape trans, model := ⟨P.flopScale * flops, e * bytes⟩, body } : Case)
+  let first := fun (v : α) => P.probe (LevelOneData.get v 0)
+  let zero := P.scalar 0.0
+  let mut cs := #[]
+  for t in transposes do
+    let tr := s!" trans={transName t}"
+    -- the triangular calls start from the same `x` every call, so they include one copy of it
+    let triangular := fun (op : String) (flops bytes : Float) (call : α → α) =>
+      mk op tr flops bytes fun _ => pure (first (call x))
+    cs := cs ++ #[
+      mk "gemv" tr (2 * N * N) (N * N + 3 * N) (← inPlace y fun i y =>
+        let y := LevelTwoData.gemv order t n n (P.scalar (alternate i 2.0)) A 0 n x 0 inc zero y 0 inc
+        (y, first y)),
+      mk "bmv" tr (2 * N * (2 * Kb + 1)) ((2 * Kb + 1) * N + 3 * N) (← inPlace y fun i y =>
+        let y := LevelTwoData.bmv order t n n kb kb (P.scalar (alternate i 2.0)) band 0 (2 * kb + 1)
+          x 0 inc zero y 0 inc
+        (y, first y)),
+      triangular "trmv" (N * N) (N * N / 2 + 2 * N)
+        (LevelTwoData.trmv order .Lower t false n A 0 n · 0 inc),
+      triangular "tbmv" (2 * N * Kb) ((Kb + 1) * N + 2 * N)
+        (LevelTwoData.tbmv order .Lower t false n kb Lb 0 (kb + 1) · 0 inc),
+      triangular "tpmv" (N * N) (Np + 2 * N)
+        (LevelTwoData.tpmv order .Lower t false n Lp 0 · 0 inc),
+      triangular "trsv" (N * N) (N * N / 2 + 2 * N)
+        (LevelTwoData.trsv order .Lower t false n A 0 n · 0 inc),
+      triangular "tbsv" (2 * N * Kb) ((Kb + 1) * N + 2 * N)
+        (LevelTwoData.tbsv order .Lower t false n kb Lb 0 (kb + 1) · 0 inc),
+      triangular "tpsv" (N * N) (Np + 2 * N)
+        (LevelTwoData.tpsv order .Lower t false n Lp 0 · 0 inc)]
+  -- rank updates alternate the sign of alpha, so `A` returns to its start every other call
+  cs := cs ++ #[
+    mk "ger" "" (2 * N * N) (2 * N * N + 2 * N) (← inPlace A fun i A =>
+      let A := LevelTwoData.ger order n n (P.scalar (alternateSign i 0.5)) x 0 inc y 0 inc A 0 n
+      (A, first A)),
+    mk "her" "" (N * N) (N * N + N) (← inPlace A fun i A =>
+      let A := LevelTwoData.her order .Lower n (P.scalar (alternateSign i 0.5)) x 0 inc A 0 n
+      (A, first A)),
+    mk "her2" "" (2 * N * N) (N * N + 2 * N) (← inPlace A fun i A =>
+      let A := LevelTwoData.her2 order .Lower n (P.scalar (alternateSign i 0.5)) x 0 inc y 0 inc A 0 n
+      (A, first A))]
+  if let some ops := packed then
+    let D := P.ofFn (n * n) fun _ => 0.0
+    cs := cs ++ #[
+      mk "gpr" "" (2 * Np) (2 * Np + 2 * N) (← inPlace Lp fun i Lp =>
+        let Lp := ops.gpr order .Lower n (P.scalar (alternateSign i 0.5)) x inc y inc Lp
+        (Lp, first Lp)),
+      mk "packedToDense" "" 0 (Np + N * N) (← inPlace D fun _ D =>
+        let D := ops.toDense n .Lower order Lp D n
+        (D, first D)),
+      mk "denseToPacked" "" 0 (N * N / 2 + Np) (← inPlace Lp fun _ Lp =>
+        let Lp := ops.toPacked n .Lower order A n Lp
+        (Lp, first Lp))]
+  return cs
+
+/-- Measures the cases of `P` and prints GB/s against `bandwidth`. -/
+def run (cfg : Config) (sizes : List Nat) (ops : List String) (bandwidth : Option Float)
+    (P : Precision α K) (packed : Option (PackedOps α K)) : IO (Array Result) := do
+  let mut results := #[]
+  for n in sizes do
+    for order in [Order.ColMajor, .RowMajor] do
+      for inc in [1, 2] do
+        for c in (← cases P packed n order inc) do
+          unless ops.isEmpty || ops.contains c.op do continue
+          let (stats, checksum) ← measure cfg c.body
+          let r : Result :=
+            { op := c.op, precision := P.name, shape := c.shape, model := c.model, stats, checksum }
+          let pct := match bandwidth with
+            | some bw => s!"{100.0 * r.gbps / bw}%"
+            | none => "-"
+          IO.println s!"{r.op}\t{r.precision}\t{r.shape}\t{formatNs r.stats.median}\t\
+            {r.gflops}\t{r.gbps}\t{pct}"
+          results := results.push r
+  return results
+
+end Cases
+
+structure Options where
+  quick : Bool := false
+  ops : List String := []
+  precisions : List String := []
+  sizes : List Nat := []
+  bandwidth : Option Float := none
+  peak : String := ".lake/build/bin/roofline_peak_c"
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | "--precision" :: p :: rest => parseArgs { o with precisions := o.precisions ++ [p] } rest
+  | "--size" :: n :: rest => match n.toNat? with
+    | some n => parseArgs { o with sizes := o.sizes ++ [n] } rest
+    | none => .error s!"--size expects a number, got {n}"
+  | "--bandwidth" :: b :: rest => match parseFloat b with
+    | some b => parseArgs { o with bandwidth := some b } rest
+    | none => .error s!"--bandwidth expects GB/s, got {b}"
+  | "--peak" :: path :: rest => parseArgs { o with peak := path } rest
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: Level2Benchmarks [--quick] [--op NAME]… [--precision f64|f32|c64]… [--size N]… \
+    [--bandwidth GBPS] [--peak PATH] [--json FILE] [--save-baseline FILE] [--compare FILE] [--tolerance X]"
+
+/-- The triad bandwidth at the BLAS thread count, or `none` if it cannot be measured. -/
+def machineBandwidth (o : Options) : IO (Option Float) := do
+  if o.bandwidth.isSome then return o.bandwidth
+  let threads ← Roofline.blasThreads
+  try
+    let roofs ← Roofline.measureRoofs o.peak threads
+    return some (Roofline.roofAt roofs.triad threads)
+  catch e =>
+    IO.eprintln s!"Level2Benchmarks: no bandwidth to compare with ({e}); pass --bandwidth GBPS"
+    return none
+
+def main (args : List String) : IO UInt32 :=
+  gate "Level2Benchmarks" args fun args => do
+    let o ← match parseArgs {} args with
+      | .ok o => pure o
+      | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+    let cfg : Config := if o.quick then Config.quick else {}
+    let sizes := if !o.sizes.isEmpty then o.sizes else if o.quick then [256] else [64, 512, 2048]
+    IO.println (← BLAS.Backend.summary)
+    let bandwidth ← machineBandwidth o
+    if let some bw := bandwidth then
+      IO.println s!"machine bandwidth: {bw} GB/s (triad)\n"
+    IO.println "op\tprecision\tshape\tmedian\tGFLOP/s\tGB/s\t% of bandwidth"
+    let wanted := fun p => o.precisions.isEmpty || o.precisions.contains p
+    let mut results := #[]
+    if wanted f64.name then results := results ++ (← run cfg sizes o.ops bandwidth f64 (some f64Packed))
+    if wanted f32.name then results := results ++ (← run cfg sizes o.ops bandwidth f32 (some f32Packed))
+    if wanted c64.name then results := results ++ (← run cfg sizes o.ops bandwidth c64 none)
+    return results
+
+end BLAS.Test.Level2Benchmarks
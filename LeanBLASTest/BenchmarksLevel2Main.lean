@@ -0,0 +1,4 @@
+import LeanBLASTest.BenchmarksLevel2
+
+def main (args : List String) : IO UInt32 :=
+  BLAS.Test.Level2Benchmarks.main args
@@ -1,4 +1,5 @@
 import LeanBLAS
+import LeanBLASTest.BenchGate
 import LeanBLAS.CBLAS.LevelThree
 import LeanBLAS.FFI.CBLASLevelThreeFloat64
 
@@ -48,16 +49,24 @@ def benchGemm (sizes : List Nat) : IO Unit := do
     -- Timing loop with checksum accumulation (first element)
     let start ← IO.monoNanosNow
     let mut checksum : Float := 0.0
+    let mut samples : Array Float := #[]
+    let counting ← Bench.startCounters
     for _ in [:iterations] do
+      let t0 ← IO.monoNanosNow
       c := gemmNat Order.RowMajor Transpose.NoTrans Transpose.NoTrans m n k 1.0 a 0 k b 0 n 0.0 c 0 n
+      let t1 ← IO.monoNanosNow
+      samples := samples.push (t1 - t0).toFloat
       checksum := checksum + (c.toFloatArray.get! 0)
     let stop ← IO.monoNanosNow
+    let counters ← Bench.stopCounters counting iterations
 
     let elapsed_sec := Float.ofNat (stop - start) / 1e9
     let time_per_op := elapsed_sec / Float.ofNat iterations
 
     let flops := 2.0 * (Float.ofNat m) * (Float.ofNat n) * (Float.ofNat k)
     let gflops := flops / (time_per_op * 1e9)
+    Bench.recordSamples "gemm" "f64" s!"m={m} n={n} k={k}"
+      ⟨flops, Float.ofNat (8 * (m * k + k * n + m * n))⟩ samples checksum counters
 
     IO.println s!"{n}x{n}\t{formatTime time_per_op}\t{Float.toString gflops}\t{checksum}"
 
@@ -81,12 +90,15 @@ def quickCorrectness : IO Unit := do
     IO.println "❌ GEMM produced wrong result"
 
 /-- Entry point for `lake exe Level3Benchmarks` -/
-def main : IO Unit := do
-  quickCorrectness
-  IO.println ""
-  benchGemm [64, 128, 256, 512]
-  IO.println "\n✓ Level-3 benchmarks completed!"
+def main (args : List String) : IO UInt32 :=
+  Bench.gate "Level3Benchmarks" args fun _ => do
+    IO.println (← BLAS.Backend.summary)
+    quickCorrectness
+    IO.println ""
+    benchGemm [64, 128, 256, 512]
+    IO.println "\n✓ Level-3 benchmarks completed!"
+    return #[]
 
 end BLAS.Test.Level3Benchmarks
 
-def main : IO Unit := BLAS.Test.Level3Benchmarks.main
+def main (args : List String) : IO UInt32 := BLAS.Test.Level3Benchmarks.main args
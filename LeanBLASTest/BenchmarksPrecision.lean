@@ -0,0 +1,171 @@
+import LeanBLAS
+import LeanBLASTest.BenchmarkSuite
+
+/-!
+# Precision Benchmarks
+
+Every case of the benchmark suite — Level 1, the elementwise `LevelOneDataExt`
+operations, Level 2, the conjugate gradient iteration and Level 3 — in
+`Float32Array` and `Float64Array` at identical shapes, side by side:
+
+* the median time of each and the speedup of `f32` over `f64`;
+* the bytes each call moves by the suite's byte model, and the GB/s reached;
+* the relative error of the `f32` result against the `f64` result of the same
+  call on the same data, `‖r₃₂ - r₆₄‖₂ / ‖r₆₄‖₂` over all output elements (or
+  `|r₃₂ - r₆₄| / |r₆₄|` for a scalar). Inputs are generated in `Float` and
+  rounded to `Float32`, so the error includes that rounding, as it would in a
+  pipeline that switches precision. Operations with exact results (`copy`,
+  `swap`, `iamax`, `const`) and `cg` show `-`.
+
+Memory-bound calls should approach a 2× speedup; compute-bound ones gain what
+the wider `f32` SIMD lanes give.
+
+```
+lake exe PrecisionBenchmarks [--quick] [--op NAME]…
+```
+
+plus the `--json`/`--save-baseline`/`--compare` flags of `BLAS.Test.Bench.gate`.
+-/
+
+open BLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.PrecisionBenchmarks
+
+section Accuracy
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [LevelThreeData α Float K] [Inhabited α]
+
+/-- All elements of `v`, as `Float`. -/
+def values (P : Precision α K) (v : α) : Array Float :=
+  (Array.range (LevelOneData.size v)).map fun i => P.probe (LevelOneData.get v i)
+
+/-- One call of each operation with an inexact result, on the suite's data:
+Level 1 and elementwise calls on `n1` elements, Level 2 on `n2 × n2` and Level 3
+on `n3 × n3` matrices. -/
+def outputs (P : Precision α K) (n1 n2 n3 : Nat) : Array (String × Array Float) := Id.run do
+  let vec := fun (n : Nat) (f : Float → Float) => P.ofFn n fun i => f (i.toFloat * 0.1)
+  let x := vec n1 Float.sin
+  let y := vec n1 Float.cos
+  -- positive data for the elementwise operations, as in `elementwise`
+  let px := vec n1 fun t => 1.5 + 0.5 * Float.sin t
+  let py := vec n1 fun t => 1.5 + 0.5 * Float.cos t
+  let s := P.scalar
+  let v := values P
+  let n := n1
+  let l1 := #[
+    ("dot", #[P.probe (LevelOneData.dot n x 0 1 y 0 1)]),
+    ("nrm2", #[LevelOneData.nrm2 n x 0 1]),
+    ("asum", #[LevelOneData.asum n x 0 1]),
+    ("sum", #[P.probe (LevelOneDataExt.sum n x 0 1)]),
+    ("axpy", v (LevelOneData.axpy n (s 0.3) x 0 1 y 0 1)),
+    ("axpby", v (LevelOneDataExt.axpby n (s 0.3) x 0 1 (s 0.7) y 0 1)),
+    ("scal", v (LevelOneData.scal n (s 0.3) y 0 1)),
+    ("rot", (fun (a, b) => v a ++ v b) (LevelOneData.rot n x 0 1 y 0 1 (s 0.6) (s 0.8))),
+    ("scaladd", v (LevelOneDataExt.scaladd n (s 0.3) py 0 1 (s 0.7))),
+    ("mul", v (LevelOneDataExt.mul n px 0 1 py 0 1)),
+    ("div", v (LevelOneDataExt.div n px 0 1 py 0 1)),
+    ("inv", v (LevelOneDataExt.inv n py 0 1)),
+    ("abs", v (LevelOneDataExt.abs n y 0 1)),
+    ("sqrt", v (LevelOneDataExt.sqrt n py 0 1)),
+    ("exp", v (LevelOneDataExt.exp n py 0 1)),
+    ("sin", v (LevelOneDataExt.sin n py 0 1)),
+    ("cos", v (LevelOneDataExt.cos n py 0 1))]
+  let n := n2
+  let kb := min 16 (n - 1)
+  let A := P.ofFn (n * n) fun i => Float.sin (i.toFloat * 0.01)
+  let L := P.ofFn (n * n) (lowerTriangular n)
+  let band := P.ofFn ((2 * kb + 1) * n) fun i => Float.sin (i.toFloat * 0.01)
+  let x := vec n Float.sin
+  let y := vec n Float.cos
+  let l2 := #[
+    ("gemv", v (LevelTwoData.gemv .ColMajor .NoTrans n n (s 1.0) A 0 n x 0 1 (s 0.0) y 0 1)),
+    ("bmv", v (LevelTwoData.bmv .ColMajor .NoTrans n n kb kb (s 1.0) band 0 (2 * kb + 1) x 0 1 (s 0.0) y 0 1)),
+    ("trmv", v (LevelTwoData.trmv .ColMajor .Lower .NoTrans false n L 0 n x 0 1)),
+    ("trsv", v (LevelTwoData.trsv .ColMajor .Lower .NoTrans false n L 0 n x 0 1)),
+    ("ger", v (LevelTwoData.ger .ColMajor n n (s 0.5) x 0 1 y 0 1 A 0 n)),
+    ("her", v (LevelTwoData.her .ColMajor .Lower n (s 0.5) x 0 1 A 0 n)),
+    ("her2", v (LevelTwoData.her2 .ColMajor .Lower n (s 0.5) x 0 1 y 0 1 A 0 n))]
+  let n := n3
+  let A := P.ofFn (n * n) fun i => Float.sin (i.toFloat * 0.01)
+  let B := P.ofFn (n * n) fun i => Float.cos (i.toFloat * 0.01)
+  let C := P.ofFn (n * n) fun _ => 0.0
+  let L := P.ofFn (n * n) (lowerTriangular n)
+  let l3 := #[
+    ("gemm", v (LevelThreeData.gemm .ColMajor .NoTrans .NoTrans n n n (s 1.0) A 0 n B 0 n (s 0.0) C 0 n)),
+    ("symm", v (LevelThreeData.symm .ColMajor .Left .Lower n n (s 1.0) A 0 n B 0 n (s 0.0) C 0 n)),
+    ("syrk", v (LevelThreeData.syrk .ColMajor .Lower .NoTrans n n (s 1.0) A 0 n (s 0.0) C 0 n)),
+    ("syr2k", v (LevelThreeData.syr2k .ColMajor .Lower .NoTrans n n (s 1.0) A 0 n B 0 n (s 0.0) C 0 n)),
+    ("trmm", v (LevelThreeData.trmm .ColMajor .Left .Lower .NoTrans false n n (s 1.0) L 0 n B 0 n)),
+    ("trsm", v (LevelThreeData.trsm .ColMajor .Left .Lower .NoTrans false n n (s 1.0) L 0 n B 0 n))]
+  return l1 ++ l2 ++ l3
+
+end Accuracy
+
+/-- `‖a - b‖₂ / ‖b‖₂`, or the absolute error if `b` is zero. -/
+def relativeError (a b : Array Float) : Float := Id.run do
+  let mut diff := 0.0
+  let mut norm := 0.0
+  for i in [0:min a.size b.size] do
+    diff := diff + (a[i]! - b[i]!) * (a[i]! - b[i]!)
+    norm := norm + b[i]! * b[i]!
+  return if norm == 0.0 then diff.sqrt else (diff / norm).sqrt
+
+structure Options where
+  quick : Bool := false
+  ops : List String := []
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: PrecisionBenchmarks [--quick] [--op NAME]… \
+    [--json FILE] [--save-baseline FILE] [--compare FILE] [--tolerance X]"
+
+def formatBytes (b : Float) : String :=
+  if b ≥ 1e9 then s!"{b / 1e9} GB" else if b ≥ 1e6 then s!"{b / 1e6} MB"
+  else if b ≥ 1e3 then s!"{b / 1e3} kB" else s!"{b} B"
+
+def main (args : List String) : IO UInt32 :=
+  gate "PrecisionBenchmarks" args fun args => do
+    let o ← match parseArgs {} args with
+      | .ok o => pure o
+      | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+    let cfg : Config := if o.quick then Config.quick else {}
+    let sizes := if o.quick then Sizes.quick else Sizes.full
+    IO.println (← BLAS.Backend.summary)
+
+    -- errors at the largest size of each level
+    let largest := fun (ns : List Nat) => ns.foldl max 1
+    let (n1, n2, n3) := (largest sizes.level1, largest sizes.level2, largest sizes.level3)
+    let reference := outputs f64 n1 n2 n3
+    let errors := (outputs f32 n1 n2 n3).filterMap fun (op, r) =>
+      (reference.find? (·.1 == op)).map fun (_, ref) => (op, relativeError r ref)
+    IO.println s!"relative errors at n={n1} (Level 1), {n2} (Level 2), {n3} (Level 3)\n"
+
+    IO.println "op\tshape\tf64\tf32\tspeedup\tf64 bytes\tf32 bytes\tf64 GB/s\tf32 GB/s\trel. error"
+    let cases64 ← cases sizes o.ops f64
+    let cases32 ← cases sizes o.ops f32
+    let mut results := #[]
+    for c in cases64 do
+      let some c32 := cases32.find? fun d => d.op == c.op && d.shape == c.shape | continue
+      let (s64, k64) ← measure cfg c.body
+      let (s32, k32) ← measure cfg c32.body
+      let r64 : Result :=
+        { op := c.op, precision := f64.name, shape := c.shape, model := c.model, stats := s64, checksum := k64 }
+      let r32 : Result :=
+        { op := c.op, precision := f32.name, shape := c.shape, model := c32.model, stats := s32, checksum := k32 }
+      let err := match errors.find? (·.1 == c.op) with
+        | some (_, e) => toString e
+        | none => "-"
+      IO.println s!"{c.op}\t{c.shape}\t{formatNs s64.median}\t{formatNs s32.median}\t{s64.median / s32.median}\t\
+        {formatBytes c.model.bytes}\t{formatBytes c32.model.bytes}\t{r64.gbps}\t{r32.gbps}\t{err}"
+      results := results.push r64 |>.push r32
+    return results
+
+end BLAS.Test.PrecisionBenchmarks
+
+def main (args : List String) : IO UInt32 := BLAS.Test.PrecisionBenchmarks.main args
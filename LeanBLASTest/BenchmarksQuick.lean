@@ -1,4 +1,5 @@
 import LeanBLAS
+import LeanBLASTest.BenchGate
 
 /-- Local pretty-printer for durations (replicates logic in `LeanBLASTest/Benchmarks.lean`) -/
 def formatTime (sec : Float) : String :=
@@ -57,10 +58,14 @@ Single operation time: {single_time} seconds"
   -- sanity-check that subsequent iterations keep producing the same number.
   let iterations := 10
   let mut acc : Float := 0.0
+  let mut samples : Array Float := #[]
   let start ← IO.monoNanosNow
   for i in [:iterations] do
     let n_i := size - i
+    let t0 ← IO.monoNanosNow
     acc := acc + ddot n_i.toUSize x i.toUSize 1 y i.toUSize 1
+    let t1 ← IO.monoNanosNow
+    samples := samples.push (t1 - t0).toFloat
   let end_time ← IO.monoNanosNow
 
   -- Use the accumulator so the result is observable.
@@ -70,6 +75,7 @@ Single operation time: {single_time} seconds"
   let time_per_op := total_time / Float.ofNat iterations
   let flops := Float.ofNat (2 * size) -- multiply + add per element
   let gflops := flops / (time_per_op * 1e9)
+  Bench.recordSamples "dot" "f64" s!"n={size}" ⟨flops, Float.ofNat (16 * size)⟩ samples acc
 
   IO.println s!"Total time for {iterations} iterations: {total_time} seconds
 Time per operation: {formatTime time_per_op}
@@ -97,16 +103,21 @@ Expected: {expected_small}"
   
   let iterations := 10
   let mut acc : Float := 0.0
+  let mut samples : Array Float := #[]
   let start ← IO.monoNanosNow
   for i in [:iterations] do
     let n_i := size - i
+    let t0 ← IO.monoNanosNow
     acc := acc + dnrm2 n_i.toUSize x i.toUSize 1
+    let t1 ← IO.monoNanosNow
+    samples := samples.push (t1 - t0).toFloat
   let end_time ← IO.monoNanosNow
 
   let total_time := Float.ofNat (end_time - start) / 1e9
   let time_per_op := total_time / Float.ofNat iterations
   let flops := Float.ofNat (2 * size + 1)  -- square + accumulate + sqrt
   let gflops := flops / (time_per_op * 1e9)
+  Bench.recordSamples "nrm2" "f64" s!"n={size}" ⟨flops, Float.ofNat (8 * size)⟩ samples acc
 
   IO.println s!"Checksum (acc): {acc}"
   IO.println s!"Total time for {iterations} iterations: {total_time} seconds
@@ -145,10 +156,14 @@ def testAxpy : IO Unit := do
   
   let iterations := 10
   let mut checksum := 0.0
+  let mut samples : Array Float := #[]
   let start ← IO.monoNanosNow
   for i in [:iterations] do
     let n_i := size - i
+    let t0 ← IO.monoNanosNow
     y := daxpy n_i.toUSize 2.5 x i.toUSize 1 y i.toUSize 1
+    let t1 ← IO.monoNanosNow
+    samples := samples.push (t1 - t0).toFloat
     checksum := checksum + (y.toFloatArray.get! i)  -- accumulate varying element
   let end_time ← IO.monoNanosNow
 
@@ -156,6 +171,7 @@ def testAxpy : IO Unit := do
   let time_per_op := total_time / Float.ofNat iterations
   let flops := Float.ofNat (2 * size)  -- multiply + add per element
   let gflops := flops / (time_per_op * 1e9)
+  Bench.recordSamples "axpy" "f64" s!"n={size}" ⟨flops, Float.ofNat (24 * size)⟩ samples checksum
 
   IO.println s!"Checksum: {checksum}"
   IO.println s!"Total time for {iterations} iterations: {total_time} seconds
@@ -175,32 +191,39 @@ def testMemoryBandwidth : IO Unit := do
   
   let iterations := 10
   let mut checksum := 0.0
+  let mut samples : Array Float := #[]
   let start ← IO.monoNanosNow
   for _ in [:iterations] do
+    let t0 ← IO.monoNanosNow
     checksum := checksum + dsum size.toUSize x 0 1
+    let t1 ← IO.monoNanosNow
+    samples := samples.push (t1 - t0).toFloat
   let end_time ← IO.monoNanosNow
 
   let total_time := Float.ofNat (end_time - start) / 1e9
   let time_per_op := total_time / Float.ofNat iterations
   let bytes_accessed := Float.ofNat (size * 8)  -- 8 bytes per Float64
   let bandwidth_gb_s := bytes_accessed / (time_per_op * 1e9)
+  Bench.recordSamples "sum" "f64" s!"n={size}" ⟨Float.ofNat size, bytes_accessed⟩ samples checksum
 
   IO.println s!"Checksum: {checksum}"
   IO.println s!"Time per operation: {formatTime time_per_op}"
   IO.println s!"Memory bandwidth: {bandwidth_gb_s} GB/s"
 
 /-- Main benchmark runner -/
-def main : IO Unit := do
-  IO.println "LeanBLAS Level 1 Performance Tests"
-  IO.println "=================================="
-  
-  testDotProduct
-  testNorm
-  testAxpy
-  testMemoryBandwidth
-  
-  IO.println "\n✓ All benchmarks completed!"
+def main (args : List String) : IO UInt32 :=
+  Bench.gate "BenchmarksQuickTest" args fun _ => do
+    IO.println "LeanBLAS Level 1 Performance Tests"
+    IO.println "=================================="
+
+    testDotProduct
+    testNorm
+    testAxpy
+    testMemoryBandwidth
+
+    IO.println "\n✓ All benchmarks completed!"
+    return #[]
 
 end BLAS.Test.BenchmarksQuick
 
-def main : IO Unit := BLAS.Test.BenchmarksQuick.main
+def main (args : List String) : IO UInt32 := BLAS.Test.BenchmarksQuick.main args
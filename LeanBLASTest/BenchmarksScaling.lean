@@ -0,0 +1,203 @@
+import Lean.Data.Json
+import LeanBLAS
+import LeanBLASTest.BenchmarkSuite
+
+/-!
+# Scaling Benchmarks
+
+How the Level 1, 2 and 3 operations scale with cores, in two sweeps over the
+`Float64Array` cases of the benchmark suite:
+
+* **threads**: one caller, with the BLAS set to 1, 2, 4, … threads up to the
+  number of logical CPUs and then twice that. For each count the report gives
+  the median time per call, the speedup over one thread and the parallel
+  efficiency (speedup / threads);
+* **callers**: 1, 2, 4, … Lean tasks calling the same operation at once on their
+  own arrays, with the BLAS at one thread and at one thread per physical core.
+  For each count the report gives the total throughput, its speedup over a
+  single caller and the efficiency (speedup / callers).
+
+Configurations with more busy threads than logical CPUs (threads × callers) are
+marked as oversubscribed, with their slowdown: how much lower their throughput
+is than the best configuration of the same sweep that is not oversubscribed.
+
+The BLAS thread count can be set for the native backend and for OpenBLAS; with
+another system BLAS the thread sweep is skipped.
+
+```
+lake exe ScalingBenchmarks [--quick] [--op gemm]… [--report FILE]
+```
+
+`--report FILE` writes all rows as JSON. The thread sweep also goes through
+`BLAS.Test.Bench.gate` (`--json`/`--save-baseline`/`--compare`).
+-/
+
+open Lean BLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.ScalingBenchmarks
+
+/-- One measured configuration. -/
+structure Row where
+  sweep : String
+  op : String
+  shape : String
+  threads : Nat
+  callers : Nat
+  /-- median time per call of one caller -/
+  medianNs : Float
+  /-- calls per second, summed over the callers -/
+  throughput : Float
+  speedup : Float := 1.0
+  efficiency : Float := 1.0
+  oversubscribed : Bool := false
+  /-- best throughput of the sweep without oversubscription / this throughput -/
+  slowdown : Float := 1.0
+
+def Row.toJson (r : Row) : Json :=
+  Json.mkObj [
+    ("sweep", toJson r.sweep), ("op", toJson r.op), ("shape", toJson r.shape),
+    ("threads", toJson r.threads), ("callers", toJson r.callers), ("median_ns", toJson r.medianNs),
+    ("calls_per_s", toJson r.throughput), ("speedup", toJson r.speedup),
+    ("efficiency", toJson r.efficiency), ("oversubscribed", toJson r.oversubscribed),
+    ("slowdown", toJson r.slowdown)]
+
+def Row.print (r : Row) : IO Unit := do
+  let over := if r.oversubscribed then s!"oversubscribed, {r.slowdown}× slower" else ""
+  IO.println s!"{r.op}\t{r.shape}\t{r.threads}\t{r.callers}\t{formatNs r.medianNs}\t\
+    {r.throughput}\t{r.speedup}\t{r.efficiency}\t{over}"
+
+/-- 1, 2, 4, … below `n`, then `n`. -/
+def powersUpTo (n : Nat) : List Nat :=
+  let rec go (k fuel : Nat) : List Nat :=
+    match fuel with
+    | 0 => [n]
+    | fuel + 1 => if k < n then k :: go (2 * k) fuel else [n]
+  go 1 64
+
+/-- Fills in speedup and efficiency against the first row, and the
+oversubscription slowdown against the best row that is not oversubscribed. -/
+def relate (logical : Nat) (workers : Row → Nat) (rows : Array Row) : Array Row := Id.run do
+  let some base := rows[0]? | return rows
+  let rows := rows.map fun r =>
+    let speedup := r.throughput / base.throughput
+    { r with speedup, efficiency := speedup / (workers r).toFloat,
+             oversubscribed := r.threads * r.callers > logical }
+  let best := rows.foldl (fun b r => if r.oversubscribed then b else max b r.throughput) 0.0
+  return rows.map fun r =>
+    if r.oversubscribed && best > 0.0 then { r with slowdown := best / r.throughput } else r
+
+/-- The suite's `f64` cases named `op`, rebuilt for each caller so that no two
+callers update the same arrays. Only the level that has `op` is built. -/
+def casesFor (sizes : Sizes) (op : String) : IO (Array Case) := do
+  for level in ([⟨sizes.level1, [], []⟩, ⟨[], sizes.level2, []⟩, ⟨[], [], sizes.level3⟩] : List Sizes) do
+    let cs ← cases level [op] f64
+    unless cs.isEmpty do return cs
+  return #[]
+
+/-- Median time per call of `c` with the BLAS at its current thread count. -/
+def medianOf (cfg : Config) (c : Case) : IO Float := do
+  let (stats, _) ← measure cfg c.body
+  return stats.median
+
+/-- Runs one task per body, each calling its body `calls` times, and returns calls per
+second over the time from the first start to the last finish. -/
+def concurrent (bodies : Array (Nat → IO Float)) (calls : Nat) : IO Float := do
+  let tasks ← bodies.mapM fun body => IO.asTask (prio := .dedicated) do
+    let t0 ← IO.monoNanosNow
+    let mut sink := 0.0
+    for i in [0:calls] do sink := sink + (← body i)
+    let t1 ← IO.monoNanosNow
+    return (t0, t1, sink)
+  let mut first := 0
+  let mut last := 0
+  for t in tasks do
+    let (t0, t1, _) ← IO.ofExcept t.get
+    first := if first == 0 then t0 else min first t0
+    last := max last t1
+  return (bodies.size * calls).toFloat * 1e9 / (last - first).toFloat
+
+structure Options where
+  quick : Bool := false
+  ops : List String := []
+  report : Option String := none
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | "--report" :: path :: rest => parseArgs { o with report := some path } rest
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: ScalingBenchmarks [--quick] [--op NAME]… [--report FILE] \
+    [--json FILE] [--save-baseline FILE] [--compare FILE] [--tolerance X]"
+
+/-- Representative operations of each level. -/
+def defaultOps : List String := ["dot", "axpy", "nrm2", "gemv", "ger", "gemm", "syrk", "trsm"]
+
+def main (args : List String) : IO UInt32 :=
+  gate "ScalingBenchmarks" args fun args => do
+    let o ← match parseArgs {} args with
+      | .ok o => pure o
+      | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+    let cfg : Config := if o.quick then Config.quick else {}
+    -- large enough that one call has work for every core
+    let sizes : Sizes := if o.quick then ⟨[1000000], [1024], [256]⟩ else ⟨[4000000], [4096], [1024]⟩
+    let targetNs := if o.quick then 50000000 else 300000000
+    let ops := if o.ops.isEmpty then defaultOps else o.ops
+    let cpu ← BLAS.Backend.cpuInfo
+    let logical := max 1 cpu.logicalCpus
+    let cores := max 1 cpu.physicalCores
+    let before ← BLAS.Backend.blasThreads
+    IO.println (← BLAS.Backend.summary)
+    let canSet ← BLAS.Backend.setBlasThreads (before.getD cores)
+    unless canSet do
+      IO.println "The BLAS thread count cannot be set for this system BLAS; skipping the thread sweep."
+    IO.println "op\tshape\tthreads\tcallers\tmedian\tcalls/s\tspeedup\tefficiency"
+    let mut rows : Array Row := #[]
+    let mut results : Array Result := #[]
+    for op in ops do
+      let some c := (← casesFor sizes op)[0]? | throw $ IO.userError s!"unknown operation {op}"
+      -- threads sweep
+      if canSet then
+        let mut sweep := #[]
+        for t in powersUpTo logical ++ [2 * logical] do
+          let _ ← BLAS.Backend.setBlasThreads t
+          let (stats, checksum) ← measure cfg c.body
+          results := results.push
+            { op := c.op, precision := "f64", shape := s!"{c.shape} threads={t}", model := c.model, stats, checksum }
+          sweep := sweep.push { sweep := "threads", op := c.op, shape := c.shape, threads := t, callers := 1,
+                                medianNs := stats.median, throughput := 1e9 / stats.median : Row }
+        let sweep := relate logical (·.threads) sweep
+        sweep.forM Row.print
+        rows := rows ++ sweep
+      -- callers sweep, with single-threaded and fully threaded calls
+      for t in (if canSet then [1, cores].eraseDups else [before.getD 1]) do
+        let _ ← if canSet then BLAS.Backend.setBlasThreads t else pure true
+        let median ← medianOf cfg c
+        let calls := max 5 (targetNs.toFloat / median).toUInt64.toNat
+        let mut sweep := #[]
+        for k in powersUpTo logical do
+          let mut bodies := #[]
+          for _ in [0:k] do
+            let some own := (← casesFor sizes op)[0]? | continue
+            bodies := bodies.push own.body
+          let throughput ← concurrent bodies calls
+          sweep := sweep.push { sweep := s!"callers@{t}", op := c.op, shape := c.shape, threads := t,
+                                callers := k, medianNs := k.toFloat * 1e9 / throughput, throughput : Row }
+        let sweep := relate logical (·.callers) sweep
+        sweep.forM Row.print
+        rows := rows ++ sweep
+    if canSet then
+      let _ ← BLAS.Backend.setBlasThreads (before.getD cores)
+    if let some path := o.report then
+      let json := Json.mkObj [
+        ("backend", toJson (BLAS.Backend.backendName ())), ("logical_cpus", toJson logical),
+        ("physical_cores", toJson cores), ("rows", Json.arr (rows.map Row.toJson))]
+      IO.FS.writeFile path (json.pretty ++ "\n")
+      IO.println s!"wrote {rows.size} rows to {path}"
+    return results
+
+end BLAS.Test.ScalingBenchmarks
+
+def main (args : List String) : IO UInt32 := BLAS.Test.ScalingBenchmarks.main args
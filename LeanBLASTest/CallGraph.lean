@@ -0,0 +1,114 @@
+import LeanBLAS
+import LeanBLAS.CBLAS.LevelThree
+import LeanBLAS.CallGraph
+
+/-!
+# Call-Graph Capture and Replay Tests
+
+Replays a recorded mix of Level 1/2/3 calls and compares it with the same calls
+made one by one, checks that fusion, parallel levels and shared temporaries
+kick in, and that malformed recordings and replays are rejected.
+-/
+
+open BLAS CBLAS
+
+namespace BLAS.Test.CallGraph
+
+def values (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n) fun i => Float.sin (Float.ofNat i.val * 0.37 + phase) * 0.5)).toFloat64Array
+
+def bits (x : Float64Array) : Array UInt64 := x.toFloatArray.data.map Float.toBits
+
+/-- Handles of the recorded program. -/
+structure Handles where
+  dot : CallGraph.Scalar
+  norm : CallGraph.Scalar
+  total : CallGraph.Scalar
+
+/-- x := x + exp y, C := 1.5 A Bᵀ + 0.5 C, with reductions over temporaries:
+`dot = (2x + y)ᵀy`, `norm = ‖A t‖` for `t = 2x + y` and `total = Σ 3 over the
+even entries of a temporary`. -/
+def program (n m : USize) : CallGraph.CaptureM Handles := do
+  let x ← CallGraph.arg n.toNat
+  let y ← CallGraph.arg n.toNat
+  let A ← CallGraph.arg (m * m).toNat
+  let B ← CallGraph.arg (m * m).toNat
+  let C ← CallGraph.arg (m * m).toNat
+  let t1 ← CallGraph.temp n.toNat
+  let t2 ← CallGraph.temp n.toNat
+  let t3 ← CallGraph.temp m.toNat
+  let t4 ← CallGraph.temp n.toNat
+  CallGraph.dcopy n x 0 1 t1 0 1
+  CallGraph.dscal n 2.0 t1 0 1
+  CallGraph.daxpy n 1.0 y 0 1 t1 0 1
+  let dot ← CallGraph.ddot n t1 0 1 y 0 1
+  CallGraph.dcopy n y 0 1 t2 0 1
+  CallGraph.dexp n t2 0 1
+  CallGraph.dgemm .ColMajor .NoTrans .Trans m m m 1.5 A 0 m B 0 m 0.5 C 0 m
+  CallGraph.daxpy n 1.0 t2 0 1 x 0 1
+  CallGraph.dgemv .ColMajor .NoTrans m m 1.0 A 0 m t1 0 1 0.0 t3 0 1
+  let norm ← CallGraph.dnrm2 m t3 0 1
+  CallGraph.dconst (n / 2) 3.0 t4 0 2
+  let total ← CallGraph.dsum n t4 0 1
+  return { dot, norm, total }
+
+/-- The same calls through the ordinary bindings. -/
+def reference (n m : USize) (x y a b c : Float64Array) : Float64Array × Float64Array × Array Float :=
+  let t1 := daxpy n 1.0 y 0 1 (dscal n 2.0 (dcopy n x 0 1 (dconst n 0.0) 0 1) 0 1) 0 1
+  let dot := ddot n t1 0 1 y 0 1
+  let t2 := dexp n (dcopy n y 0 1 (dconst n 0.0) 0 1) 0 1
+  let c' := dgemm Order.ColMajor Transpose.NoTrans Transpose.Trans m m m 1.5 a 0 m b 0 m 0.5 c 0 m
+  let x' := daxpy n 1.0 t2 0 1 x 0 1
+  let t3 := dgemv Order.ColMajor Transpose.NoTrans m m 1.0 a 0 m t1 0 1 0.0 (dconst m 0.0) 0 1
+  (x', c', #[dot, dnrm2 m t3 0 1, (n / 2).toNat.toFloat * 3.0])
+
+def test_replay : IO Unit := do
+  IO.println "Call graph: replay matches the individual calls"
+  let n : USize := 10000
+  let m : USize := 150
+  let (graph, h) ← CallGraph.capture (program n m)
+  let info := graph.info
+  IO.println s!"  {repr info}"
+  if info.groups ≥ info.nodes || info.levels ≥ info.groups || info.tempSlots ≥ 4 then
+    throw $ IO.userError "expected fused nodes, parallel levels and shared temporaries"
+  for i in [:3] do
+    let phase := Float.ofNat i
+    let x := values n.toNat phase
+    let y := values n.toNat (phase + 1.0)
+    let a := values (m * m).toNat 2.0
+    let b := values (m * m).toNat 3.0
+    let c := values (m * m).toNat 4.0
+    let (x', c', scalars) := reference n m x y a b c
+    let (out, s) ← graph.replay #[x, y, a, b, c]
+    if bits out[0]! != bits x' || bits out[4]! != bits c' then
+      throw $ IO.userError s!"replay {i}: arrays differ from the individual calls"
+    for (name, slot, expected) in [("dot", h.dot, scalars[0]!), ("norm", h.norm, scalars[1]!),
+        ("total", h.total, scalars[2]!)] do
+      let got := s[slot.id]!
+      if (got - expected).abs > 1e-12 * expected.abs then
+        throw $ IO.userError s!"replay {i}: {name} = {got}, expected {expected}"
+    if bits x == bits out[0]! then
+      throw $ IO.userError "the caller's array was written"
+  IO.println "✓ 3 replays"
+
+def test_errors : IO Unit := do
+  IO.println "Call graph: malformed input is rejected"
+  let outOfRange ← (CallGraph.capture do
+      let x ← CallGraph.arg 10
+      CallGraph.dscal 11 2.0 x 0 1).toBaseIO
+  if outOfRange matches .ok _ then
+    throw $ IO.userError "an access past the end of a buffer was accepted"
+  let (graph, _) ← CallGraph.capture do
+    let x ← CallGraph.arg 10
+    CallGraph.dscal 10 2.0 x 0 1
+  if (← (graph.replay #[]).toBaseIO) matches .ok _ then
+    throw $ IO.userError "a replay with missing arguments was accepted"
+  if (← (graph.replay #[values 5 0.0]).toBaseIO) matches .ok _ then
+    throw $ IO.userError "a replay with a short argument was accepted"
+  IO.println "✓ bounds, arity and sizes checked"
+
+def main : IO Unit := do
+  test_replay
+  test_errors
+
+end BLAS.Test.CallGraph
@@ -0,0 +1,4 @@
+import LeanBLASTest.CallGraph
+
+def main : IO Unit :=
+  BLAS.Test.CallGraph.main
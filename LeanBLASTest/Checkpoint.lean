@@ -0,0 +1,89 @@
+import LeanBLAS
+import LeanBLAS.FFI.Checkpoint
+import LeanBLASTest.FileFixtures
+
+/-!
+# Checkpoint Tests
+
+Writes arrays of every supported type, order and shape (including an empty
+one) with the streaming writer, loads them mapped and copied, checks that
+mapped arrays are 64-byte aligned and that a write through a wrapper leaves
+the mapping and the file alone, that an unfinished checkpoint never replaces
+the last complete one, and that a corrupted payload, a duplicate name and a
+missing array are reported.
+-/
+
+open BLAS BLAS.Npy BLAS.Checkpoint BLAS.Test.Files
+
+namespace BLAS.Test.Checkpoint
+
+def dir : System.FilePath := ".lake" / "checkpoint-test"
+
+def A : NpyArray Float64Array := { data := f64 12 0.0, shape := #[3, 4], order := .ColMajor }
+def x : NpyArray Float32Array := { data := f32 7, shape := #[7] }
+def z : NpyArray ComplexFloat64Array := { data := c64, shape := #[3, 1] }
+def e : NpyArray Float64Array := { data := f64 0 0.0, shape := #[0, 5] }
+def big : NpyArray Float64Array := { data := f64 100000 1.0, shape := #[100000] }
+
+def test_round_trip : IO Unit := do
+  write (dir / "state.ckpt") fun w => do
+    w.add "A" A
+    w.add "solver/x" x
+    w.add "z" z
+    w.add "empty" e
+    w.add "big" big
+  for mmap in [true, false] do
+    let f ← load (dir / "state.ckpt") mmap
+    expect (f.names == #["A", "solver/x", "z", "empty", "big"]) s!"names: {f.names}"
+    same s!"f64 mmap={mmap}" (← f.get "A") A
+    same s!"f32 mmap={mmap}" (← f.get "solver/x") x
+    same s!"c64 mmap={mmap}" (← f.get "z") z
+    same s!"empty mmap={mmap}" (← f.get "empty") e
+    same s!"big mmap={mmap}" (← f.get "big") big
+  save (dir / "raw.ckpt") #[("A", A.toRaw), ("z", z.toRaw)]
+  same "save" (← (← load (dir / "raw.ckpt")).get "z") z
+  IO.println "✓ checkpoint round trips"
+
+def test_mapped_write : IO Unit := do
+  let f ← load (dir / "state.ckpt")
+  for (name, r) in f.arrays do
+    expect (r.data.size == 0 || isAligned r.data) s!"mapped '{name}' is not 64-byte aligned"
+  let B ← f.get (α := Float64Array) "big"
+  scaleMapped "mapped array" B big
+  same "file after dscal" (← (← load (dir / "state.ckpt") (mmap := false)).get "big") big
+  IO.println "✓ writes to a mapped array copy it"
+
+def test_unfinished : IO Unit := do
+  let path := dir / "keep.ckpt"
+  save path #[("A", A.toRaw)]
+  let w ← Writer.new path.toString
+  w.add "x" x
+  -- never finished: the complete checkpoint is still in place
+  same "after an unfinished write" (← (← load path).get "A") A
+  fails "unfinished" "never finished" (load (System.FilePath.mk (path.toString ++ ".tmp")))
+  fails "duplicate" "duplicate array 'x'" (w.add "x" x)
+  IO.println "✓ unfinished checkpoints leave the last one in place"
+
+def test_corruption : IO Unit := do
+  let path := dir / "bad.ckpt"
+  save path #[("A", A.toRaw)]
+  let mut bytes ← IO.FS.readBinFile path
+  -- the first payload starts at byte 128
+  bytes := bytes.set! 130 (bytes.get! 130 ^^^ 1)
+  IO.FS.writeBinFile path bytes
+  fails "payload" "checksum mismatch in 'A'" (load path)
+  let _ ← load path (verify := false)
+  fails "missing" "no array 'B'" (do (← load path (verify := false)).get (α := Float64Array) "B")
+  fails "dtype" "expected c16" (do (← load path (verify := false)).get (α := ComplexFloat64Array) "A")
+  IO.FS.writeBinFile (dir / "junk.ckpt") "not a checkpoint, just some text".toUTF8
+  fails "junk" "not a checkpoint" (load (dir / "junk.ckpt"))
+  IO.println "✓ errors"
+
+def main : IO Unit := do
+  IO.FS.createDirAll dir
+  test_round_trip
+  test_mapped_write
+  test_unfinished
+  test_corruption
+
+end BLAS.Test.Checkpoint
@@ -0,0 +1,4 @@
+import LeanBLASTest.Checkpoint
+
+def main : IO Unit :=
+  BLAS.Test.Checkpoint.main
@@ -0,0 +1,155 @@
+import LeanBLAS
+import LeanBLASTest.BenchHarness
+
+/-!
+# FFI Overhead
+
+Times the same `ddot`, `daxpy`, `dscal`, `dgemv` and `dgemm` calls along four
+paths and reports the time per call in nanoseconds:
+
+* `C` – the `cblas_*` functions called from C (`c/bench/ffi_overhead.c`,
+  built as the `ffiOverheadC` target);
+* `extern` – the `@[extern]` functions of `BLAS.CBLAS` with `USize` arguments;
+* `class` – `LevelOneData`/`LevelTwoData`/`LevelThreeData` at `Float64Array`,
+  with `Nat` arguments converted to `USize` by the instances;
+* `generic` – the same class calls from code that is generic in the array
+  type and not specialized, so every call goes through the instance dictionary.
+
+The differences to `C` are the cost of the bindings: boxing and unboxing,
+the exclusivity check of in-place outputs and the argument conversions. Cases
+and arguments match the C program, which is run as a subprocess.
+
+```
+lake exe FFIOverhead [--c PATH]
+```
+-/
+
+open BLAS CBLAS
+
+namespace BLAS.Test.FFIOverhead
+
+def level1Sizes : List Nat := [1, 16, 256, 4096, 65536]
+def level2Sizes : List Nat := [1, 8, 64]
+def level3Sizes : List Nat := [1, 8, 32]
+
+/-- Runs `step` `iters` times, threading its state. -/
+@[specialize] def loop {σ : Type} (iters : Nat) (step : Nat → σ → σ) (s : σ) : IO σ := do
+  let mut s := s
+  for i in [0:iters] do
+    s := step i s
+  return s
+
+/-- Median time per call of `step` over 15 runs of at least a millisecond each. -/
+@[specialize] def perCall {σ : Type} (step : Nat → σ → σ) (s : σ) : IO (Float × σ) := do
+  let mut s := s
+  let mut iters := 1
+  repeat
+    let t0 ← IO.monoNanosNow
+    s ← loop iters step s
+    let t1 ← IO.monoNanosNow
+    if t1 - t0 ≥ 1000000 then break
+    iters := 2 * iters
+  let mut times : Array Float := #[]
+  for _ in [0:15] do
+    let t0 ← IO.monoNanosNow
+    s ← loop iters step s
+    let t1 ← IO.monoNanosNow
+    times := times.push ((t1 - t0).toFloat / iters.toFloat)
+  return (Bench.quantile (times.qsort (· < ·)) 0.5, s)
+
+def filled (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n) fun i =>
+    Float.ofNat ((i.val * 7 + (phase * 10).toUInt64.toNat) % 13) / 13.0 - 0.5)).toFloat64Array
+
+/-- Vectors and matrices shared by all paths; `x` has one extra element for
+the alternating offset of `dot`. -/
+structure Data where
+  x : Float64Array := filled (65536 + 1) 0.0
+  y : Float64Array := filled (65536 + 1) 1.0
+  A : Float64Array := filled (64 * 64) 2.0
+  B : Float64Array := filled (64 * 64) 3.0
+  C : Float64Array := filled (64 * 64) 4.0
+
+def sign (i : Nat) (a : Float) : Float := if i % 2 == 0 then a else -a
+def scale (i : Nat) : Float := if i % 2 == 0 then 2.0 else 0.5
+
+/-! ## Paths -/
+
+def externTimes (d : Data) (op : String) (n : Nat) : IO Float := do
+  let N := n.toUSize
+  match op with
+  | "dot" => return (← perCall (fun i acc => acc + ddot N d.x (i % 2).toUSize 1 d.y 0 1) 0.0).1
+  | "axpy" => return (← perCall (fun i y => daxpy N (sign i 0.5) d.x 0 1 y 0 1) d.y).1
+  | "scal" => return (← perCall (fun i y => dscal N (scale i) y 0 1) d.y).1
+  | "gemv" => return (← perCall (fun i y =>
+      dgemv .ColMajor .NoTrans N N (scale i) d.A 0 N d.x 0 1 0.0 y 0 1) d.y).1
+  | "gemm" => return (← perCall (fun i C =>
+      dgemm .ColMajor .NoTrans .NoTrans N N N (scale i) d.A 0 N d.B 0 N 0.0 C 0 N) d.C).1
+  | _ => throw $ IO.userError s!"unknown operation {op}"
+
+def classTimes (d : Data) (op : String) (n : Nat) : IO Float := do
+  match op with
+  | "dot" => return (← perCall (fun i acc => acc + LevelOneData.dot n d.x (i % 2) 1 d.y 0 1) 0.0).1
+  | "axpy" => return (← perCall (fun i y => LevelOneData.axpy n (sign i 0.5) d.x 0 1 y 0 1) d.y).1
+  | "scal" => return (← perCall (fun i y => LevelOneData.scal n (scale i) y 0 1) d.y).1
+  | "gemv" => return (← perCall (fun i y =>
+      LevelTwoData.gemv .ColMajor .NoTrans n n (scale i) d.A 0 n d.x 0 1 0.0 y 0 1) d.y).1
+  | "gemm" => return (← perCall (fun i C =>
+      LevelThreeData.gemm .ColMajor .NoTrans .NoTrans n n n (scale i) d.A 0 n d.B 0 n 0.0 C 0 n) d.C).1
+  | _ => throw $ IO.userError s!"unknown operation {op}"
+
+section Generic
+
+variable {α : Type} [LevelOneData α Float Float] [LevelTwoData α Float Float] [LevelThreeData α Float Float]
+
+/-- The loops of `classTimes`, compiled once for every array type. -/
+@[nospecialize] def genericTimes (x y A B C : α) (op : String) (n : Nat) : IO Float := do
+  match op with
+  | "dot" => return (← perCall (fun i acc => acc + LevelOneData.dot n x (i % 2) 1 y 0 1) 0.0).1
+  | "axpy" => return (← perCall (fun i y => LevelOneData.axpy n (sign i 0.5) x 0 1 y 0 1) y).1
+  | "scal" => return (← perCall (fun i y => LevelOneData.scal n (scale i) y 0 1) y).1
+  | "gemv" => return (← perCall (fun i y =>
+      LevelTwoData.gemv .ColMajor .NoTrans n n (scale i) A 0 n x 0 1 0.0 y 0 1) y).1
+  | "gemm" => return (← perCall (fun i C =>
+      LevelThreeData.gemm .ColMajor .NoTrans .NoTrans n n n (scale i) A 0 n B 0 n 0.0 C 0 n) C).1
+  | _ => throw $ IO.userError s!"unknown operation {op}"
+
+end Generic
+
+/-- `(op, n) ↦ ns` from the `op<TAB>n<TAB>ns` lines of the C program. -/
+def runC (path : String) : IO (Option (List ((String × Nat) × Float))) := do
+  unless (← System.FilePath.pathExists path) do
+    IO.eprintln s!"{path} not found (lake build ffiOverheadC); skipping the C baseline"
+    return none
+  let out ← IO.Process.output { cmd := path }
+  if out.exitCode != 0 then
+    IO.eprintln s!"{path} failed: {out.stderr}"
+    return none
+  return some <| (out.stdout.splitOn "\n").filterMap fun line =>
+    match line.splitOn "\t" with
+    | [op, n, ns] => do pure ((op, ← n.toNat?), ← Bench.parseFloat ns)
+    | _ => none
+
+def main (args : List String) : IO Unit := do
+  let cPath := match args with
+    | ["--c", path] => path
+    | _ => ".lake/build/bin/ffi_overhead_c"
+  IO.println s!"FFI overhead ({BLAS.Backend.backendName ()} backend), ns per call"
+  let c ← runC cPath
+  let d : Data := {}
+  let cases := (["dot", "axpy", "scal"].flatMap fun op => level1Sizes.map (op, ·)) ++
+    level2Sizes.map ("gemv", ·) ++ level3Sizes.map ("gemm", ·)
+  IO.println "op\tn\tC\textern\tclass\tgeneric\textern-C\tclass-C\tgeneric-C"
+  for (op, n) in cases do
+    let e ← externTimes d op n
+    let k ← classTimes d op n
+    let g ← genericTimes d.x d.y d.A d.B d.C op n
+    match c.bind (·.lookup (op, n)) with
+    | some t =>
+      IO.println s!"{op}\t{n}\t{t}\t{e}\t{k}\t{g}\t{e - t}\t{k - t}\t{g - t}"
+    | none =>
+      IO.println s!"{op}\t{n}\t-\t{e}\t{k}\t{g}\t-\t-\t-"
+
+end BLAS.Test.FFIOverhead
+
+def main (args : List String) : IO Unit := BLAS.Test.FFIOverhead.main args
@@ -0,0 +1,51 @@
+import LeanBLAS
+
+/-!
+# File Test Fixtures
+
+Arrays and checks shared by the file format tests (`.npy`, Matrix Market,
+checkpoints, safetensors and streaming pipelines).
+-/
+
+open BLAS BLAS.Npy
+
+namespace BLAS.Test.Files
+
+def f64 (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n) fun i => Float.sin (i.val.toFloat * 0.37 + phase))).toFloat64Array
+
+def f32 (n : Nat) : Float32Array := Id.run do
+  let mut a := Float32Array.mkZero n
+  for i in [0:n] do a := a.set i (Float.cos (i.toFloat * 0.37))
+  return a
+
+def c64 : ComplexFloat64Array := #c64[⟨1.0, -2.0⟩, ⟨0.5, 3.25⟩, ⟨-1.0, 0.0⟩]
+
+def expect (cond : Bool) (msg : String) : IO Unit :=
+  unless cond do throw $ IO.userError msg
+
+/-- Expects `a` and `b` to hold the same bytes, shape and order. -/
+def same {α : Type} [Element α] (name : String) (a b : NpyArray α) : IO Unit := do
+  expect ((Element.toBytes a.data).data == (Element.toBytes b.data).data) s!"{name}: data differs"
+  expect (a.shape == b.shape) s!"{name}: shape is {a.shape}, expected {b.shape}"
+  expect (a.order == b.order) s!"{name}: order differs"
+
+/-- Scales the mapped `a` by 2 with the in-place `dscal` wrapper and expects the
+result to be scaled while `a` still holds `ref`: the wrapper must copy a mapped
+array rather than write to the mapping. -/
+def scaleMapped (name : String) (a ref : NpyArray Float64Array) : IO Unit := do
+  let n := ref.data.size
+  let y := (CBLAS.dscal n.toUSize 2.0 a.data 0 1).toFloatArray
+  let r := ref.data.toFloatArray
+  expect (y.size == n && (List.range n).all fun i => y[i]! == 2.0 * r[i]!) s!"{name}: dscal result is wrong"
+  same s!"{name} after dscal" a ref
+
+/-- Expects `act` to fail with a message containing `part`. -/
+def fails {β : Type} (name : String) (part : String) (act : IO β) : IO Unit := do
+  match ← act.toBaseIO with
+  | .ok _ => throw $ IO.userError s!"{name}: expected an error"
+  | .error e =>
+    unless (e.toString.splitOn part).length > 1 do
+      throw $ IO.userError s!"{name}: error '{e}' does not mention '{part}'"
+
+end BLAS.Test.Files
@@ -0,0 +1,125 @@
+import LeanBLAS
+import LeanBLAS.Lazy
+
+/-!
+# Lazy Expression Tests
+
+Checks that matrix expressions compile to the expected BLAS calls, without
+temporaries where the expression maps onto `gemm`/`gemv`/`syrk` directly, and
+that the results match a naive evaluation of the same expression.
+-/
+
+open BLAS BLAS.Lazy
+
+namespace BLAS.Test.Lazy
+
+abbrev E := MatExpr Float64Array Float
+
+def values (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n) fun i => Float.sin (Float.ofNat i.val * 0.37 + phase))).toFloat64Array
+
+/-- Evaluates `e` entry by entry, as nested rows. -/
+def reference : E → Array (Array Float)
+  | .leaf A =>
+    let d := A.data.toFloatArray
+    Array.ofFn (n := A.rows) fun i => Array.ofFn (n := A.cols) fun j =>
+      d[A.off + i.val * A.rowStride + j.val * A.colStride]!
+  | .transpose e =>
+    let m := reference e
+    let cols := (m[0]?.map (·.size)).getD 0
+    Array.ofFn (n := cols) fun j => m.map (·[j]!)
+  | .scale a e => (reference e).map (·.map (a * ·))
+  | .add e f =>
+    let a := reference e
+    let b := reference f
+    Array.ofFn (n := a.size) fun i => Array.ofFn (n := a[i.val]!.size) fun j =>
+      a[i.val]![j.val]! + b[i.val]![j.val]!
+  | .mul e f =>
+    let a := reference e
+    let b := reference f
+    let cols := (b[0]?.map (·.size)).getD 0
+    a.map fun row => Array.ofFn (n := cols) fun j =>
+      (List.range row.size).foldl (fun s k => s + row[k]! * b[k]![j]!) 0.0
+
+def check (name : String) (e : E) (calls : Array String) (temps : Nat := 0) : IO Unit := do
+  let plan ← IO.ofExcept (compile e)
+  let got := plan.calls.map Call.name
+  if got != calls || plan.temps.size != temps then
+    throw $ IO.userError s!"{name}: compiled to {got} with {plan.temps.size} temporaries, expected {calls} with {temps}"
+  let D := plan.run
+  let d := D.data.toFloatArray
+  let ref := reference e
+  for i in [0:ref.size] do
+    for j in [0:ref[i]!.size] do
+      let x := d[D.off + i * D.rowStride + j * D.colStride]!
+      let y := ref[i]![j]!
+      if (x - y).abs > 1e-12 * (1.0 + y.abs) then
+        throw $ IO.userError s!"{name}: entry ({i}, {j}) is {x}, expected {y}"
+  IO.println s!"✓ {name}"
+
+def m := 5
+def k := 4
+def n := 3
+
+def A : E := mat (Matrix.colMajor (values (m * k) 0.0) m k)
+def A' : E := mat (Matrix.rowMajor (values (m * k) 0.5) m k)
+def At : E := mat (Matrix.colMajor (values (k * m) 1.0) k m)
+def B : E := mat (Matrix.colMajor (values (k * n) 2.0) k n)
+def C : E := mat (Matrix.colMajor (values (m * n) 3.0) m n)
+def Cr : E := mat (Matrix.rowMajor (values (m * n) 3.5) m n)
+def S : E := mat (Matrix.colMajor (values (m * m) 7.0) m m)
+def x : E := mat (Matrix.vec (values k 4.0) k)
+/-- Every other element of a longer array, starting at 1. -/
+def y : E := mat (Matrix.vec (values (2 * m + 1) 5.0) m 1 2)
+/-- The `m × k` block at offset 3 of a matrix with 7 rows. -/
+def Asub : E := mat ⟨values (3 + 7 * k) 6.0, .ColMajor, m, k, 3, 7⟩
+
+def test_rewrites : IO Unit := do
+  IO.println "Expressions compile to single BLAS calls"
+  check "transpose (scale 2 A) * B + C" (transpose (scale 2.0 At) * B + C) #["gemm"]
+  check "scale 2 (transpose (A * B))" (scale 2.0 (transpose (A * B))) #["gemm"]
+  check "A * B + C (row-major C)" (A * B + scale 0.5 Cr) #["gemm"]
+  check "A' * B (row-major A')" (A' * B) #["gemm"]
+  check "A * B + A' * B + C" (A * B + A' * B + C) #["gemm", "gemm"]
+  check "A * x + y" (A * x + y) #["gemv"]
+  check "transpose y * A" (transpose y * A) #["gemv"]
+  check "A * transpose A" (A * transpose A) #["syrk"]
+  check "scale 3 (transpose A * A)" (scale 3.0 (transpose A * A)) #["syrk"]
+  check "A * transpose A + A' * transpose A'" (A * transpose A + A' * transpose A') #["syrk", "gemm"]
+  check "A * transpose A' (different matrices)" (A * transpose A') #["gemm"]
+  check "Asub * B (strided view)" (Asub * B + C) #["gemm"]
+
+def test_sums : IO Unit := do
+  IO.println "Sums accumulate into one of their terms"
+  check "scale 2 A + A'" (scale 2.0 A + A') #["scal", "axpy"]
+  check "A + A' + Asub" (A + A' + Asub) #["axpy", "axpy"]
+  check "C + transpose (transpose C)" (C + transpose (transpose C)) #["axpy"]
+  check "A * transpose A + S (no syrk into S)" (A * transpose A + S) #["gemm"]
+
+def test_temporaries : IO Unit := do
+  IO.println "Only nested sums and products need temporaries"
+  check "(A + A') * B" ((A + A') * B) #["axpy", "gemm"] (temps := 1)
+  check "(A * B) * transpose C" ((A * B) * transpose C) #["gemm", "gemm"] (temps := 1)
+  check "A * (B * transpose C)" (A * (B * transpose C)) #["gemm", "gemm"] (temps := 1)
+
+def expectError (name : String) (e : E) : IO Unit := do
+  match compile e with
+  | .ok _ => throw $ IO.userError s!"{name}: compiled, expected a shape error"
+  | .error msg => IO.println s!"✓ {name}: {msg}"
+
+def test_errors : IO Unit := do
+  IO.println "Shape errors"
+  expectError "A * A" (A * A)
+  expectError "A + B" (A + B)
+  expectError "short leading dimension" (mat ⟨values 20 0.0, .ColMajor, 5, 4, 0, 3⟩ : E)
+
+def main : IO Unit := do
+  IO.println "Lazy Expression Tests"
+  IO.println "====================="
+  test_rewrites
+  test_sums
+  test_temporaries
+  test_errors
+  IO.println "All lazy expression tests passed"
+
+end BLAS.Test.Lazy
@@ -0,0 +1,4 @@
+import LeanBLASTest.Lazy
+
+def main : IO Unit :=
+  BLAS.Test.Lazy.main
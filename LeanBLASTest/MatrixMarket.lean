@@ -0,0 +1,127 @@
+import LeanBLAS
+import LeanBLAS.FFI.MatrixMarket
+import LeanBLASTest.FileFixtures
+
+/-!
+# Matrix Market Tests
+
+Reads small hand-written files of every format, field and symmetry into dense
+matrices in both orders and into CSR, checks the expansion of symmetric,
+skew-symmetric and Hermitian files, the summing of duplicates and the sorting
+of CSR columns, round-trips both writers, reads a file large enough to be
+parsed in several chunks, and checks the errors for malformed files and for
+array types Matrix Market values cannot be read into.
+-/
+
+open BLAS BLAS.MatrixMarket BLAS.Test.Files
+
+namespace BLAS.Test.MatrixMarket
+
+def dir : System.FilePath := ".lake" / "mm-test"
+
+def file (name contents : String) : IO System.FilePath := do
+  let path := dir / name
+  IO.FS.writeFile path contents
+  return path
+
+def entries (A : Dense Float64Array) : List Float := A.data.toFloatArray.toList
+
+/-- The dense row-major matrix of a CSR one. -/
+def densify (A : CSR Float64Array) : List Float := Id.run do
+  let mut d := Array.replicate (A.rows * A.cols) 0.0
+  let v := A.values.toFloatArray
+  for i in [0:A.rows] do
+    for e in [(A.rowPtr.get i.toUSize).toNat:(A.rowPtr.get (i + 1).toUSize).toNat] do
+      let j := (A.colIdx.get e.toUSize).toNat
+      d := d.set! (i * A.cols + j) (d[i * A.cols + j]! + v[e]!)
+  return d.toList
+
+def test_coordinate : IO Unit := do
+  let path ← file "coo.mtx" "%%MatrixMarket matrix coordinate real general\n\
+    % a comment\n\
+    2 3 5\n\
+    2 3 -1.5e2\n\
+    1 1 0.25\n\
+    1 3 3\n\
+    2 1 1e-3\n\
+    1 3 1\n"
+  let h ← readHeader path.toString
+  expect (h == { format := "coordinate", field := "real", symmetry := "general", rows := 2, cols := 3, entries := 5 })
+    s!"header: {repr h}"
+  let R ← readDense (α := Float64Array) path (order := .RowMajor)
+  expect (entries R == [0.25, 0.0, 4.0, 1e-3, 0.0, -150.0]) s!"row-major: {entries R}"
+  let C ← readDense (α := Float64Array) path
+  expect (entries C == [0.25, 1e-3, 0.0, 0.0, 4.0, -150.0]) s!"column-major: {entries C}"
+  let S ← readCSR (α := Float64Array) path
+  expect (S.rowPtr.toArray == #[0, 2, 4] && S.colIdx.toArray == #[0, 2, 0, 2]) "CSR structure"
+  expect (S.values.toFloatArray.toList == [0.25, 4.0, 1e-3, -150.0]) s!"CSR values: {S.values.toFloatArray.toList}"
+  IO.println "✓ coordinate files"
+
+def test_symmetric : IO Unit := do
+  let sym ← file "sym.mtx" "%%MatrixMarket matrix array real symmetric\n3 3\n1\n2\n3\n4\n5\n6\n"
+  let A ← readDense (α := Float64Array) sym (order := .RowMajor)
+  expect (entries A == [1, 2, 3, 2, 4, 5, 3, 5, 6]) s!"symmetric array: {entries A}"
+  expect (densify (← readCSR sym) == entries A) "symmetric array as CSR"
+  let skew ← file "skew.mtx" "%%MatrixMarket matrix coordinate integer skew-symmetric\n3 3 2\n2 1 7\n3 2 -1\n"
+  let K ← readDense (α := Float64Array) skew (order := .RowMajor)
+  expect (entries K == [0, -7, 0, 7, 0, 1, 0, -1, 0]) s!"skew-symmetric: {entries K}"
+  let pat ← file "pat.mtx" "%%MatrixMarket matrix coordinate pattern symmetric\n2 2 2\n1 1\n2 1\n"
+  expect (densify (← readCSR pat) == [1, 1, 1, 0]) "pattern"
+  let herm ← file "herm.mtx" "%%MatrixMarket matrix coordinate complex hermitian\n2 2 2\n1 1 2 0\n2 1 1 -3\n"
+  let H ← readDense (α := ComplexFloat64Array) herm (order := .RowMajor)
+  let z := H.data.toComplexFloatArray
+  let h := (List.range z.size).map fun i => ((z.get! i).re, (z.get! i).im)
+  expect (h == [(2, 0), (1, 3), (1, -3), (0, 0)]) s!"hermitian: {h}"
+  fails "complex into real" "complex" (readDense (α := Float64Array) herm)
+  IO.println "✓ symmetric, skew-symmetric, pattern and Hermitian files"
+
+def test_round_trip : IO Unit := do
+  let A : Dense Float64Array :=
+    { rows := 3, cols := 2, data := #f64[0.1, -2.0, 1e-310, 3.141592653589793, 1e300, 0.0], order := .RowMajor }
+  writeDense (dir / "dense.mtx") A
+  let B ← readDense (α := Float64Array) (dir / "dense.mtx") (order := .RowMajor)
+  expect (entries B == entries A && B.rows == 3 && B.cols == 2) s!"dense round trip: {entries B}"
+  let S ← readCSR (α := Float64Array) (dir / "dense.mtx")
+  writeCSR (dir / "sparse.mtx") S
+  let T ← readCSR (α := Float64Array) (dir / "sparse.mtx")
+  expect (densify T == entries A && T.colIdx.size == 5) s!"CSR round trip: {densify T}"
+  IO.println "✓ writers round-trip exactly"
+
+def test_chunks : IO Unit := do
+  -- a few megabytes, so that the parser splits the entries across tasks
+  let n := 1000
+  let mut text := s!"%%MatrixMarket matrix coordinate real general\n{n} {n} {n * 100}\n"
+  for k in [0:n * 100] do
+    text := text ++ s!"{k % n + 1} {k / 100 + 1} {k.toFloat * 0.5}\n"
+  let path ← file "big.mtx" text
+  let S ← readCSR (α := Float64Array) path
+  expect (S.colIdx.size == n * 100) s!"chunks: {S.colIdx.size} entries"
+  let v := S.values.toFloatArray
+  let mut sum := 0.0
+  for i in [0:v.size] do sum := sum + v[i]!
+  let expected := (n * 100 * (n * 100 - 1) / 2).toFloat * 0.5
+  expect (sum == expected) s!"chunks: sum {sum}, expected {expected}"
+  IO.println "✓ parallel chunks"
+
+def test_errors : IO Unit := do
+  let banner ← file "banner.mtx" "%%MatrixMarket tensor coordinate real general\n1 1 0\n"
+  fails "object" "matrix" (readHeader banner.toString)
+  let count ← file "count.mtx" "%%MatrixMarket matrix coordinate real general\n2 2 3\n1 1 1\n2 2 2\n"
+  fails "entry count" "expected 3 entries, found 2" (readDense (α := Float64Array) count)
+  let index ← file "index.mtx" "%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1\n3 1 2\n"
+  fails "index" "line 4" (readCSR (α := Float64Array) index)
+  let value ← file "value.mtx" "%%MatrixMarket matrix array real general\n1 2\n1.0\n2.0x\n"
+  fails "value" "bad value" (readDense (α := Float64Array) value)
+  fails "float32" "f8 or c16" (readDense (α := Float32Array) count)
+  fails "size" "rows × cols" (writeDense (dir / "w.mtx") { rows := 2, cols := 2, data := #f64[1.0] : Dense Float64Array })
+  IO.println "✓ errors"
+
+def main : IO Unit := do
+  IO.FS.createDirAll dir
+  test_coordinate
+  test_symmetric
+  test_round_trip
+  test_chunks
+  test_errors
+
+end BLAS.Test.MatrixMarket
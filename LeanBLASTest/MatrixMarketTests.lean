@@ -0,0 +1,4 @@
+import LeanBLASTest.MatrixMarket
+
+def main : IO Unit :=
+  BLAS.Test.MatrixMarket.main
@@ -0,0 +1,176 @@
+import LeanBLAS
+import LeanBLAS.Matrix
+
+/-!
+# Matrix View Tests
+
+Checks that submatrix, block, row, column and transpose views address the
+right elements, that Level 2/3 calls on views match the equivalent calls with
+explicit `(order, trans, off, ld)` arguments, and that blocked algorithms built
+from views agree with the unblocked call for every array type.
+-/
+
+open BLAS CBLAS
+
+namespace BLAS.Test.MatrixView
+
+def floats (n : Nat) (phase : Float) : Array Float :=
+  Array.ofFn (n := n) fun i => Float.sin (Float.ofNat i.val * 0.37 + phase)
+
+def values (n : Nat) (phase : Float) : Float64Array :=
+  (FloatArray.mk (floats n phase)).toFloat64Array
+
+def values32 (n : Nat) (phase : Float) : Float32Array :=
+  (floats n phase).foldl (init := (Float32Array.mkZero n, 0)) (fun (a, i) x => (a.set i x, i + 1)) |>.1
+
+def complexValues (n : Nat) (phase : Float) : ComplexFloat64Array :=
+  let zs := ((floats n phase).zip (floats n (phase + 0.5))).map fun (re, im) => ComplexFloat.mk re im
+  (ComplexFloatArray.ofArray zs).toComplexFloat64Array
+
+/-- A well-conditioned lower triangular matrix. -/
+def lowerTriangular (n : Nat) : Float64Array :=
+  (FloatArray.mk (Array.ofFn (n := n * n) fun i =>
+    let r := i.val % n
+    let c := i.val / n
+    if r == c then 4.0 + Float.ofNat r * 0.01
+    else if r > c then Float.sin (Float.ofNat i.val) * 0.1
+    else 0.0)).toFloat64Array
+
+def bits (x : Float64Array) : Array UInt64 := x.toFloatArray.data.map Float.toBits
+
+def expect (name : String) (ok : Bool) (msg : String := "mismatch") : IO Unit := do
+  unless ok do throw $ IO.userError s!"{name}: {msg}"
+  IO.println s!"✓ {name}"
+
+/-- Largest `dist` between corresponding entries of two same-shape views. -/
+def maxDist {α R K : Type} [LevelOneData α R K] (dist : K → K → Float) (A B : Matrix α) : Float := Id.run do
+  let mut d := 0.0
+  for i in [0:A.rows] do
+    for j in [0:A.cols] do
+      d := max d (dist (A.get i j) (B.get i j))
+  return d
+
+/-- `C := A * B + C` one block product at a time, each updating a block of `C` in place. -/
+def blockedGemm {α R K : Type} [LevelThreeData α R K] [OfNat K 1] (nb : Nat) (A B C : Matrix α) :
+    Matrix α := Id.run do
+  let count := fun n => (n + nb - 1) / nb
+  let mut C := C
+  for bi in [0:count C.rows] do
+    for bj in [0:count C.cols] do
+      for bk in [0:count A.cols] do
+        C := C.modifySubmatrix (bi * nb) (bj * nb) nb nb fun Cij =>
+          Matrix.gemm 1 (A.block bi bk nb nb) (B.block bk bj nb nb) 1 Cij
+  return C
+
+def test_views : IO Unit := do
+  IO.println "Views address the right elements"
+  let a := values 70 0.0
+  let d := a.toFloatArray
+  -- 6 × 5 column-major block with leading dimension 9, starting at 4
+  let A : Matrix Float64Array := ⟨a, .ColMajor, 6, 5, 4, 9⟩
+  let entry := fun i j => d[4 + i + j * 9]!
+  let S := A.submatrix 2 1 3 3
+  let T := A.transpose
+  let mut ok := true
+  for i in [0:3] do
+    for j in [0:3] do
+      ok := ok && S.get i j == entry (i + 2) (j + 1)
+  for i in [0:5] do
+    for j in [0:6] do
+      ok := ok && T.get i j == entry j i
+  for j in [0:5] do
+    ok := ok && (A.row 3).get 0 j == entry 3 j
+  for i in [0:6] do
+    ok := ok && (A.col 2).get i 0 == entry i 2
+  for j in [0:5] do
+    ok := ok && (T.col 3).get j 0 == entry 3 j
+  expect "submatrix, transpose, row and col" ok
+  let B := A.block 1 1 4 4
+  expect "ragged last block is clipped" (B.rows == 2 && B.cols == 1 && B.get 0 0 == entry 4 4)
+  expect "submatrix of a transpose" ((T.submatrix 1 2 2 2).get 1 0 == entry 2 2)
+
+def test_transposed_calls : IO Unit := do
+  IO.println "Calls on transposed views pick the transpose flags"
+  let n := 7
+  let a := values (n * n) 0.0
+  let b := values (n * n) 1.0
+  let c := values (n * n) 2.0
+  let A := Matrix.colMajor a n n
+  let B := Matrix.colMajor b n n
+  let C := Matrix.colMajor c n n
+  let r := Matrix.gemm 1.5 A.transpose B 0.5 C
+  expect "gemm Aᵀ B" (bits r.data == bits (dgemm .ColMajor .Trans .NoTrans n.toUSize n.toUSize n.toUSize
+    1.5 a 0 n.toUSize b 0 n.toUSize 0.5 c 0 n.toUSize))
+  let r := Matrix.gemm 1.0 A B.transpose 0.0 C.transpose
+  expect "gemm into a row-major view" (bits r.data == bits (dgemm .RowMajor .Trans .NoTrans n.toUSize n.toUSize
+    n.toUSize 1.0 a 0 n.toUSize b 0 n.toUSize 0.0 c 0 n.toUSize))
+  let l := lowerTriangular n
+  let L := Matrix.colMajor l n n
+  -- Lᵀ is upper triangular; the call solves with the stored lower triangle transposed.
+  let r := Matrix.trsm .Left .Upper false 1.0 L.transpose B
+  expect "trsm with Lᵀ" (bits r.data == bits (dtrsm .ColMajor .Left .Lower .Trans .NonUnit n.toUSize n.toUSize
+    1.0 l 0 n.toUSize b 0 n.toUSize))
+  let r := Matrix.trmm .Right .Lower true 2.0 L B
+  expect "trmm" (bits r.data == bits (dtrmm .ColMajor .Right .Lower .NoTrans .Unit n.toUSize n.toUSize
+    2.0 l 0 n.toUSize b 0 n.toUSize))
+  let r := Matrix.syrk .Upper 1.0 A.transpose 1.0 C
+  expect "syrk Aᵀ A" (bits r.data == bits (dsyrk .ColMajor .Upper .Trans n.toUSize n.toUSize
+    1.0 a 0 n.toUSize 1.0 c 0 n.toUSize))
+  -- symm needs B in C's order; a row-major B is copied first.
+  let S := (Matrix.syrk .Lower 1.0 A 0.0 C).symmetrize .Lower
+  let viaCopy := Matrix.symm .Left .Lower 1.0 S (Matrix.rowMajor b n n).transpose.transpose 0.0 C
+  let direct := Matrix.symm .Left .Lower 1.0 S (Matrix.rowMajor b n n |>.compact (order := .ColMajor)) 0.0 C
+  expect "symm with a row-major B" (bits viaCopy.data == bits direct.data)
+  expect "symmetrize" (maxDist (fun x y => (x - y).abs) S S.transpose == 0.0)
+
+def test_level2_views : IO Unit := do
+  IO.println "Level 2 calls on rows and columns"
+  let m := 6
+  let n := 4
+  let a := values (m * n) 0.0
+  let A := Matrix.rowMajor a m n
+  let X := Matrix.colMajor (values (n * 3) 1.0) n 3
+  let Y := Matrix.colMajor (values (3 * m) 2.0) 3 m
+  -- y := A * X[:,1] written into row 2 of Y
+  let r := Matrix.gemv 1.0 A (X.col 1) 0.0 (Y.row 2)
+  let want := dgemv .RowMajor .NoTrans m.toUSize n.toUSize 1.0 a 0 n.toUSize X.data n.toUSize 1 0.0 Y.data 2 3
+  expect "gemv from a column into a row" (bits r.data == bits want)
+  let r := Matrix.ger 0.5 (Y.row 0).transpose (X.col 2) A
+  let want := dger .RowMajor m.toUSize n.toUSize 0.5 Y.data 0 3 X.data (2 * n).toUSize 1 a 0 n.toUSize
+  expect "ger with a row and a column" (bits r.data == bits want)
+  let l := lowerTriangular n
+  let L := Matrix.colMajor l n n
+  let x := Matrix.trsv .Lower false L (Matrix.trmv .Lower false L (X.col 0))
+  expect "trsv undoes trmv" (maxDist (fun u v => (u - v).abs) (x.col 0) (X.col 0) < 1e-12)
+
+def test_blocked : IO Unit := do
+  IO.println "Blocked gemm on views matches one gemm"
+  let (m, k, n) := (13, 11, 9)
+  for nb in [4, 5, 16] do
+    let A := Matrix.colMajor (values (m * k) 0.0) m k
+    let B := (Matrix.colMajor (values (n * k) 1.0) n k).transpose
+    let C := Matrix.colMajor (values (m * n) 2.0) m n
+    let blocked := blockedGemm nb A B C
+    let full := Matrix.gemm 1.0 A B 1.0 C
+    expect s!"Float64Array, blocks of {nb}" (maxDist (fun x y => (x - y).abs) blocked full < 1e-12)
+  let A := Matrix.colMajor (values32 (m * k) 0.0) m k
+  let B := Matrix.rowMajor (values32 (k * n) 1.0) k n
+  let C := Matrix.colMajor (values32 (m * n) 2.0) m n
+  expect "Float32Array, blocks of 4"
+    (maxDist (fun x y => (x - y).abs) (blockedGemm 4 A B C) (Matrix.gemm 1.0 A B 1.0 C) < 1e-5)
+  let A := Matrix.colMajor (complexValues (m * k) 0.0) m k
+  let B := Matrix.colMajor (complexValues (k * n) 1.0) k n
+  let C := Matrix.rowMajor (complexValues (m * n) 2.0) m n
+  expect "ComplexFloat64Array, blocks of 4"
+    (maxDist (fun x y => (x - y).abs) (blockedGemm 4 A B C) (Matrix.gemm ComplexFloat.one A B ComplexFloat.one C) < 1e-12)
+
+def main : IO Unit := do
+  IO.println "Matrix View Tests"
+  IO.println "================="
+  test_views
+  test_transposed_calls
+  test_level2_views
+  test_blocked
+  IO.println "All matrix view tests passed"
+
+end BLAS.Test.MatrixView
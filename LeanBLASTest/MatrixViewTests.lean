@@ -0,0 +1,4 @@
+import LeanBLASTest.MatrixView
+
+def main : IO Unit :=
+  BLAS.Test.MatrixView.main
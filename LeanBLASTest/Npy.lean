@@ -0,0 +1,107 @@
+import LeanBLAS
+import LeanBLAS.FFI.Npy
+import LeanBLASTest.FileFixtures
+
+/-!
+# NumPy File Tests
+
+Round-trips every supported array type and order through `.npy` and `.npz`
+(stored and deflated), checks that mapped and copied loads agree and that a
+write to a mapped array leaves the file alone, reads a big-endian file written
+byte by byte, and checks the errors for a wrong dtype, a missing array, a
+file that is not a `.npy` and a compressed entry with a forged size.
+-/
+
+open BLAS BLAS.Npy BLAS.Test.Files
+
+namespace BLAS.Test.Npy
+
+def dir : System.FilePath := ".lake" / "npy-test"
+
+def test_npy : IO Unit := do
+  let A : NpyArray Float64Array := { data := f64 12 0.0, shape := #[3, 4], order := .ColMajor }
+  let x : NpyArray Float32Array := { data := f32 7, shape := #[7] }
+  let z : NpyArray ComplexFloat64Array := { data := c64, shape := #[3, 1] }
+  let e : NpyArray Float64Array := { data := f64 0 0.0, shape := #[0, 5] }
+  save (dir / "A.npy") A
+  save (dir / "x.npy") x
+  save (dir / "z.npy") z
+  save (dir / "e.npy") e
+  for mmap in [true, false] do
+    same s!"f64 mmap={mmap}" (← load (α := Float64Array) (dir / "A.npy") mmap) A
+    same s!"f32 mmap={mmap}" (← load (α := Float32Array) (dir / "x.npy") mmap) x
+    same s!"c64 mmap={mmap}" (← load (α := ComplexFloat64Array) (dir / "z.npy") mmap) z
+    same s!"empty mmap={mmap}" (← load (α := Float64Array) (dir / "e.npy") mmap) e
+  IO.println "✓ npy round trips"
+
+def test_mapped_write : IO Unit := do
+  let A : NpyArray Float64Array := { data := f64 1000 1.0, shape := #[1000] }
+  save (dir / "m.npy") A
+  let B ← load (α := Float64Array) (dir / "m.npy")
+  scaleMapped "mapped array" B A
+  same "file after dscal" (← load (α := Float64Array) (dir / "m.npy") (mmap := false)) A
+  IO.println "✓ writes to a mapped array copy it"
+
+/-- A hand-written big-endian `float64` file in Fortran order. -/
+def bigEndian : ByteArray := Id.run do
+  let dict := "{'descr': '>f8', 'fortran_order': True, 'shape': (2, 2), }"
+  let len := 64 - 10
+  let header := (dict ++ "".pushn ' ' (len - dict.length - 1) ++ "\n").toUTF8
+  let mut b := ByteArray.mk #[0x93] ++ "NUMPY".toUTF8 ++ ByteArray.mk #[1, 0, len.toUInt8, 0] ++ header
+  for v in [1.5, 2.5, -3.0, 4.0] do
+    let bits := v.toBits
+    for k in [0:8] do
+      b := b.push (bits >>> (8 * (7 - k)).toUInt64).toUInt8
+  return b
+
+def test_big_endian : IO Unit := do
+  IO.FS.writeBinFile (dir / "be.npy") bigEndian
+  let A ← load (α := Float64Array) (dir / "be.npy")
+  expect (A.shape == #[2, 2] && A.order == .ColMajor) "big-endian: wrong shape or order"
+  let d := A.data.toFloatArray
+  expect (d.toList == [1.5, 2.5, -3.0, 4.0]) s!"big-endian: read {d.toList}"
+  IO.println "✓ big-endian npy"
+
+def test_npz : IO Unit := do
+  let A : NpyArray Float64Array := { data := f64 20 2.0, shape := #[4, 5] }
+  let x : NpyArray Float32Array := { data := f32 9, shape := #[9], order := .ColMajor }
+  let z : NpyArray ComplexFloat64Array := { data := c64, shape := #[3] }
+  for compress in (if compressionAvailable () then [false, true] else [false]) do
+    let path := dir / s!"d{compress}.npz"
+    saveNpz path #[("A", A.toRaw), ("x", x.toRaw), ("z", z.toRaw)] compress
+    expect ((← npzNames path) == #["A", "x", "z"]) s!"npz names: {← npzNames path}"
+    for mmap in [true, false] do
+      same s!"npz A compress={compress}" (← loadNpz (α := Float64Array) path "A" mmap) A
+      same s!"npz x compress={compress}" (← loadNpz (α := Float32Array) path "x" mmap) x
+      same s!"npz z compress={compress}" (← loadNpz (α := ComplexFloat64Array) path "z" mmap) z
+  IO.println "✓ npz round trips"
+
+def test_errors : IO Unit := do
+  save (dir / "w.npy") { data := f64 4 0.0, shape := #[4] : NpyArray Float64Array }
+  fails "wrong dtype" "dtype" (load (α := Float32Array) (dir / "w.npy"))
+  fails "missing array" "no array named" (loadNpz (α := Float64Array) (dir / "dfalse.npz") "B")
+  fails "not npy" "not a .npy" (load (α := Float64Array) (dir / "dfalse.npz"))
+  fails "shape mismatch" "shape" (save (dir / "bad.npy") { data := f64 4 0.0, shape := #[5] : NpyArray Float64Array })
+  fails "missing file" "missing.npy" (load (α := Float64Array) (dir / "missing.npy"))
+  if compressionAvailable () then
+    -- a deflated entry claiming more data than its compressed bytes can hold
+    let mut b ← IO.FS.readBinFile (dir / "dtrue.npz")
+    let some cd := (List.range (b.size - 3)).find? fun i =>
+        b.get! i == 0x50 && b.get! (i + 1) == 0x4b && b.get! (i + 2) == 1 && b.get! (i + 3) == 2
+      | throw $ IO.userError "dtrue.npz has no central directory"
+    for k in [0:4] do b := b.set! (cd + 24 + k) 0x70
+    IO.FS.writeBinFile (dir / "forged.npz") b
+    fails "forged size" "is impossible for" (loadNpz (α := Float64Array) (dir / "forged.npz") "A")
+  else
+    fails "no zlib" "no zlib" (saveNpz (dir / "z.npz") #[] (compress := true))
+  IO.println "✓ errors"
+
+def main : IO Unit := do
+  IO.FS.createDirAll dir
+  test_npy
+  test_mapped_write
+  test_big_endian
+  test_npz
+  test_errors
+
+end BLAS.Test.Npy
@@ -0,0 +1,4 @@
+import LeanBLASTest.Npy
+
+def main : IO Unit :=
+  BLAS.Test.Npy.main
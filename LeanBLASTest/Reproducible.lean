@@ -0,0 +1,120 @@
+import LeanBLAS
+import LeanBLAS.CBLAS.LevelThree
+import LeanBLAS.FFI.Reproducible
+
+/-!
+# Reproducible Mode Tests
+
+Checks that `BLAS.Reproducible.ddot`, `dsum`, `dasum`, `dnrm2`, `dgemv` and
+`dgemm` return the same bits for every thread count, that the binned reductions
+do not depend on the order or stride of their input, and that the reproducible
+mode switches call graph replays but not the pure `BLAS.CBLAS` bindings.
+-/
+
+open BLAS CBLAS
+
+namespace BLAS.Test.Reproducible
+
+/-- Values spanning ~12 orders of magnitude with mixed signs, so that a plain
+sum depends on how the terms are grouped. -/
+def values (n : Nat) (phase : Float) : Array Float := Id.run do
+  let mut xs := Array.mkEmpty n
+  for i in [:n] do
+    let e := Float.ofNat ((i * 7) % 41) - 20.0
+    xs := xs.push (Float.sin (Float.ofNat i * 0.37 + phase) * Float.pow 2.0 e)
+  return xs
+
+def toF64 (xs : Array Float) : Float64Array := (FloatArray.mk xs).toFloat64Array
+
+/-- Sizes are read back from a reference so that the calls below happen after
+the thread count changed, instead of being hoisted as constants. -/
+structure Sizes where
+  n : USize
+  m : USize
+  k : USize
+
+/-- Bit patterns of every reproducible routine on fixed inputs. -/
+def results (sizes : IO.Ref Sizes) (threads : USize) : IO (Array UInt64) := do
+  BLAS.Backend.setNativeThreads threads
+  let ⟨n, m, k⟩ ← sizes.get
+  let x := toF64 (values n.toNat 0.0)
+  let y := toF64 (values n.toNat 1.0)
+  let a := toF64 (values (m * k).toNat 2.0)
+  let b := toF64 (values (k * m).toNat 3.0)
+  let c := toF64 (values (m * m).toNat 4.0)
+  let v := Reproducible.dgemv Order.ColMajor Transpose.NoTrans m k 0.5 a 0 m y 0 1 0.25 (toF64 (values m.toNat 5.0)) 0 1
+  let w := Reproducible.dgemv Order.RowMajor Transpose.NoTrans m k 0.5 a 0 k y 0 1 0.0 (toF64 (values m.toNat 5.0)) 0 1
+  let p := Reproducible.dgemm Order.ColMajor Transpose.NoTrans Transpose.Trans m m k 1.5 a 0 m b 0 m (-0.5) c 0 m
+  let scalars := #[Reproducible.ddot n x 0 1 y 0 1, Reproducible.dsum n x 0 1, Reproducible.dasum n x 0 1,
+    Reproducible.dnrm2 n x 0 1]
+  let arrays := #[v, w, p].map fun r => r.toFloatArray.data.foldl (fun h f => mixHash h f.toBits) 7
+  return scalars.map Float.toBits ++ arrays
+
+def test_threads (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Reproducible: same bits for 1-4 threads"
+  let reference ← results sizes 1
+  for t in [2, 3, 4] do
+    let r ← results sizes t.toUSize
+    if r != reference then
+      throw $ IO.userError s!"results with {t} threads differ from 1 thread: {r} vs {reference}"
+  IO.println "✓ ddot, dsum, dasum, dnrm2, dgemv, dgemm"
+
+def test_order (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Reproducible: dsum independent of order and stride"
+  let ⟨n, _, _⟩ ← sizes.get
+  let xs := values n.toNat 0.0
+  let forward := Reproducible.dsum n (toF64 xs) 0 1
+  let backward := Reproducible.dsum n (toF64 xs.reverse) 0 1
+  let strided := Reproducible.dsum n (toF64 (xs.flatMap fun x => #[x, 1.0e300])) 0 2
+  if forward.toBits != backward.toBits || forward.toBits != strided.toBits then
+    throw $ IO.userError s!"dsum depends on layout: {forward} {backward} {strided}"
+  IO.println s!"✓ dsum = {forward}"
+
+def test_accuracy (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Reproducible: agrees with the backend"
+  let ⟨n, _, _⟩ ← sizes.get
+  let x := toF64 (values n.toNat 0.0)
+  let y := toF64 (values n.toNat 1.0)
+  let repro := Reproducible.ddot n x 0 1 y 0 1
+  let plain := ddot n x 0 1 y 0 1
+  if (repro - plain).abs > 1e-9 * repro.abs then
+    throw $ IO.userError s!"reproducible ddot {repro} far from backend {plain}"
+  IO.println s!"✓ ddot {repro} vs backend {plain}"
+
+def test_special : IO Unit := do
+  IO.println "Reproducible: special values"
+  let inf := 1.0 / 0.0
+  let s := Reproducible.dsum 4 #f64[1.0, inf, 2.0, -inf] 0 1
+  let t := Reproducible.dsum 3 #f64[1.0e308, 1.0e308, -1.0e308] 0 1
+  if !s.isNaN || t != 1.0e308 || Reproducible.dsum 0 #f64[] 0 1 != 0.0 then
+    throw $ IO.userError s!"special values: {s} {t}"
+  IO.println "✓ inf - inf = NaN, no spurious overflow"
+
+/-- The sequential sum of `1e16, 1, -1e16` loses the 1 and the binned sum keeps
+it, so the result shows which routine ran. -/
+def test_mode : IO Unit := do
+  IO.println "Reproducible mode: switches graph replays, not the pure bindings"
+  let x := #f64[1.0e16, 1.0, -1.0e16]
+  let (graph, total) ← CallGraph.capture do
+    let v ← CallGraph.arg 3
+    CallGraph.dsum 3 v 0 1
+  let (_, plain) ← graph.replay #[x]
+  let (_, repro) ← BLAS.Reproducible.withEnabled (graph.replay #[x])
+  let pureSum ← BLAS.Reproducible.withEnabled (return dsum 3 x 0 1)
+  if plain[total.id]! != 0.0 || repro[total.id]! != 1.0 || pureSum != 0.0 || Reproducible.dsum 3 x 0 1 != 1.0 then
+    throw $ IO.userError s!"mode: replay {plain[total.id]!} / {repro[total.id]!}, CBLAS.dsum {pureSum}"
+  if (← BLAS.Reproducible.isEnabled) then
+    throw $ IO.userError "withEnabled did not restore the previous mode"
+  IO.println "✓ replay follows the mode, CBLAS.dsum does not"
+
+def main : IO Unit := do
+  let sizes ← IO.mkRef { n := 100003, m := 600, k := 257 : Sizes }
+  let before ← BLAS.Backend.nativeThreads
+  test_threads sizes
+  test_order sizes
+  test_accuracy sizes
+  test_special
+  BLAS.Backend.setNativeThreads before
+  test_mode
+
+end BLAS.Test.Reproducible
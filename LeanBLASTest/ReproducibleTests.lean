@@ -0,0 +1,4 @@
+import LeanBLASTest.Reproducible
+
+def main : IO Unit :=
+  BLAS.Test.Reproducible.main
@@ -0,0 +1,178 @@
+import LeanBLASTest.BenchmarkSuite
+
+/-!
+# Roofline
+
+Places every case of the benchmark suite on the roofline of this machine:
+
+* the roofs are the STREAM-like triad bandwidth and the peak FMA throughput
+  measured by `c/bench/roofline_peak.c` (the `rooflinePeakC` target), for 1, 2,
+  4, … threads up to the thread count the BLAS uses;
+* an operation with arithmetic intensity `I` flop/byte can reach at most
+  `min(peak, I · bandwidth)`. Operations without flops (`copy`, `swap`,
+  `abs`) are compared with the bandwidth alone;
+* the report gives the achieved rate as a percentage of that roof, and
+  whether the roof is the memory or the compute one.
+
+Flop and byte counts are the models of the suite: compulsory traffic only,
+so an operation whose data fits in cache can exceed 100% of the memory roof.
+
+```
+lake exe Roofline [--quick] [--op gemv]… [--precision f64]… [--threads T] [--peak PATH] [--csv FILE]
+```
+-/
+
+open BLAS BLAS.Test.Bench BLAS.Test.BenchmarkSuite
+
+namespace BLAS.Test.Roofline
+
+/-- Measured roofs as `(threads, value)`, by increasing thread count. -/
+structure Roofs where
+  /-- GB/s -/
+  triad : Array (Nat × Float) := #[]
+  /-- GFLOP/s -/
+  fma64 : Array (Nat × Float) := #[]
+  fma32 : Array (Nat × Float) := #[]
+
+/-- The value at the largest measured thread count not above `threads`. -/
+def roofAt (xs : Array (Nat × Float)) (threads : Nat) : Float :=
+  (xs.foldl (fun best (t, v) => if t ≤ threads then some v else best) none).getD
+    ((xs[0]?.map (·.2)).getD 0.0)
+
+/-- Runs the roof program for up to `threads` threads. -/
+def measureRoofs (path : String) (threads : Nat) : IO Roofs := do
+  unless (← System.FilePath.pathExists path) do
+    throw $ IO.userError s!"{path} not found (lake build rooflinePeakC)"
+  let out ← IO.Process.output { cmd := path, args := #[toString threads] }
+  if out.exitCode != 0 then
+    throw $ IO.userError s!"{path} failed: {out.stderr}"
+  let mut roofs : Roofs := {}
+  for line in out.stdout.splitOn "\n" do
+    match line.splitOn "\t" with
+    | [kind, t, v] =>
+      let some t := t.toNat? | continue
+      let some v := parseFloat v | continue
+      match kind with
+      | "triad" => roofs := { roofs with triad := roofs.triad.push (t, v) }
+      | "fma64" => roofs := { roofs with fma64 := roofs.fma64.push (t, v) }
+      | "fma32" => roofs := { roofs with fma32 := roofs.fma32.push (t, v) }
+      | _ => pure ()
+    | _ => pure ()
+  if roofs.triad.isEmpty || roofs.fma64.isEmpty then
+    throw $ IO.userError s!"{path} printed no roofs:\n{out.stdout}"
+  return roofs
+
+def Roofs.print (r : Roofs) : IO Unit := do
+  IO.println "threads\ttriad GB/s\tf64 GFLOP/s\tf32 GFLOP/s\tridge f64 (flop/byte)"
+  for (t, bw) in r.triad do
+    let p64 := roofAt r.fma64 t
+    IO.println s!"{t}\t{bw}\t{p64}\t{roofAt r.fma32 t}\t{p64 / bw}"
+
+/-- Where a measured case sits under the roofs `bandwidth` (GB/s) and `peak` (GFLOP/s). -/
+structure Placement where
+  /-- flop/byte, 0 for operations without flops -/
+  intensity : Float
+  /-- GFLOP/s, or GB/s for operations without flops -/
+  achieved : Float
+  roof : Float
+  bound : String
+
+def Placement.percent (p : Placement) : Float := 100.0 * p.achieved / p.roof
+
+def place (bandwidth peak : Float) (r : Result) : Placement :=
+  if r.model.flops == 0.0 || r.model.bytes == 0.0 then
+    { intensity := 0.0, achieved := r.gbps, roof := bandwidth, bound := "memory" }
+  else
+    let intensity := r.model.flops / r.model.bytes
+    let memoryRoof := intensity * bandwidth
+    if memoryRoof < peak then
+      { intensity, achieved := r.gflops, roof := memoryRoof, bound := "memory" }
+    else
+      { intensity, achieved := r.gflops, roof := peak, bound := "compute" }
+
+structure Options where
+  quick : Bool := false
+  ops : List String := []
+  precisions : List String := []
+  threads : Option Nat := none
+  peak : String := ".lake/build/bin/roofline_peak_c"
+  csv : Option String := none
+
+def parseArgs (o : Options) : List String → Except String Options
+  | [] => .ok o
+  | "--quick" :: rest => parseArgs { o with quick := true } rest
+  | "--op" :: op :: rest => parseArgs { o with ops := o.ops ++ [op] } rest
+  | "--precision" :: p :: rest => parseArgs { o with precisions := o.precisions ++ [p] } rest
+  | "--threads" :: t :: rest => match t.toNat? with
+    | some t => parseArgs { o with threads := some t } rest
+    | none => .error s!"--threads expects a number, got {t}"
+  | "--peak" :: path :: rest => parseArgs { o with peak := path } rest
+  | "--csv" :: path :: rest => parseArgs { o with csv := some path } rest
+  | arg :: _ => .error s!"unknown or incomplete argument {arg}"
+
+def usage : String :=
+  "usage: Roofline [--quick] [--op NAME]… [--precision f64|f32|c64]… [--threads T] [--peak PATH] [--csv FILE]"
+
+/-- Threads the BLAS calls run on: the native pool, or one per physical core for
+a system BLAS. -/
+def blasThreads : IO Nat := do
+  if BLAS.Backend.backendName () == "native" then
+    return (← BLAS.Backend.nativeThreads).toNat
+  return max 1 (((BLAS.Backend.cpuTopology ())[1]?).getD 1)
+
+section
+
+variable {α K : Type} [LevelOneData α Float K] [LevelOneDataExt α Float K]
+  [LevelTwoData α Float K] [LevelThreeData α Float K] [Inhabited α]
+
+def runPrecision (cfg : Config) (sizes : Sizes) (ops : List String) (bandwidth peak : Float)
+    (P : Precision α K) : IO (Array (Result × Placement)) := do
+  let mut rows := #[]
+  for c in (← cases sizes ops P) do
+    let (stats, checksum) ← measure cfg c.body
+    let r : Result := { op := c.op, precision := P.name, shape := c.shape, model := c.model, stats, checksum }
+    let p := place bandwidth peak r
+    let unit := if p.intensity == 0.0 then "GB/s" else "GFLOP/s"
+    IO.println s!"{r.op}\t{r.precision}\t{r.shape}\t{p.intensity}\t{p.achieved} {unit}\t\
+      {p.roof} {unit}\t{p.percent}%\t{p.bound}"
+    rows := rows.push (r, p)
+  return rows
+
+end
+
+def toCsv (rows : Array (Result × Placement)) : String :=
+  "op,precision,shape,median_ns,flop_per_byte,achieved,roof,percent_of_roof,bound\n" ++
+    String.join (rows.toList.map fun (r, p) =>
+      s!"{r.op},{r.precision},{r.shape},{r.stats.median},{p.intensity},{p.achieved},{p.roof},\
+        {p.percent},{p.bound}\n")
+
+def main (args : List String) : IO UInt32 := do
+  let o ← match parseArgs {} args with
+    | .ok o => pure o
+    | .error msg => throw $ IO.userError s!"{msg}\n{usage}"
+  let threads ← match o.threads with
+    | some t => pure (max t 1)
+    | none => blasThreads
+  IO.println s!"Roofline ({BLAS.Backend.backendName ()} backend, {threads} BLAS threads)\n"
+  let roofs ← measureRoofs o.peak threads
+  roofs.print
+  let bandwidth := roofAt roofs.triad threads
+  IO.println s!"\nroofs at {threads} threads: {bandwidth} GB/s, \
+    {roofAt roofs.fma64 threads} GFLOP/s (f64), {roofAt roofs.fma32 threads} GFLOP/s (f32)\n"
+  let cfg : Config := if o.quick then Config.quick else {}
+  let sizes := if o.quick then Sizes.quick else Sizes.full
+  IO.println "op\tprecision\tshape\tflop/byte\tachieved\troof\t% of roof\tbound"
+  let wanted := fun p => o.precisions.isEmpty || o.precisions.contains p
+  let mut rows := #[]
+  if wanted f64.name then
+    rows := rows ++ (← runPrecision cfg sizes o.ops bandwidth (roofAt roofs.fma64 threads) f64)
+  if wanted f32.name then
+    rows := rows ++ (← runPrecision cfg sizes o.ops bandwidth (roofAt roofs.fma32 threads) f32)
+  if wanted c64.name then
+    rows := rows ++ (← runPrecision cfg sizes o.ops bandwidth (roofAt roofs.fma64 threads) c64)
+  if let some path := o.csv then
+    IO.FS.writeFile path (toCsv rows)
+    IO.println s!"wrote {rows.size} rows to {path}"
+  return 0
+
+end BLAS.Test.Roofline
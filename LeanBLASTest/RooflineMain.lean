@@ -0,0 +1,4 @@
+import LeanBLASTest.Roofline
+
+def main (args : List String) : IO UInt32 :=
+  BLAS.Test.Roofline.main args
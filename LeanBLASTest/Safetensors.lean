@@ -0,0 +1,99 @@
+import LeanBLAS
+import LeanBLAS.FFI.Safetensors
+import LeanBLASTest.FileFixtures
+
+/-!
+# Safetensors Tests
+
+Writes `F32` and `F64` tensors with metadata, loads them mapped and copied,
+checks that a write to a mapped tensor leaves the file alone, widens
+hand-written `F16` and `BF16` tensors, keeps the bytes of an integer tensor,
+and checks the errors for tensors written out of order, a dtype mismatch, a
+missing tensor, a complex array, a header that names a tensor twice and a
+file that is not a safetensors file.
+-/
+
+open BLAS BLAS.Npy BLAS.Safetensors BLAS.Test.Files
+
+namespace BLAS.Test.Safetensors
+
+def dir : System.FilePath := ".lake" / "safetensors-test"
+
+def W : NpyArray Float32Array := { data := f32 12, shape := #[3, 4] }
+def b : NpyArray Float32Array := { data := f32 5, shape := #[5] }
+def D : NpyArray Float64Array := { data := f64 1000 0.5, shape := #[10, 100] }
+
+def test_round_trip : IO Unit := do
+  save (dir / "f32.safetensors") #[("layer.W", W), ("layer.b", b)] (metadata := #[("format", "pt")])
+  save (dir / "f64.safetensors") #[("D", D)]
+  for mmap in [true, false] do
+    let f ← load (dir / "f32.safetensors") mmap
+    expect (f.names == #["layer.W", "layer.b"]) s!"names: {f.names}"
+    expect (f.metadata == #[("format", "pt")]) s!"metadata: {f.metadata}"
+    same s!"W mmap={mmap}" (← f.get "layer.W") W
+    same s!"b mmap={mmap}" (← f.get "layer.b") b
+    same s!"D mmap={mmap}" (← (← load (dir / "f64.safetensors") mmap).get "D") D
+  IO.println "✓ safetensors round trips"
+
+def test_mapped_write : IO Unit := do
+  let E ← (← load (dir / "f64.safetensors")).get (α := Float64Array) "D"
+  scaleMapped "mapped tensor" E D
+  same "file after dscal" (← (← load (dir / "f64.safetensors") (mmap := false)).get "D") D
+  IO.println "✓ writes to a mapped tensor copy it"
+
+def test_widening : IO Unit := do
+  let tensors := #[("h", { dtype := "F16", shape := #[3] : Info }), ("bf", { dtype := "BF16", shape := #[2] }),
+                   ("ids", { dtype := "I32", shape := #[2] })]
+  write (dir / "half.safetensors") tensors fun w => do
+    -- 1.0, -0.5, 2^-24 (the smallest subnormal)
+    w.addBytes "h" (ByteArray.mk #[0x00, 0x3C, 0x00, 0xB8, 0x01, 0x00])
+    -- 1.0, -3.0
+    w.addBytes "bf" (ByteArray.mk #[0x80, 0x3F, 0x40, 0xC0])
+    w.addBytes "ids" (ByteArray.mk #[7, 0, 0, 0, 9, 0, 0, 0])
+  let f ← load (dir / "half.safetensors")
+  let h ← f.get (α := Float32Array) "h"
+  expect (h.data.get 0 == 1.0 && h.data.get 1 == -0.5 && h.data.get 2 == Float.pow 2.0 (-24.0))
+    s!"F16: {h.data.get 0} {h.data.get 1} {h.data.get 2}"
+  let bf ← f.get (α := Float32Array) "bf"
+  expect (bf.data.get 0 == 1.0 && bf.data.get 1 == -3.0) s!"BF16: {bf.data.get 0} {bf.data.get 1}"
+  let some ids := f.getRaw? "ids" | throw $ IO.userError "ids missing"
+  expect (ids.dtype == "I32" && ids.data.data == #[7, 0, 0, 0, 9, 0, 0, 0]) "I32 bytes"
+  fails "integer as float" "dtype is I32" (f.get (α := Float32Array) "ids")
+  IO.println "✓ F16 and BF16 are widened to F32"
+
+/-- A file with a hand-written JSON header. -/
+def writeRaw (path : System.FilePath) (header : String) (data : ByteArray) : IO Unit := do
+  let h := header.toUTF8
+  let len := ByteArray.mk ((Array.range 8).map fun i => (h.size >>> (8 * i)).toUInt8)
+  IO.FS.writeBinFile path (len ++ h ++ data)
+
+def test_errors : IO Unit := do
+  let tensors := #[("a", { dtype := "F32", shape := #[2] : Info }), ("b", { dtype := "F32", shape := #[1] })]
+  let w ← Writer.new (dir / "e.safetensors").toString tensors #[]
+  fails "order" "expected tensor 'a', got 'b'" (w.add "b" (f32 1))
+  fails "size" "expected 8" (w.add "a" (f32 3))
+  w.add "a" (f32 2)
+  fails "unfinished" "never written" w.finish
+  let f ← load (dir / "f32.safetensors")
+  fails "dtype" "expected F64" (f.get (α := Float64Array) "layer.W")
+  fails "missing" "no tensor 'nope'" (f.get (α := Float32Array) "nope")
+  fails "column-major" "row-major" (save (dir / "c.safetensors") #[("W", { W with order := .ColMajor })])
+  let Z : NpyArray ComplexFloat64Array := { data := ComplexFloat64Array.zeros 2, shape := #[2] }
+  fails "complex" "no safetensors dtype for c16" (save (dir / "z.safetensors") #[("Z", Z)])
+  writeRaw (dir / "empty.safetensors") "{}" .empty
+  expect ((← load (dir / "empty.safetensors")).names.isEmpty) "empty header"
+  let t := "{\"dtype\":\"F32\",\"shape\":[1],\"data_offsets\":[0,4]}"
+  writeRaw (dir / "dup.safetensors") s!"\{\"a\":{t},\"a\":{t}}" (ByteArray.mk #[0, 0, 0, 0])
+  fails "duplicate" "duplicate tensor 'a'" (load (dir / "dup.safetensors"))
+  IO.FS.writeBinFile (dir / "junk.safetensors") "not a safetensors file".toUTF8
+  fails "junk" "not a safetensors file" (load (dir / "junk.safetensors"))
+  IO.println "✓ errors"
+
+def main : IO Unit := do
+  IO.FS.createDirAll dir
+  test_round_trip
+  test_mapped_write
+  test_widening
+  test_errors
+
+end BLAS.Test.Safetensors
@@ -0,0 +1,4 @@
+import LeanBLASTest.Safetensors
+
+def main : IO Unit :=
+  BLAS.Test.Safetensors.main
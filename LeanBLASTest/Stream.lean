@@ -0,0 +1,104 @@
+import LeanBLAS
+import LeanBLAS.FFI.Stream
+import LeanBLASTest.FileFixtures
+
+/-!
+# Streaming Pipeline Tests
+
+Runs reductions and maps over files much larger than the chunk size and checks
+them against the same computation on in-memory arrays: `dot`, `nrm2`, `asum`
+and `sum` across chunk boundaries, fused maps written to a new file, in-place
+`scal` and `axpy`, `y` reading as zeros, `nrm2` of values whose squares
+overflow, and the errors for mismatched sizes and a missing file.
+-/
+
+open BLAS BLAS.Stream BLAS.Test.Files
+
+namespace BLAS.Test.Stream
+
+def dir : System.FilePath := ".lake" / "stream-test"
+
+def n : Nat := 100003
+
+def xs : FloatArray := FloatArray.mk (Array.ofFn (n := n) fun i => Float.sin (i.val.toFloat * 0.001))
+def ys : FloatArray := FloatArray.mk (Array.ofFn (n := n) fun i => Float.cos (i.val.toFloat * 0.002) + 0.5)
+
+def writeVec (path : System.FilePath) (v : FloatArray) : IO Unit :=
+  IO.FS.writeBinFile path v.toFloat64Array.data
+
+def readVec (path : System.FilePath) : IO FloatArray := do
+  let b ← IO.FS.readBinFile path
+  if h : b.size % 8 = 0 then return (Float64Array.mk b h).toFloatArray
+  else throw $ IO.userError s!"{path}: size is not a multiple of 8"
+
+def close (a b : Float) : Bool := (a - b).abs ≤ 1e-9 * (1 + b.abs)
+
+def closeVec (a b : FloatArray) : Bool :=
+  a.size == b.size && (List.range a.size).all fun i => close a[i]! b[i]!
+
+def fold (f : Float → Float → Float → Float) : Float := Id.run do
+  let mut s := 0.0
+  for i in [0:n] do s := f s xs[i]! ys[i]!
+  return s
+
+def test_reductions : IO Unit := do
+  let x := dir / "x.bin"
+  let y := dir / "y.bin"
+  writeVec x xs
+  writeVec y ys
+  let d := fold fun s a b => s + a * b
+  let nx := (fold fun s a _ => s + a * a).sqrt
+  let ay := fold fun s _ b => s + b.abs
+  for chunk in [1000, 65536, n] do
+    let r ← run { x, y := some y, steps := #[.dot, .nrm2 .x, .asum .y, .sum .x], chunk }
+    expect (r.size == 4) s!"results: {r}"
+    expect (close r[0]! d && close r[1]! nx && close r[2]! ay) s!"chunk {chunk}: {r}"
+    expect (close r[3]! (fold fun s a _ => s + a)) s!"chunk {chunk}: sum {r[3]!}"
+  expect (close (← dot x y (chunk := 777)) d) "dot"
+  expect (close (← nrm2 x (chunk := 777)) nx) "nrm2"
+  IO.println "✓ reductions carry across chunks"
+
+def test_maps : IO Unit := do
+  let x := dir / "x.bin"
+  let y := dir / "y.bin"
+  -- z ← |2x + y| + 1, written from y without touching either input
+  let r ← run { x, y := some y, steps := #[.axpy 2.0, .abs .y, .scaladd .y 1.0 1.0, .sum .y],
+                output := some (.y, dir / "z.bin"), chunk := 4096 }
+  let z := FloatArray.mk (Array.ofFn (n := n) fun i => (2.0 * xs[i]! + ys[i]!).abs + 1.0)
+  expect (closeVec (← readVec (dir / "z.bin")) z) "fused maps"
+  expect (close r[0]! (z.data.foldl (· + ·) 0.0)) s!"sum after maps: {r[0]!}"
+  expect (closeVec (← readVec y) ys) "y was modified"
+  -- y reads as zeros without a file
+  let r ← run { x, steps := #[.sum .y, .copy, .mul, .sum .y], chunk := 4096 }
+  expect (r[0]! == 0.0 && close r[1]! (fold fun s a _ => s + a * a)) s!"y as zeros: {r}"
+  IO.println "✓ fused maps"
+
+def test_in_place : IO Unit := do
+  let x := dir / "x2.bin"
+  let y := dir / "y2.bin"
+  writeVec x xs
+  writeVec y ys
+  scal 3.0 x (chunk := 1000)
+  expect (closeVec (← readVec x) (xs.data.map (3.0 * ·) |> FloatArray.mk)) "scal in place"
+  axpy (-1.0) x y (chunk := 1000)
+  let expected := FloatArray.mk (Array.ofFn (n := n) fun i => ys[i]! - 3.0 * xs[i]!)
+  expect (closeVec (← readVec y) expected) "axpy in place"
+  IO.println "✓ in-place updates"
+
+def test_edge_cases : IO Unit := do
+  writeVec (dir / "big.bin") (FloatArray.mk #[1e300, 1e300, 1e300, 1e300])
+  expect (close (← nrm2 (dir / "big.bin") (chunk := 1)) 2e300) "nrm2 overflowed"
+  writeVec (dir / "empty.bin") FloatArray.empty
+  expect ((← asum (dir / "empty.bin")) == 0.0) "empty file"
+  fails "size" "bytes, but" (dot (dir / "x.bin") (dir / "big.bin"))
+  fails "missing" "missing.bin" (nrm2 (dir / "missing.bin"))
+  IO.println "✓ edge cases and errors"
+
+def main : IO Unit := do
+  IO.FS.createDirAll dir
+  test_reductions
+  test_maps
+  test_in_place
+  test_edge_cases
+
+end BLAS.Test.Stream
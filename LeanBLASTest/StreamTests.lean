@@ -0,0 +1,4 @@
+import LeanBLASTest.Stream
+
+def main : IO Unit :=
+  BLAS.Test.Stream.main
@@ -0,0 +1,116 @@
+import Lean.Data.Json
+import LeanBLAS
+import LeanBLAS.CBLAS.LevelThree
+import LeanBLAS.FFI.Trace
+
+/-!
+# Tracing Tests
+
+Checks that `BLAS.Trace` records the calls made while it is enabled, with
+their size and stride arguments, that a shared output array shows up as a
+`copy` event, that calls from other threads get their own track, and that
+nothing is recorded while it is disabled.
+-/
+
+open Lean BLAS CBLAS
+
+namespace BLAS.Test.Trace
+
+/-- Sizes are read back from a reference so that the calls below happen while
+tracing is in the intended state, instead of being hoisted as constants. -/
+structure Sizes where
+  n : USize
+  m : USize
+
+def filled (n : Nat) (v : Float) : Float64Array := (FloatArray.mk (Array.replicate n v)).toFloat64Array
+
+/-- The complete (`"X"`) events of the current trace. -/
+def events : IO (Array Json) := do
+  let j ← IO.ofExcept (Json.parse (← BLAS.Trace.chromeJson))
+  let evs ← IO.ofExcept (j.getObjValAs? (Array Json) "traceEvents")
+  return evs.filter fun e => e.getObjValAs? String "ph" == .ok "X"
+
+def named (evs : Array Json) (name : String) : Array Json :=
+  evs.filter fun e => e.getObjValAs? String "name" == .ok name
+
+def arg (e : Json) (k : String) : Option Nat :=
+  (e.getObjVal? "args" >>= (·.getObjValAs? Nat k)).toOption
+
+def test_disabled (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Tracing: nothing recorded while disabled"
+  BLAS.Trace.setEnabled false
+  BLAS.Trace.clear
+  let ⟨n, _⟩ ← sizes.get
+  let d := ddot n (filled n.toNat 1.0) 0 1 (filled n.toNat 2.0) 0 1
+  if d != 2.0 * n.toNat.toFloat then throw $ IO.userError s!"ddot returned {d}"
+  let evs ← events
+  unless evs.isEmpty do
+    throw $ IO.userError s!"{evs.size} events recorded while disabled"
+  IO.println "✓ no events"
+
+def test_calls (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Tracing: calls with sizes and strides"
+  BLAS.Trace.clear
+  BLAS.Trace.withEnabled do
+    let ⟨n, m⟩ ← sizes.get
+    let d := ddot n (filled (2 * n.toNat) 1.0) 0 2 (filled n.toNat 1.0) 0 1
+    let c := dgemm .RowMajor .NoTrans .NoTrans m m m 1.0 (filled (m * m).toNat 1.0) 0 m
+      (filled (m * m).toNat 1.0) 0 m 0.0 (filled (m * m).toNat 0.0) 0 m
+    if d != n.toNat.toFloat || c.toFloatArray.get! 0 != m.toNat.toFloat then
+      throw $ IO.userError s!"wrong results {d} {c.toFloatArray.get! 0}"
+  let evs ← events
+  let ⟨n, m⟩ ← sizes.get
+  let some dot := (named evs "ddot")[0]? | throw $ IO.userError "no ddot event"
+  unless arg dot "N" == some n.toNat && arg dot "incX" == some 2 && arg dot "incY" == some 1 do
+    throw $ IO.userError s!"ddot arguments: {dot.compress}"
+  let some gemm := (named evs "dgemm")[0]? | throw $ IO.userError "no dgemm event"
+  unless [arg gemm "M", arg gemm "N", arg gemm "K", arg gemm "lda"].all (· == some m.toNat) do
+    throw $ IO.userError s!"dgemm arguments: {gemm.compress}"
+  unless (gemm.getObjValAs? Float "dur").toOption.getD (-1.0) ≥ 0.0 do
+    throw $ IO.userError s!"dgemm duration: {gemm.compress}"
+  IO.println s!"✓ {evs.size} events, e.g. {gemm.compress}"
+
+def test_copy (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Tracing: copy of a shared output"
+  BLAS.Trace.clear
+  let ⟨n, _⟩ ← sizes.get
+  let y := filled n.toNat 1.0
+  let y' ← BLAS.Trace.withEnabled do
+    return daxpy n 1.0 (filled n.toNat 1.0) 0 1 y 0 1
+  -- `y` is still used here, so `daxpy` had to copy it
+  if y.toFloatArray.get! 0 != 1.0 || y'.toFloatArray.get! 0 != 2.0 then
+    throw $ IO.userError "daxpy modified its shared input"
+  let copies := named (← events) "copy"
+  unless copies.any (arg · "bytes" == some (8 * n.toNat)) do
+    throw $ IO.userError s!"no copy of {8 * n.toNat} bytes: {copies.map (·.compress)}"
+  IO.println s!"✓ copy of {8 * n.toNat} bytes"
+
+def test_threads (sizes : IO.Ref Sizes) : IO Unit := do
+  IO.println "Tracing: one track per thread"
+  BLAS.Trace.clear
+  BLAS.Trace.withEnabled do
+    let task ← IO.asTask (prio := .dedicated) do
+      let ⟨n, _⟩ ← sizes.get
+      return dsum n (filled n.toNat 1.0) 0 1
+    let ⟨n, _⟩ ← sizes.get
+    let s := dsum n (filled n.toNat 1.0) 0 1
+    let t ← IO.ofExcept task.get
+    if s != t then throw $ IO.userError s!"dsum {s} vs {t}"
+  let tids := (named (← events) "dsum").filterMap fun e => (e.getObjValAs? Nat "tid").toOption
+  unless tids.size == 2 && tids[0]! != tids[1]! do
+    throw $ IO.userError s!"dsum thread ids: {tids}"
+  IO.println s!"✓ threads {tids}"
+
+def main : IO Unit := do
+  unless BLAS.Trace.compiled () do
+    IO.println "Tracing is compiled out (-K trace=off), skipping"
+    return
+  let sizes ← IO.mkRef { n := 1000, m := 16 : Sizes }
+  test_disabled sizes
+  test_calls sizes
+  test_copy sizes
+  test_threads sizes
+  if (← BLAS.Trace.isEnabled) then
+    throw $ IO.userError "withEnabled did not restore the previous state"
+
+end BLAS.Test.Trace
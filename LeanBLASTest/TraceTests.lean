@@ -0,0 +1,4 @@
+import LeanBLASTest.Trace
+
+def main : IO Unit :=
+  BLAS.Test.Trace.main
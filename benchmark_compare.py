@@ -2,267 +2,396 @@
 """
 benchmark_compare.py
 ====================
-A simple benchmarking harness that measures the performance of NumPy's
-vector dot-product on a few representative sizes and compares it to the
-LeanBLAS quick benchmark suite (LeanBLASTest/BenchmarksQuick.lean).
+Times every operation of the LeanBLAS benchmark suite
+(LeanBLASTest/BenchmarkSuite.lean) against the same call made from Python, at
+the same sizes and precisions, and reports the ratio per operation.
+
+The Python side calls the BLAS routine directly through ``scipy.linalg.blas``
+whenever there is one (``ddot``, ``dgemv``, ``zgemm``, …), so with NumPy/SciPy
+linked against the same BLAS as LeanBLAS the difference between the two columns
+is the cost of the Lean bindings: argument marshalling, copy-on-write checks and
+result boxing. Operations without a BLAS routine (``sum``, ``axpby``, the
+elementwise ``LevelOneDataExt`` operations) are timed as the equivalent NumPy
+expression, written in place with ``out=``; those rows compare against NumPy's
+own loops rather than a shared kernel and are marked ``numpy``.
 
 Usage
 -----
 Run from the project root after the Lean executables have been built::
 
-    python benchmark_compare.py
+    python benchmark_compare.py [--quick] [--op gemm]... [--precision f64]...
+                                [--lean-json FILE] [--json FILE]
 
-The script prints two sections:
-1. NumPy results (time/op, GFLOPS, ops/sec)
-2. Raw output from `lake exe BenchmarksQuickTest` (LeanBLAS side)
-
-It does **not** attempt to parse the LeanBLAS output – human comparison is
-typically sufficient and the exact formatting may evolve.  Feel free to extend
-this script with a regex if automated dashboards are desired.
+The LeanBLAS numbers come from ``lake exe BenchmarkSuite --json``, or from a
+file that command wrote earlier (``--lean-json``). ``--json FILE`` writes the
+comparison, one object per operation, for dashboards. Check which BLAS NumPy
+uses with ``python -c "import numpy; numpy.show_config()"`` and which LeanBLAS
+uses in the first line of the suite's output.
 """
 
 from __future__ import annotations
 
+import argparse
+import json
+import math
 import subprocess
 import sys
+import tempfile
 import time
 from pathlib import Path
+from typing import Callable
 
 try:
     import numpy as np  # type: ignore
-except ImportError as exc:  # pragma: no cover – runtime dependency
-    sys.stderr.write("NumPy is required for benchmarking but was not found.\n")
+    import scipy  # type: ignore
+    import scipy.linalg.blas as blas  # type: ignore
+except ImportError:  # pragma: no cover – runtime dependency
+    sys.stderr.write("NumPy and SciPy are required for benchmarking but were not found.\n")
     raise
 
 # ---------------------------------------------------------------------------
-# Shared helpers
+# Timing, with the same statistics as LeanBLASTest/BenchHarness.lean
 # ---------------------------------------------------------------------------
 
 
-def _select_iterations(size: int, base: int = 1_000) -> int:
-    """Heuristic for choosing repeat count so total runtime is similar across sizes."""
-    if size <= 0:
-        return base
-    return max(10, base // max(1, size // 100))
-
-
-def _generate_vector(size: int) -> "np.ndarray":
-    """Generate a test vector matching LeanBLAS' pattern (sinusoid)."""
-    idx = np.arange(size, dtype=np.float64)
-    return np.sin(idx * 0.1)
+def measure(body: Callable[[int], object], trials: int, min_batch_ns: float = 200_000.0) -> float:
+    """Median time per call in nanoseconds of `body(i)`, over `trials` batches.
+
+    The batch size doubles until one batch takes `min_batch_ns`, so that the
+    clock resolution and the loop do not dominate small calls."""
+    i = 0
+    # warm-up: caches, page faults and lazy BLAS initialisation
+    deadline = time.perf_counter_ns() + 20_000_000
+    while i < 3 or time.perf_counter_ns() < deadline:
+        body(i)
+        i += 1
+    batch = 1
+    while True:
+        start = time.perf_counter_ns()
+        for _ in range(batch):
+            body(i)
+            i += 1
+        elapsed = time.perf_counter_ns() - start
+        if elapsed >= min_batch_ns or batch >= 1 << 20:
+            break
+        batch *= 2
+    samples = []
+    for _ in range(trials):
+        start = time.perf_counter_ns()
+        for _ in range(batch):
+            body(i)
+            i += 1
+        samples.append((time.perf_counter_ns() - start) / batch)
+    samples.sort()
+    mid = len(samples) // 2
+    return samples[mid] if len(samples) % 2 else 0.5 * (samples[mid - 1] + samples[mid])
+
+
+def alternate(i: int, a: float) -> float:
+    """`a`, then `1 / a`, as in the Lean cases, so repeated scaling cancels."""
+    return a if i % 2 == 0 else 1.0 / a
+
+
+def alternate_sign(i: int, a: float) -> float:
+    return a if i % 2 == 0 else -a
 
 
 # ---------------------------------------------------------------------------
-# NumPy micro-benchmarks (DOT, NORM, AXPY)
+# Data matching the Lean cases
 # ---------------------------------------------------------------------------
 
+DTYPES = {"f64": np.float64, "f32": np.float32, "c64": np.complex128}
+PREFIX = {"f64": "d", "f32": "s", "c64": "z"}
 
-def _print_header(op_name: str) -> None:
-    print(f"NumPy {op_name} benchmarks (double precision)")
-    print("Size\tTime/op (s)\tGFLOPS\tops/sec")
-
-
-def benchmark_numpy_dot(sizes: list[int]) -> None:
-    _print_header("DOT-product")
-
-    for size in sizes:
-        x = _generate_vector(size)
-        y = _generate_vector(size)
-
-        iterations = _select_iterations(size)
-
-        # Warm-up
-        np.dot(x, y)
-
-        start = time.perf_counter()
-        for _ in range(iterations):
-            np.dot(x, y)
-        elapsed = time.perf_counter() - start
+# BLAS names that do not follow `prefix + op`
+RENAMES = {
+    "d": {"iamax": "idamax", "her": "dsyr", "her2": "dsyr2", "bmv": "dgbmv"},
+    "s": {"iamax": "isamax", "her": "ssyr", "her2": "ssyr2", "bmv": "sgbmv"},
+    "z": {"iamax": "izamax", "nrm2": "dznrm2", "asum": "dzasum", "dot": "zdotc", "ger": "zgeru",
+          "bmv": "zgbmv"},
+}
 
-        time_per_op = elapsed / iterations
-        flops = 2.0 * size  # mul + add per element
-        gflops = flops / (time_per_op * 1e9)
-        ops_per_sec = 1.0 / time_per_op
 
-        print(f"{size}\t{time_per_op:.6e}\t{gflops:.3f}\t{ops_per_sec:,.0f}")
+def routine(precision: str, op: str) -> Callable:
+    prefix = PREFIX[precision]
+    return getattr(blas, RENAMES[prefix].get(op, prefix + op))
 
 
-def benchmark_numpy_norm(sizes: list[int]) -> None:
-    _print_header("NORM (L2)")
+def of_fn(precision: str, n: int, f: Callable[["np.ndarray"], "np.ndarray"]) -> "np.ndarray":
+    """`Precision.ofFn`: the complex arrays hold `f i + 0.5 f (i + 1) i`."""
+    idx = np.arange(n, dtype=np.float64)
+    if precision == "c64":
+        return (f(idx) + 0.5j * f(idx + 1)).astype(np.complex128)
+    return f(idx).astype(DTYPES[precision])
 
-    for size in sizes:
-        x = _generate_vector(size)
 
-        iterations = _select_iterations(size)
+def matrix(precision: str, n: int, f: Callable[["np.ndarray"], "np.ndarray"]) -> "np.ndarray":
+    """An `n × n` column-major matrix from the same generator."""
+    return np.asfortranarray(of_fn(precision, n * n, f).reshape((n, n), order="F"))
 
-        np.linalg.norm(x)
 
-        start = time.perf_counter()
-        for _ in range(iterations):
-            np.linalg.norm(x)
-        elapsed = time.perf_counter() - start
+def lower_triangular(precision: str, n: int) -> "np.ndarray":
+    """`lowerTriangular`: 4 on the diagonal and small entries below it."""
+    a = np.tril(0.1 * matrix(precision, n, np.sin), -1)
+    a[np.diag_indices(n)] = 4.0
+    return np.asfortranarray(a)
 
-        time_per_op = elapsed / iterations
-        flops = 2.0 * size + 1  # mul + add + sqrt
-        gflops = flops / (time_per_op * 1e9)
-        ops_per_sec = 1.0 / time_per_op
 
-        print(f"{size}\t{time_per_op:.6e}\t{gflops:.3f}\t{ops_per_sec:,.0f}")
-
-
-def benchmark_numpy_axpy(sizes: list[int]) -> None:
-    _print_header("AXPY (y = a*x + y)")
-
-    alpha = 2.5
-    for size in sizes:
-        x = _generate_vector(size)
-        y = _generate_vector(size)
-
-        iterations = _select_iterations(size)
-
-        y + alpha * x  # warm-up
-
-        start = time.perf_counter()
-        for _ in range(iterations):
-            y = alpha * x + y  # AXPY equivalent
-        elapsed = time.perf_counter() - start
-
-        time_per_op = elapsed / iterations
-        flops = 2.0 * size  # mul + add
-        gflops = flops / (time_per_op * 1e9)
-        ops_per_sec = 1.0 / time_per_op
-
-        print(f"{size}\t{time_per_op:.6e}\t{gflops:.3f}\t{ops_per_sec:,.0f}")
+def shape_dims(shape: str) -> dict[str, int]:
+    """`"m=64 n=64 k=64"` → `{"m": 64, "n": 64, "k": 64}`."""
+    dims = {}
+    for part in shape.split():
+        key, _, value = part.partition("=")
+        if value.isdigit():
+            dims[key] = int(value)
+    return dims
 
 
 # ---------------------------------------------------------------------------
-# LeanBLAS benchmark invocation
+# The Python side of each case
 # ---------------------------------------------------------------------------
 
-
-def run_lean_bench() -> None:
-    """Invoke `lake exe BenchmarksQuickTest` and return its stdout."""
-    # Ensure we are in the repo root where lakefile lives.
-    repo_root = Path(__file__).resolve().parent
-    try:
-        result = subprocess.run(
-            ["lake", "exe", "BenchmarksQuickTest"],
-            cwd=repo_root,
-            capture_output=True,
-            text=True,
-            check=True,
-        )
-    except FileNotFoundError:
-        sys.stderr.write(
-            "Error: `lake` command not found. Ensure Lean's Lake is installed and on PATH.\n"
-        )
-        return
-    except subprocess.CalledProcessError as exc:
-        sys.stderr.write("`lake exe BenchmarksQuickTest` failed – see output below.\n")
-        sys.stderr.write(exc.stdout)
-        sys.stderr.write(exc.stderr)
-        return
-
-    print("\nLeanBLAS benchmark output (raw):\n" + "-" * 40)
-    print(result.stdout)
-
-    # ------------------------------------------------------------------
-    # Simple correctness cross-check versus NumPy for the 1M-element test
-    # ------------------------------------------------------------------
-
-    import re, numpy as np  # noqa: E402  (import only if Lean run succeeded)
-
-    # Helper to generate the same test vector (1, 2, 3, …) used in Lean.
-    def _gen(size: int) -> "np.ndarray":
-        return np.arange(1, size + 1, dtype=np.float64)
-
-    dot_match = re.search(r"Checksum \(acc\):\s+([0-9.eE+\-]+)\s*\n", result.stdout)
-    norm_match = re.search(r"NORM .*?Checksum \(acc\):\s+([0-9.eE+\-]+)\s*\n", result.stdout, re.S)
-    axpy_match = re.search(r"AXPY .*?Checksum:\s+([0-9.eE+\-]+)\s*\n", result.stdout, re.S)
-    mem_match = re.search(r"Memory Bandwidth .*?Checksum:\s+([0-9.eE+\-]+)\s*\n", result.stdout, re.S)
-
-    size = 1_000_000
-    iterations = 10
-    vec = _gen(size)
-
-    # ---------- DOT checksum ----------
-    if dot_match:
-        lean_checksum = float(dot_match.group(1))
-
-        py_checksum = 0.0
-        for i in range(iterations):
-            py_checksum += float(np.dot(vec[i:], vec[i:]))
-
-        print("Dot product checksum comparison (sum over 10 sliced dots):")
-        print(f"  Lean: {lean_checksum:.6e}\n  NumPy: {py_checksum:.6e}\n  diff: {abs(lean_checksum-py_checksum):.3e}")
+# Each group builds the data of one Lean case from its precision and dimensions
+# and returns the body to time for every operation it covers.
+
+
+def level1(precision: str, dims: dict[str, int]) -> dict[str, Callable[[int], object]]:
+    n = dims["n"]
+    x = of_fn(precision, n, lambda i: np.sin(i * 0.1))
+    y = of_fn(precision, n, lambda i: np.cos(i * 0.1))
+    x2 = x.copy()
+    f = lambda op: routine(precision, op)  # noqa: E731
+    dot, nrm2, asum, iamax = f("dot"), f("nrm2"), f("asum"), f("iamax")
+    copy, swap, axpy, scal = f("copy"), f("swap"), f("axpy"), f("scal")
+    bodies = {
+        "dot": lambda i: dot(x, y),
+        "nrm2": lambda i: nrm2(x),
+        "asum": lambda i: asum(x),
+        "iamax": lambda i: iamax(x),
+        "copy": lambda i: copy(x, y),
+        "swap": lambda i: swap(x2, y),
+        "axpy": lambda i: axpy(x, y, a=alternate_sign(i, 0.5)),
+        "scal": lambda i: scal(alternate(i, 2.0), y),
+    }
+    if precision != "c64":
+        rot = f("rot")
+        bodies["rot"] = lambda i: rot(x2, y, 0.6, alternate_sign(i, 0.8), overwrite_x=1, overwrite_y=1)
+    return bodies
+
+
+def level1_numpy(precision: str, dims: dict[str, int]) -> dict[str, Callable[[int], object]]:
+    """`LevelOneDataExt` operations, which have no BLAS routine."""
+    n = dims["n"]
+    x = of_fn(precision, n, lambda i: 1.5 + 0.5 * np.sin(i * 0.1))
+    xinv = 1.0 / x
+    y = of_fn(precision, n, lambda i: 1.5 + 0.5 * np.cos(i * 0.1))
+    t = np.empty_like(y)
+
+    def axpby(i: int) -> None:
+        a = 1.0 if i % 2 == 0 else -0.5
+        np.multiply(y, alternate(i, 2.0), out=y)
+        np.multiply(x, a, out=t)
+        np.add(y, t, out=y)
+
+    def scaladd(i: int) -> None:
+        a, b = (2.0, 1.0) if i % 2 == 0 else (0.5, -0.5)
+        np.multiply(y, a, out=y)
+        np.add(y, b, out=y)
+
+    def unary(fn: Callable) -> Callable[[int], object]:
+        return lambda i: fn(y, out=y)
+
+    return {
+        "sum": lambda i: np.sum(x),
+        "axpby": axpby,
+        "scaladd": scaladd,
+        "mul": lambda i: np.multiply(y, x if i % 2 == 0 else xinv, out=y),
+        "div": lambda i: np.divide(y, x, out=y),
+        "inv": lambda i: np.reciprocal(y, out=y),
+        "abs": unary(np.abs) if precision != "c64" else (lambda i: np.abs(y)),
+        "sqrt": unary(np.sqrt),
+        "exp": lambda i: (np.exp if i % 2 == 0 else np.log)(y, out=y),
+        "sin": unary(np.sin),
+        "cos": unary(np.cos),
+    }
+
+
+def level2(precision: str, dims: dict[str, int]) -> dict[str, Callable[[int], object]]:
+    n = dims["n"]
+    kb = min(16, n - 1)
+    a = matrix(precision, n, lambda i: np.sin(i * 0.01))
+    lower = lower_triangular(precision, n)
+    band = np.asfortranarray(of_fn(precision, (2 * kb + 1) * n, lambda i: np.sin(i * 0.01))
+                             .reshape((2 * kb + 1, n), order="F"))
+    # band and packed storage of `lower`
+    lower_band = np.zeros((kb + 1, n), dtype=lower.dtype, order="F")
+    for d in range(kb + 1):
+        lower_band[d, : n - d] = np.diagonal(lower, -d)
+    packed = np.concatenate([lower[j:, j] for j in range(n)])
+    x = of_fn(precision, n, lambda i: np.sin(i * 0.1))
+    y = of_fn(precision, n, lambda i: np.cos(i * 0.1))
+    f = lambda op: routine(precision, op)  # noqa: E731
+    gemv, gbmv, ger, her, her2 = f("gemv"), f("bmv"), f("ger"), f("her"), f("her2")
+    trmv, tbmv, tpmv, trsv, tbsv, tpsv = f("trmv"), f("tbmv"), f("tpmv"), f("trsv"), f("tbsv"), f("tpsv")
+    # the Lean triangular calls copy their shared `x`, and so do these
+    return {
+        "gemv": lambda i: gemv(alternate(i, 2.0), a, x, 0.0, y, overwrite_y=1),
+        "bmv": lambda i: gbmv(n, n, kb, kb, alternate(i, 2.0), band, x, beta=0.0, y=y, overwrite_y=1),
+        "trmv": lambda i: trmv(lower, x, lower=1),
+        "tbmv": lambda i: tbmv(kb, lower_band, x, lower=1),
+        "tpmv": lambda i: tpmv(n, packed, x, lower=1),
+        "trsv": lambda i: trsv(lower, x, lower=1),
+        "tbsv": lambda i: tbsv(kb, lower_band, x, lower=1),
+        "tpsv": lambda i: tpsv(n, packed, x, lower=1),
+        "ger": lambda i: ger(alternate_sign(i, 0.5), x, y, a=a, overwrite_a=1),
+        "her": lambda i: her(alternate_sign(i, 0.5), x, lower=1, a=a, overwrite_a=1),
+        "her2": lambda i: her2(alternate_sign(i, 0.5), x, y, lower=1, a=a, overwrite_a=1),
+    }
+
+
+def level3(precision: str, dims: dict[str, int]) -> dict[str, Callable[[int], object]]:
+    n = dims["n"]
+    a = matrix(precision, n, lambda i: np.sin(i * 0.01))
+    b = matrix(precision, n, lambda i: np.cos(i * 0.01))
+    c = np.zeros((n, n), dtype=a.dtype, order="F")
+    lower = lower_triangular(precision, n)
+    f = lambda op: routine(precision, op)  # noqa: E731
+    gemm, symm, syrk, syr2k, trmm, trsm = f("gemm"), f("symm"), f("syrk"), f("syr2k"), f("trmm"), f("trsm")
+    # `trmm` and `trsm` return a new matrix in Lean, since `B` stays shared
+    return {
+        "gemm": lambda i: gemm(alternate(i, 2.0), a, b, 0.0, c, overwrite_c=1),
+        "symm": lambda i: symm(alternate(i, 2.0), a, b, 0.0, c, lower=1, overwrite_c=1),
+        "syrk": lambda i: syrk(alternate(i, 2.0), a, 0.0, c, lower=1, overwrite_c=1),
+        "syr2k": lambda i: syr2k(alternate(i, 2.0), a, b, 0.0, c, lower=1, overwrite_c=1),
+        "trmm": lambda i: trmm(1.0, lower, b, lower=1),
+        "trsm": lambda i: trsm(1.0, lower, b, lower=1),
+    }
+
+
+LEVEL2_OPS = {"gemv", "bmv", "trmv", "tbmv", "tpmv", "trsv", "tbsv", "tpsv", "ger", "her", "her2"}
+LEVEL3_OPS = {"gemm", "symm", "syrk", "syr2k", "trmm", "trsm"}
+NUMPY_OPS = {"sum", "axpby", "scaladd", "mul", "div", "inv", "abs", "sqrt", "exp", "sin", "cos"}
+
+
+def python_body(precision: str, op: str, shape: str) -> tuple[Callable[[int], object], str] | None:
+    """The Python body of the Lean case `op` at `shape`, and what it calls."""
+    dims = shape_dims(shape)
+    if op in LEVEL3_OPS:
+        # the suite's Level 3 cases are square
+        if not dims.get("m") == dims.get("n") == dims.get("k"):
+            return None
+        group, source = level3, "scipy.blas"
+    elif op in LEVEL2_OPS:
+        group, source = level2, "scipy.blas"
+    elif op in NUMPY_OPS:
+        group, source = level1_numpy, "numpy"
     else:
-        print("Could not parse dot-product checksum from Lean output.")
-
-    # ---------- Norm checksum ----------
-    if norm_match:
-        lean_checksum = float(norm_match.group(1))
+        group, source = level1, "scipy.blas"
+    if "n" not in dims:
+        return None
+    try:
+        bodies = group(precision, dims)
+    except AttributeError:  # a routine this SciPy does not have
+        return None
+    return (bodies[op], source) if op in bodies else None
 
-        py_checksum = 0.0
-        for i in range(iterations):
-            py_checksum += float(np.linalg.norm(vec[i:]))
 
-        print("\nNorm checksum comparison:")
-        print(f"  Lean: {lean_checksum:.6e}\n  NumPy: {py_checksum:.6e}\n  diff: {abs(lean_checksum-py_checksum):.3e}")
-    else:
-        print("Could not parse norm checksum from Lean output.")
-
-    # ---------- AXPY checksum ----------
-    if axpy_match:
-        lean_checksum = float(axpy_match.group(1))
-
-        alpha = 2.5
-        x = vec.copy()
-        y = vec.copy()
-        py_checksum = 0.0
-        for i in range(iterations):
-            n_i = size - i
-            y[i : i + n_i] = alpha * x[i : i + n_i] + y[i : i + n_i]
-            py_checksum += float(y[i])
-
-        print("\nAXPY checksum comparison:")
-        print(f"  Lean: {lean_checksum:.6e}\n  NumPy: {py_checksum:.6e}\n  diff: {abs(lean_checksum-py_checksum):.3e}")
-    else:
-        print("Could not parse AXPY checksum from Lean output.")
-
-    # ---------- DSUM checksum ----------
-    if mem_match:
-        lean_checksum = float(mem_match.group(1))
+# ---------------------------------------------------------------------------
+# LeanBLAS side
+# ---------------------------------------------------------------------------
 
-        sum_val = float(np.sum(vec))
-        py_checksum = iterations * sum_val
 
-        print("\nDSUM checksum comparison:")
-        print(f"  Lean: {lean_checksum:.6e}\n  NumPy: {py_checksum:.6e}\n  diff: {abs(lean_checksum-py_checksum):.3e}")
-    else:
-        print("Could not parse DSUM checksum from Lean output.")
+def run_lean(args: argparse.Namespace) -> dict:
+    """The results of `lake exe BenchmarkSuite --json`, or of `--lean-json`."""
+    if args.lean_json:
+        return json.loads(Path(args.lean_json).read_text())
+    repo_root = Path(__file__).resolve().parent
+    with tempfile.TemporaryDirectory() as tmp:
+        out = Path(tmp) / "lean.json"
+        cmd = ["lake", "exe", "BenchmarkSuite", "--json", str(out)]
+        if args.quick:
+            cmd.append("--quick")
+        for op in args.op:
+            cmd += ["--op", op]
+        for p in args.precision:
+            cmd += ["--precision", p]
+        print("$ " + " ".join(cmd), file=sys.stderr)
+        try:
+            subprocess.run(cmd, cwd=repo_root, check=True, stdout=sys.stderr)
+        except FileNotFoundError:
+            sys.exit("Error: `lake` command not found. Ensure Lean's Lake is installed and on PATH.")
+        except subprocess.CalledProcessError as exc:
+            sys.exit(f"`{' '.join(cmd)}` failed with exit code {exc.returncode}")
+        return json.loads(out.read_text())
 
 
 # ---------------------------------------------------------------------------
-# Entry-point
+# Report
 # ---------------------------------------------------------------------------
 
 
-def main() -> None:
-    print("=== LeanBLAS vs NumPy Benchmarks ===")
-    print()
+def format_ns(ns: float) -> str:
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("µs", 1e3)):
+        if ns >= scale:
+            return f"{ns / scale:.3g} {unit}"
+    return f"{ns:.3g} ns"
 
-    sizes = [100, 1_000, 10_000, 100_000]
 
-    # --- NumPy section ---
-    benchmark_numpy_dot(sizes)
+def compare(lean: dict, args: argparse.Namespace) -> list[dict]:
+    trials = 5 if args.quick else 21
+    rows = []
+    skipped = []
+    print(f"LeanBLAS backend: {lean.get('backend', '?')}")
+    print(f"NumPy {np.__version__}, SciPy {scipy.__version__}")
     print()
-    benchmark_numpy_norm(sizes)
-    print()
-    benchmark_numpy_axpy(sizes)
+    print("op\tprecision\tshape\tLeanBLAS\tPython\tratio\toverhead\tsource")
+    for r in lean["results"]:
+        op, precision, shape = r["op"], r["precision"], r["shape"]
+        if args.op and op not in args.op or precision not in DTYPES:
+            continue
+        match = python_body(precision, op, shape)
+        if match is None:
+            skipped.append(f"{op} {precision} {shape}")
+            continue
+        body, source = match
+        python_ns = measure(body, trials)
+        lean_ns = r["median_ns"]
+        row = {
+            "op": op, "precision": precision, "shape": shape, "source": source,
+            "lean_median_ns": lean_ns, "python_median_ns": python_ns,
+            "ratio": lean_ns / python_ns, "overhead_ns": lean_ns - python_ns,
+        }
+        rows.append(row)
+        print(f"{op}\t{precision}\t{shape}\t{format_ns(lean_ns)}\t{format_ns(python_ns)}\t"
+              f"{row['ratio']:.3f}\t{format_ns(row['overhead_ns']) if row['overhead_ns'] > 0 else '-'}\t{source}")
+    if skipped:
+        print(f"\nno Python equivalent: {', '.join(skipped)}")
+    # geometric mean of the ratios, per source and precision
+    print("\nsource\tprecision\tcases\tgeometric mean ratio (LeanBLAS / Python)")
+    for source in ("scipy.blas", "numpy"):
+        for precision in DTYPES:
+            ratios = [row["ratio"] for row in rows if row["source"] == source and row["precision"] == precision]
+            if ratios:
+                mean = math.exp(sum(map(math.log, ratios)) / len(ratios))
+                print(f"{source}\t{precision}\t{len(ratios)}\t{mean:.3f}")
+    return rows
 
-    # --- LeanBLAS section ---
-    print()
-    run_lean_bench()
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compare LeanBLAS with the same calls from NumPy/SciPy.")
+    parser.add_argument("--quick", action="store_true", help="small sizes and few trials")
+    parser.add_argument("--op", action="append", default=[], help="only this operation (repeatable)")
+    parser.add_argument("--precision", action="append", default=[], choices=sorted(DTYPES),
+                        help="only this precision (repeatable)")
+    parser.add_argument("--lean-json", help="read LeanBLAS results from this file instead of running lake")
+    parser.add_argument("--json", help="write the comparison to this file")
+    args = parser.parse_args()
+
+    print("=== LeanBLAS vs NumPy/SciPy ===")
+    rows = compare(run_lean(args), args)
+    if args.json:
+        Path(args.json).write_text(json.dumps({"results": rows}, indent=2) + "\n")
+        print(f"\nwrote {len(rows)} comparisons to {args.json}")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,454 @@
+#include <lean/lean.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "cblas_compat.h"
+#include "reproducible.h"
+#include "util.h"
+
+// Asynchronous Level 2/3 calls.
+//
+// `leanblas_async_<op>` takes the same arguments as `leanblas_cblas_<op>`, but
+// instead of running the routine it queues a job for a small pool of worker
+// threads.  The Lean wrapper passes a fresh `IO.Promise` as the first argument
+// and returns its task; the worker resolves the promise with the output array.
+//
+// * Ownership: the job holds a reference to every input array until the call
+//   has finished, and the output array is made exclusive on submission and
+//   only handed back through the promise, so neither side can observe it while
+//   the worker writes to it.  The workers register themselves with the Lean
+//   runtime, so they can resolve the promise and release the job's references.
+// * Backpressure: at most `capacity` jobs wait in the queue.  Submitting to a
+//   full queue blocks the calling thread until a worker picks up a job.
+// * A pending job occupies no Lean thread: the task is just the promise's
+//   result, so waiting on it costs nothing until the worker resolves it.
+//
+// `LEANBLAS_ASYNC_THREADS` (default 2) and `LEANBLAS_ASYNC_QUEUE` (default 16)
+// set the initial pool size and queue capacity.
+
+#define ASYNC_MAX_WORKERS 64
+#define ASYNC_OUT 2
+
+typedef struct leanblas_job leanblas_job;
+
+struct leanblas_job {
+  void (*run)(const leanblas_job *job);
+  uint8_t order, side, uplo, transA, transB, diag;
+  size_t M, N, K;
+  double alpha, beta;
+  int reproducible;       // mode at submission time
+  lean_object *arg[3];    // inputs in BLAS argument order, then the output
+  size_t off[3], ld[3];   // offsets and leading dimensions (increments for vectors)
+  lean_object *promise;   // `IO.Promise Float64Array` resolved with the output
+  leanblas_job *next;
+};
+
+static pthread_once_t async_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t async_not_full = PTHREAD_COND_INITIALIZER;
+
+static leanblas_job *queue_head = NULL, *queue_tail = NULL;
+static size_t queued = 0;       // jobs waiting for a worker
+static size_t running = 0;      // jobs inside a BLAS call
+static size_t capacity = 16;
+static int workers_wanted = 2;
+static int workers_started = 0;
+
+static double *job_ptr(const leanblas_job *job, int i) {
+  return lean_float64_array_cptr(job->arg[i]) + job->off[i];
+}
+
+// Hands the output to the promise and drops the job's references.
+static void job_finish(leanblas_job *job) {
+  lean_object *out = job->arg[ASYNC_OUT];
+  job->arg[ASYNC_OUT] = NULL;
+  lean_promise_resolve(out, job->promise);
+  for (int i = 0; i < 3; i++) {
+    if (job->arg[i]) lean_dec(job->arg[i]);
+  }
+  lean_dec(job->promise);
+  free(job);
+}
+
+// ---------------------------------------------------------------------------
+// Worker pool
+// ---------------------------------------------------------------------------
+
+static void *async_worker(void *arg) {
+  (void)arg;
+  lean_initialize_thread();
+  pthread_mutex_lock(&async_lock);
+  for (;;) {
+    while (!queue_head && workers_started <= workers_wanted) pthread_cond_wait(&async_not_empty, &async_lock);
+    if (workers_started > workers_wanted) break;
+    leanblas_job *job = queue_head;
+    queue_head = job->next;
+    if (!queue_head) queue_tail = NULL;
+    queued--;
+    running++;
+    pthread_cond_signal(&async_not_full);
+    pthread_mutex_unlock(&async_lock);
+
+    job->run(job);
+    job_finish(job);
+
+    pthread_mutex_lock(&async_lock);
+    running--;
+  }
+  workers_started--;
+  pthread_mutex_unlock(&async_lock);
+  lean_finalize_thread();
+  return NULL;
+}
+
+// Must be called with `async_lock` held.
+static void async_spawn_workers(void) {
+  while (workers_started < workers_wanted) {
+    pthread_t tid;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    const int err = pthread_create(&tid, &attr, async_worker, NULL);
+    pthread_attr_destroy(&attr);
+    if (err) break;
+    workers_started++;
+  }
+  if (workers_started == 0) lean_internal_panic("LeanBLAS: could not start an async worker thread");
+}
+
+static void async_init(void) {
+  const char *env = getenv("LEANBLAS_ASYNC_THREADS");
+  if (env && atoi(env) > 0) workers_wanted = atoi(env) < ASYNC_MAX_WORKERS ? atoi(env) : ASYNC_MAX_WORKERS;
+  env = getenv("LEANBLAS_ASYNC_QUEUE");
+  if (env && atoi(env) > 0) capacity = (size_t)atoi(env);
+}
+
+// ---------------------------------------------------------------------------
+// Submission
+// ---------------------------------------------------------------------------
+
+static leanblas_job *job_new(void (*run)(const leanblas_job *), lean_obj_arg promise) {
+  pthread_once(&async_once, async_init);
+  leanblas_job *job = (leanblas_job *)calloc(1, sizeof(leanblas_job));
+  if (!job) lean_internal_panic_out_of_memory();
+  job->run = run;
+  lean_mark_mt(promise);
+  job->promise = promise;
+  return job;
+}
+
+static void job_input(leanblas_job *job, int i, lean_obj_arg X, size_t off, size_t ld) {
+  lean_mark_mt(X);
+  job->arg[i] = X;
+  job->off[i] = off;
+  job->ld[i] = ld;
+}
+
+static void job_output(leanblas_job *job, lean_obj_arg X, size_t off, size_t ld) {
+  ensure_exclusive_byte_array(&X);
+  job_input(job, ASYNC_OUT, X, off, ld);
+}
+
+static lean_obj_res job_submit(leanblas_job *job) {
+  pthread_mutex_lock(&async_lock);
+  async_spawn_workers();
+  while (queued >= capacity) pthread_cond_wait(&async_not_full, &async_lock);
+  if (queue_tail) queue_tail->next = job;
+  else queue_head = job;
+  queue_tail = job;
+  queued++;
+  pthread_cond_signal(&async_not_empty);
+  pthread_mutex_unlock(&async_lock);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+// ---------------------------------------------------------------------------
+// Jobs
+// ---------------------------------------------------------------------------
+
+static void run_dgemv(const leanblas_job *j) {
+  if (j->reproducible) {
+    leanblas_repro_dgemv(leanblas_cblas_order(j->order), leanblas_cblas_transpose(j->transA), (int)j->M, (int)j->N,
+                         j->alpha, job_ptr(j, 0), (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta,
+                         job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+    return;
+  }
+  cblas_dgemv(leanblas_cblas_order(j->order), leanblas_cblas_transpose(j->transA), (int)j->M, (int)j->N, j->alpha,
+              job_ptr(j, 0), (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta, job_ptr(j, ASYNC_OUT),
+              (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dtrmv(const leanblas_job *j) {
+  cblas_dtrmv(leanblas_cblas_order(j->order), leanblas_cblas_uplo(j->uplo), leanblas_cblas_transpose(j->transA),
+              leanblas_cblas_diag(j->diag), (int)j->N, job_ptr(j, 0), (int)j->ld[0], job_ptr(j, ASYNC_OUT),
+              (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dtrsv(const leanblas_job *j) {
+  cblas_dtrsv(leanblas_cblas_order(j->order), leanblas_cblas_uplo(j->uplo), leanblas_cblas_transpose(j->transA),
+              leanblas_cblas_diag(j->diag), (int)j->N, job_ptr(j, 0), (int)j->ld[0], job_ptr(j, ASYNC_OUT),
+              (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dger(const leanblas_job *j) {
+  cblas_dger(leanblas_cblas_order(j->order), (int)j->M, (int)j->N, j->alpha, job_ptr(j, 0), (int)j->ld[0],
+             job_ptr(j, 1), (int)j->ld[1], job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dgemm(const leanblas_job *j) {
+  if (j->reproducible) {
+    leanblas_repro_dgemm(leanblas_cblas_order(j->order), leanblas_cblas_transpose(j->transA),
+                         leanblas_cblas_transpose(j->transB), (int)j->M, (int)j->N, (int)j->K, j->alpha,
+                         job_ptr(j, 0), (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta, job_ptr(j, ASYNC_OUT),
+                         (int)j->ld[ASYNC_OUT]);
+    return;
+  }
+  cblas_dgemm(leanblas_cblas_order(j->order), leanblas_cblas_transpose(j->transA),
+              leanblas_cblas_transpose(j->transB), (int)j->M, (int)j->N, (int)j->K, j->alpha, job_ptr(j, 0),
+              (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta, job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dsymm(const leanblas_job *j) {
+  cblas_dsymm(leanblas_cblas_order(j->order), leanblas_cblas_side(j->side), leanblas_cblas_uplo(j->uplo), (int)j->M,
+              (int)j->N, j->alpha, job_ptr(j, 0), (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta,
+              job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dsyrk(const leanblas_job *j) {
+  cblas_dsyrk(leanblas_cblas_order(j->order), leanblas_cblas_uplo(j->uplo), leanblas_cblas_transpose(j->transA),
+              (int)j->N, (int)j->K, j->alpha, job_ptr(j, 0), (int)j->ld[0], j->beta, job_ptr(j, ASYNC_OUT),
+              (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dsyr2k(const leanblas_job *j) {
+  cblas_dsyr2k(leanblas_cblas_order(j->order), leanblas_cblas_uplo(j->uplo), leanblas_cblas_transpose(j->transA),
+               (int)j->N, (int)j->K, j->alpha, job_ptr(j, 0), (int)j->ld[0], job_ptr(j, 1), (int)j->ld[1], j->beta,
+               job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dtrmm(const leanblas_job *j) {
+  cblas_dtrmm(leanblas_cblas_order(j->order), leanblas_cblas_side(j->side), leanblas_cblas_uplo(j->uplo),
+              leanblas_cblas_transpose(j->transA), leanblas_cblas_diag(j->diag), (int)j->M, (int)j->N, j->alpha,
+              job_ptr(j, 0), (int)j->ld[0], job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+static void run_dtrsm(const leanblas_job *j) {
+  cblas_dtrsm(leanblas_cblas_order(j->order), leanblas_cblas_side(j->side), leanblas_cblas_uplo(j->uplo),
+              leanblas_cblas_transpose(j->transA), leanblas_cblas_diag(j->diag), (int)j->M, (int)j->N, j->alpha,
+              job_ptr(j, 0), (int)j->ld[0], job_ptr(j, ASYNC_OUT), (int)j->ld[ASYNC_OUT]);
+}
+
+// ---------------------------------------------------------------------------
+// Lean entry points
+// ---------------------------------------------------------------------------
+
+LEAN_EXPORT lean_obj_res leanblas_async_dgemv(lean_obj_arg promise, const uint8_t order, const uint8_t transA,
+                                              const size_t M, const size_t N, const double alpha, lean_obj_arg A,
+                                              const size_t offA, const size_t lda, lean_obj_arg X, const size_t offX,
+                                              const size_t incX, const double beta, lean_obj_arg Y, const size_t offY,
+                                              const size_t incY, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dgemv, promise);
+  job->order = order;
+  job->transA = transA;
+  job->M = M;
+  job->N = N;
+  job->alpha = alpha;
+  job->beta = beta;
+  job->reproducible = leanblas_reproducible();
+  job_input(job, 0, A, offA, lda);
+  job_input(job, 1, X, offX, incX);
+  job_output(job, Y, offY, incY);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dtrmv(lean_obj_arg promise, const uint8_t order, const uint8_t uplo,
+                                              const uint8_t transA, const uint8_t diag, const size_t N,
+                                              lean_obj_arg A, const size_t offA, const size_t lda, lean_obj_arg X,
+                                              const size_t offX, const size_t incX, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dtrmv, promise);
+  job->order = order;
+  job->uplo = uplo;
+  job->transA = transA;
+  job->diag = diag;
+  job->N = N;
+  job_input(job, 0, A, offA, lda);
+  job_output(job, X, offX, incX);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dtrsv(lean_obj_arg promise, const uint8_t order, const uint8_t uplo,
+                                              const uint8_t transA, const uint8_t diag, const size_t N,
+                                              lean_obj_arg A, const size_t offA, const size_t lda, lean_obj_arg X,
+                                              const size_t offX, const size_t incX, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dtrsv, promise);
+  job->order = order;
+  job->uplo = uplo;
+  job->transA = transA;
+  job->diag = diag;
+  job->N = N;
+  job_input(job, 0, A, offA, lda);
+  job_output(job, X, offX, incX);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dger(lean_obj_arg promise, const uint8_t order, const size_t M,
+                                             const size_t N, const double alpha, lean_obj_arg X, const size_t offX,
+                                             const size_t incX, lean_obj_arg Y, const size_t offY, const size_t incY,
+                                             lean_obj_arg A, const size_t offA, const size_t lda, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dger, promise);
+  job->order = order;
+  job->M = M;
+  job->N = N;
+  job->alpha = alpha;
+  job_input(job, 0, X, offX, incX);
+  job_input(job, 1, Y, offY, incY);
+  job_output(job, A, offA, lda);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dgemm(lean_obj_arg promise, const uint8_t order, const uint8_t transA,
+                                              const uint8_t transB, const size_t M, const size_t N, const size_t K,
+                                              const double alpha, lean_obj_arg A, const size_t offA, const size_t lda,
+                                              lean_obj_arg B, const size_t offB, const size_t ldb, const double beta,
+                                              lean_obj_arg C, const size_t offC, const size_t ldc, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dgemm, promise);
+  job->order = order;
+  job->transA = transA;
+  job->transB = transB;
+  job->M = M;
+  job->N = N;
+  job->K = K;
+  job->alpha = alpha;
+  job->beta = beta;
+  job->reproducible = leanblas_reproducible();
+  job_input(job, 0, A, offA, lda);
+  job_input(job, 1, B, offB, ldb);
+  job_output(job, C, offC, ldc);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dsymm(lean_obj_arg promise, const uint8_t order, const uint8_t side,
+                                              const uint8_t uplo, const size_t M, const size_t N, const double alpha,
+                                              lean_obj_arg A, const size_t offA, const size_t lda, lean_obj_arg B,
+                                              const size_t offB, const size_t ldb, const double beta, lean_obj_arg C,
+                                              const size_t offC, const size_t ldc, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dsymm, promise);
+  job->order = order;
+  job->side = side;
+  job->uplo = uplo;
+  job->M = M;
+  job->N = N;
+  job->alpha = alpha;
+  job->beta = beta;
+  job_input(job, 0, A, offA, lda);
+  job_input(job, 1, B, offB, ldb);
+  job_output(job, C, offC, ldc);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dsyrk(lean_obj_arg promise, const uint8_t order, const uint8_t uplo,
+                                              const uint8_t trans, const size_t N, const size_t K, const double alpha,
+                                              lean_obj_arg A, const size_t offA, const size_t lda, const double beta,
+                                              lean_obj_arg C, const size_t offC, const size_t ldc, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dsyrk, promise);
+  job->order = order;
+  job->uplo = uplo;
+  job->transA = trans;
+  job->N = N;
+  job->K = K;
+  job->alpha = alpha;
+  job->beta = beta;
+  job_input(job, 0, A, offA, lda);
+  job_output(job, C, offC, ldc);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dsyr2k(lean_obj_arg promise, const uint8_t order, const uint8_t uplo,
+                                               const uint8_t trans, const size_t N, const size_t K,
+                                               const double alpha, lean_obj_arg A, const size_t offA,
+                                               const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb,
+                                               const double beta, lean_obj_arg C, const size_t offC, const size_t ldc,
+                                               lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dsyr2k, promise);
+  job->order = order;
+  job->uplo = uplo;
+  job->transA = trans;
+  job->N = N;
+  job->K = K;
+  job->alpha = alpha;
+  job->beta = beta;
+  job_input(job, 0, A, offA, lda);
+  job_input(job, 1, B, offB, ldb);
+  job_output(job, C, offC, ldc);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dtrmm(lean_obj_arg promise, const uint8_t order, const uint8_t side,
+                                              const uint8_t uplo, const uint8_t transA, const uint8_t diag,
+                                              const size_t M, const size_t N, const double alpha, lean_obj_arg A,
+                                              const size_t offA, const size_t lda, lean_obj_arg B, const size_t offB,
+                                              const size_t ldb, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dtrmm, promise);
+  job->order = order;
+  job->side = side;
+  job->uplo = uplo;
+  job->transA = transA;
+  job->diag = diag;
+  job->M = M;
+  job->N = N;
+  job->alpha = alpha;
+  job_input(job, 0, A, offA, lda);
+  job_output(job, B, offB, ldb);
+  return job_submit(job);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_dtrsm(lean_obj_arg promise, const uint8_t order, const uint8_t side,
+                                              const uint8_t uplo, const uint8_t transA, const uint8_t diag,
+                                              const size_t M, const size_t N, const double alpha, lean_obj_arg A,
+                                              const size_t offA, const size_t lda, lean_obj_arg B, const size_t offB,
+                                              const size_t ldb, lean_obj_arg w) {
+  leanblas_job *job = job_new(run_dtrsm, promise);
+  job->order = order;
+  job->side = side;
+  job->uplo = uplo;
+  job->transA = transA;
+  job->diag = diag;
+  job->M = M;
+  job->N = N;
+  job->alpha = alpha;
+  job_input(job, 0, A, offA, lda);
+  job_output(job, B, offB, ldb);
+  return job_submit(job);
+}
+
+/** leanblas_async_stats
+ * @return #[queued, running, queue capacity, workers].
+ */
+LEAN_EXPORT lean_obj_res leanblas_async_stats(lean_obj_arg w) {
+  pthread_once(&async_once, async_init);
+  pthread_mutex_lock(&async_lock);
+  const size_t stats[4] = {queued, running, capacity, (size_t)workers_wanted};
+  pthread_mutex_unlock(&async_lock);
+  lean_obj_res arr = lean_mk_empty_array();
+  for (int i = 0; i < 4; i++) arr = lean_array_push(arr, lean_usize_to_nat(stats[i]));
+  return lean_io_result_mk_ok(arr);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_async_set_queue_capacity(size_t n, lean_obj_arg w) {
+  pthread_once(&async_once, async_init);
+  pthread_mutex_lock(&async_lock);
+  capacity = n < 1 ? 1 : n;
+  pthread_cond_broadcast(&async_not_full);
+  pthread_mutex_unlock(&async_lock);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+// Extra workers exit once they are idle; new ones start on the next submission.
+LEAN_EXPORT lean_obj_res leanblas_async_set_workers(size_t n, lean_obj_arg w) {
+  pthread_once(&async_once, async_init);
+  pthread_mutex_lock(&async_lock);
+  workers_wanted = n < 1 ? 1 : n > ASYNC_MAX_WORKERS ? ASYNC_MAX_WORKERS : (int)n;
+  pthread_cond_broadcast(&async_not_empty);
+  pthread_mutex_unlock(&async_lock);
+  return lean_io_result_mk_ok(lean_box(0));
+}
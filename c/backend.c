@@ -0,0 +1,113 @@
+#include <lean/lean.h>
+#include <limits.h>
+#include "native.h"
+#include "reproducible.h"
+
+// Lean view of the backend configuration: which BLAS the wrappers call, what
+// the CPU supports and which variant every native kernel family selected.
+
+/** leanblas_backend_name
+ * @return "native" when built with `-K blas=native`, "system" otherwise.
+ */
+LEAN_EXPORT lean_obj_res leanblas_backend_name(lean_obj_arg unit) {
+#ifdef LEANBLAS_NATIVE_BACKEND
+  return lean_mk_string("native");
+#else
+  return lean_mk_string("system");
+#endif
+}
+
+LEAN_EXPORT lean_obj_res leanblas_cpu_vendor(lean_obj_arg unit) {
+  return lean_mk_string(leanblas_cpu()->vendor);
+}
+
+/** leanblas_cpu_features
+ * @return Names of the detected features usable on this machine, e.g. #["sse4_1", "avx2", "fma"].
+ */
+LEAN_EXPORT lean_obj_res leanblas_cpu_features(lean_obj_arg unit) {
+  const uint32_t features = leanblas_cpu()->features;
+  lean_obj_res arr = lean_mk_empty_array();
+  for (int i = 0; i < LEANBLAS_CPU_FEATURE_COUNT; i++)
+    if (features & (1u << i)) arr = lean_array_push(arr, lean_mk_string(leanblas_cpu_feature_name(1u << i)));
+  return arr;
+}
+
+/** leanblas_cpu_caches
+ * @return #[l1d, l2, l3] cache sizes in bytes, 0 where unknown.
+ */
+LEAN_EXPORT lean_obj_res leanblas_cpu_caches(lean_obj_arg unit) {
+  const leanblas_cpu_info *cpu = leanblas_cpu();
+  lean_obj_res arr = lean_mk_empty_array();
+  arr = lean_array_push(arr, lean_usize_to_nat(cpu->l1d_bytes));
+  arr = lean_array_push(arr, lean_usize_to_nat(cpu->l2_bytes));
+  arr = lean_array_push(arr, lean_usize_to_nat(cpu->l3_bytes));
+  return arr;
+}
+
+/** leanblas_cpu_topology
+ * @return #[logical CPUs, physical cores, packages] available to this process.
+ */
+LEAN_EXPORT lean_obj_res leanblas_cpu_topology(lean_obj_arg unit) {
+  const leanblas_cpu_info *cpu = leanblas_cpu();
+  lean_obj_res arr = lean_mk_empty_array();
+  arr = lean_array_push(arr, lean_usize_to_nat((size_t)cpu->logical_cpus));
+  arr = lean_array_push(arr, lean_usize_to_nat((size_t)cpu->physical_cores));
+  arr = lean_array_push(arr, lean_usize_to_nat((size_t)cpu->packages));
+  return arr;
+}
+
+/** leanblas_kernel_selections
+ * @return (family, selected variant) for every native kernel family, e.g. ("dgemm", "avx512").
+ */
+LEAN_EXPORT lean_obj_res leanblas_kernel_selections(lean_obj_arg unit) {
+  lean_obj_res arr = lean_mk_empty_array();
+  for (int i = 0; i < leanblas_kernel_family_count(); i++) {
+    const leanblas_kernel_family *family = leanblas_kernel_family_at(i);
+    lean_obj_res pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, lean_mk_string(family->name));
+    lean_ctor_set(pair, 1, lean_mk_string(family->selected->name));
+    arr = lean_array_push(arr, pair);
+  }
+  return arr;
+}
+
+LEAN_EXPORT lean_obj_res leanblas_native_threads(lean_obj_arg w) {
+  return lean_io_result_mk_ok(lean_box_usize((size_t)leanblas_num_threads()));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_set_native_threads(size_t n, lean_obj_arg w) {
+  leanblas_set_num_threads(n > INT_MAX ? INT_MAX : (int)n);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_reproducible_enabled(lean_obj_arg w) {
+  return lean_io_result_mk_ok(lean_box(leanblas_reproducible() ? 1 : 0));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_set_reproducible_enabled(uint8_t on, lean_obj_arg w) {
+  leanblas_set_reproducible(on);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+// OpenBLAS thread control, when the system BLAS is OpenBLAS.  Weak, so that
+// linking against another BLAS leaves them NULL.
+extern void openblas_set_num_threads(int n) __attribute__((weak));
+extern int openblas_get_num_threads(void) __attribute__((weak));
+
+/** leanblas_system_threads
+ * @return Threads the system BLAS uses, or 0 if it does not say (not OpenBLAS).
+ */
+LEAN_EXPORT lean_obj_res leanblas_system_threads(lean_obj_arg w) {
+  size_t n = openblas_get_num_threads ? (size_t)openblas_get_num_threads() : 0;
+  return lean_io_result_mk_ok(lean_box_usize(n));
+}
+
+/** leanblas_set_system_threads
+ * Sets the threads of the system BLAS.
+ * @return Whether it could be set (the system BLAS is OpenBLAS).
+ */
+LEAN_EXPORT lean_obj_res leanblas_set_system_threads(size_t n, lean_obj_arg w) {
+  if (!openblas_set_num_threads) return lean_io_result_mk_ok(lean_box(0));
+  openblas_set_num_threads(n > INT_MAX ? INT_MAX : (int)n);
+  return lean_io_result_mk_ok(lean_box(1));
+}
@@ -0,0 +1,90 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../cblas_compat.h"
+
+// Baseline for `lake exe FFIOverhead`: the same CBLAS calls as
+// `LeanBLASTest/FFIOverhead.lean`, made directly from C.
+//
+// Every case runs a tight loop of calls, doubling its length until one run
+// takes at least a millisecond, and reports the median time per call over
+// `TRIALS` runs as `op<TAB>n<TAB>ns` lines.  Operations, sizes and arguments
+// (including the alternating offsets and scalars) must match the Lean side.
+
+#define TRIALS 15
+#define MIN_RUN_NS 1000000ull
+
+static const int level1_sizes[] = {1, 16, 256, 4096, 65536};
+static const int level2_sizes[] = {1, 8, 64};
+static const int level3_sizes[] = {1, 8, 32};
+
+static double *X, *Y, *A, *B, *C;
+static volatile double sink;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#define DEFINE_CASE(name, call)                              \
+  static uint64_t run_##name(int n, size_t iters) {          \
+    double acc = 0.0;                                        \
+    uint64_t t0 = now_ns();                                  \
+    for (size_t i = 0; i < iters; i++) { call; }             \
+    uint64_t t1 = now_ns();                                  \
+    sink += acc;                                             \
+    return t1 - t0;                                          \
+  }
+
+DEFINE_CASE(dot, acc += cblas_ddot(n, X + (i & 1), 1, Y, 1))
+DEFINE_CASE(axpy, cblas_daxpy(n, (i & 1) ? -0.5 : 0.5, X, 1, Y, 1))
+DEFINE_CASE(scal, cblas_dscal(n, (i & 1) ? 0.5 : 2.0, Y, 1))
+DEFINE_CASE(gemv, cblas_dgemv(CblasColMajor, CblasNoTrans, n, n, (i & 1) ? 0.5 : 2.0, A, n, X, 1, 0.0, Y, 1))
+DEFINE_CASE(gemm, cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, n, n, (i & 1) ? 0.5 : 2.0,
+                              A, n, B, n, 0.0, C, n))
+
+static int compare(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void measure(const char *op, int n, uint64_t (*run)(int, size_t)) {
+  size_t iters = 1;
+  while (run(n, iters) < MIN_RUN_NS) iters *= 2;
+  double times[TRIALS];
+  for (int t = 0; t < TRIALS; t++) times[t] = (double)run(n, iters) / (double)iters;
+  qsort(times, TRIALS, sizeof(double), compare);
+  printf("%s\t%d\t%.3f\n", op, n, times[TRIALS / 2]);
+}
+
+static double *filled(size_t len, double phase) {
+  double *p = malloc(len * sizeof(double));
+  if (!p) {
+    fprintf(stderr, "ffi_overhead: out of memory\n");
+    exit(1);
+  }
+  for (size_t i = 0; i < len; i++) p[i] = (double)((i * 7 + (size_t)(phase * 10)) % 13) / 13.0 - 0.5;
+  return p;
+}
+
+int main(void) {
+  // one extra element for the alternating offset of `dot`
+  X = filled(65536 + 1, 0.0);
+  Y = filled(65536 + 1, 1.0);
+  A = filled(64 * 64, 2.0);
+  B = filled(64 * 64, 3.0);
+  C = filled(64 * 64, 4.0);
+  for (size_t k = 0; k < sizeof level1_sizes / sizeof *level1_sizes; k++) {
+    measure("dot", level1_sizes[k], run_dot);
+    measure("axpy", level1_sizes[k], run_axpy);
+    measure("scal", level1_sizes[k], run_scal);
+  }
+  for (size_t k = 0; k < sizeof level2_sizes / sizeof *level2_sizes; k++)
+    measure("gemv", level2_sizes[k], run_gemv);
+  for (size_t k = 0; k < sizeof level3_sizes / sizeof *level3_sizes; k++)
+    measure("gemm", level3_sizes[k], run_gemm);
+  fprintf(stderr, "checksum %g\n", sink);
+  return 0;
+}
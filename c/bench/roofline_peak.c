@@ -0,0 +1,221 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../native.h"
+
+// Machine roofs for `lake exe Roofline`.
+//
+//   roofline_peak_c [THREADS [TRIAD_ELEMENTS]]
+//
+// For 1, 2, 4, ... threads up to THREADS (default: physical cores), and
+// THREADS itself, prints
+//
+//   triad<TAB>threads<TAB>GB/s       a[i] = b[i] + s*c[i], 24 bytes per element
+//   fma64<TAB>threads<TAB>GFLOP/s    independent double FMA chains
+//   fma32<TAB>threads<TAB>GFLOP/s    the same in single precision
+//
+// Like STREAM, the triad counts the bytes of the three arrays once (no
+// write-allocate traffic) and reports the best of REPS runs.  Each thread
+// touches its part of the arrays first, so the pages end up on its NUMA node.
+// The arrays default to four times the last-level cache each, at least 32 MiB.
+// The FMA chains use the widest vectors the CPU offers (AVX-512, AVX2+FMA or
+// the baseline) and enough accumulators to hide the FMA latency.
+
+#define REPS 10
+#define FMA_ITERS 2000000
+#define FMA_ACC 16
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// FMA chains
+// ---------------------------------------------------------------------------
+
+// acc = acc * m + a converges to a / (1 - m) without denormals or overflow.
+#define DEFINE_FMA(name, T, bytes, attr)                                        \
+  attr static double name(long iters) {                                        \
+    typedef T vec __attribute__((vector_size(bytes)));                         \
+    vec acc[FMA_ACC];                                                          \
+    vec m, a;                                                                  \
+    for (size_t l = 0; l < sizeof(vec) / sizeof(T); l++) {                     \
+      m[l] = (T)0.999999;                                                      \
+      a[l] = (T)1e-6;                                                          \
+    }                                                                          \
+    for (int j = 0; j < FMA_ACC; j++) acc[j] = a * (T)j;                       \
+    for (long i = 0; i < iters; i++)                                           \
+      for (int j = 0; j < FMA_ACC; j++) acc[j] = acc[j] * m + a;               \
+    double s = 0.0;                                                            \
+    for (int j = 0; j < FMA_ACC; j++)                                          \
+      for (size_t l = 0; l < sizeof(vec) / sizeof(T); l++) s += acc[j][l];     \
+    return s;                                                                  \
+  }
+
+DEFINE_FMA(fma64_generic, double, 16, )
+DEFINE_FMA(fma32_generic, float, 16, )
+#ifdef LEANBLAS_X86_DISPATCH
+DEFINE_FMA(fma64_avx2, double, 32, LEANBLAS_TARGET_AVX2)
+DEFINE_FMA(fma32_avx2, float, 32, LEANBLAS_TARGET_AVX2)
+DEFINE_FMA(fma64_avx512, double, 64, LEANBLAS_TARGET_AVX512)
+DEFINE_FMA(fma32_avx512, float, 64, LEANBLAS_TARGET_AVX512)
+#endif
+
+typedef double (*fma_fn)(long);
+
+// Lanes per vector of the selected variant, for the flop count.
+static int fma_lanes64;
+static fma_fn fma64, fma32;
+
+static void select_fma(void) {
+  fma64 = fma64_generic;
+  fma32 = fma32_generic;
+  fma_lanes64 = 2;
+#ifdef LEANBLAS_X86_DISPATCH
+  uint32_t f = leanblas_cpu()->features;
+  if (f & LEANBLAS_CPU_AVX512F) {
+    fma64 = fma64_avx512;
+    fma32 = fma32_avx512;
+    fma_lanes64 = 8;
+  } else if ((f & LEANBLAS_CPU_AVX2) && (f & LEANBLAS_CPU_FMA)) {
+    fma64 = fma64_avx2;
+    fma32 = fma32_avx2;
+    fma_lanes64 = 4;
+  }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Threads
+// ---------------------------------------------------------------------------
+
+enum { JOB_INIT, JOB_TRIAD, JOB_FMA64, JOB_FMA32 };
+
+typedef struct {
+  int nthreads;
+  pthread_barrier_t barrier;
+  double *a, *b, *c;
+  size_t n;
+  int job;
+  double best_ns;
+  double sink;
+  pthread_mutex_t lock;
+} run_state;
+
+typedef struct {
+  run_state *st;
+  int id;
+} worker_arg;
+
+static void do_job(run_state *st, int id) {
+  size_t lo = st->n * (size_t)id / (size_t)st->nthreads;
+  size_t hi = st->n * (size_t)(id + 1) / (size_t)st->nthreads;
+  double *restrict a = st->a, *restrict b = st->b, *restrict c = st->c;
+  double s = 0.0;
+  switch (st->job) {
+    case JOB_INIT:
+      for (size_t i = lo; i < hi; i++) {
+        a[i] = 0.0;
+        b[i] = 1.0;
+        c[i] = 2.0;
+      }
+      break;
+    case JOB_TRIAD:
+      for (size_t i = lo; i < hi; i++) a[i] = b[i] + 0.5 * c[i];
+      s = a[lo];
+      break;
+    case JOB_FMA64:
+      s = fma64(FMA_ITERS);
+      break;
+    case JOB_FMA32:
+      s = fma32(FMA_ITERS);
+      break;
+  }
+  pthread_mutex_lock(&st->lock);
+  st->sink += s;
+  pthread_mutex_unlock(&st->lock);
+}
+
+// Every rep starts and ends at a barrier; thread 0 times it.
+static void *worker(void *p) {
+  worker_arg *w = (worker_arg *)p;
+  run_state *st = w->st;
+  int reps = st->job == JOB_INIT ? 1 : REPS;
+  for (int r = 0; r < reps; r++) {
+    pthread_barrier_wait(&st->barrier);
+    uint64_t t0 = now_ns();
+    do_job(st, w->id);
+    pthread_barrier_wait(&st->barrier);
+    if (w->id == 0) {
+      double t = (double)(now_ns() - t0);
+      if (t < st->best_ns) st->best_ns = t;
+    }
+  }
+  return NULL;
+}
+
+// Runs `job` on `nthreads` threads and returns the best time of one rep.
+static double run(run_state *st, int nthreads, int job) {
+  pthread_t tids[nthreads];
+  worker_arg args[nthreads];
+  st->nthreads = nthreads;
+  st->job = job;
+  st->best_ns = 1e300;
+  pthread_barrier_init(&st->barrier, NULL, (unsigned)nthreads);
+  for (int i = 1; i < nthreads; i++) {
+    args[i] = (worker_arg){st, i};
+    pthread_create(&tids[i], NULL, worker, &args[i]);
+  }
+  args[0] = (worker_arg){st, 0};
+  worker(&args[0]);
+  for (int i = 1; i < nthreads; i++) pthread_join(tids[i], NULL);
+  pthread_barrier_destroy(&st->barrier);
+  return st->best_ns;
+}
+
+static void measure(run_state *st, int t) {
+  // fresh arrays per thread count, first touched by the threads that use them
+  st->a = malloc(st->n * sizeof(double));
+  st->b = malloc(st->n * sizeof(double));
+  st->c = malloc(st->n * sizeof(double));
+  if (!st->a || !st->b || !st->c) {
+    fprintf(stderr, "roofline_peak: out of memory\n");
+    exit(1);
+  }
+  run(st, t, JOB_INIT);
+  double triad = run(st, t, JOB_TRIAD);
+  printf("triad\t%d\t%.3f\n", t, 24.0 * (double)st->n / triad);
+  free(st->a);
+  free(st->b);
+  free(st->c);
+  double flops64 = 2.0 * FMA_ACC * fma_lanes64 * (double)FMA_ITERS * t;
+  printf("fma64\t%d\t%.3f\n", t, flops64 / run(st, t, JOB_FMA64));
+  printf("fma32\t%d\t%.3f\n", t, 2.0 * flops64 / run(st, t, JOB_FMA32));
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  const leanblas_cpu_info *cpu = leanblas_cpu();
+  int threads = argc > 1 ? atoi(argv[1]) : cpu->physical_cores;
+  if (threads < 1) threads = 1;
+  size_t n = argc > 2 ? (size_t)atoll(argv[2]) : 0;
+  if (n == 0) {
+    size_t bytes = 4 * cpu->l3_bytes;
+    if (bytes < ((size_t)32 << 20)) bytes = (size_t)32 << 20;
+    n = bytes / sizeof(double);
+  }
+  select_fma();
+  run_state st;
+  memset(&st, 0, sizeof st);
+  st.n = n;
+  pthread_mutex_init(&st.lock, NULL);
+  for (int t = 1; t < threads; t *= 2) measure(&st, t);
+  measure(&st, threads);
+  fprintf(stderr, "checksum %g\n", st.sink);
+  return 0;
+}
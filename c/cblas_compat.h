@@ -0,0 +1,26 @@
+#pragma once
+
+// Selects where the `cblas_*` symbols used by the Lean wrappers come from.
+//
+// By default we include the system `<cblas.h>` and link against whatever
+// `libblas` the platform provides.  Building with `-DLEANBLAS_NATIVE_BACKEND`
+// (`lake build -K blas=native`) instead uses the in-tree kernels from
+// `c/native_*.c`, which export the `cblas_*` symbols themselves.  In that case
+// no system header is needed, so the enums are declared here with the
+// standard CBLAS values.
+
+#ifdef LEANBLAS_NATIVE_BACKEND
+
+typedef enum CBLAS_ORDER     {CblasRowMajor=101, CblasColMajor=102} CBLAS_ORDER;
+typedef enum CBLAS_TRANSPOSE {CblasNoTrans=111, CblasTrans=112, CblasConjTrans=113} CBLAS_TRANSPOSE;
+typedef enum CBLAS_UPLO      {CblasUpper=121, CblasLower=122} CBLAS_UPLO;
+typedef enum CBLAS_DIAG      {CblasNonUnit=131, CblasUnit=132} CBLAS_DIAG;
+typedef enum CBLAS_SIDE      {CblasLeft=141, CblasRight=142} CBLAS_SIDE;
+
+#include "native.h"
+
+#else
+
+#include <cblas.h>
+
+#endif
@@ -0,0 +1,486 @@
+#include <lean/lean.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "util.h"
+
+// Checkpoint files (`LeanBLAS/FFI/Checkpoint.lean`): named arrays with their
+// dtype, shape and order, each payload 64-byte aligned and checksummed.
+//
+//   header, 64 bytes, little-endian:
+//     "LBLASCKP", u32 version (1), u32 flags (bit 0: payloads little-endian),
+//     u64 count, u64 index offset, u64 index bytes, u64 XXH64 of the index,
+//     16 zero bytes
+//   payloads, each at a multiple of 64 and preceded by at least 64 unused
+//   bytes, in native byte order
+//   index, one record per array, little-endian:
+//     u16 name bytes, name, u8 dtype bytes, dtype, u8 fortran order, u8 ndim,
+//     u64 shape[ndim], u64 offset, u64 bytes, u64 XXH64 of the payload
+//
+// The writer streams: `add` appends a payload (hashing it block by block as it
+// goes out), `finish` appends the index, writes the header and renames the
+// file from `PATH.tmp` to `PATH`, so an interrupted checkpoint never replaces
+// a complete one.
+//
+// The reader maps the file privately and builds each `ByteArray` in place: the
+// persistent array header goes into the unused bytes before the payload (see
+// `leanblas_mapped_sarray` in util.h).  The arrays are never freed and the mapping is never unmapped;
+// writes through a wrapper copy first and the file does not change.
+
+#define CKPT_VERSION 1
+#define CKPT_ALIGN 64
+#define CKPT_BLOCK (1u << 20)
+
+// ---------------------------------------------------------------------------
+// XXH64
+// ---------------------------------------------------------------------------
+
+static const uint64_t P1 = 0x9E3779B185EBCA87ull, P2 = 0xC2B2AE3D27D4EB4Full, P3 = 0x165667B19E3779F9ull,
+                      P4 = 0x85EBCA77C2B2AE63ull, P5 = 0x27D4EB2F165667C5ull;
+
+static uint64_t rotl(uint64_t x, int r) { return x << r | x >> (64 - r); }
+static uint64_t xxh_round(uint64_t acc, uint64_t in) { return rotl(acc + in * P2, 31) * P1; }
+static uint64_t xxh_merge(uint64_t h, uint64_t v) { return (h ^ xxh_round(0, v)) * P1 + P4; }
+
+typedef struct {
+  uint64_t v[4];
+} xxh64_state;
+
+static void xxh64_init(xxh64_state *s) {
+  s->v[0] = P1 + P2;
+  s->v[1] = P2;
+  s->v[2] = 0;
+  s->v[3] = -P1;
+}
+
+// Consumes `n` bytes, a multiple of 32.
+static void xxh64_stripes(xxh64_state *s, const uint8_t *p, size_t n) {
+  for (const uint8_t *end = p + n; p < end; p += 32)
+    for (int k = 0; k < 4; k++) s->v[k] = xxh_round(s->v[k], leanblas_get64(p + 8 * k));
+}
+
+// The hash of `total` bytes whose last `n` (< 32) are `tail` and the rest went
+// through `xxh64_stripes`.
+static uint64_t xxh64_finish(const xxh64_state *s, const uint8_t *tail, size_t n, uint64_t total) {
+  uint64_t h;
+  if (total >= 32) {
+    h = rotl(s->v[0], 1) + rotl(s->v[1], 7) + rotl(s->v[2], 12) + rotl(s->v[3], 18);
+    for (int k = 0; k < 4; k++) h = xxh_merge(h, s->v[k]);
+  } else {
+    h = P5;
+  }
+  h += total;
+  for (; n >= 8; tail += 8, n -= 8) h = rotl(h ^ xxh_round(0, leanblas_get64(tail)), 27) * P1 + P4;
+  if (n >= 4) {
+    h = rotl(h ^ (uint64_t)leanblas_get32(tail) * P1, 23) * P2 + P3;
+    tail += 4;
+    n -= 4;
+  }
+  for (; n > 0; tail++, n--) h = rotl(h ^ *tail * P5, 11) * P1;
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+static uint64_t xxh64(const uint8_t *p, size_t n) {
+  xxh64_state s;
+  xxh64_init(&s);
+  const size_t body = n - n % 32;
+  xxh64_stripes(&s, p, body);
+  return xxh64_finish(&s, p + body, n - body, n);
+}
+
+// ---------------------------------------------------------------------------
+// Arrays
+// ---------------------------------------------------------------------------
+
+static lean_object *mk_raw(const char *dtype, const uint64_t *shape, size_t ndim, int fortran, lean_object *data) {
+  lean_object *s = lean_alloc_array(ndim, ndim);
+  for (size_t i = 0; i < ndim; i++) lean_array_set_core(s, i, lean_uint64_to_nat(shape[i]));
+  lean_object *r = lean_alloc_ctor(0, 3, 1);
+  lean_ctor_set(r, 0, lean_mk_string(dtype));
+  lean_ctor_set(r, 1, s);
+  lean_ctor_set(r, 2, data);
+  lean_ctor_set_uint8(r, 3 * sizeof(void *), (uint8_t)fortran);
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  int fd;
+  char *path, *tmp;
+  uint64_t pos;
+  uint8_t *index;
+  size_t index_len, index_cap;
+  uint64_t count;
+  char **names;
+  int done;
+} ckpt_writer;
+
+static lean_external_class *writer_class = NULL;
+static pthread_once_t writer_once = PTHREAD_ONCE_INIT;
+
+static void writer_release(ckpt_writer *w) {
+  if (w->fd >= 0) {
+    close(w->fd);
+    unlink(w->tmp);
+    w->fd = -1;
+  }
+}
+
+static void writer_finalize(void *data) {
+  ckpt_writer *w = data;
+  writer_release(w);
+  for (uint64_t i = 0; i < w->count; i++) free(w->names[i]);
+  free(w->names);
+  free(w->index);
+  free(w->path);
+  free(w->tmp);
+  free(w);
+}
+
+static void writer_foreach(void *data, b_lean_obj_arg f) {
+  (void)data;
+  (void)f;
+}
+
+static void writer_init(void) { writer_class = lean_register_external_class(writer_finalize, writer_foreach); }
+
+// Fails with the current `errno` and gives up on the checkpoint.
+static lean_obj_res writer_os_error(ckpt_writer *w) {
+  const int err = errno;
+  lean_object *lpath = lean_mk_string(w->path);
+  lean_obj_res r = lean_io_result_mk_error(lean_decode_io_error(err, lpath));
+  lean_dec(lpath);
+  writer_release(w);
+  return r;
+}
+
+static int index_append(ckpt_writer *w, const void *p, size_t n) {
+  if (w->index_len + n > w->index_cap) {
+    size_t cap = w->index_cap ? 2 * w->index_cap : 1024;
+    while (cap < w->index_len + n) cap *= 2;
+    uint8_t *grown = realloc(w->index, cap);
+    if (!grown) return -1;
+    w->index = grown;
+    w->index_cap = cap;
+  }
+  memcpy(w->index + w->index_len, p, n);
+  w->index_len += n;
+  return 0;
+}
+
+LEAN_EXPORT lean_obj_res leanblas_checkpoint_create(b_lean_obj_arg lpath, lean_obj_arg world) {
+  (void)world;
+  pthread_once(&writer_once, writer_init);
+  const char *path = lean_string_cstr(lpath);
+  ckpt_writer *w = calloc(1, sizeof(ckpt_writer));
+  if (!w) lean_internal_panic_out_of_memory();
+  w->path = strdup(path);
+  w->tmp = malloc(strlen(path) + 5);
+  if (!w->path || !w->tmp) lean_internal_panic_out_of_memory();
+  sprintf(w->tmp, "%s.tmp", path);
+  w->fd = open(w->tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (w->fd < 0) {
+    lean_obj_res r = leanblas_os_error(lpath);
+    writer_finalize(w);
+    return r;
+  }
+  // the header is written by `finish`; until then the file has no magic
+  uint8_t zero[CKPT_ALIGN] = {0};
+  if (leanblas_write_all(w->fd, zero, sizeof(zero)) != 0) {
+    lean_obj_res r = leanblas_os_error(lpath);
+    writer_finalize(w);
+    return r;
+  }
+  w->pos = CKPT_ALIGN;
+  return lean_io_result_mk_ok(lean_alloc_external(writer_class, w));
+}
+
+/**
+ * Appends one array: `raw` is a `BLAS.Npy.Raw`.
+ */
+LEAN_EXPORT lean_obj_res leanblas_checkpoint_add(b_lean_obj_arg writer, b_lean_obj_arg lname, b_lean_obj_arg raw,
+                                                 lean_obj_arg world) {
+  (void)world;
+  ckpt_writer *w = lean_get_external_data(writer);
+  const char *name = lean_string_cstr(lname);
+  if (w->fd < 0) return leanblas_file_error(w->path, "checkpoint already finished or failed");
+  const char *dtype = lean_string_cstr(lean_ctor_get(raw, 0));
+  b_lean_obj_arg shape = lean_ctor_get(raw, 1);
+  b_lean_obj_arg data = lean_ctor_get(raw, 2);
+  const int fortran = lean_ctor_get_uint8(raw, 3 * sizeof(void *));
+  const size_t item = leanblas_raw_dtype_item(dtype);
+  const size_t name_len = lean_string_size(lname) - 1;
+  const size_t ndim = lean_array_size(shape);
+  if (!item) return leanblas_file_error(w->path, "'%s': unsupported dtype %s", name, dtype);
+  if (name_len > 0xFFFF) return leanblas_file_error(w->path, "array name too long");
+  if (ndim > 255) return leanblas_file_error(w->path, "'%s': too many dimensions", name);
+  for (uint64_t i = 0; i < w->count; i++)
+    if (strcmp(w->names[i], name) == 0) return leanblas_file_error(w->path, "duplicate array '%s'", name);
+  uint64_t count = 1;
+  for (size_t i = 0; i < ndim; i++) {
+    b_lean_obj_arg d = lean_array_get_core(shape, i);
+    const uint64_t k = lean_is_scalar(d) ? lean_unbox(d) : UINT64_MAX;
+    if (k == UINT64_MAX || (k != 0 && count > UINT64_MAX / k))
+      return leanblas_file_error(w->path, "'%s': shape too large", name);
+    count *= k;
+  }
+  const size_t bytes = lean_sarray_size(data);
+  if (count > SIZE_MAX / item || count * item != bytes)
+    return leanblas_file_error(w->path, "'%s': data size does not match the shape", name);
+  char **names = realloc(w->names, (w->count + 1) * sizeof(char *));
+  if (!names) lean_internal_panic_out_of_memory();
+  w->names = names;
+
+  // padding up to the slot in front of the payload
+  const uint64_t offset = (w->pos + CKPT_ALIGN - 1) / CKPT_ALIGN * CKPT_ALIGN + CKPT_ALIGN;
+  uint8_t zero[2 * CKPT_ALIGN] = {0};
+  int err = leanblas_write_all(w->fd, zero, (size_t)(offset - w->pos));
+
+  // payload, hashed block by block on its way out
+  const uint8_t *p = lean_sarray_cptr(data);
+  const size_t body = bytes - bytes % 32;
+  xxh64_state s;
+  xxh64_init(&s);
+  for (size_t done = 0; !err && done < body; done += CKPT_BLOCK) {
+    const size_t n = body - done < CKPT_BLOCK ? body - done : CKPT_BLOCK;
+    xxh64_stripes(&s, p + done, n);
+    err = leanblas_write_all(w->fd, p + done, n);
+  }
+  if (!err) err = leanblas_write_all(w->fd, p + body, bytes - body);
+  if (err) return writer_os_error(w);
+  const uint64_t hash = xxh64_finish(&s, p + body, bytes - body, bytes);
+  w->pos = offset + bytes;
+
+  uint8_t rec[4 + 8 * 3];
+  const uint8_t dtype_len = (uint8_t)strlen(dtype);
+  rec[0] = (uint8_t)name_len;
+  rec[1] = (uint8_t)(name_len >> 8);
+  int ok = index_append(w, rec, 2) == 0 && index_append(w, name, name_len) == 0 &&
+           index_append(w, &dtype_len, 1) == 0 && index_append(w, dtype, dtype_len) == 0;
+  rec[0] = (uint8_t)fortran;
+  rec[1] = (uint8_t)ndim;
+  ok = ok && index_append(w, rec, 2) == 0;
+  for (size_t i = 0; ok && i < ndim; i++) {
+    leanblas_put64(rec, lean_unbox(lean_array_get_core(shape, i)));
+    ok = index_append(w, rec, 8) == 0;
+  }
+  leanblas_put64(rec, offset);
+  leanblas_put64(rec + 8, bytes);
+  leanblas_put64(rec + 16, hash);
+  if (!ok || index_append(w, rec, 24) != 0) lean_internal_panic_out_of_memory();
+  w->names[w->count] = strdup(name);
+  if (!w->names[w->count]) lean_internal_panic_out_of_memory();
+  w->count++;
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_checkpoint_finish(b_lean_obj_arg writer, lean_obj_arg world) {
+  (void)world;
+  ckpt_writer *w = lean_get_external_data(writer);
+  if (w->fd < 0) return leanblas_file_error(w->path, "checkpoint already finished or failed");
+  uint8_t h[CKPT_ALIGN] = {0};
+  memcpy(h, "LBLASCKP", 8);
+  leanblas_put32(h + 8, CKPT_VERSION);
+  leanblas_put32(h + 12, leanblas_host_is_little() ? 1 : 0);
+  leanblas_put64(h + 16, w->count);
+  leanblas_put64(h + 24, w->pos);
+  leanblas_put64(h + 32, w->index_len);
+  leanblas_put64(h + 40, xxh64(w->index, w->index_len));
+  int err = leanblas_write_all(w->fd, w->index, w->index_len) != 0 || leanblas_write_at(w->fd, h, sizeof(h), 0) != 0 ||
+            fsync(w->fd) != 0;
+  if (!err) {
+    err = close(w->fd) != 0;
+    w->fd = -1;
+    if (!err) err = rename(w->tmp, w->path) != 0;
+    if (err) unlink(w->tmp);
+  }
+  if (err) return writer_os_error(w);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  char name[0x10000];
+  char dtype[256];
+  int fortran;
+  size_t ndim;
+  uint64_t shape[255];
+  uint64_t offset, bytes, hash;
+} ckpt_entry;
+
+// Parses the index record at `*pos`; returns an error message or NULL.
+// Payloads must come in file order, each with its unused bytes in front, so
+// that the array headers placed there in a mapping never overlap data.
+static const char *parse_entry(const uint8_t *ix, size_t len, size_t *pos, uint64_t data_start, uint64_t data_end,
+                               ckpt_entry *e) {
+  size_t p = *pos;
+  if (p + 2 > len) return "truncated index";
+  const size_t nlen = (size_t)ix[p] | (size_t)ix[p + 1] << 8;
+  p += 2;
+  if (p + nlen + 1 > len) return "truncated index";
+  memcpy(e->name, ix + p, nlen);
+  e->name[nlen] = 0;
+  p += nlen;
+  const size_t dlen = ix[p++];
+  if (p + dlen + 2 > len) return "truncated index";
+  memcpy(e->dtype, ix + p, dlen);
+  e->dtype[dlen] = 0;
+  p += dlen;
+  e->fortran = ix[p++] != 0;
+  e->ndim = ix[p++];
+  if (p + 8 * e->ndim + 24 > len) return "truncated index";
+  uint64_t count = 1;
+  int overflow = 0;
+  for (size_t i = 0; i < e->ndim; i++, p += 8) {
+    e->shape[i] = leanblas_get64(ix + p);
+    if (e->shape[i] != 0 && count > UINT64_MAX / e->shape[i]) overflow = 1;
+    else count *= e->shape[i];
+  }
+  e->offset = leanblas_get64(ix + p);
+  e->bytes = leanblas_get64(ix + p + 8);
+  e->hash = leanblas_get64(ix + p + 16);
+  p += 24;
+  *pos = p;
+  const size_t item = leanblas_raw_dtype_item(e->dtype);
+  if (!item) return "unsupported dtype";
+  if (overflow || count > UINT64_MAX / item || count * item != e->bytes) return "size does not match the shape";
+  if (e->offset % CKPT_ALIGN != 0 || e->offset < data_start + CKPT_ALIGN || e->offset > data_end ||
+      e->bytes > data_end - e->offset || e->bytes > SIZE_MAX)
+    return "payload outside the data section";
+  return NULL;
+}
+
+/**
+ * Loads every array of a checkpoint.
+ *
+ * @param map    build the arrays in a private mapping of the file instead of
+ *               reading them
+ * @param verify check the XXH64 of every payload (reads all of them)
+ * @return Array (String × BLAS.Npy.Raw)
+ */
+LEAN_EXPORT lean_obj_res leanblas_checkpoint_load(b_lean_obj_arg lpath, uint8_t map, uint8_t verify,
+                                                  lean_obj_arg world) {
+  (void)world;
+  const char *path = lean_string_cstr(lpath);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  uint8_t h[CKPT_ALIGN];
+  uint8_t *ix = NULL;
+  ckpt_entry *e = NULL;
+  uint8_t *base = NULL;
+  size_t mapped = 0;
+  lean_object *out = NULL;
+  lean_obj_res r = NULL;
+  if (fstat(fd, &st) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  if (st.st_size < CKPT_ALIGN) {
+    r = leanblas_file_error(path, "not a checkpoint");
+    goto done;
+  }
+  if (leanblas_read_at(fd, h, sizeof(h), 0) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  if (memcmp(h, "LBLASCKP", 8) != 0) {
+    r = leanblas_file_error(path, "not a checkpoint, or one that was never finished");
+    goto done;
+  }
+  if (leanblas_get32(h + 8) != CKPT_VERSION) {
+    r = leanblas_file_error(path, "unsupported checkpoint version %u", leanblas_get32(h + 8));
+    goto done;
+  }
+  if ((int)(leanblas_get32(h + 12) & 1) != leanblas_host_is_little()) {
+    r = leanblas_file_error(path, "written on a machine with the other byte order");
+    goto done;
+  }
+  const uint64_t count = leanblas_get64(h + 16), index_off = leanblas_get64(h + 24), index_len = leanblas_get64(h + 32);
+  if (index_off < CKPT_ALIGN || index_off > (uint64_t)st.st_size || index_len > (uint64_t)st.st_size - index_off ||
+      count > index_len / 28) {
+    r = leanblas_file_error(path, "corrupt header");
+    goto done;
+  }
+  ix = malloc(index_len ? index_len : 1);
+  e = malloc(sizeof(ckpt_entry));
+  if (!ix || !e) lean_internal_panic_out_of_memory();
+  if (leanblas_read_at(fd, ix, index_len, index_off) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  if (xxh64(ix, index_len) != leanblas_get64(h + 40)) {
+    r = leanblas_file_error(path, "index checksum mismatch");
+    goto done;
+  }
+  if (map && index_off > 0) {
+    void *m = mmap(NULL, index_off, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (m != MAP_FAILED) {
+      base = m;
+      mapped = index_off;
+    }
+  }
+  out = lean_alloc_array(0, count);
+  size_t pos = 0;
+  uint64_t next = CKPT_ALIGN;
+  for (uint64_t i = 0; i < count; i++) {
+    const char *err = parse_entry(ix, index_len, &pos, next, index_off, e);
+    if (err) {
+      r = leanblas_file_error(path, "array %llu: %s", (unsigned long long)i, err);
+      goto done;
+    }
+    next = e->offset + e->bytes;
+    lean_object *data;
+    if (base && e->bytes > 0) {
+      data = leanblas_mapped_sarray(base + e->offset, e->bytes);
+    } else {
+      data = lean_alloc_sarray(1, e->bytes, e->bytes);
+      if (leanblas_read_at(fd, lean_sarray_cptr(data), e->bytes, e->offset) != 0) {
+        r = leanblas_os_error(lpath);
+        lean_dec(data);
+        goto done;
+      }
+    }
+    if (verify && xxh64(lean_sarray_cptr(data), e->bytes) != e->hash) {
+      r = leanblas_file_error(path, "checksum mismatch in '%s'", e->name);
+      lean_dec(data);
+      goto done;
+    }
+    lean_object *pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, lean_mk_string(e->name));
+    lean_ctor_set(pair, 1, mk_raw(e->dtype, e->shape, e->ndim, e->fortran, data));
+    out = lean_array_push(out, pair);
+  }
+  r = lean_io_result_mk_ok(out);
+  out = NULL;
+  mapped = 0;   // the arrays live in the mapping from now on
+done:
+  if (out) lean_dec(out);
+  if (mapped) munmap(base, mapped);
+  free(ix);
+  free(e);
+  close(fd);
+  return r;
+}
+
+LEAN_EXPORT uint8_t leanblas_checkpoint_is_aligned(b_lean_obj_arg a) {
+  return (uintptr_t)lean_sarray_cptr(a) % CKPT_ALIGN == 0;
+}
@@ -0,0 +1,65 @@
+#include <math.h>
+#include "cblas_compat.h"
+#include "elementwise.h"
+
+// Elementwise Level 1 kernels, see elementwise.h.
+
+static void ew_copy(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) {
+  (void)a;
+  (void)b;
+  cblas_dcopy((int)n, x, (int)incX, y, (int)incY);
+}
+
+static void ew_axpy(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) {
+  (void)b;
+  cblas_daxpy((int)n, a, x, (int)incX, y, (int)incY);
+}
+
+static void ew_scal(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) {
+  (void)b;
+  (void)y;
+  (void)incY;
+  cblas_dscal((int)n, a, x, (int)incX);
+}
+
+static void ew_axpby(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) {
+  for (size_t i = 0; i < n; i++) y[i * incY] = a * x[i * incX] + b * y[i * incY];
+}
+
+static void ew_mul(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) {
+  (void)a;
+  (void)b;
+  for (size_t i = 0; i < n; i++) y[i * incY] *= x[i * incX];
+}
+
+// x ← f(x), for the kernels on a single vector.
+#define EW_MAP(name, f)                                                                              \
+  static void name(size_t n, double a, double b, double *x, size_t incX, double *y, size_t incY) { \
+    (void)a;                                                                                         \
+    (void)b;                                                                                         \
+    (void)y;                                                                                         \
+    (void)incY;                                                                                      \
+    for (size_t i = 0; i < n; i++) {                                                                 \
+      const double v = x[i * incX];                                                                  \
+      (void)v;                                                                                       \
+      x[i * incX] = (f);                                                                             \
+    }                                                                                                \
+  }
+
+EW_MAP(ew_scaladd, a * v + b)
+EW_MAP(ew_const, a)
+EW_MAP(ew_abs, fabs(v))
+EW_MAP(ew_sqrt, sqrt(v))
+EW_MAP(ew_exp, exp(v))
+EW_MAP(ew_log, log(v))
+EW_MAP(ew_sin, sin(v))
+EW_MAP(ew_cos, cos(v))
+EW_MAP(ew_inv, 1.0 / v)
+
+const leanblas_ew_kernel leanblas_ew_kernels[LEANBLAS_EW_NOPS] = {
+    [LEANBLAS_EW_COPY] = ew_copy,   [LEANBLAS_EW_AXPY] = ew_axpy,       [LEANBLAS_EW_SCAL] = ew_scal,
+    [LEANBLAS_EW_AXPBY] = ew_axpby, [LEANBLAS_EW_SCALADD] = ew_scaladd, [LEANBLAS_EW_CONST] = ew_const,
+    [LEANBLAS_EW_MUL] = ew_mul,     [LEANBLAS_EW_ABS] = ew_abs,         [LEANBLAS_EW_SQRT] = ew_sqrt,
+    [LEANBLAS_EW_EXP] = ew_exp,     [LEANBLAS_EW_LOG] = ew_log,         [LEANBLAS_EW_SIN] = ew_sin,
+    [LEANBLAS_EW_COS] = ew_cos,     [LEANBLAS_EW_INV] = ew_inv,
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+// Elementwise Level 1 kernels (elementwise.c), shared by captured call graphs
+// (graph.c) and streaming pipelines (stream.c).
+//
+// The opcodes are the first LEANBLAS_EW_NOPS of `BLAS.CallGraph.Op` and of
+// `BLAS.Stream.Step`, in the same order.  Every kernel updates elements
+// [0, n) of strided vectors x and y; the ops on a single vector update x and
+// ignore y.
+enum {
+  LEANBLAS_EW_COPY,     // y ← x
+  LEANBLAS_EW_AXPY,     // y ← αx + y
+  LEANBLAS_EW_SCAL,     // x ← αx
+  LEANBLAS_EW_AXPBY,    // y ← αx + βy
+  LEANBLAS_EW_SCALADD,  // x ← αx + β
+  LEANBLAS_EW_CONST,    // x ← α
+  LEANBLAS_EW_MUL,      // y ← x ⊙ y
+  LEANBLAS_EW_ABS,
+  LEANBLAS_EW_SQRT,
+  LEANBLAS_EW_EXP,
+  LEANBLAS_EW_LOG,
+  LEANBLAS_EW_SIN,
+  LEANBLAS_EW_COS,
+  LEANBLAS_EW_INV,      // x ← 1 / x
+  LEANBLAS_EW_NOPS
+};
+
+typedef void (*leanblas_ew_kernel)(size_t n, double alpha, double beta, double *x, size_t incX, double *y,
+                                   size_t incY);
+
+extern const leanblas_ew_kernel leanblas_ew_kernels[LEANBLAS_EW_NOPS];
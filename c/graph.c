@@ -0,0 +1,532 @@
+#include <lean/lean.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cblas_compat.h"
+#include "elementwise.h"
+#include "native.h"
+#include "reproducible.h"
+#include "util.h"
+
+// Captured BLAS call graphs (`LeanBLAS/CallGraph.lean`).
+//
+// `leanblas_graph_compile` turns a recorded node list into a plan:
+// 1. Runs of adjacent elementwise Level 1 nodes of the same length are fused
+//    into one group.  A fused group sweeps its vectors in chunks of
+//    GRAPH_CHUNK elements and applies every node to a chunk before moving on,
+//    so intermediate results stay in cache.
+// 2. Temporaries whose lifetimes do not overlap share storage.  The storage
+//    belongs to the plan and is reused by every replay; a temporary reads as
+//    zero until it is first written.
+// 3. Groups are sorted into levels by their buffer dependencies
+//    (read-after-write, write-after-read, write-after-write on whole buffers).
+//    The groups of a level are independent and run in parallel on the native
+//    thread pool.
+// `leanblas_graph_replay` runs the plan on the argument arrays in one FFI call.
+//
+// A recorded node is GRAPH_NODE_WORDS words of `code`:
+//   op, order, side, uplo, transA, transB, diag, M, N, K,
+//   (buffer + 1, offset, leading dimension or increment) for 3 operands,
+//   scalar slot + 1
+// with 0 for unused buffers and slots; its alpha and beta are consts[2i] and
+// consts[2i + 1].
+
+#define GRAPH_NODE_WORDS 20
+#define GRAPH_CHUNK 2048
+
+// Same order as `BLAS.CallGraph.Op`.
+enum {
+  GRAPH_COPY, GRAPH_AXPY, GRAPH_SCAL, GRAPH_AXPBY, GRAPH_SCALADD, GRAPH_CONST, GRAPH_MUL,
+  GRAPH_ABS, GRAPH_SQRT, GRAPH_EXP, GRAPH_LOG, GRAPH_SIN, GRAPH_COS, GRAPH_INV,
+  GRAPH_DOT, GRAPH_NRM2, GRAPH_ASUM, GRAPH_SUM,
+  GRAPH_GEMV, GRAPH_GER, GRAPH_TRMV, GRAPH_TRSV,
+  GRAPH_GEMM, GRAPH_SYMM, GRAPH_SYRK, GRAPH_TRMM, GRAPH_TRSM,
+  GRAPH_NOPS
+};
+
+_Static_assert(GRAPH_INV + 1 == LEANBLAS_EW_NOPS, "elementwise ops must match elementwise.h");
+
+typedef struct {
+  int operands;     // number of array operands
+  int writes;       // bit i set if operand i is written
+  int elementwise;  // element i of the output depends only on element i of the inputs
+} graph_op_info;
+
+static const graph_op_info op_info[GRAPH_NOPS] = {
+    [GRAPH_COPY] = {2, 2, 1},  [GRAPH_AXPY] = {2, 2, 1},    [GRAPH_SCAL] = {1, 1, 1},
+    [GRAPH_AXPBY] = {2, 2, 1}, [GRAPH_SCALADD] = {1, 1, 1}, [GRAPH_CONST] = {1, 1, 1},
+    [GRAPH_MUL] = {2, 2, 1},   [GRAPH_ABS] = {1, 1, 1},     [GRAPH_SQRT] = {1, 1, 1},
+    [GRAPH_EXP] = {1, 1, 1},   [GRAPH_LOG] = {1, 1, 1},     [GRAPH_SIN] = {1, 1, 1},
+    [GRAPH_COS] = {1, 1, 1},   [GRAPH_INV] = {1, 1, 1},     [GRAPH_DOT] = {2, 0, 0},
+    [GRAPH_NRM2] = {1, 0, 0},  [GRAPH_ASUM] = {1, 0, 0},    [GRAPH_SUM] = {1, 0, 0},
+    [GRAPH_GEMV] = {3, 4, 0},  [GRAPH_GER] = {3, 4, 0},     [GRAPH_TRMV] = {2, 2, 0},
+    [GRAPH_TRSV] = {2, 2, 0},  [GRAPH_GEMM] = {3, 4, 0},    [GRAPH_SYMM] = {3, 4, 0},
+    [GRAPH_SYRK] = {2, 2, 0},  [GRAPH_TRMM] = {2, 2, 0},    [GRAPH_TRSM] = {2, 2, 0},
+};
+
+typedef struct {
+  int buf;      // -1 if unused
+  size_t off, ld;
+} graph_operand;
+
+typedef struct {
+  int op;
+  uint8_t order, side, uplo, transA, transB, diag;
+  size_t M, N, K;
+  double alpha, beta;
+  graph_operand x[3];
+  int scalar;   // -1 if none
+} graph_node;
+
+typedef struct {
+  int first, count;   // nodes [first, first + count)
+  int zero_first, zero_count;   // temporaries that start their lifetime here, in `zero_bufs`
+} graph_group;
+
+typedef struct {
+  int nnodes, ngroups, nlevels, nbufs, nargs, nscalars, nstores;
+  graph_node *nodes;
+  graph_group *groups;
+  int *sched;         // group indices ordered by level
+  int *level_start;   // level l is sched[level_start[l] .. level_start[l + 1])
+  int *zero_bufs;
+  int *buf_arg;       // argument index, or -1 for a temporary
+  int *buf_store;     // storage of a temporary, -1 if it is never used
+  size_t *buf_size;
+  int *arg_written;
+  double **store;
+  size_t temp_bytes;
+
+  // Replay state, guarded by `lock`.
+  pthread_mutex_t lock;
+  double **ptr;       // data of every buffer
+  double *scalars;
+} leanblas_graph;
+
+static lean_external_class *graph_class = NULL;
+static pthread_once_t graph_once = PTHREAD_ONCE_INIT;
+
+static void graph_free(leanblas_graph *g) {
+  if (g->store)
+    for (int s = 0; s < g->nstores; s++) free(g->store[s]);
+  free(g->store);
+  free(g->nodes);
+  free(g->groups);
+  free(g->sched);
+  free(g->level_start);
+  free(g->zero_bufs);
+  free(g->buf_arg);
+  free(g->buf_store);
+  free(g->buf_size);
+  free(g->arg_written);
+  free(g->ptr);
+  free(g->scalars);
+  pthread_mutex_destroy(&g->lock);
+  free(g);
+}
+
+static void graph_finalize(void *data) { graph_free((leanblas_graph *)data); }
+
+static void graph_foreach(void *data, b_lean_obj_arg f) {
+  (void)data;
+  (void)f;
+}
+
+static void graph_init(void) { graph_class = lean_register_external_class(graph_finalize, graph_foreach); }
+
+static lean_obj_res graph_error(const char *msg) {
+  return lean_io_result_mk_error(lean_mk_io_user_error(lean_mk_string(msg)));
+}
+
+static void *graph_alloc(size_t n, size_t size) {
+  void *p = calloc(n ? n : 1, size);
+  if (!p) lean_internal_panic_out_of_memory();
+  return p;
+}
+
+// ---------------------------------------------------------------------------
+// Compilation
+// ---------------------------------------------------------------------------
+
+static int node_writes(const graph_node *node, int i) { return (op_info[node->op].writes >> i) & 1; }
+
+// Whether `next` can join the elementwise group of nodes [first, first + count).
+// Nodes in a group run chunk by chunk, so any buffer written by one of them
+// must be accessed through the same view by all of them.
+static int can_fuse(const leanblas_graph *g, const graph_group *group, const graph_node *next) {
+  const graph_node *head = &g->nodes[group->first];
+  if (!op_info[head->op].elementwise || !op_info[next->op].elementwise || head->N != next->N) return 0;
+  for (int k = group->first; k < group->first + group->count; k++) {
+    const graph_node *node = &g->nodes[k];
+    for (int i = 0; i < op_info[node->op].operands; i++)
+      for (int j = 0; j < op_info[next->op].operands; j++) {
+        const graph_operand *a = &node->x[i], *b = &next->x[j];
+        if (a->buf != b->buf || !(node_writes(node, i) || node_writes(next, j))) continue;
+        if (a->off != b->off || a->ld != b->ld) return 0;
+      }
+  }
+  return 1;
+}
+
+// Resource of a buffer for the dependency analysis: arguments first, then
+// storage slots, since temporaries sharing a slot conflict with each other.
+static int buf_resource(const leanblas_graph *g, int buf) {
+  return g->buf_arg[buf] >= 0 ? g->buf_arg[buf] : g->nargs + g->buf_store[buf];
+}
+
+// Whether operand i of node k is a temporary whose lifetime starts in group
+// gi; the group zeroes it, which counts as a write.
+static int starts_here(const leanblas_graph *g, const int *first, int k, int i, int gi) {
+  const int b = g->nodes[k].x[i].buf;
+  return g->buf_arg[b] < 0 && first[b] == gi;
+}
+
+static void graph_plan(leanblas_graph *g) {
+  // 1. Fuse runs of elementwise nodes.
+  g->groups = (graph_group *)graph_alloc((size_t)g->nnodes, sizeof(graph_group));
+  for (int k = 0; k < g->nnodes; k++) {
+    if (g->ngroups > 0 && can_fuse(g, &g->groups[g->ngroups - 1], &g->nodes[k])) {
+      g->groups[g->ngroups - 1].count++;
+      continue;
+    }
+    g->groups[g->ngroups++] = (graph_group){.first = k, .count = 1};
+  }
+
+  // 2. Assign storage to temporaries by lifetime, in order of first use.
+  int *first = (int *)graph_alloc((size_t)g->nbufs, sizeof(int));
+  int *last = (int *)graph_alloc((size_t)g->nbufs, sizeof(int));
+  for (int b = 0; b < g->nbufs; b++) first[b] = -1;
+  for (int gi = 0; gi < g->ngroups; gi++)
+    for (int k = g->groups[gi].first; k < g->groups[gi].first + g->groups[gi].count; k++)
+      for (int i = 0; i < op_info[g->nodes[k].op].operands; i++) {
+        const int b = g->nodes[k].x[i].buf;
+        if (first[b] < 0) first[b] = gi;
+        last[b] = gi;
+      }
+  size_t *store_size = (size_t *)graph_alloc((size_t)g->nbufs, sizeof(size_t));
+  int *store_last = (int *)graph_alloc((size_t)g->nbufs, sizeof(int));
+  g->zero_bufs = (int *)graph_alloc((size_t)g->nbufs, sizeof(int));
+  int nzero = 0;
+  for (int gi = 0; gi < g->ngroups; gi++) {
+    g->groups[gi].zero_first = nzero;
+    for (int b = 0; b < g->nbufs; b++) {
+      if (g->buf_arg[b] >= 0 || first[b] != gi) continue;
+      // Smallest free slot that fits, else the largest free one (grown), else a new one.
+      int fit = -1, grow = -1;
+      for (int s = 0; s < g->nstores; s++) {
+        if (store_last[s] >= gi) continue;
+        if (store_size[s] >= g->buf_size[b]) {
+          if (fit < 0 || store_size[s] < store_size[fit]) fit = s;
+        } else if (grow < 0 || store_size[s] > store_size[grow]) {
+          grow = s;
+        }
+      }
+      const int best = fit >= 0 ? fit : grow >= 0 ? grow : g->nstores++;
+      if (store_size[best] < g->buf_size[b]) store_size[best] = g->buf_size[b];
+      store_last[best] = last[b];
+      g->buf_store[b] = best;
+      g->zero_bufs[nzero++] = b;
+    }
+    g->groups[gi].zero_count = nzero - g->groups[gi].zero_first;
+  }
+  g->store = (double **)graph_alloc((size_t)g->nstores, sizeof(double *));
+  for (int s = 0; s < g->nstores; s++) {
+    const size_t bytes = (store_size[s] * sizeof(double) + 63) & ~(size_t)63;
+    g->store[s] = (double *)aligned_alloc(64, bytes ? bytes : 64);
+    if (!g->store[s]) lean_internal_panic_out_of_memory();
+    g->temp_bytes += bytes;
+  }
+
+  // 3. Level the groups: a group runs after every earlier group that writes a
+  // resource it touches, and after every earlier reader of a resource it writes.
+  const int nres = g->nargs + g->nstores;
+  int *last_write = (int *)graph_alloc((size_t)nres, sizeof(int));
+  int *last_read = (int *)graph_alloc((size_t)nres, sizeof(int));
+  int *level = (int *)graph_alloc((size_t)g->ngroups, sizeof(int));
+  for (int r = 0; r < nres; r++) last_write[r] = last_read[r] = -1;
+  for (int gi = 0; gi < g->ngroups; gi++) {
+    const graph_group *group = &g->groups[gi];
+    int lv = 0;
+    for (int k = group->first; k < group->first + group->count; k++)
+      for (int i = 0; i < op_info[g->nodes[k].op].operands; i++) {
+        const int r = buf_resource(g, g->nodes[k].x[i].buf);
+        const int written = node_writes(&g->nodes[k], i) || starts_here(g, first, k, i, gi);
+        if (last_write[r] + 1 > lv) lv = last_write[r] + 1;
+        if (written && last_read[r] + 1 > lv) lv = last_read[r] + 1;
+      }
+    level[gi] = lv;
+    if (lv + 1 > g->nlevels) g->nlevels = lv + 1;
+    for (int k = group->first; k < group->first + group->count; k++)
+      for (int i = 0; i < op_info[g->nodes[k].op].operands; i++) {
+        const int r = buf_resource(g, g->nodes[k].x[i].buf);
+        if (node_writes(&g->nodes[k], i) || starts_here(g, first, k, i, gi)) last_write[r] = lv;
+        if (last_read[r] < lv) last_read[r] = lv;
+      }
+  }
+  g->level_start = (int *)graph_alloc((size_t)g->nlevels + 1, sizeof(int));
+  g->sched = (int *)graph_alloc((size_t)g->ngroups, sizeof(int));
+  for (int gi = 0; gi < g->ngroups; gi++) g->level_start[level[gi] + 1]++;
+  for (int l = 0; l < g->nlevels; l++) g->level_start[l + 1] += g->level_start[l];
+  int *fill = (int *)graph_alloc((size_t)g->nlevels, sizeof(int));
+  for (int gi = 0; gi < g->ngroups; gi++) g->sched[g->level_start[level[gi]] + fill[level[gi]]++] = gi;
+
+  free(fill);
+  free(level);
+  free(last_read);
+  free(last_write);
+  free(store_last);
+  free(store_size);
+  free(last);
+  free(first);
+}
+
+/** leanblas_graph_compile
+ *
+ * @param code GRAPH_NODE_WORDS words per node, see the top of this file
+ * @param consts alpha and beta of every node
+ * @param bufSizes size in elements of every buffer
+ * @param bufArgs argument index + 1 of every buffer, 0 for temporaries
+ * @param nscalars number of scalar result slots
+ *
+ * The Lean side has already checked that every access lies inside its buffer.
+ */
+LEAN_EXPORT lean_obj_res leanblas_graph_compile(b_lean_obj_arg code, b_lean_obj_arg consts,
+                                                b_lean_obj_arg bufSizes, b_lean_obj_arg bufArgs,
+                                                const size_t nscalars, lean_obj_arg w) {
+  pthread_once(&graph_once, graph_init);
+  const size_t words = lean_array_size(code);
+  const size_t nbufs = lean_array_size(bufSizes);
+  if (words % GRAPH_NODE_WORDS != 0 || lean_array_size(bufArgs) != nbufs ||
+      lean_sarray_size(consts) != 2 * (words / GRAPH_NODE_WORDS) || nbufs > INT32_MAX || nscalars > INT32_MAX)
+    return graph_error("LeanBLAS call graph: malformed recording");
+
+  leanblas_graph *g = (leanblas_graph *)graph_alloc(1, sizeof(leanblas_graph));
+  pthread_mutex_init(&g->lock, NULL);
+  g->nnodes = (int)(words / GRAPH_NODE_WORDS);
+  g->nbufs = (int)nbufs;
+  g->nscalars = (int)nscalars;
+  g->buf_arg = (int *)graph_alloc(nbufs, sizeof(int));
+  g->buf_store = (int *)graph_alloc(nbufs, sizeof(int));
+  g->buf_size = (size_t *)graph_alloc(nbufs, sizeof(size_t));
+  for (size_t b = 0; b < nbufs; b++) {
+    g->buf_size[b] = lean_unbox_usize(lean_array_get_core(bufSizes, b));
+    g->buf_arg[b] = (int)lean_unbox_usize(lean_array_get_core(bufArgs, b)) - 1;
+    g->buf_store[b] = -1;
+    if (g->buf_arg[b] >= g->nargs) g->nargs = g->buf_arg[b] + 1;
+  }
+  g->arg_written = (int *)graph_alloc((size_t)g->nargs, sizeof(int));
+  g->ptr = (double **)graph_alloc(nbufs, sizeof(double *));
+  g->scalars = (double *)graph_alloc(nscalars, sizeof(double));
+
+  g->nodes = (graph_node *)graph_alloc((size_t)g->nnodes, sizeof(graph_node));
+  const double *cs = (const double *)lean_float_array_cptr(consts);
+  for (int k = 0; k < g->nnodes; k++) {
+    size_t v[GRAPH_NODE_WORDS];
+    for (int i = 0; i < GRAPH_NODE_WORDS; i++)
+      v[i] = lean_unbox_usize(lean_array_get_core(code, (size_t)k * GRAPH_NODE_WORDS + i));
+    graph_node *node = &g->nodes[k];
+    if (v[0] >= GRAPH_NOPS || v[19] > nscalars) {
+      graph_free(g);
+      return graph_error("LeanBLAS call graph: malformed node");
+    }
+    *node = (graph_node){.op = (int)v[0], .order = (uint8_t)v[1], .side = (uint8_t)v[2], .uplo = (uint8_t)v[3],
+                         .transA = (uint8_t)v[4], .transB = (uint8_t)v[5], .diag = (uint8_t)v[6],
+                         .M = v[7], .N = v[8], .K = v[9], .alpha = cs[2 * k], .beta = cs[2 * k + 1],
+                         .scalar = (int)v[19] - 1};
+    for (int i = 0; i < 3; i++) {
+      node->x[i] = (graph_operand){.buf = (int)v[10 + 3 * i] - 1, .off = v[11 + 3 * i], .ld = v[12 + 3 * i]};
+      const int used = i < op_info[node->op].operands;
+      if (used != (node->x[i].buf >= 0) || node->x[i].buf >= g->nbufs) {
+        graph_free(g);
+        return graph_error("LeanBLAS call graph: malformed node operands");
+      }
+      if (used && g->buf_arg[node->x[i].buf] >= 0 && node_writes(node, i)) g->arg_written[g->buf_arg[node->x[i].buf]] = 1;
+    }
+  }
+
+  graph_plan(g);
+  return lean_io_result_mk_ok(lean_alloc_external(graph_class, g));
+}
+
+/** leanblas_graph_info
+ * @return #[nodes, groups after fusion, levels, temporary slots, temporary bytes].
+ */
+LEAN_EXPORT lean_obj_res leanblas_graph_info(b_lean_obj_arg graph) {
+  const leanblas_graph *g = (const leanblas_graph *)lean_get_external_data(graph);
+  const size_t info[5] = {(size_t)g->nnodes, (size_t)g->ngroups, (size_t)g->nlevels, (size_t)g->nstores,
+                          g->temp_bytes};
+  lean_obj_res arr = lean_mk_empty_array();
+  for (int i = 0; i < 5; i++) arr = lean_array_push(arr, lean_usize_to_nat(info[i]));
+  return arr;
+}
+
+// ---------------------------------------------------------------------------
+// Execution
+// ---------------------------------------------------------------------------
+
+static double *operand_ptr(const leanblas_graph *g, const graph_node *node, int i) {
+  return g->ptr[node->x[i].buf] + node->x[i].off;
+}
+
+// Elements [lo, lo + n) of an elementwise node.
+static void run_elementwise(const leanblas_graph *g, const graph_node *node, size_t lo, size_t n) {
+  const size_t incX = node->x[0].ld, incY = node->x[1].ld;
+  double *x = operand_ptr(g, node, 0) + lo * incX;
+  double *y = node->x[1].buf >= 0 ? operand_ptr(g, node, 1) + lo * incY : NULL;
+  leanblas_ew_kernels[node->op](n, node->alpha, node->beta, x, incX, y, incY);
+}
+
+static void run_node(leanblas_graph *g, const graph_node *node) {
+  if (op_info[node->op].elementwise) {
+    run_elementwise(g, node, 0, node->N);
+    return;
+  }
+  const CBLAS_ORDER order = leanblas_cblas_order(node->order);
+  const int M = (int)node->M, N = (int)node->N, K = (int)node->K;
+  const double a = node->alpha, b = node->beta;
+  double *p0 = operand_ptr(g, node, 0);
+  double *p1 = node->x[1].buf >= 0 ? operand_ptr(g, node, 1) : NULL;
+  double *p2 = node->x[2].buf >= 0 ? operand_ptr(g, node, 2) : NULL;
+  const int ld0 = (int)node->x[0].ld, ld1 = (int)node->x[1].ld, ld2 = (int)node->x[2].ld;
+  const int repro = leanblas_reproducible();
+  switch (node->op) {
+    case GRAPH_DOT:
+      g->scalars[node->scalar] = repro ? leanblas_repro_ddot(N, p0, ld0, p1, ld1) : cblas_ddot(N, p0, ld0, p1, ld1);
+      break;
+    case GRAPH_NRM2:
+      g->scalars[node->scalar] = repro ? leanblas_repro_dnrm2(N, p0, ld0) : cblas_dnrm2(N, p0, ld0);
+      break;
+    case GRAPH_ASUM:
+      g->scalars[node->scalar] = repro ? leanblas_repro_dasum(N, p0, ld0) : cblas_dasum(N, p0, ld0);
+      break;
+    case GRAPH_SUM:
+      if (repro) {
+        g->scalars[node->scalar] = leanblas_repro_dsum(N, p0, ld0);
+      } else {
+        double s = 0;
+        for (size_t i = 0; i < node->N; i++) s += p0[i * node->x[0].ld];
+        g->scalars[node->scalar] = s;
+      }
+      break;
+    case GRAPH_GEMV:
+      if (repro)
+        leanblas_repro_dgemv(order, leanblas_cblas_transpose(node->transA), M, N, a, p0, ld0, p1, ld1, b, p2, ld2);
+      else
+        cblas_dgemv(order, leanblas_cblas_transpose(node->transA), M, N, a, p0, ld0, p1, ld1, b, p2, ld2);
+      break;
+    case GRAPH_GER: cblas_dger(order, M, N, a, p0, ld0, p1, ld1, p2, ld2); break;
+    case GRAPH_TRMV:
+      cblas_dtrmv(order, leanblas_cblas_uplo(node->uplo), leanblas_cblas_transpose(node->transA),
+                  leanblas_cblas_diag(node->diag), N, p0, ld0, p1, ld1);
+      break;
+    case GRAPH_TRSV:
+      cblas_dtrsv(order, leanblas_cblas_uplo(node->uplo), leanblas_cblas_transpose(node->transA),
+                  leanblas_cblas_diag(node->diag), N, p0, ld0, p1, ld1);
+      break;
+    case GRAPH_GEMM:
+      if (repro)
+        leanblas_repro_dgemm(order, leanblas_cblas_transpose(node->transA), leanblas_cblas_transpose(node->transB), M,
+                             N, K, a, p0, ld0, p1, ld1, b, p2, ld2);
+      else
+        cblas_dgemm(order, leanblas_cblas_transpose(node->transA), leanblas_cblas_transpose(node->transB), M, N, K, a,
+                    p0, ld0, p1, ld1, b, p2, ld2);
+      break;
+    case GRAPH_SYMM:
+      cblas_dsymm(order, leanblas_cblas_side(node->side), leanblas_cblas_uplo(node->uplo), M, N, a, p0, ld0, p1, ld1,
+                  b, p2, ld2);
+      break;
+    case GRAPH_SYRK:
+      cblas_dsyrk(order, leanblas_cblas_uplo(node->uplo), leanblas_cblas_transpose(node->transA), N, K, a, p0, ld0, b,
+                  p1, ld1);
+      break;
+    case GRAPH_TRMM:
+      cblas_dtrmm(order, leanblas_cblas_side(node->side), leanblas_cblas_uplo(node->uplo),
+                  leanblas_cblas_transpose(node->transA), leanblas_cblas_diag(node->diag), M, N, a, p0, ld0, p1, ld1);
+      break;
+    case GRAPH_TRSM:
+      cblas_dtrsm(order, leanblas_cblas_side(node->side), leanblas_cblas_uplo(node->uplo),
+                  leanblas_cblas_transpose(node->transA), leanblas_cblas_diag(node->diag), M, N, a, p0, ld0, p1, ld1);
+      break;
+  }
+}
+
+static void run_group(leanblas_graph *g, const graph_group *group) {
+  for (int z = group->zero_first; z < group->zero_first + group->zero_count; z++) {
+    const int b = g->zero_bufs[z];
+    memset(g->ptr[b], 0, g->buf_size[b] * sizeof(double));
+  }
+  if (group->count == 1) {
+    run_node(g, &g->nodes[group->first]);
+    return;
+  }
+  const size_t n = g->nodes[group->first].N;
+  for (size_t lo = 0; lo < n; lo += GRAPH_CHUNK) {
+    const size_t cnt = n - lo < GRAPH_CHUNK ? n - lo : GRAPH_CHUNK;
+    for (int k = group->first; k < group->first + group->count; k++) run_elementwise(g, &g->nodes[k], lo, cnt);
+  }
+}
+
+typedef struct {
+  leanblas_graph *g;
+  int level;
+} graph_level_ctx;
+
+static void level_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const graph_level_ctx *c = (const graph_level_ctx *)ctx;
+  run_group(c->g, &c->g->groups[c->g->sched[c->g->level_start[c->level] + task]]);
+}
+
+static size_t float64_array_len(b_lean_obj_arg X) {
+  return lean_sarray_size(lean_is_sarray(X) ? X : lean_ctor_get(X, 0)) / sizeof(double);
+}
+
+/** leanblas_graph_replay
+ *
+ * @param args the argument arrays, in the order they were declared
+ * @return the arguments after the replay (written ones are copied first if
+ *         shared) and the scalar results
+ */
+LEAN_EXPORT lean_obj_res leanblas_graph_replay(b_lean_obj_arg graph, lean_obj_arg args, lean_obj_arg w) {
+  leanblas_graph *g = (leanblas_graph *)lean_get_external_data(graph);
+  if (lean_array_size(args) != (size_t)g->nargs) {
+    lean_dec(args);
+    return graph_error("LeanBLAS call graph: wrong number of arguments");
+  }
+  const int own = lean_is_exclusive(args);
+  lean_object *out = lean_alloc_array((size_t)g->nargs, (size_t)g->nargs);
+  for (int i = 0; i < g->nargs; i++) {
+    lean_object *X = lean_array_get_core(args, (size_t)i);
+    if (own) lean_array_set_core(args, (size_t)i, lean_box(0));
+    else lean_inc(X);
+    if (g->arg_written[i]) ensure_exclusive_byte_array(&X);
+    lean_array_set_core(out, (size_t)i, X);
+  }
+  lean_dec(args);
+  for (int b = 0; b < g->nbufs; b++)
+    if (g->buf_arg[b] >= 0 && float64_array_len(lean_array_get_core(out, (size_t)g->buf_arg[b])) < g->buf_size[b]) {
+      lean_dec(out);
+      return graph_error("LeanBLAS call graph: argument array smaller than recorded");
+    }
+
+  lean_object *scalars = lean_alloc_sarray(sizeof(double), (size_t)g->nscalars, (size_t)g->nscalars);
+  pthread_mutex_lock(&g->lock);
+  for (int b = 0; b < g->nbufs; b++)
+    g->ptr[b] = g->buf_arg[b] >= 0 ? lean_float64_array_cptr(lean_array_get_core(out, (size_t)g->buf_arg[b]))
+                : g->buf_store[b] >= 0 ? g->store[g->buf_store[b]]
+                                       : NULL;
+  for (int l = 0; l < g->nlevels; l++) {
+    const int ngroups = g->level_start[l + 1] - g->level_start[l];
+    graph_level_ctx ctx = {g, l};
+    if (ngroups == 1) level_task(&ctx, 0, 1);
+    else leanblas_parallel_for(ngroups, level_task, &ctx);
+  }
+  if (g->nscalars > 0) memcpy(lean_float_array_cptr(scalars), g->scalars, (size_t)g->nscalars * sizeof(double));
+  pthread_mutex_unlock(&g->lock);
+
+  lean_object *pair = lean_alloc_ctor(0, 2, 0);
+  lean_ctor_set(pair, 0, out);
+  lean_ctor_set(pair, 1, scalars);
+  return lean_io_result_mk_ok(pair);
+}
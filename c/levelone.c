@@ -1,7 +1,9 @@
 #include <lean/lean.h>
-#include <cblas.h>
+#include "cblas_compat.h"
 #include <math.h>
 #include "util.h"
+#include "trace.h"
+#include "reproducible.h"
 
 
 
@@ -22,9 +24,19 @@
 LEAN_EXPORT double leanblas_cblas_ddot(const size_t N,
                                  const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                  const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   return cblas_ddot((int)N, lean_float64_array_cptr(X) + offX, (int)incX, lean_float64_array_cptr(Y) + offY, (int)incY);
 }
 
+/** Bitwise-reproducible `ddot`, see `reproducible.h`. */
+LEAN_EXPORT double leanblas_reproducible_ddot(const size_t N,
+                                              const b_lean_obj_arg X, const size_t offX, const size_t incX,
+                                              const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE_NAMED("repro_ddot", N, incX, incY);
+  return leanblas_repro_ddot((ptrdiff_t)N, lean_float64_array_cptr(X) + offX, (ptrdiff_t)incX,
+                             lean_float64_array_cptr(Y) + offY, (ptrdiff_t)incY);
+}
+
 
 
 /** zdot
@@ -44,12 +56,13 @@ LEAN_EXPORT double leanblas_cblas_ddot(const size_t N,
 LEAN_EXPORT lean_obj_res leanblas_cblas_zdot(const size_t N,
                                        const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                        const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
 
   double r[2];
   cblas_zdotc_sub((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX,
                           (void *)(lean_complex_float64_array_cptr(Y) + 2*offY), (int)incY, r);
 
-  lean_obj_res lean_res = lean_alloc_ctor(0, 0, 2*sizeof(double));
+  lean_obj_res lean_res = leanblas_alloc_ctor(0, 0, 2*sizeof(double));
   lean_ctor_set_float(lean_res, 0*sizeof(double), r[0]);
   lean_ctor_set_float(lean_res, 1*sizeof(double), r[1]);
   return lean_res;
@@ -59,11 +72,12 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zdot(const size_t N,
 LEAN_EXPORT lean_obj_res leanblas_cblas_zdotc(const size_t N,
                                       const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                       const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   double r[2];
   cblas_zdotc_sub((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX,
                           (void *)(lean_complex_float64_array_cptr(Y) + 2*offY), (int)incY, r);
 
-  lean_obj_res lean_res = lean_alloc_ctor(0, 0, 2*sizeof(double));
+  lean_obj_res lean_res = leanblas_alloc_ctor(0, 0, 2*sizeof(double));
   lean_ctor_set_float(lean_res, 0*sizeof(double), r[0]);
   lean_ctor_set_float(lean_res, 1*sizeof(double), r[1]);
   return lean_res;
@@ -72,35 +86,40 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zdotc(const size_t N,
 LEAN_EXPORT lean_obj_res leanblas_cblas_zdotu(const size_t N,
                                       const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                       const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   double r[2];
   cblas_zdotu_sub((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX,
                           (void *)(lean_complex_float64_array_cptr(Y) + 2*offY), (int)incY, r);
 
-  lean_obj_res lean_res = lean_alloc_ctor(0, 0, 2*sizeof(double));
+  lean_obj_res lean_res = leanblas_alloc_ctor(0, 0, 2*sizeof(double));
   lean_ctor_set_float(lean_res, 0*sizeof(double), r[0]);
   lean_ctor_set_float(lean_res, 1*sizeof(double), r[1]);
   return lean_res;
 }
 
 LEAN_EXPORT double leanblas_cblas_dznrm2(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_dznrm2((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX);
 }
 
 LEAN_EXPORT double leanblas_cblas_dzasum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_dzasum((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX);
 }
 
 LEAN_EXPORT size_t leanblas_cblas_izamax(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_izamax((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX);
 }
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_zswap(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&X);
   ensure_exclusive_byte_array(&Y);
   cblas_zswap((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX,
                       (void *)(lean_complex_float64_array_cptr(Y) + 2*offY), (int)incY);
-  lean_obj_res result = lean_alloc_ctor(0, 2, 0);
+  lean_obj_res result = leanblas_alloc_ctor(0, 2, 0);
   lean_ctor_set(result, 0, X);
   lean_ctor_set(result, 1, Y);
   return result;
@@ -108,15 +127,26 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zswap(const size_t N, lean_obj_arg X, co
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_zcopy(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   cblas_zcopy((int)N, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX,
                       (void *)(lean_complex_float64_array_cptr(Y) + 2*offY), (int)incY);
   return Y;
 }
 
+LEAN_EXPORT lean_obj_res leanblas_cblas_zcopy_within(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
+                                                     const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
+  ensure_exclusive_byte_array(&X);
+  double *xptr = lean_complex_float64_array_cptr(X);
+  cblas_zcopy((int)N, (void *)(xptr + 2*offX), (int)incX, (void *)(xptr + 2*offY), (int)incY);
+  return X;
+}
+
 LEAN_EXPORT lean_obj_res leanblas_cblas_zaxpy(const size_t N, const b_lean_obj_arg alpha, 
                                               const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   double alpha_arr[2];
   leanblas_complexfloat_parts(alpha, &alpha_arr[0], &alpha_arr[1]);
@@ -128,6 +158,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zaxpy(const size_t N, const b_lean_obj_a
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_zscal(const size_t N, const b_lean_obj_arg alpha, 
                                               lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double alpha_arr[2];
   leanblas_complexfloat_parts(alpha, &alpha_arr[0], &alpha_arr[1]);
@@ -138,6 +169,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zscal(const size_t N, const b_lean_obj_a
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_zdscal(const size_t N, const double alpha, 
                                                lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   cblas_zdscal((int)N, alpha, (void *)(lean_complex_float64_array_cptr(X) + 2*offX), (int)incX);
   return X;
@@ -158,9 +190,17 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zdscal(const size_t N, const double alph
  * @return Euclidean norm of X
  */
 LEAN_EXPORT double leanblas_cblas_dnrm2(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_dnrm2((int)N, lean_float64_array_cptr(X) + offX, (int)incX);
 }
 
+/** Bitwise-reproducible `dnrm2`, see `reproducible.h`. */
+LEAN_EXPORT double leanblas_reproducible_dnrm2(const size_t N, const b_lean_obj_arg X, const size_t offX,
+                                               const size_t incX){
+  LEANBLAS_TRACE_NAMED("repro_dnrm2", N, incX);
+  return leanblas_repro_dnrm2((ptrdiff_t)N, lean_float64_array_cptr(X) + offX, (ptrdiff_t)incX);
+}
+
 
 /** dasum
  *
@@ -174,9 +214,17 @@ LEAN_EXPORT double leanblas_cblas_dnrm2(const size_t N, const b_lean_obj_arg X,
  * @return Sum of the absolute values of the elements of X
  */
 LEAN_EXPORT double leanblas_cblas_dasum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_dasum((int)N, lean_float64_array_cptr(X) + offX, (int)incX);
 }
 
+/** Bitwise-reproducible `dasum`, see `reproducible.h`. */
+LEAN_EXPORT double leanblas_reproducible_dasum(const size_t N, const b_lean_obj_arg X, const size_t offX,
+                                               const size_t incX){
+  LEANBLAS_TRACE_NAMED("repro_dasum", N, incX);
+  return leanblas_repro_dasum((ptrdiff_t)N, lean_float64_array_cptr(X) + offX, (ptrdiff_t)incX);
+}
+
 /** idamax
  *
  * Finds the index of the first element with maximum absolute value.
@@ -189,6 +237,7 @@ LEAN_EXPORT double leanblas_cblas_dasum(const size_t N, const b_lean_obj_arg X,
  * @return Index of the first element with maximum absolute value
  */
 LEAN_EXPORT size_t leanblas_cblas_idamax(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_idamax((int)N, lean_float64_array_cptr(X) + offX, (int)incX);
 }
 
@@ -209,11 +258,12 @@ LEAN_EXPORT size_t leanblas_cblas_idamax(const size_t N, const b_lean_obj_arg X,
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_dswap(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                 lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&X);
   ensure_exclusive_byte_array(&Y);
   cblas_dswap((int)N, lean_float64_array_cptr(X) + offX, (int)incX, lean_float64_array_cptr(Y) + offY, (int)incY);
 
-  lean_obj_res res = lean_alloc_ctor(0, 2, 0);
+  lean_obj_res res = leanblas_alloc_ctor(0, 2, 0);
   lean_ctor_set(res, 0, X);
   lean_ctor_set(res, 1, Y);
   return res;
@@ -236,6 +286,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dswap(const size_t N, lean_obj_arg X, co
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_dcopy(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   cblas_dcopy((int)N, lean_float64_array_cptr(X) + offX, (int)incX, lean_float64_array_cptr(Y) + offY, (int)incY);
   return Y;
@@ -258,6 +309,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dcopy(const size_t N, const b_lean_obj_a
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_daxpy(const size_t N, const double alpha, const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   cblas_daxpy((int)N, alpha, lean_float64_array_cptr(X) + offX, (int)incX, lean_float64_array_cptr(Y) + offY, (int)incY);
   return Y;
@@ -277,10 +329,11 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_daxpy(const size_t N, const double alpha
   * @return a, b, c, and s with the Givens plane rotation constructed
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_drotg(double a, double b){
+  LEANBLAS_TRACE();
   double c, s;
   cblas_drotg(&a, &b, &c, &s);
 
-  lean_obj_res res = lean_alloc_ctor(0, 4, 0);
+  lean_obj_res res = leanblas_alloc_ctor(0, 4, 0);
   lean_ctor_set(res, 0, lean_box(a));
   lean_ctor_set(res, 1, lean_box(b));
   lean_ctor_set(res, 2, lean_box(c));
@@ -302,13 +355,14 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_drotg(double a, double b){
   * @return d1, d2, x1, y1, and param with the modified Givens plane rotation constructed
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_drotmg(const double d1, const double d2, const double x1, const double y1){
+  LEANBLAS_TRACE();
   double d1_out, d2_out, x1_out, y1_out;
   double param[5];
   cblas_drotmg(&d1_out, &d2_out, &x1_out, y1_out, param);
 
   printf("fix implementation of drotmg\n");
 
-  lean_obj_res res = lean_alloc_ctor(0, 5, 0);
+  lean_obj_res res = leanblas_alloc_ctor(0, 5, 0);
   lean_ctor_set(res, 0, lean_box(d1_out));
   lean_ctor_set(res, 1, lean_box(d2_out));
   lean_ctor_set(res, 2, lean_box(x1_out));
@@ -336,11 +390,12 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_drotmg(const double d1, const double d2,
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_drot(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                lean_obj_arg Y, const size_t offY, const size_t incY, const double c, const double s){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&X);
   ensure_exclusive_byte_array(&Y);
   cblas_drot((int)N, lean_float64_array_cptr(X) + offX, (int)incX, lean_float64_array_cptr(Y) + offY, (int)incY, c, s);
  
-  lean_obj_res res = lean_alloc_ctor(0, 2, 0);
+  lean_obj_res res = leanblas_alloc_ctor(0, 2, 0);
   lean_ctor_set(res, 0, X);
   lean_ctor_set(res, 1, Y);
   return res;
@@ -360,6 +415,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_drot(const size_t N, lean_obj_arg X, con
   * @return X with the elements scaled by alpha
   */
 LEAN_EXPORT lean_obj_res leanblas_cblas_dscal(const size_t N, const double alpha, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   cblas_dscal((int)N, alpha, lean_float64_array_cptr(X) + offX, (int)incX);
   return X;
@@ -392,9 +448,10 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dscal(const size_t N, const double alpha
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dconst(const size_t N, const double a){
+  LEANBLAS_TRACE(N);
 
   size_t s = sizeof(double)/sizeof(char);
-  lean_obj_res arr = lean_alloc_sarray(sizeof(char), s*N, s*N);
+  lean_obj_res arr = leanblas_alloc_sarray(sizeof(char), s*N, s*N);
   double * ptr = lean_float64_array_cptr(arr);
 
   for (size_t i = 0; i < N; i++){
@@ -405,18 +462,27 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dconst(const size_t N, const double a){
 }
 
 
-LEAN_EXPORT lean_obj_res leanblas_cblas_dsum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
-  double sum = 0;
+LEAN_EXPORT double leanblas_cblas_dsum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   double * xptr = lean_float64_array_cptr(X);
+  double sum = 0;
   for (size_t i = 0; i < N; i++){
     sum += xptr[offX + i*incX];
   }
-  return lean_box(sum);
+  return sum;
+}
+
+/** Bitwise-reproducible `dsum`, see `reproducible.h`. */
+LEAN_EXPORT double leanblas_reproducible_dsum(const size_t N, const b_lean_obj_arg X, const size_t offX,
+                                              const size_t incX){
+  LEANBLAS_TRACE_NAMED("repro_dsum", N, incX);
+  return leanblas_repro_dsum((ptrdiff_t)N, lean_float64_array_cptr(X) + offX, (ptrdiff_t)incX);
 }
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_daxpby(const size_t N, const double alpha, lean_obj_arg X, const size_t offX, const size_t incX,
                                                                const double beta,  lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   // modify `X` in place only iff we are supposed to modify *all* elements of `Y`
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
       lean_sarray_size(X)*sizeof(double) == N && offX == 0 && incX == 1 &&
@@ -443,6 +509,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_daxpby(const size_t N, const double alph
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dscaladd(const size_t N, const double alpha, lean_obj_arg X, const size_t offX, const size_t incX,
                                                                   const double beta){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -451,8 +518,19 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dscaladd(const size_t N, const double al
   return X;
 }
 
+/** dcopy_within - X[offY + i*incY] := X[offX + i*incX] for views of X that do not overlap (non-standard) */
+LEAN_EXPORT lean_obj_res leanblas_cblas_dcopy_within(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
+                                                     const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
+  ensure_exclusive_byte_array(&X);
+  double * xptr = lean_float64_array_cptr(X);
+  cblas_dcopy((int)N, xptr + offX, (int)incX, xptr + offY, (int)incY);
+  return X;
+}
+
 
 LEAN_EXPORT size_t leanblas_cblas_dimax_re(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   double * xptr = lean_float64_array_cptr(X);
   double max = xptr[offX];
   size_t max_index = 0;
@@ -467,6 +545,7 @@ LEAN_EXPORT size_t leanblas_cblas_dimax_re(const size_t N, const b_lean_obj_arg
 
 
 LEAN_EXPORT size_t leanblas_cblas_dimin_re(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   double * xptr = lean_float64_array_cptr(X);
   double min = xptr[offX];
   size_t min_index = 0;
@@ -483,6 +562,7 @@ LEAN_EXPORT size_t leanblas_cblas_dimin_re(const size_t N, const b_lean_obj_arg
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dmul(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                              lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
 
   // modify `X` in place only iff we are supposed to modify *all* elements of `Y`
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
@@ -510,6 +590,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dmul(const size_t N, lean_obj_arg X, con
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_ddiv(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                              lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   // modify `X` in place only iff we are supposed to modify *all* elements of `Y`
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
       lean_sarray_size(X)*sizeof(double) == N && offX == 0 && incX == 1 &&
@@ -535,6 +616,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ddiv(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dinv(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -545,6 +627,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dinv(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dabs(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -555,6 +638,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dabs(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dsqrt(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -565,6 +649,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsqrt(const size_t N, lean_obj_arg X, co
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dexp(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -575,6 +660,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dexp(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dlog(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -585,6 +671,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dlog(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dsin(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -595,6 +682,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsin(const size_t N, lean_obj_arg X, con
 
 
 LEAN_EXPORT lean_obj_res leanblas_cblas_dcos(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   double * xptr = lean_float64_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -620,33 +708,38 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dcos(const size_t N, lean_obj_arg X, con
 LEAN_EXPORT double leanblas_cblas_sdot(const size_t N,
                                  const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                  const b_lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   return (double)cblas_sdot((int)N, lean_float32_array_cptr(X) + offX, (int)incX,
                                     lean_float32_array_cptr(Y) + offY, (int)incY);
 }
 
 /** snrm2 - Single precision Euclidean norm */
 LEAN_EXPORT double leanblas_cblas_snrm2(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return (double)cblas_snrm2((int)N, lean_float32_array_cptr(X) + offX, (int)incX);
 }
 
 /** sasum - Single precision sum of absolute values */
 LEAN_EXPORT double leanblas_cblas_sasum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return (double)cblas_sasum((int)N, lean_float32_array_cptr(X) + offX, (int)incX);
 }
 
 /** isamax - Index of max absolute value (single precision) */
 LEAN_EXPORT size_t leanblas_cblas_isamax(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   return cblas_isamax((int)N, lean_float32_array_cptr(X) + offX, (int)incX);
 }
 
 /** sswap - Swap two single precision vectors */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sswap(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&X);
   ensure_exclusive_byte_array(&Y);
   cblas_sswap((int)N, lean_float32_array_cptr(X) + offX, (int)incX,
                       lean_float32_array_cptr(Y) + offY, (int)incY);
-  lean_obj_res result = lean_alloc_ctor(0, 2, 0);
+  lean_obj_res result = leanblas_alloc_ctor(0, 2, 0);
   lean_ctor_set(result, 0, X);
   lean_ctor_set(result, 1, Y);
   return result;
@@ -655,6 +748,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sswap(const size_t N, lean_obj_arg X, co
 /** scopy - Copy single precision vector */
 LEAN_EXPORT lean_obj_res leanblas_cblas_scopy(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   cblas_scopy((int)N, lean_float32_array_cptr(X) + offX, (int)incX,
                       lean_float32_array_cptr(Y) + offY, (int)incY);
@@ -665,6 +759,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_scopy(const size_t N, const b_lean_obj_a
 LEAN_EXPORT lean_obj_res leanblas_cblas_saxpy(const size_t N, const double alpha,
                                               const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                               lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Y);
   cblas_saxpy((int)N, (float)alpha, lean_float32_array_cptr(X) + offX, (int)incX,
                                     lean_float32_array_cptr(Y) + offY, (int)incY);
@@ -674,6 +769,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_saxpy(const size_t N, const double alpha
 /** sscal - Single precision: X := alpha*X */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sscal(const size_t N, const double alpha,
                                               lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   cblas_sscal((int)N, (float)alpha, lean_float32_array_cptr(X) + offX, (int)incX);
   return X;
@@ -681,9 +777,10 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sscal(const size_t N, const double alpha
 
 /** srotg - Construct Givens rotation (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_srotg(double a, double b){
+  LEANBLAS_TRACE();
   float fa = (float)a, fb = (float)b, fc, fs;
   cblas_srotg(&fa, &fb, &fc, &fs);
-  lean_obj_res result = lean_alloc_ctor(0, 0, 4*sizeof(double));
+  lean_obj_res result = leanblas_alloc_ctor(0, 0, 4*sizeof(double));
   lean_ctor_set_float(result, 0*sizeof(double), (double)fa);
   lean_ctor_set_float(result, 1*sizeof(double), (double)fb);
   lean_ctor_set_float(result, 2*sizeof(double), (double)fc);
@@ -695,11 +792,12 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_srotg(double a, double b){
 LEAN_EXPORT lean_obj_res leanblas_cblas_srot(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                               lean_obj_arg Y, const size_t offY, const size_t incY,
                                                               const double c, const double s){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&X);
   ensure_exclusive_byte_array(&Y);
   cblas_srot((int)N, lean_float32_array_cptr(X) + offX, (int)incX,
                      lean_float32_array_cptr(Y) + offY, (int)incY, (float)c, (float)s);
-  lean_obj_res result = lean_alloc_ctor(0, 2, 0);
+  lean_obj_res result = leanblas_alloc_ctor(0, 2, 0);
   lean_ctor_set(result, 0, X);
   lean_ctor_set(result, 1, Y);
   return result;
@@ -707,8 +805,9 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_srot(const size_t N, lean_obj_arg X, con
 
 /** sconst - Create constant single precision vector (non-standard) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sconst(const size_t N, const double alpha){
+  LEANBLAS_TRACE(N);
   size_t byte_size = N * 4;
-  lean_obj_res arr = lean_alloc_sarray(1, byte_size, byte_size);
+  lean_obj_res arr = leanblas_alloc_sarray(1, byte_size, byte_size);
   float* ptr = (float*)lean_sarray_cptr(arr);
   float val = (float)alpha;
   for (size_t i = 0; i < N; i++) {
@@ -719,6 +818,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sconst(const size_t N, const double alph
 
 /** ssum - Sum of elements (single precision, non-standard) */
 LEAN_EXPORT double leanblas_cblas_ssum(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   const float* ptr = lean_float32_array_cptr(X) + offX;
   double sum = 0.0;
   for (size_t i = 0; i < N; i++) {
@@ -729,11 +829,12 @@ LEAN_EXPORT double leanblas_cblas_ssum(const size_t N, const b_lean_obj_arg X, c
 
 /** srotmg - Construct modified Givens rotation (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_srotmg(const double d1, const double d2, const double x1, const double y1){
+  LEANBLAS_TRACE();
   float fd1 = (float)d1, fd2 = (float)d2, fx1 = (float)x1;
   float param[5];
   cblas_srotmg(&fd1, &fd2, &fx1, (float)y1, param);
 
-  lean_obj_res res = lean_alloc_ctor(0, 0, 5*sizeof(double));
+  lean_obj_res res = leanblas_alloc_ctor(0, 0, 5*sizeof(double));
   lean_ctor_set_float(res, 0*sizeof(double), (double)fd1);
   lean_ctor_set_float(res, 1*sizeof(double), (double)fd2);
   lean_ctor_set_float(res, 2*sizeof(double), (double)fx1);
@@ -745,6 +846,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_srotmg(const double d1, const double d2,
 /** saxpby - Single precision: Y := alpha*X + beta*Y (non-standard) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_saxpby(const size_t N, const double alpha, lean_obj_arg X, const size_t offX, const size_t incX,
                                                                const double beta,  lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
       lean_sarray_size(X)/4 == N && offX == 0 && incX == 1 &&
       lean_sarray_size(Y)/4 == N && offY == 0 && incY == 1){
@@ -766,6 +868,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_saxpby(const size_t N, const double alph
 /** sscaladd - Single precision: X := alpha*X + beta (non-standard) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sscaladd(const size_t N, const double alpha, lean_obj_arg X, const size_t offX, const size_t incX,
                                                                   const double beta){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   float a = (float)alpha, b = (float)beta;
@@ -775,8 +878,19 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sscaladd(const size_t N, const double al
   return X;
 }
 
+/** scopy_within - Single precision: X[offY + i*incY] := X[offX + i*incX] for views that do not overlap (non-standard) */
+LEAN_EXPORT lean_obj_res leanblas_cblas_scopy_within(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
+                                                     const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
+  ensure_exclusive_byte_array(&X);
+  float* xptr = lean_float32_array_cptr(X);
+  cblas_scopy((int)N, xptr + offX, (int)incX, xptr + offY, (int)incY);
+  return X;
+}
+
 /** simax_re - Index of max value (single precision) */
 LEAN_EXPORT size_t leanblas_cblas_simax_re(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   const float* xptr = lean_float32_array_cptr(X);
   float max = xptr[offX];
   size_t max_index = 0;
@@ -791,6 +905,7 @@ LEAN_EXPORT size_t leanblas_cblas_simax_re(const size_t N, const b_lean_obj_arg
 
 /** simin_re - Index of min value (single precision) */
 LEAN_EXPORT size_t leanblas_cblas_simin_re(const size_t N, const b_lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   const float* xptr = lean_float32_array_cptr(X);
   float min = xptr[offX];
   size_t min_index = 0;
@@ -806,6 +921,7 @@ LEAN_EXPORT size_t leanblas_cblas_simin_re(const size_t N, const b_lean_obj_arg
 /** smul - Element-wise multiply (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_smul(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                              lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
       lean_sarray_size(X)/4 == N && offX == 0 && incX == 1 &&
       lean_sarray_size(Y)/4 == N && offY == 0 && incY == 1){
@@ -831,6 +947,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_smul(const size_t N, lean_obj_arg X, con
 /** sdiv - Element-wise divide (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sdiv(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX,
                                                              lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, incX, incY);
   if (lean_is_exclusive(X) && !lean_is_exclusive(Y) &&
       lean_sarray_size(X)/4 == N && offX == 0 && incX == 1 &&
       lean_sarray_size(Y)/4 == N && offY == 0 && incY == 1){
@@ -855,6 +972,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sdiv(const size_t N, lean_obj_arg X, con
 
 /** sinv - Element-wise inverse (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sinv(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -865,6 +983,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sinv(const size_t N, lean_obj_arg X, con
 
 /** sabs - Element-wise absolute value (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sabs(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -875,6 +994,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sabs(const size_t N, lean_obj_arg X, con
 
 /** ssqrt - Element-wise square root (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_ssqrt(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -885,6 +1005,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssqrt(const size_t N, lean_obj_arg X, co
 
 /** sexp - Element-wise exponential (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_sexp(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -895,6 +1016,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sexp(const size_t N, lean_obj_arg X, con
 
 /** slog - Element-wise natural log (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_slog(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -905,6 +1027,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_slog(const size_t N, lean_obj_arg X, con
 
 /** ssin - Element-wise sine (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_ssin(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -915,6 +1038,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssin(const size_t N, lean_obj_arg X, con
 
 /** scos - Element-wise cosine (single precision) */
 LEAN_EXPORT lean_obj_res leanblas_cblas_scos(const size_t N, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
   float* xptr = lean_float32_array_cptr(X);
   for (size_t i = 0; i < N; i++){
@@ -1,5 +1,7 @@
 #include "util.h"
-#include <cblas.h>
+#include "trace.h"
+#include "reproducible.h"
+#include "cblas_compat.h"
 #include <complex.h>
 #include <lean/lean.h>
 
@@ -34,6 +36,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgemm(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const double beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_dgemm(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -45,6 +48,25 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgemm(
     return C;
 }
 
+/** Bitwise-reproducible `dgemm`, see `reproducible.h`. */
+LEAN_EXPORT lean_obj_res leanblas_reproducible_dgemm(
+    const uint8_t order, const uint8_t transA, const uint8_t transB,
+    const size_t M, const size_t N, const size_t K, const double alpha,
+    const b_lean_obj_arg A, const size_t offA, const size_t lda,
+    const b_lean_obj_arg B, const size_t offB, const size_t ldb,
+    const double beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE_NAMED("repro_dgemm", M, N, K, lda, ldb, ldc);
+    ensure_exclusive_byte_array(&C);
+
+    leanblas_repro_dgemm(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
+                         leanblas_cblas_transpose(transB), (int)M, (int)N, (int)K, alpha,
+                         lean_float64_array_cptr(A) + offA, (int)lda,
+                         lean_float64_array_cptr(B) + offB, (int)ldb, beta,
+                         lean_float64_array_cptr(C) + offC, (int)ldc);
+
+    return C;
+}
+
 /** dsymm
  *
  * Computes a matrix-matrix product where one matrix is symmetric.
@@ -75,6 +97,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsymm(
     const size_t offA, const size_t lda, const b_lean_obj_arg B,
     const size_t offB, const size_t ldb, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_dsymm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -112,6 +135,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsyrk(
     const size_t N, const size_t K, const double alpha, const b_lean_obj_arg A,
     const size_t offA, const size_t lda, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_dsyrk(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -153,6 +177,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsyr2k(
     const size_t offA, const size_t lda, const b_lean_obj_arg B,
     const size_t offB, const size_t ldb, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_dsyr2k(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -191,6 +216,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtrmm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const double alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     cblas_dtrmm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -229,6 +255,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtrsm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const double alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     cblas_dtrsm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -271,6 +298,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zgemm(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const lean_obj_arg beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -300,6 +328,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zsymm(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const lean_obj_arg beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -329,6 +358,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zhemm(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const lean_obj_arg beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -357,6 +387,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zsyrk(
     const size_t N, const size_t K, const lean_obj_arg alpha,
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const lean_obj_arg beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -385,6 +416,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zherk(
     const size_t N, const size_t K, const double alpha,
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const double beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_zherk(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -406,6 +438,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zsyr2k(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const lean_obj_arg beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -436,6 +469,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zher2k(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const double beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     double alpha_real, alpha_imag;
@@ -461,6 +495,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ztrmm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const lean_obj_arg alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     double alpha_real, alpha_imag;
@@ -486,6 +521,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ztrsm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const lean_obj_arg alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     double alpha_real, alpha_imag;
@@ -517,6 +553,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sgemm(
     const b_lean_obj_arg A, const size_t offA, const size_t lda,
     const b_lean_obj_arg B, const size_t offB, const size_t ldb,
     const double beta, lean_obj_arg C, const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_sgemm(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -539,6 +576,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssymm(
     const size_t offA, const size_t lda, const b_lean_obj_arg B,
     const size_t offB, const size_t ldb, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(M, N, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_ssymm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -560,6 +598,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssyrk(
     const size_t N, const size_t K, const double alpha, const b_lean_obj_arg A,
     const size_t offA, const size_t lda, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_ssyrk(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -581,6 +620,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssyr2k(
     const size_t offA, const size_t lda, const b_lean_obj_arg B,
     const size_t offB, const size_t ldb, const double beta, lean_obj_arg C,
     const size_t offC, const size_t ldc) {
+    LEANBLAS_TRACE(N, K, lda, ldb, ldc);
     ensure_exclusive_byte_array(&C);
 
     cblas_ssyr2k(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -602,6 +642,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_strmm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const double alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     cblas_strmm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -623,6 +664,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_strsm(
     const uint8_t transA, const uint8_t diag, const size_t M, const size_t N,
     const double alpha, const b_lean_obj_arg A, const size_t offA,
     const size_t lda, lean_obj_arg B, const size_t offB, const size_t ldb) {
+    LEANBLAS_TRACE(M, N, lda, ldb);
     ensure_exclusive_byte_array(&B);
 
     cblas_strsm(leanblas_cblas_order(order), leanblas_cblas_side(side),
@@ -1,7 +1,9 @@
 #include <lean/lean.h>
-#include <cblas.h>
+#include "cblas_compat.h"
 #include <complex.h>
 #include "util.h"
+#include "trace.h"
+#include "reproducible.h"
 
 
 /** dgemv
@@ -31,6 +33,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgemv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const double beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(M, N, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   cblas_dgemv(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -40,6 +43,22 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgemv(const uint8_t order, const uint8_t
   return Y;
 }
 
+/** Bitwise-reproducible `dgemv`, see `reproducible.h`. */
+LEAN_EXPORT lean_obj_res leanblas_reproducible_dgemv(const uint8_t order, const uint8_t transA,
+                                const size_t M, const size_t N, const double alpha,
+                                const b_lean_obj_arg A, const size_t offA, const size_t lda,
+                                const b_lean_obj_arg X, const size_t offX, const size_t incX,
+                                const double beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE_NAMED("repro_dgemv", M, N, lda, incX, incY);
+  ensure_exclusive_byte_array(&Y);
+
+  leanblas_repro_dgemv(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
+                       (int)M, (int)N, alpha, lean_float64_array_cptr(A) + offA, (int)lda,
+                       lean_float64_array_cptr(X) + offX, (int)incX, beta, lean_float64_array_cptr(Y) + offY, (int)incY);
+
+  return Y;
+}
+
 
 
 /** dgbmv
@@ -71,6 +90,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgbmv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const double beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(M, N, KL, KU, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   cblas_dgbmv(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -103,6 +123,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgbmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtrmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtrmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -134,6 +155,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtrmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtbmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const size_t K, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, K, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtbmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -162,6 +184,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtbmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtpmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                               const size_t N, const b_lean_obj_arg A, const size_t offA, lean_obj_arg X, const size_t offX,
                                               const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtpmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -192,6 +215,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtpmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtrsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtrsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -223,6 +247,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtrsv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtbsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const size_t K, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, K, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtbsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -250,6 +275,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dtbsv(const uint8_t order, const uint8_t
  */
 LEAN_EXPORT lean_obj_res leanblas_cblas_dtpsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_dtpsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -283,6 +309,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dger(const uint8_t order, const size_t M
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(M, N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_dger(leanblas_cblas_order(order), (int)M, (int)N, alpha,
@@ -320,6 +347,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zgemv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const lean_obj_arg beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(M, N, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -366,6 +394,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zhemv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const lean_obj_arg beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(N, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   double alpha_real, alpha_imag, beta_real, beta_imag;
@@ -408,6 +437,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ztrmv(const uint8_t order, const uint8_t
                                 const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_ztrmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -441,6 +471,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ztrsv(const uint8_t order, const uint8_t
                                 const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_ztrsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -477,6 +508,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zgerc(const uint8_t order, const size_t
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(M, N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   double alpha_real, alpha_imag;
@@ -517,6 +549,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zgeru(const uint8_t order, const size_t
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(M, N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   double alpha_real, alpha_imag;
@@ -553,6 +586,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zher(const uint8_t order, const uint8_t
                                 const size_t N, const double alpha,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_zher(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -589,6 +623,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_zher2(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   double alpha_real, alpha_imag;
@@ -626,6 +661,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsyr(const uint8_t order, const uint8_t
                               const size_t N, const double alpha,
                               const b_lean_obj_arg X, const size_t offX, const size_t incX,
                               lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_dsyr(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -661,6 +697,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dsyr2(const uint8_t order, const uint8_t
                                const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_dsyr2(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -685,6 +722,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sgemv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const double beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(M, N, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   cblas_sgemv(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -703,6 +741,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sgbmv(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const double beta, lean_obj_arg Y, const size_t offY, const size_t incY){
+  LEANBLAS_TRACE(M, N, KL, KU, lda, incX, incY);
   ensure_exclusive_byte_array(&Y);
 
   cblas_sgbmv(leanblas_cblas_order(order), leanblas_cblas_transpose(transA),
@@ -719,6 +758,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sgbmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_strmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_strmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -734,6 +774,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_strmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_stbmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const size_t K, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, K, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_stbmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -749,6 +790,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_stbmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_stpmv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                               const size_t N, const b_lean_obj_arg A, const size_t offA, lean_obj_arg X, const size_t offX,
                                               const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_stpmv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -764,6 +806,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_stpmv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_strsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_strsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -779,6 +822,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_strsv(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_stbsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const size_t K, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, K, lda, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_stbsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -793,6 +837,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_stbsv(const uint8_t order, const uint8_t
  */
 LEAN_EXPORT lean_obj_res leanblas_cblas_stpsv(const uint8_t order, const uint8_t uplo, const uint8_t transA, const uint8_t diag,
                                 const size_t N, const b_lean_obj_arg A, const size_t offA, lean_obj_arg X, const size_t offX, const size_t incX){
+  LEANBLAS_TRACE(N, incX);
   ensure_exclusive_byte_array(&X);
 
   cblas_stpsv(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), leanblas_cblas_transpose(transA), leanblas_cblas_diag(diag),
@@ -809,6 +854,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sger(const uint8_t order, const size_t M
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(M, N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_sger(leanblas_cblas_order(order), (int)M, (int)N, (float)alpha,
@@ -826,6 +872,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssyr(const uint8_t order, const uint8_t
                               const size_t N, const double alpha,
                               const b_lean_obj_arg X, const size_t offX, const size_t incX,
                               lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_ssyr(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -844,6 +891,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssyr2(const uint8_t order, const uint8_t
                                const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                lean_obj_arg A, const size_t offA, const size_t lda){
+  LEANBLAS_TRACE(N, incX, incY, lda);
   ensure_exclusive_byte_array(&A);
 
   cblas_ssyr2(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo),
@@ -865,6 +913,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ssyr2(const uint8_t order, const uint8_t
 LEAN_EXPORT lean_obj_res leanblas_cblas_spacked_to_dense(const size_t N, const uint8_t uplo,
                                 const uint8_t orderAp, const b_lean_obj_arg Ap,
                                 const uint8_t orderA, lean_obj_arg A, const size_t offA, const size_t lds) {
+  LEANBLAS_TRACE(N, lds);
   ensure_exclusive_byte_array(&A);
 
   const float* packed = lean_float32_array_cptr(Ap);
@@ -902,6 +951,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_spacked_to_dense(const size_t N, const u
 LEAN_EXPORT lean_obj_res leanblas_cblas_sdense_to_packed(const size_t N, const uint8_t uplo,
                                 const uint8_t orderA, const b_lean_obj_arg A, const size_t offA, const size_t lda,
                                 const uint8_t orderAp, lean_obj_arg Ap) {
+  LEANBLAS_TRACE(N, lda);
   ensure_exclusive_byte_array(&Ap);
 
   const float* dense = lean_float32_array_cptr(A) + offA;
@@ -936,6 +986,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_sgpr(const uint8_t order, const uint8_t
                               const b_lean_obj_arg X, const size_t offX, const size_t incX,
                               const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                               lean_obj_arg Ap, const size_t offA) {
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Ap);
 
   float* packed = lean_float32_array_cptr(Ap) + offA;
@@ -1,6 +1,7 @@
 #include <lean/lean.h>
-#include <cblas.h>
+#include "cblas_compat.h"
 #include "util.h"
+#include "trace.h"
 
 
 /** General packed rank-1 update
@@ -108,6 +109,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dgpr(const uint8_t order, const uint8_t
                                 const b_lean_obj_arg X, const size_t offX, const size_t incX,
                                 const b_lean_obj_arg Y, const size_t offY, const size_t incY,
                                 lean_obj_arg Ap, const size_t offAp){
+  LEANBLAS_TRACE(N, incX, incY);
   ensure_exclusive_byte_array(&Ap);
 
   cblas_dgpr(leanblas_cblas_order(order), leanblas_cblas_uplo(uplo), (int)N, alpha,
@@ -231,6 +233,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_dpacked_to_dense(const size_t N,
                                                         lean_obj_arg A,
                                                         const size_t offA,
                                                         const size_t lda){
+  LEANBLAS_TRACE(N, lda);
 
   ensure_exclusive_byte_array(&A);
 
@@ -339,6 +342,7 @@ LEAN_EXPORT lean_obj_res leanblas_cblas_ddense_to_packed(const size_t N,
                                                          const size_t lda,
                                                          const uint8_t orderAp,
                                                          lean_obj_arg Ap){
+  LEANBLAS_TRACE(N, lda);
 
   ensure_exclusive_byte_array(&Ap);
 
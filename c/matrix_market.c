@@ -0,0 +1,859 @@
+#include <lean/lean.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "native.h"
+#include "util.h"
+
+// Matrix Market files (`LeanBLAS/FFI/MatrixMarket.lean`).
+//
+// Reading maps the file and parses its entries in two passes on the native
+// thread pool: the data lines are cut into chunks at line boundaries, every
+// chunk counts its entries, and after a prefix sum every chunk parses its
+// entries straight into their final positions.  `array` files go directly
+// into the dense result; `coordinate` files go into (row, column, value)
+// triplets that are scattered into a dense matrix or sorted into CSR with two
+// stable counting sorts (by column, then by row), so CSR rows come out with
+// ascending columns and duplicates summed.  Symmetric, skew-symmetric and
+// Hermitian files are expanded to the full matrix.
+//
+// Numbers with at most 19 significant digits and a decimal exponent within
+// ±22 are converted exactly with one multiplication or division by a power of
+// ten; everything else goes through `strtod`.
+//
+// Writing formats blocks of entries in parallel, each with the shortest of
+// `%.15g`, `%.16g` and `%.17g` that reads back exactly, and writes the
+// blocks in order.
+
+enum { MM_REAL, MM_INTEGER, MM_COMPLEX, MM_PATTERN };
+enum { MM_GENERAL, MM_SYMMETRIC, MM_SKEW, MM_HERMITIAN };
+
+static const char *const field_names[] = {"real", "integer", "complex", "pattern"};
+static const char *const symmetry_names[] = {"general", "symmetric", "skew-symmetric", "hermitian"};
+
+#define MM_CHUNK_BYTES (256u << 10)   // bytes of text per parse task, at least
+#define MM_WRITE_CHUNK 32768          // entries per formatting task
+
+typedef struct {
+  const char *path;
+  const char *text;   // the mapped file
+  size_t size;
+  int coordinate, field, symmetry;
+  size_t rows, cols, entries;   // `entries` is the number of stored entries
+  size_t body;        // offset of the first line after the size line
+  size_t body_line;   // its line number, from 1
+} mm_file;
+
+static int is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static size_t line_end(const mm_file *f, size_t pos) {
+  const char *nl = memchr(f->text + pos, '\n', f->size - pos);
+  return nl ? (size_t)(nl - f->text) : f->size;
+}
+
+static size_t line_number(const mm_file *f, size_t pos) {
+  size_t line = f->body_line;
+  for (const char *p = f->text + f->body, *end = f->text + pos; (p = memchr(p, '\n', (size_t)(end - p))); p++)
+    line++;
+  return line;
+}
+
+// ---------------------------------------------------------------------------
+// Numbers
+// ---------------------------------------------------------------------------
+
+static const double pow10_exact[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Parses the number starting at `p` (after blanks) into `out`; returns the
+// end of the token, or NULL if there is no valid number.
+static const char *parse_double(const char *p, const char *end, double *out) {
+  while (p < end && is_blank(*p)) p++;
+  const char *start = p;
+  int neg = 0;
+  if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+  uint64_t mant = 0;
+  int digits = 0, exp10 = 0, any = 0, exact = 1;
+  for (; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+    if (digits < 19) {
+      mant = mant * 10 + (uint64_t)(*p - '0');
+      if (mant) digits++;
+    } else {
+      exp10++;
+      if (*p != '0') exact = 0;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+      if (digits < 19) {
+        mant = mant * 10 + (uint64_t)(*p - '0');
+        if (mant) digits++;
+        exp10--;
+      } else if (*p != '0') {
+        exact = 0;
+      }
+    }
+  }
+  if (any && p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    int eneg = 0, e = 0, edigits = 0;
+    if (q < end && (*q == '-' || *q == '+')) eneg = *q++ == '-';
+    for (; q < end && *q >= '0' && *q <= '9'; q++, edigits++)
+      if (e < 100000) e = e * 10 + (*q - '0');
+    if (edigits) {
+      exp10 += eneg ? -e : e;
+      p = q;
+    }
+  }
+  const int at_end = p == end || is_blank(*p) || *p == '\n';
+  if (any && at_end && exact && mant <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+    const double m = (double)mant;
+    *out = exp10 < 0 ? m / pow10_exact[-exp10] : m * pow10_exact[exp10];
+    if (neg) *out = -*out;
+    return p;
+  }
+  // long mantissas, large exponents, inf and nan
+  const char *tok = start;
+  while (p < end && !is_blank(*p) && *p != '\n') p++;
+  const size_t len = (size_t)(p - tok);
+  if (len == 0 || len > 511) return NULL;
+  char buf[512];
+  memcpy(buf, tok, len);
+  buf[len] = 0;
+  char *stop;
+  *out = strtod(buf, &stop);
+  return stop == buf + len ? p : NULL;
+}
+
+// Parses a 1-based index no larger than `max`; returns the end, or NULL.
+static const char *parse_index(const char *p, const char *end, size_t max, size_t *out) {
+  while (p < end && is_blank(*p)) p++;
+  size_t v = 0;
+  const char *start = p;
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    if (v > (SIZE_MAX - 9) / 10) return NULL;
+    v = v * 10 + (size_t)(*p - '0');
+  }
+  if (p == start || v < 1 || v > max) return NULL;
+  *out = v - 1;
+  return p;
+}
+
+// The shortest `%.Ng` of `v` that reads back exactly.
+static int format_double(char *buf, double v) {
+  int n = 0;
+  for (int prec = 15; prec <= 17; prec++) {
+    n = snprintf(buf, 32, "%.*g", prec, v);
+    if (prec == 17 || strtod(buf, NULL) == v || v != v) break;
+  }
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// Header
+// ---------------------------------------------------------------------------
+
+static int word_is(const char *w, size_t n, const char *s) { return strlen(s) == n && strncasecmp(w, s, n) == 0; }
+
+// Splits the next blank-separated word of [p, end).
+static const char *next_word(const char **p, const char *end, size_t *n) {
+  while (*p < end && is_blank(**p)) (*p)++;
+  const char *w = *p;
+  while (*p < end && !is_blank(**p)) (*p)++;
+  *n = (size_t)(*p - w);
+  return w;
+}
+
+static const char *parse_banner(mm_file *f) {
+  const char *p = f->text, *end = f->text + line_end(f, 0);
+  size_t n;
+  const char *w = next_word(&p, end, &n);
+  if (!word_is(w, n, "%%MatrixMarket")) return "not a Matrix Market file (no %%MatrixMarket banner)";
+  w = next_word(&p, end, &n);
+  if (!word_is(w, n, "matrix")) return "only 'matrix' objects are supported";
+  w = next_word(&p, end, &n);
+  if (word_is(w, n, "coordinate")) f->coordinate = 1;
+  else if (word_is(w, n, "array")) f->coordinate = 0;
+  else return "format must be 'coordinate' or 'array'";
+  w = next_word(&p, end, &n);
+  f->field = -1;
+  for (int k = 0; k < 4; k++)
+    if (word_is(w, n, field_names[k])) f->field = k;
+  if (word_is(w, n, "double")) f->field = MM_REAL;
+  if (f->field < 0) return "field must be 'real', 'integer', 'complex' or 'pattern'";
+  w = next_word(&p, end, &n);
+  f->symmetry = -1;
+  for (int k = 0; k < 4; k++)
+    if (word_is(w, n, symmetry_names[k])) f->symmetry = k;
+  if (f->symmetry < 0) return "symmetry must be 'general', 'symmetric', 'skew-symmetric' or 'hermitian'";
+  if (f->field == MM_PATTERN && !f->coordinate) return "'pattern' needs the 'coordinate' format";
+  if (f->symmetry == MM_HERMITIAN && f->field != MM_COMPLEX) return "'hermitian' needs the 'complex' field";
+
+  // comments, then the size line
+  size_t pos = line_end(f, 0) + 1, line = 2;
+  for (; pos < f->size; pos = line_end(f, pos) + 1, line++) {
+    const char *q = f->text + pos;
+    while (q < f->text + f->size && is_blank(*q)) q++;
+    if (q < f->text + f->size && *q != '%' && *q != '\n') break;
+  }
+  if (pos >= f->size) return "missing size line";
+  const char *q = f->text + pos, *qend = f->text + line_end(f, pos);
+  size_t vals[3];
+  for (int k = 0; k < 2 + f->coordinate; k++) {
+    while (q < qend && is_blank(*q)) q++;
+    const char *s = q;
+    size_t v = 0;
+    for (; q < qend && *q >= '0' && *q <= '9'; q++) {
+      if (v > (SIZE_MAX - 9) / 10) return "malformed size line";
+      v = v * 10 + (size_t)(*q - '0');
+    }
+    if (q == s) return "malformed size line";
+    vals[k] = v;
+  }
+  f->rows = vals[0];
+  f->cols = vals[1];
+  if (f->cols != 0 && f->rows > SIZE_MAX / 16 / f->cols) return "matrix too large";
+  if (f->symmetry != MM_GENERAL && f->rows != f->cols) return "symmetric matrices must be square";
+  if (f->coordinate) f->entries = vals[2];
+  else if (f->symmetry == MM_GENERAL) f->entries = f->rows * f->cols;
+  else if (f->symmetry == MM_SKEW) f->entries = f->rows * (f->rows ? f->rows - 1 : 0) / 2;
+  else f->entries = f->rows * (f->rows + 1) / 2;
+  f->body = line_end(f, pos) + 1;
+  if (f->body > f->size) f->body = f->size;
+  f->body_line = line + 1;
+  return NULL;
+}
+
+// Maps `path` and parses its header; on failure returns an error result.
+static lean_object *mm_open(b_lean_obj_arg lpath, mm_file *f) {
+  memset(f, 0, sizeof(*f));
+  f->path = lean_string_cstr(lpath);
+  int fd = open(f->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    lean_object *r = leanblas_os_error(lpath);
+    close(fd);
+    return r;
+  }
+  f->size = (size_t)st.st_size;
+  if (f->size == 0) {
+    close(fd);
+    return leanblas_file_error(f->path, "empty file");
+  }
+  void *m = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) return leanblas_os_error(lpath);
+  madvise(m, f->size, MADV_SEQUENTIAL);
+  f->text = m;
+  const char *err = parse_banner(f);
+  if (err) {
+    munmap(m, f->size);
+    return leanblas_file_error(f->path, "%s", err);
+  }
+  return NULL;
+}
+
+static void mm_close(mm_file *f) { munmap((void *)f->text, f->size); }
+
+static lean_object *mk_header(const mm_file *f) {
+  lean_object *h = lean_alloc_ctor(0, 6, 0);
+  lean_ctor_set(h, 0, lean_mk_string(f->coordinate ? "coordinate" : "array"));
+  lean_ctor_set(h, 1, lean_mk_string(field_names[f->field]));
+  lean_ctor_set(h, 2, lean_mk_string(symmetry_names[f->symmetry]));
+  lean_ctor_set(h, 3, lean_usize_to_nat(f->rows));
+  lean_ctor_set(h, 4, lean_usize_to_nat(f->cols));
+  lean_ctor_set(h, 5, lean_usize_to_nat(f->entries));
+  return h;
+}
+
+LEAN_EXPORT lean_obj_res leanblas_mm_read_header(b_lean_obj_arg lpath, lean_obj_arg w) {
+  (void)w;
+  mm_file f;
+  lean_object *err = mm_open(lpath, &f);
+  if (err) return err;
+  lean_object *h = mk_header(&f);
+  mm_close(&f);
+  return lean_io_result_mk_ok(h);
+}
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  const mm_file *f;
+  int ntasks;
+  size_t *start;        // ntasks + 1 line-aligned offsets
+  size_t *first;        // entries before each task, after the counting pass
+  int cplx;             // two doubles per value
+  // array files parse into `dense` (`order` 0 = row-major, 1 = column-major)
+  // and everything else into triplets
+  double *dense;
+  int order;
+  size_t *ti, *tj;
+  double *tv;
+  pthread_mutex_t lock;
+  size_t error_pos;
+  const char *error;
+} mm_parse;
+
+static void parse_fail(mm_parse *s, size_t pos, const char *msg) {
+  pthread_mutex_lock(&s->lock);
+  if (!s->error || pos < s->error_pos) {
+    s->error = msg;
+    s->error_pos = pos;
+  }
+  pthread_mutex_unlock(&s->lock);
+}
+
+static void count_task(void *ctx, int t, int ntasks) {
+  (void)ntasks;
+  mm_parse *s = ctx;
+  const char *p = s->f->text + s->start[t], *end = s->f->text + s->start[t + 1];
+  size_t n = 0;
+  while (p < end) {
+    while (p < end && is_blank(*p)) p++;
+    if (p < end && *p != '\n' && *p != '%') n++;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    p = nl ? nl + 1 : end;
+  }
+  s->first[t] = n;
+}
+
+// Position of stored entry `k` of an `array` file (column by column, only the
+// lower triangle of symmetric ones).
+static void array_position(const mm_file *f, size_t k, size_t *i, size_t *j) {
+  if (f->symmetry == MM_GENERAL) {
+    *j = f->rows ? k / f->rows : 0;
+    *i = f->rows ? k % f->rows : 0;
+    return;
+  }
+  const size_t skip = f->symmetry == MM_SKEW;
+  size_t col = 0;
+  while (k >= f->rows - col - skip) k -= f->rows - col - skip, col++;
+  *j = col;
+  *i = col + skip + k;
+}
+
+static void store_dense(mm_parse *s, size_t i, size_t j, const double v[2]) {
+  const mm_file *f = s->f;
+  const size_t at = s->order == 0 ? i * f->cols + j : j * f->rows + i;
+  if (s->cplx) {
+    s->dense[2 * at] = v[0];
+    s->dense[2 * at + 1] = v[1];
+  } else {
+    s->dense[at] = v[0];
+  }
+  if (f->symmetry == MM_GENERAL || i == j) return;
+  const size_t mirror = s->order == 0 ? j * f->cols + i : i * f->rows + j;
+  const double re = f->symmetry == MM_SKEW ? -v[0] : v[0];
+  const double im = f->symmetry == MM_SYMMETRIC ? v[1] : -v[1];
+  if (s->cplx) {
+    s->dense[2 * mirror] = re;
+    s->dense[2 * mirror + 1] = im;
+  } else {
+    s->dense[mirror] = re;
+  }
+}
+
+static void parse_task(void *ctx, int t, int ntasks) {
+  (void)ntasks;
+  mm_parse *s = ctx;
+  const mm_file *f = s->f;
+  const char *p = f->text + s->start[t], *end = f->text + s->start[t + 1];
+  const int nvals = f->field == MM_PATTERN ? 0 : f->field == MM_COMPLEX ? 2 : 1;
+  size_t k = s->first[t], i = 0, j = 0;
+  if (!f->coordinate && k < f->entries) array_position(f, k, &i, &j);
+  while (p < end) {
+    while (p < end && is_blank(*p)) p++;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    const char *eol = nl ? nl : end;
+    if (p == eol || *p == '%') {
+      p = eol < end ? eol + 1 : end;
+      continue;
+    }
+    const size_t pos = (size_t)(p - f->text);
+    if (f->coordinate && (!(p = parse_index(p, eol, f->rows, &i)) || !(p = parse_index(p, eol, f->cols, &j)))) {
+      parse_fail(s, pos, "bad row or column index");
+      return;
+    }
+    double v[2] = {1.0, 0.0};
+    for (int c = 0; c < nvals; c++)
+      if (!(p = parse_double(p, eol, &v[c]))) {
+        parse_fail(s, pos, "bad value");
+        return;
+      }
+    while (p < eol && is_blank(*p)) p++;
+    if (p != eol) {
+      parse_fail(s, pos, "unexpected text after the entry");
+      return;
+    }
+    if (s->dense) {
+      store_dense(s, i, j, v);
+      if (++i == f->rows) {
+        j++;
+        i = f->symmetry == MM_GENERAL ? 0 : j + (f->symmetry == MM_SKEW);
+      }
+    } else {
+      s->ti[k] = i;
+      s->tj[k] = j;
+      if (s->cplx) {
+        s->tv[2 * k] = v[0];
+        s->tv[2 * k + 1] = v[1];
+      } else {
+        s->tv[k] = v[0];
+      }
+      if (!f->coordinate && ++i == f->rows) {
+        j++;
+        i = f->symmetry == MM_GENERAL ? 0 : j + (f->symmetry == MM_SKEW);
+      }
+    }
+    k++;
+    p = eol < end ? eol + 1 : end;
+  }
+}
+
+// Counts and parses the entries of `f` into `s` (whose outputs are set up by
+// the caller once the count is known, through `setup`).
+static lean_object *mm_parse_entries(mm_parse *s, const mm_file *f, int (*setup)(mm_parse *, void *), void *arg) {
+  const size_t len = f->size - f->body;
+  const size_t threads = (size_t)leanblas_num_threads();
+  size_t ntasks = len / MM_CHUNK_BYTES + 1;
+  if (ntasks > 4 * threads) ntasks = 4 * threads;
+  s->f = f;
+  s->ntasks = (int)ntasks;
+  s->start = malloc((ntasks + 1) * sizeof(size_t));
+  s->first = malloc(ntasks * sizeof(size_t));
+  pthread_mutex_init(&s->lock, NULL);
+  lean_object *r = NULL;
+  if (!s->start || !s->first) {
+    r = leanblas_file_error(f->path, "out of memory");
+    goto done;
+  }
+  s->start[0] = f->body;
+  for (size_t t = 1; t < ntasks; t++) {
+    size_t at = f->body + len / ntasks * t;
+    if (at < s->start[t - 1]) at = s->start[t - 1];
+    at = at < f->size ? line_end(f, at) + 1 : f->size;
+    s->start[t] = at > f->size ? f->size : at;
+  }
+  s->start[ntasks] = f->size;
+  leanblas_parallel_for(s->ntasks, count_task, s);
+  size_t total = 0;
+  for (size_t t = 0; t < ntasks; t++) {
+    const size_t n = s->first[t];
+    s->first[t] = total;
+    total += n;
+  }
+  if (total != f->entries) {
+    r = leanblas_file_error(f->path, "expected %zu entries, found %zu", f->entries, total);
+    goto done;
+  }
+  if (!setup(s, arg)) {
+    r = leanblas_file_error(f->path, "out of memory");
+    goto done;
+  }
+  leanblas_parallel_for(s->ntasks, parse_task, s);
+  if (s->error) r = leanblas_file_error(f->path, "line %zu: %s", line_number(f, s->error_pos), s->error);
+done:
+  free(s->start);
+  free(s->first);
+  pthread_mutex_destroy(&s->lock);
+  return r;
+}
+
+static int setup_triplets(mm_parse *s, void *arg) {
+  (void)arg;
+  const size_t n = s->f->entries ? s->f->entries : 1;
+  s->ti = malloc(n * sizeof(size_t));
+  s->tj = malloc(n * sizeof(size_t));
+  s->tv = malloc(n * (s->cplx ? 2 : 1) * sizeof(double));
+  return s->ti && s->tj && s->tv;
+}
+
+static int setup_dense(mm_parse *s, void *arg) {
+  s->dense = arg;
+  return 1;
+}
+
+static void free_triplets(mm_parse *s) {
+  free(s->ti);
+  free(s->tj);
+  free(s->tv);
+}
+
+static lean_obj_res mm_result(const mm_file *f, lean_object *value) {
+  lean_object *pair = lean_alloc_ctor(0, 2, 0);
+  lean_ctor_set(pair, 0, mk_header(f));
+  lean_ctor_set(pair, 1, value);
+  return lean_io_result_mk_ok(pair);
+}
+
+/**
+ * Reads a Matrix Market file into a dense `rows × cols` matrix.
+ *
+ * @param cplx  1 for a ComplexFloat64Array, 0 for a Float64Array
+ * @param order 0 = RowMajor, 1 = ColMajor
+ * @return (header, bytes of the matrix)
+ */
+LEAN_EXPORT lean_obj_res leanblas_mm_read_dense(b_lean_obj_arg lpath, uint8_t cplx, uint8_t order, lean_obj_arg w) {
+  (void)w;
+  mm_file f;
+  lean_object *err = mm_open(lpath, &f);
+  if (err) return err;
+  if (f.field == MM_COMPLEX && !cplx) {
+    mm_close(&f);
+    return leanblas_file_error(f.path, "complex matrix cannot be read into a real array");
+  }
+  const size_t width = cplx ? 16 : 8;
+  const size_t bytes = f.rows * f.cols * width;
+  lean_object *data = lean_alloc_sarray(1, bytes, bytes);
+  double *A = (double *)lean_sarray_cptr(data);
+  // array files write every element; coordinate files only their entries
+  if (f.coordinate || f.symmetry != MM_GENERAL) memset(A, 0, bytes);
+  mm_parse s;
+  memset(&s, 0, sizeof(s));
+  s.cplx = cplx;
+  s.order = order;
+  lean_object *r = f.coordinate ? mm_parse_entries(&s, &f, setup_triplets, NULL)
+                                : mm_parse_entries(&s, &f, setup_dense, A);
+  if (!r && f.coordinate) {
+    // scatter, summing duplicates
+    for (size_t k = 0; k < f.entries; k++) {
+      const size_t i = s.ti[k], j = s.tj[k];
+      const double re = cplx ? s.tv[2 * k] : s.tv[k], im = cplx ? s.tv[2 * k + 1] : 0.0;
+      for (int m = 0; m < 2; m++) {
+        if (m == 1 && (f.symmetry == MM_GENERAL || i == j)) break;
+        const size_t a = m ? j : i, b = m ? i : j;
+        const size_t at = order == 0 ? a * f.cols + b : b * f.rows + a;
+        const double sre = m && f.symmetry == MM_SKEW ? -re : re;
+        const double sim = m && f.symmetry != MM_SYMMETRIC ? -im : im;
+        if (cplx) {
+          A[2 * at] += sre;
+          A[2 * at + 1] += sim;
+        } else {
+          A[at] += sre;
+        }
+      }
+    }
+  }
+  free_triplets(&s);
+  if (r) {
+    lean_dec(data);
+    mm_close(&f);
+    return r;
+  }
+  r = mm_result(&f, data);
+  mm_close(&f);
+  return r;
+}
+
+/**
+ * Reads a Matrix Market file into CSR: row pointers (`rows + 1` entries) and
+ * column indices as native `uint64_t`, values as doubles (pairs if `cplx`).
+ * Rows have ascending columns and no duplicates; zeros of `array` files are
+ * dropped.
+ *
+ * @return BLAS.MatrixMarket.RawCSR (header, rowPtr, colIdx, values)
+ */
+LEAN_EXPORT lean_obj_res leanblas_mm_read_csr(b_lean_obj_arg lpath, uint8_t cplx, lean_obj_arg w) {
+  (void)w;
+  mm_file f;
+  lean_object *err = mm_open(lpath, &f);
+  if (err) return err;
+  if (f.field == MM_COMPLEX && !cplx) {
+    mm_close(&f);
+    return leanblas_file_error(f.path, "complex matrix cannot be read into a real array");
+  }
+  mm_parse s;
+  memset(&s, 0, sizeof(s));
+  s.cplx = cplx;
+  lean_object *r = mm_parse_entries(&s, &f, setup_triplets, NULL);
+  if (r) {
+    free_triplets(&s);
+    mm_close(&f);
+    return r;
+  }
+  const size_t vw = cplx ? 2 : 1;
+  const int mirror = f.symmetry != MM_GENERAL;
+  const int drop_zeros = !f.coordinate;
+
+  // expanded entry count and column counts
+  size_t *colptr = calloc(f.cols + 1, sizeof(size_t));
+  size_t n = 0;
+  for (size_t k = 0; colptr && k < f.entries; k++) {
+    const double *v = s.tv + vw * k;
+    if (drop_zeros && v[0] == 0.0 && (!cplx || v[1] == 0.0)) continue;
+    colptr[s.tj[k] + 1]++;
+    n++;
+    if (mirror && s.ti[k] != s.tj[k]) {
+      colptr[s.ti[k] + 1]++;
+      n++;
+    }
+  }
+  size_t *ci = malloc((n ? n : 1) * sizeof(size_t)), *cj = malloc((n ? n : 1) * sizeof(size_t));
+  double *cv = malloc((n ? n : 1) * vw * sizeof(double));
+  size_t *rowcount = calloc(f.rows + 1, sizeof(size_t));
+  if (!colptr || !ci || !cj || !cv || !rowcount) {
+    free(colptr), free(ci), free(cj), free(cv), free(rowcount), free_triplets(&s);
+    mm_close(&f);
+    return leanblas_file_error(f.path, "out of memory");
+  }
+
+  // stable counting sort by column
+  for (size_t c = 0; c < f.cols; c++) colptr[c + 1] += colptr[c];
+  for (size_t k = 0; k < f.entries; k++) {
+    const double *v = s.tv + vw * k;
+    if (drop_zeros && v[0] == 0.0 && (!cplx || v[1] == 0.0)) continue;
+    for (int m = 0; m < 2; m++) {
+      if (m == 1 && (!mirror || s.ti[k] == s.tj[k])) break;
+      const size_t i = m ? s.tj[k] : s.ti[k], j = m ? s.ti[k] : s.tj[k];
+      const size_t at = colptr[j]++;
+      ci[at] = i;
+      cj[at] = j;
+      cv[vw * at] = m && f.symmetry == MM_SKEW ? -v[0] : v[0];
+      if (cplx) cv[vw * at + 1] = m && f.symmetry != MM_SYMMETRIC ? -v[1] : v[1];
+      rowcount[i + 1]++;
+    }
+  }
+  free_triplets(&s);
+  free(colptr);
+
+  // stable counting sort by row, straight into the result
+  lean_object *rowptr = lean_alloc_sarray(1, (f.rows + 1) * 8, (f.rows + 1) * 8);
+  lean_object *colidx = lean_alloc_sarray(1, n * 8, n * 8);
+  lean_object *values = lean_alloc_sarray(1, n * vw * 8, n * vw * 8);
+  uint64_t *rp = (uint64_t *)lean_sarray_cptr(rowptr), *cx = (uint64_t *)lean_sarray_cptr(colidx);
+  double *vx = (double *)lean_sarray_cptr(values);
+  for (size_t i = 0; i < f.rows; i++) rowcount[i + 1] += rowcount[i];
+  for (size_t e = 0; e < n; e++) {
+    const size_t at = rowcount[ci[e]]++;
+    cx[at] = cj[e];
+    memcpy(vx + vw * at, cv + vw * e, vw * sizeof(double));
+  }
+  free(ci), free(cj), free(cv);
+
+  // sum duplicates; rowcount[i] is now the end of row i
+  size_t out = 0, begin = 0;
+  rp[0] = 0;
+  for (size_t i = 0; i < f.rows; i++) {
+    const size_t end = rowcount[i];
+    for (size_t e = begin; e < end; e++) {
+      if (out > rp[i] && cx[out - 1] == cx[e]) {
+        for (size_t c = 0; c < vw; c++) vx[vw * (out - 1) + c] += vx[vw * e + c];
+        continue;
+      }
+      cx[out] = cx[e];
+      memmove(vx + vw * out, vx + vw * e, vw * sizeof(double));
+      out++;
+    }
+    begin = end;
+    rp[i + 1] = out;
+  }
+  free(rowcount);
+  lean_to_sarray(colidx)->m_size = out * 8;
+  lean_to_sarray(values)->m_size = out * vw * 8;
+
+  lean_object *csr = lean_alloc_ctor(0, 4, 0);
+  lean_ctor_set(csr, 0, mk_header(&f));
+  lean_ctor_set(csr, 1, rowptr);
+  lean_ctor_set(csr, 2, colidx);
+  lean_ctor_set(csr, 3, values);
+  mm_close(&f);
+  return lean_io_result_mk_ok(csr);
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  size_t first, count;   // entries of one block
+  char *buf;
+  size_t len;
+  int failed;
+} mm_block;
+
+typedef struct {
+  mm_block *blocks;
+  int cplx;
+  // dense
+  const double *A;
+  size_t rows, cols;
+  int order;
+  // CSR
+  const uint64_t *rowptr, *colidx;
+  const double *values;
+} mm_writer;
+
+// Worst case per entry: two indices of 20 digits, two values of 24 characters.
+#define MM_ENTRY_MAX 96
+
+static void format_dense_task(void *ctx, int t, int ntasks) {
+  (void)ntasks;
+  mm_writer *wr = ctx;
+  mm_block *b = &wr->blocks[t];
+  b->buf = malloc(b->count * MM_ENTRY_MAX + 1);
+  if (!b->buf) {
+    b->failed = 1;
+    return;
+  }
+  char *p = b->buf;
+  for (size_t k = b->first; k < b->first + b->count; k++) {
+    const size_t i = k % wr->rows, j = k / wr->rows;
+    const size_t at = wr->order == 0 ? i * wr->cols + j : k;
+    if (wr->cplx) {
+      p += format_double(p, wr->A[2 * at]);
+      *p++ = ' ';
+      p += format_double(p, wr->A[2 * at + 1]);
+    } else {
+      p += format_double(p, wr->A[at]);
+    }
+    *p++ = '\n';
+  }
+  b->len = (size_t)(p - b->buf);
+}
+
+static void format_csr_task(void *ctx, int t, int ntasks) {
+  (void)ntasks;
+  mm_writer *wr = ctx;
+  mm_block *b = &wr->blocks[t];
+  b->buf = malloc(b->count * MM_ENTRY_MAX + 1);
+  if (!b->buf) {
+    b->failed = 1;
+    return;
+  }
+  // the row of the first entry
+  size_t lo = 0, hi = wr->rows;
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (wr->rowptr[mid] <= b->first) lo = mid;
+    else hi = mid;
+  }
+  size_t i = lo;
+  char *p = b->buf;
+  for (size_t e = b->first; e < b->first + b->count; e++) {
+    while (wr->rowptr[i + 1] <= e) i++;
+    p += sprintf(p, "%zu %llu ", i + 1, (unsigned long long)wr->colidx[e] + 1);
+    if (wr->cplx) {
+      p += format_double(p, wr->values[2 * e]);
+      *p++ = ' ';
+      p += format_double(p, wr->values[2 * e + 1]);
+    } else {
+      p += format_double(p, wr->values[e]);
+    }
+    *p++ = '\n';
+  }
+  b->len = (size_t)(p - b->buf);
+}
+
+// Writes `header` and then `total` entries, formatted by `fn` in rounds of
+// blocks on the thread pool.
+static lean_obj_res mm_write(b_lean_obj_arg lpath, const char *header, mm_writer *wr, size_t total,
+                             leanblas_task_fn fn) {
+  const char *path = lean_string_cstr(lpath);
+  FILE *out = fopen(path, "wb");
+  if (!out) return leanblas_os_error(lpath);
+  int ok = fputs(header, out) >= 0;
+  const size_t round = 4 * (size_t)leanblas_num_threads();
+  wr->blocks = calloc(round, sizeof(mm_block));
+  if (!wr->blocks) ok = 0;
+  for (size_t done = 0; ok && done < total;) {
+    int nblocks = 0;
+    for (; nblocks < (int)round && done < total; nblocks++) {
+      mm_block *b = &wr->blocks[nblocks];
+      b->first = done;
+      b->count = total - done < MM_WRITE_CHUNK ? total - done : MM_WRITE_CHUNK;
+      b->buf = NULL;
+      b->len = 0;
+      b->failed = 0;
+      done += b->count;
+    }
+    leanblas_parallel_for(nblocks, fn, wr);
+    for (int k = 0; k < nblocks; k++) {
+      mm_block *b = &wr->blocks[k];
+      if (b->failed || fwrite(b->buf, 1, b->len, out) != b->len) ok = 0;
+      free(b->buf);
+    }
+  }
+  free(wr->blocks);
+  const int saved = errno;
+  if (fclose(out) != 0) ok = 0;
+  if (ok) return lean_io_result_mk_ok(lean_box(0));
+  errno = saved ? saved : EIO;
+  return leanblas_os_error(lpath);
+}
+
+static int nat_arg(b_lean_obj_arg n, size_t *out) {
+  if (!lean_is_scalar(n)) return 0;
+  *out = lean_usize_of_nat(n);
+  return 1;
+}
+
+/**
+ * Writes a dense matrix as a general `array` file.
+ *
+ * @param order 0 = RowMajor, 1 = ColMajor
+ */
+LEAN_EXPORT lean_obj_res leanblas_mm_write_dense(b_lean_obj_arg lpath, b_lean_obj_arg lrows, b_lean_obj_arg lcols,
+                                                 uint8_t order, b_lean_obj_arg data, uint8_t cplx, lean_obj_arg w) {
+  (void)w;
+  mm_writer wr;
+  memset(&wr, 0, sizeof(wr));
+  const char *path = lean_string_cstr(lpath);
+  if (!nat_arg(lrows, &wr.rows) || !nat_arg(lcols, &wr.cols) ||
+      (wr.cols && wr.rows > SIZE_MAX / 16 / wr.cols) ||
+      wr.rows * wr.cols * (cplx ? 16 : 8) != lean_sarray_size(data))
+    return leanblas_file_error(path, "data size does not match rows × cols");
+  wr.cplx = cplx;
+  wr.order = order;
+  wr.A = (const double *)lean_sarray_cptr(data);
+  char header[128];
+  snprintf(header, sizeof(header), "%%%%MatrixMarket matrix array %s general\n%zu %zu\n", cplx ? "complex" : "real",
+           wr.rows, wr.cols);
+  return mm_write(lpath, header, &wr, wr.rows * wr.cols, format_dense_task);
+}
+
+/**
+ * Writes a CSR matrix as a general `coordinate` file, row by row.
+ */
+LEAN_EXPORT lean_obj_res leanblas_mm_write_csr(b_lean_obj_arg lpath, b_lean_obj_arg lrows, b_lean_obj_arg lcols,
+                                               b_lean_obj_arg rowptr, b_lean_obj_arg colidx, b_lean_obj_arg values,
+                                               uint8_t cplx, lean_obj_arg w) {
+  (void)w;
+  mm_writer wr;
+  memset(&wr, 0, sizeof(wr));
+  const char *path = lean_string_cstr(lpath);
+  if (!nat_arg(lrows, &wr.rows) || !nat_arg(lcols, &wr.cols) || lean_sarray_size(rowptr) != (wr.rows + 1) * 8)
+    return leanblas_file_error(path, "row pointers must have rows + 1 entries");
+  wr.cplx = cplx;
+  wr.rowptr = (const uint64_t *)lean_sarray_cptr(rowptr);
+  wr.colidx = (const uint64_t *)lean_sarray_cptr(colidx);
+  wr.values = (const double *)lean_sarray_cptr(values);
+  const size_t nnz = lean_sarray_size(colidx) / 8;
+  if (wr.rowptr[0] != 0 || wr.rowptr[wr.rows] != nnz || lean_sarray_size(values) != nnz * (cplx ? 16 : 8))
+    return leanblas_file_error(path, "row pointers, column indices and values do not agree");
+  for (size_t i = 0; i < wr.rows; i++)
+    if (wr.rowptr[i] > wr.rowptr[i + 1]) return leanblas_file_error(path, "row pointers must not decrease");
+  for (size_t e = 0; e < nnz; e++)
+    if (wr.colidx[e] >= wr.cols)
+      return leanblas_file_error(path, "column index %llu out of range", (unsigned long long)wr.colidx[e]);
+  char header[160];
+  snprintf(header, sizeof(header), "%%%%MatrixMarket matrix coordinate %s general\n%zu %zu %zu\n",
+           cplx ? "complex" : "real", wr.rows, wr.cols, nnz);
+  return mm_write(lpath, header, &wr, nnz, format_csr_task);
+}
+
+/** Entry `i` of a `BLAS.MatrixMarket.IndexArray`, 0 past the end. */
+LEAN_EXPORT uint64_t leanblas_index_array_get(b_lean_obj_arg a, size_t i) {
+  return i < lean_sarray_size(a) / 8 ? ((const uint64_t *)lean_sarray_cptr(a))[i] : 0;
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "cblas_compat.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// In-tree BLAS kernels.
+//
+// Every routine the wrappers in `levelone.c`, `leveltwo.c` and `levelthree.c`
+// import from CBLAS has a native implementation with the exact CBLAS
+// signature.  With `LEANBLAS_NATIVE_BACKEND` defined they are exported under
+// their `cblas_*` names and replace the system library; otherwise they are
+// still compiled as `leanblas_native_*` so other C code (and tests) can call
+// them next to the system BLAS.
+#ifdef LEANBLAS_NATIVE_BACKEND
+#define LEANBLAS_NATIVE(name) cblas_##name
+#else
+#define LEANBLAS_NATIVE(name) leanblas_native_##name
+#endif
+
+// Kernels that use instructions beyond the baseline are compiled per function
+// with a target attribute and picked at run time through the dispatch
+// registry below, so the library itself still builds for the generic target.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEANBLAS_X86_DISPATCH 1
+#define LEANBLAS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define LEANBLAS_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+// ---------------------------------------------------------------------------
+// Level 1
+// ---------------------------------------------------------------------------
+
+double LEANBLAS_NATIVE(ddot)(const int N, const double *X, const int incX, const double *Y, const int incY);
+double LEANBLAS_NATIVE(dnrm2)(const int N, const double *X, const int incX);
+double LEANBLAS_NATIVE(dasum)(const int N, const double *X, const int incX);
+size_t LEANBLAS_NATIVE(idamax)(const int N, const double *X, const int incX);
+void LEANBLAS_NATIVE(dswap)(const int N, double *X, const int incX, double *Y, const int incY);
+void LEANBLAS_NATIVE(dcopy)(const int N, const double *X, const int incX, double *Y, const int incY);
+void LEANBLAS_NATIVE(daxpy)(const int N, const double alpha, const double *X, const int incX, double *Y, const int incY);
+void LEANBLAS_NATIVE(drotg)(double *a, double *b, double *c, double *s);
+void LEANBLAS_NATIVE(drotmg)(double *d1, double *d2, double *b1, const double b2, double *P);
+void LEANBLAS_NATIVE(drot)(const int N, double *X, const int incX, double *Y, const int incY, const double c, const double s);
+void LEANBLAS_NATIVE(dscal)(const int N, const double alpha, double *X, const int incX);
+
+float LEANBLAS_NATIVE(sdot)(const int N, const float *X, const int incX, const float *Y, const int incY);
+float LEANBLAS_NATIVE(snrm2)(const int N, const float *X, const int incX);
+float LEANBLAS_NATIVE(sasum)(const int N, const float *X, const int incX);
+size_t LEANBLAS_NATIVE(isamax)(const int N, const float *X, const int incX);
+void LEANBLAS_NATIVE(sswap)(const int N, float *X, const int incX, float *Y, const int incY);
+void LEANBLAS_NATIVE(scopy)(const int N, const float *X, const int incX, float *Y, const int incY);
+void LEANBLAS_NATIVE(saxpy)(const int N, const float alpha, const float *X, const int incX, float *Y, const int incY);
+void LEANBLAS_NATIVE(srotg)(float *a, float *b, float *c, float *s);
+void LEANBLAS_NATIVE(srotmg)(float *d1, float *d2, float *b1, const float b2, float *P);
+void LEANBLAS_NATIVE(srot)(const int N, float *X, const int incX, float *Y, const int incY, const float c, const float s);
+void LEANBLAS_NATIVE(sscal)(const int N, const float alpha, float *X, const int incX);
+
+void LEANBLAS_NATIVE(zdotu_sub)(const int N, const void *X, const int incX, const void *Y, const int incY, void *dotu);
+void LEANBLAS_NATIVE(zdotc_sub)(const int N, const void *X, const int incX, const void *Y, const int incY, void *dotc);
+double LEANBLAS_NATIVE(dznrm2)(const int N, const void *X, const int incX);
+double LEANBLAS_NATIVE(dzasum)(const int N, const void *X, const int incX);
+size_t LEANBLAS_NATIVE(izamax)(const int N, const void *X, const int incX);
+void LEANBLAS_NATIVE(zswap)(const int N, void *X, const int incX, void *Y, const int incY);
+void LEANBLAS_NATIVE(zcopy)(const int N, const void *X, const int incX, void *Y, const int incY);
+void LEANBLAS_NATIVE(zaxpy)(const int N, const void *alpha, const void *X, const int incX, void *Y, const int incY);
+void LEANBLAS_NATIVE(zscal)(const int N, const void *alpha, void *X, const int incX);
+void LEANBLAS_NATIVE(zdscal)(const int N, const double alpha, void *X, const int incX);
+
+// ---------------------------------------------------------------------------
+// Level 2
+// ---------------------------------------------------------------------------
+
+void LEANBLAS_NATIVE(dgemv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const double alpha, const double *A, const int lda, const double *X, const int incX,
+                            const double beta, double *Y, const int incY);
+void LEANBLAS_NATIVE(dgbmv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const int KL, const int KU, const double alpha, const double *A, const int lda,
+                            const double *X, const int incX, const double beta, double *Y, const int incY);
+void LEANBLAS_NATIVE(dtrmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const double *A, const int lda, double *X, const int incX);
+void LEANBLAS_NATIVE(dtbmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const int K, const double *A, const int lda,
+                            double *X, const int incX);
+void LEANBLAS_NATIVE(dtpmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const double *Ap, double *X, const int incX);
+void LEANBLAS_NATIVE(dtrsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const double *A, const int lda, double *X, const int incX);
+void LEANBLAS_NATIVE(dtbsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const int K, const double *A, const int lda,
+                            double *X, const int incX);
+void LEANBLAS_NATIVE(dtpsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const double *Ap, double *X, const int incX);
+void LEANBLAS_NATIVE(dger)(const CBLAS_ORDER order, const int M, const int N, const double alpha,
+                           const double *X, const int incX, const double *Y, const int incY, double *A, const int lda);
+void LEANBLAS_NATIVE(dsyr)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const double alpha,
+                           const double *X, const int incX, double *A, const int lda);
+void LEANBLAS_NATIVE(dsyr2)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const double alpha,
+                            const double *X, const int incX, const double *Y, const int incY, double *A, const int lda);
+
+void LEANBLAS_NATIVE(sgemv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const float alpha, const float *A, const int lda, const float *X, const int incX,
+                            const float beta, float *Y, const int incY);
+void LEANBLAS_NATIVE(sgbmv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const int KL, const int KU, const float alpha, const float *A, const int lda,
+                            const float *X, const int incX, const float beta, float *Y, const int incY);
+void LEANBLAS_NATIVE(strmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const float *A, const int lda, float *X, const int incX);
+void LEANBLAS_NATIVE(stbmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const int K, const float *A, const int lda,
+                            float *X, const int incX);
+void LEANBLAS_NATIVE(stpmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const float *Ap, float *X, const int incX);
+void LEANBLAS_NATIVE(strsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const float *A, const int lda, float *X, const int incX);
+void LEANBLAS_NATIVE(stbsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const int K, const float *A, const int lda,
+                            float *X, const int incX);
+void LEANBLAS_NATIVE(stpsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const float *Ap, float *X, const int incX);
+void LEANBLAS_NATIVE(sger)(const CBLAS_ORDER order, const int M, const int N, const float alpha,
+                           const float *X, const int incX, const float *Y, const int incY, float *A, const int lda);
+void LEANBLAS_NATIVE(ssyr)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const float alpha,
+                           const float *X, const int incX, float *A, const int lda);
+void LEANBLAS_NATIVE(ssyr2)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const float alpha,
+                            const float *X, const int incX, const float *Y, const int incY, float *A, const int lda);
+
+void LEANBLAS_NATIVE(zgemv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, const void *X, const int incX,
+                            const void *beta, void *Y, const int incY);
+void LEANBLAS_NATIVE(zhemv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const void *alpha,
+                            const void *A, const int lda, const void *X, const int incX, const void *beta,
+                            void *Y, const int incY);
+void LEANBLAS_NATIVE(ztrmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const void *A, const int lda, void *X, const int incX);
+void LEANBLAS_NATIVE(ztrsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const void *A, const int lda, void *X, const int incX);
+void LEANBLAS_NATIVE(zgeru)(const CBLAS_ORDER order, const int M, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda);
+void LEANBLAS_NATIVE(zgerc)(const CBLAS_ORDER order, const int M, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda);
+void LEANBLAS_NATIVE(zher)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const double alpha,
+                           const void *X, const int incX, void *A, const int lda);
+void LEANBLAS_NATIVE(zher2)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda);
+
+// ---------------------------------------------------------------------------
+// Level 3
+// ---------------------------------------------------------------------------
+
+void LEANBLAS_NATIVE(dgemm)(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                            const int M, const int N, const int K, const double alpha, const double *A, const int lda,
+                            const double *B, const int ldb, const double beta, double *C, const int ldc);
+void LEANBLAS_NATIVE(dsymm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const double alpha, const double *A, const int lda,
+                            const double *B, const int ldb, const double beta, double *C, const int ldc);
+void LEANBLAS_NATIVE(dsyrk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const double alpha, const double *A, const int lda,
+                            const double beta, double *C, const int ldc);
+void LEANBLAS_NATIVE(dsyr2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const double alpha, const double *A, const int lda,
+                             const double *B, const int ldb, const double beta, double *C, const int ldc);
+void LEANBLAS_NATIVE(dtrmm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const double alpha, const double *A, const int lda, double *B, const int ldb);
+void LEANBLAS_NATIVE(dtrsm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const double alpha, const double *A, const int lda, double *B, const int ldb);
+
+void LEANBLAS_NATIVE(sgemm)(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                            const int M, const int N, const int K, const float alpha, const float *A, const int lda,
+                            const float *B, const int ldb, const float beta, float *C, const int ldc);
+void LEANBLAS_NATIVE(ssymm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const float alpha, const float *A, const int lda,
+                            const float *B, const int ldb, const float beta, float *C, const int ldc);
+void LEANBLAS_NATIVE(ssyrk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const float alpha, const float *A, const int lda,
+                            const float beta, float *C, const int ldc);
+void LEANBLAS_NATIVE(ssyr2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const float alpha, const float *A, const int lda,
+                             const float *B, const int ldb, const float beta, float *C, const int ldc);
+void LEANBLAS_NATIVE(strmm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const float alpha, const float *A, const int lda, float *B, const int ldb);
+void LEANBLAS_NATIVE(strsm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const float alpha, const float *A, const int lda, float *B, const int ldb);
+
+void LEANBLAS_NATIVE(zgemm)(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                            const int M, const int N, const int K, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zsymm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zhemm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zsyrk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const void *alpha, const void *A, const int lda,
+                            const void *beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zherk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const double alpha, const void *A, const int lda,
+                            const double beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zsyr2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const void *alpha, const void *A, const int lda,
+                             const void *B, const int ldb, const void *beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(zher2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const void *alpha, const void *A, const int lda,
+                             const void *B, const int ldb, const double beta, void *C, const int ldc);
+void LEANBLAS_NATIVE(ztrmm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, void *B, const int ldb);
+void LEANBLAS_NATIVE(ztrsm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, void *B, const int ldb);
+
+// ---------------------------------------------------------------------------
+// Threading (native_threads.c)
+// ---------------------------------------------------------------------------
+
+// Work item for `leanblas_parallel_for`: called once for every `task` in
+// `[0, ntasks)`, possibly concurrently from several pool threads.
+typedef void (*leanblas_task_fn)(void *ctx, int task, int ntasks);
+
+// Number of threads the native kernels may use.  Defaults to the number of
+// physical cores and can be overridden with `LEANBLAS_NUM_THREADS`.
+int leanblas_num_threads(void);
+void leanblas_set_num_threads(int n);
+
+// Runs `fn` for every task index and returns once all of them finished.  The
+// calling thread participates.  Calls from inside a pool thread, or while
+// another caller owns the pool, run serially on the caller.
+void leanblas_parallel_for(int ntasks, leanblas_task_fn fn, void *ctx);
+
+// ---------------------------------------------------------------------------
+// CPU features and kernel dispatch (native_cpu.c)
+// ---------------------------------------------------------------------------
+
+enum {
+  LEANBLAS_CPU_SSE4_1 = 1u << 0,
+  LEANBLAS_CPU_SSE4_2 = 1u << 1,
+  LEANBLAS_CPU_AVX = 1u << 2,
+  LEANBLAS_CPU_AVX2 = 1u << 3,
+  LEANBLAS_CPU_FMA = 1u << 4,
+  LEANBLAS_CPU_AVX512F = 1u << 5,
+  LEANBLAS_CPU_AVX512DQ = 1u << 6,
+  LEANBLAS_CPU_AVX512BW = 1u << 7,
+  LEANBLAS_CPU_AVX512VL = 1u << 8,
+  LEANBLAS_CPU_AVX512_VNNI = 1u << 9,
+  LEANBLAS_CPU_AVX512_BF16 = 1u << 10,
+  LEANBLAS_CPU_AVX_VNNI = 1u << 11,
+  LEANBLAS_CPU_NEON = 1u << 12,
+};
+
+#define LEANBLAS_CPU_FEATURE_COUNT 13
+
+typedef struct {
+  char vendor[16];       // e.g. "GenuineIntel", "AuthenticAMD", "arm64"
+  uint32_t features;     // LEANBLAS_CPU_* bits, only set when the OS enables them too
+  size_t l1d_bytes;      // per-core data caches; 0 when unknown
+  size_t l2_bytes;
+  size_t l3_bytes;
+  int logical_cpus;       // CPUs this process may run on
+  int physical_cores;     // distinct cores among them
+  int packages;
+} leanblas_cpu_info;
+
+// Detected once, on first use.
+const leanblas_cpu_info *leanblas_cpu(void);
+
+// Name of a single LEANBLAS_CPU_* bit ("avx2", "avx512_vnni", ...).
+const char *leanblas_cpu_feature_name(uint32_t feature);
+
+// One implementation of a kernel family.  `impl` points at whatever the
+// family calls through (a micro-kernel descriptor, a table of loops, ...).
+typedef struct {
+  const char *name;
+  uint32_t requires;
+  const void *impl;
+} leanblas_kernel_variant;
+
+// A kernel family lists its variants best first; the first one whose
+// `requires` bits are all present is selected on first use.  Setting
+// `LEANBLAS_KERNEL_<FAMILY>=<variant>` (e.g. LEANBLAS_KERNEL_DGEMM=generic) or
+// `LEANBLAS_KERNEL=<variant>` for all families forces a variant, as long as
+// the CPU supports it.
+typedef struct {
+  const char *name;
+  const leanblas_kernel_variant *variants;
+  int nvariants;
+  const leanblas_kernel_variant *_Atomic selected;
+} leanblas_kernel_family;
+
+#define LEANBLAS_KERNEL_FAMILY(name, variants) \
+  {(name), (variants), (int)(sizeof(variants) / sizeof((variants)[0])), NULL}
+
+const void *leanblas_kernel_select(leanblas_kernel_family *family);
+
+// All kernel families of the native backend, for reporting which variant
+// each one uses.  Calling this resolves every family.
+int leanblas_kernel_family_count(void);
+leanblas_kernel_family *leanblas_kernel_family_at(int i);
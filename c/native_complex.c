@@ -0,0 +1,594 @@
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "native.h"
+
+// Double complex Level 1/2/3 kernels of the native backend.
+//
+// Complex arguments arrive as `void *` like in CBLAS and are interleaved
+// (re, im) pairs, i.e. `double complex`.  As in `native_real.inc` everything
+// is implemented for column-major storage.  Row-major calls become
+// column-major ones on the transposed problem; where that turns a
+// `ConjTrans` into a plain conjugation the column-major kernels take an extra
+// `cj` flag.  zgemm splits into real and imaginary parts and runs on the real
+// packed gemm; the other Level 3 routines are built on top of zgemm.
+
+typedef double complex zcplx;
+
+static inline zcplx *zvec(void *x, const int N, const int inc) {
+  return inc < 0 ? (zcplx *)x + (ptrdiff_t)(1 - N) * inc : (zcplx *)x;
+}
+
+static inline const zcplx *zcvec(const void *x, const int N, const int inc) {
+  return inc < 0 ? (const zcplx *)x + (ptrdiff_t)(1 - N) * inc : (const zcplx *)x;
+}
+
+static inline zcplx zconj_if(const int cj, const zcplx a) { return cj ? conj(a) : a; }
+
+static zcplx *zalloc(const ptrdiff_t n) {
+  zcplx *p = (zcplx *)malloc((size_t)(n > 0 ? n : 1) * sizeof(zcplx));
+  if (!p) abort();
+  return p;
+}
+
+// ---------------------------------------------------------------------------
+// Level 1
+// ---------------------------------------------------------------------------
+
+static zcplx zdot(const int cj, const int N, const void *X, const int incX, const void *Y, const int incY) {
+  if (N <= 0) return 0;
+  const zcplx *x = zcvec(X, N, incX), *y = zcvec(Y, N, incY);
+  double re = 0, im = 0;
+  for (ptrdiff_t i = 0; i < N; i++) {
+    const zcplx a = x[i * incX], b = y[i * incY];
+    const double ai = cj ? -cimag(a) : cimag(a);
+    re += creal(a) * creal(b) - ai * cimag(b);
+    im += creal(a) * cimag(b) + ai * creal(b);
+  }
+  return CMPLX(re, im);
+}
+
+void LEANBLAS_NATIVE(zdotu_sub)(const int N, const void *X, const int incX, const void *Y, const int incY,
+                                void *dotu) {
+  *(zcplx *)dotu = zdot(0, N, X, incX, Y, incY);
+}
+
+void LEANBLAS_NATIVE(zdotc_sub)(const int N, const void *X, const int incX, const void *Y, const int incY,
+                                void *dotc) {
+  *(zcplx *)dotc = zdot(1, N, X, incX, Y, incY);
+}
+
+double LEANBLAS_NATIVE(dznrm2)(const int N, const void *X, const int incX) {
+  if (N <= 0 || incX <= 0) return 0;
+  const double *x = (const double *)X;
+  double ssq = 0;
+  for (ptrdiff_t i = 0; i < N; i++) {
+    const double re = x[2 * i * incX], im = x[2 * i * incX + 1];
+    ssq += re * re + im * im;
+  }
+  if (isfinite(ssq) && ssq > 1e-290) return sqrt(ssq);
+
+  double scale = 0, sumsq = 1;
+  for (ptrdiff_t i = 0; i < 2 * (ptrdiff_t)N; i++) {
+    const double v = fabs(x[(i / 2) * 2 * incX + (i % 2)]);
+    if (v == 0) continue;
+    if (isnan(v)) return v;
+    if (scale < v) {
+      sumsq = 1 + sumsq * (scale / v) * (scale / v);
+      scale = v;
+    } else {
+      sumsq += (v / scale) * (v / scale);
+    }
+  }
+  return scale * sqrt(sumsq);
+}
+
+double LEANBLAS_NATIVE(dzasum)(const int N, const void *X, const int incX) {
+  if (N <= 0 || incX <= 0) return 0;
+  const double *x = (const double *)X;
+  double r = 0;
+  for (ptrdiff_t i = 0; i < N; i++) r += fabs(x[2 * i * incX]) + fabs(x[2 * i * incX + 1]);
+  return r;
+}
+
+size_t LEANBLAS_NATIVE(izamax)(const int N, const void *X, const int incX) {
+  if (N <= 0 || incX <= 0) return 0;
+  const double *x = (const double *)X;
+  size_t best = 0;
+  double bestv = fabs(x[0]) + fabs(x[1]);
+  for (ptrdiff_t i = 1; i < N; i++) {
+    const double v = fabs(x[2 * i * incX]) + fabs(x[2 * i * incX + 1]);
+    if (v > bestv) {
+      bestv = v;
+      best = (size_t)i;
+    }
+  }
+  return best;
+}
+
+void LEANBLAS_NATIVE(zswap)(const int N, void *X, const int incX, void *Y, const int incY) {
+  if (N <= 0) return;
+  zcplx *x = zvec(X, N, incX), *y = zvec(Y, N, incY);
+  for (ptrdiff_t i = 0; i < N; i++) {
+    const zcplx t = x[i * incX];
+    x[i * incX] = y[i * incY];
+    y[i * incY] = t;
+  }
+}
+
+void LEANBLAS_NATIVE(zcopy)(const int N, const void *X, const int incX, void *Y, const int incY) {
+  if (N <= 0) return;
+  if (incX == 1 && incY == 1) {
+    memmove(Y, X, (size_t)N * sizeof(zcplx));
+    return;
+  }
+  const zcplx *x = zcvec(X, N, incX);
+  zcplx *y = zvec(Y, N, incY);
+  for (ptrdiff_t i = 0; i < N; i++) y[i * incY] = x[i * incX];
+}
+
+void LEANBLAS_NATIVE(zaxpy)(const int N, const void *alpha, const void *X, const int incX, void *Y,
+                            const int incY) {
+  const zcplx a = *(const zcplx *)alpha;
+  if (N <= 0 || a == 0) return;
+  const zcplx *x = zcvec(X, N, incX);
+  zcplx *y = zvec(Y, N, incY);
+  for (ptrdiff_t i = 0; i < N; i++) y[i * incY] += a * x[i * incX];
+}
+
+void LEANBLAS_NATIVE(zscal)(const int N, const void *alpha, void *X, const int incX) {
+  if (N <= 0 || incX <= 0) return;
+  const zcplx a = *(const zcplx *)alpha;
+  zcplx *x = (zcplx *)X;
+  for (ptrdiff_t i = 0; i < N; i++) x[i * incX] *= a;
+}
+
+void LEANBLAS_NATIVE(zdscal)(const int N, const double alpha, void *X, const int incX) {
+  if (N <= 0 || incX <= 0) return;
+  double *x = (double *)X;
+  for (ptrdiff_t i = 0; i < N; i++) {
+    x[2 * i * incX] *= alpha;
+    x[2 * i * incX + 1] *= alpha;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Level 2
+// ---------------------------------------------------------------------------
+
+// y := beta*y over a strided vector (beta == 0 clears, so NaNs in y do not leak).
+static void zscale_vec(const int n, const zcplx beta, zcplx *y, const int incy) {
+  if (beta == 1) return;
+  for (ptrdiff_t i = 0; i < n; i++) y[i * incy] = beta == 0 ? 0 : beta * y[i * incy];
+}
+
+// y := alpha*op(A)*x + beta*y with op(A) = A, Aᵀ or conj applied on top (cj).
+static void zgemv_col(const int trans, const int cj, const int M, const int N, const zcplx alpha,
+                      const zcplx *A, const ptrdiff_t lda, const void *X, const int incX, const zcplx beta,
+                      void *Y, const int incY) {
+  if (M <= 0 || N <= 0) return;
+  const int lenx = trans ? M : N, leny = trans ? N : M;
+  const zcplx *x = zcvec(X, lenx, incX);
+  zcplx *y = zvec(Y, leny, incY);
+  zscale_vec(leny, beta, y, incY);
+  if (alpha == 0) return;
+  if (!trans) {
+    for (ptrdiff_t j = 0; j < N; j++) {
+      const zcplx t = alpha * x[j * incX];
+      const zcplx *a = A + j * lda;
+      if (cj) {
+        for (ptrdiff_t i = 0; i < M; i++) y[i * incY] += t * conj(a[i]);
+      } else {
+        for (ptrdiff_t i = 0; i < M; i++) y[i * incY] += t * a[i];
+      }
+    }
+  } else {
+    for (ptrdiff_t j = 0; j < N; j++) {
+      const zcplx *a = A + j * lda;
+      zcplx s = 0;
+      if (cj) {
+        for (ptrdiff_t i = 0; i < M; i++) s += conj(a[i]) * x[i * incX];
+      } else {
+        for (ptrdiff_t i = 0; i < M; i++) s += a[i] * x[i * incX];
+      }
+      y[j * incY] += alpha * s;
+    }
+  }
+}
+
+void LEANBLAS_NATIVE(zgemv)(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, const void *X, const int incX,
+                            const void *beta, void *Y, const int incY) {
+  const zcplx a = *(const zcplx *)alpha, b = *(const zcplx *)beta;
+  if (order == CblasColMajor)
+    zgemv_col(TransA != CblasNoTrans, TransA == CblasConjTrans, M, N, a, (const zcplx *)A, lda, X, incX, b, Y, incY);
+  else
+    zgemv_col(TransA == CblasNoTrans, TransA == CblasConjTrans, N, M, a, (const zcplx *)A, lda, X, incX, b, Y, incY);
+}
+
+// Hermitian element (i, j) from the stored triangle, conjugated when cj.
+static inline zcplx zherm_at(const int upper, const int cj, const zcplx *A, const ptrdiff_t lda,
+                             const ptrdiff_t i, const ptrdiff_t j) {
+  zcplx a;
+  if (i == j)
+    a = creal(A[i + i * lda]);
+  else if ((i < j) == upper)
+    a = A[i + j * lda];
+  else
+    a = conj(A[j + i * lda]);
+  return zconj_if(cj, a);
+}
+
+void LEANBLAS_NATIVE(zhemv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const void *alpha,
+                            const void *A, const int lda, const void *X, const int incX, const void *beta,
+                            void *Y, const int incY) {
+  if (N <= 0) return;
+  // The row-major view of a Hermitian matrix is its conjugate in column-major.
+  const int upper = (Uplo == CblasUpper) == (order == CblasColMajor);
+  const int cj = order == CblasRowMajor;
+  const zcplx al = *(const zcplx *)alpha, be = *(const zcplx *)beta;
+  const zcplx *a = (const zcplx *)A, *x = zcvec(X, N, incX);
+  zcplx *y = zvec(Y, N, incY);
+  zscale_vec(N, be, y, incY);
+  if (al == 0) return;
+  for (ptrdiff_t i = 0; i < N; i++) {
+    zcplx s = 0;
+    for (ptrdiff_t j = 0; j < N; j++) s += zherm_at(upper, cj, a, lda, i, j) * x[j * incX];
+    y[i * incY] += al * s;
+  }
+}
+
+// Element (i, j) of op(A) with op given by (trans, cj).
+static inline zcplx zop_at(const int trans, const int cj, const zcplx *A, const ptrdiff_t lda, const ptrdiff_t i,
+                           const ptrdiff_t j) {
+  return zconj_if(cj, trans ? A[j + i * lda] : A[i + j * lda]);
+}
+
+// x := op(A)*x (solve = 0) or x := op(A)⁻¹*x (solve = 1) for triangular A.
+static void ztrxv_col(const int solve, const int upper, const int trans, const int cj, const int unit, const int N,
+                      const zcplx *A, const ptrdiff_t lda, zcplx *x, const ptrdiff_t incx) {
+  const int lower = upper == trans;  // op(A) is lower triangular
+  for (ptrdiff_t s = 0; s < N; s++) {
+    // Solves go in dependency order, multiplies in reverse so inputs stay intact.
+    const ptrdiff_t i = (solve == lower) ? s : N - 1 - s;
+    const ptrdiff_t lo = lower ? 0 : i + 1, hi = lower ? i : N;
+    zcplx acc = 0;
+    for (ptrdiff_t j = lo; j < hi; j++) acc += zop_at(trans, cj, A, lda, i, j) * x[j * incx];
+    const zcplx d = unit ? 1 : zop_at(trans, cj, A, lda, i, i);
+    x[i * incx] = solve ? (x[i * incx] - acc) / d : d * x[i * incx] + acc;
+  }
+}
+
+static void ztrxv(const int solve, const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                  const CBLAS_DIAG Diag, const int N, const void *A, const int lda, void *X, const int incX) {
+  if (N <= 0) return;
+  const int col = order == CblasColMajor;
+  const int upper = (Uplo == CblasUpper) == col;
+  const int trans = (TransA != CblasNoTrans) == col;
+  ztrxv_col(solve, upper, trans, TransA == CblasConjTrans, Diag == CblasUnit, N, (const zcplx *)A, lda,
+            zvec(X, N, incX), incX);
+}
+
+void LEANBLAS_NATIVE(ztrmv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const void *A, const int lda, void *X, const int incX) {
+  ztrxv(0, order, Uplo, TransA, Diag, N, A, lda, X, incX);
+}
+
+void LEANBLAS_NATIVE(ztrsv)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE TransA,
+                            const CBLAS_DIAG Diag, const int N, const void *A, const int lda, void *X, const int incX) {
+  ztrxv(1, order, Uplo, TransA, Diag, N, A, lda, X, incX);
+}
+
+// A := alpha*x*op(y)ᵀ with op(y) = y or conj(y), on an M×N column-major A.
+static void zger_col(const int M, const int N, const zcplx alpha, const void *X, const int incX, const int cjx,
+                     const void *Y, const int incY, const int cjy, zcplx *A, const ptrdiff_t lda) {
+  if (M <= 0 || N <= 0 || alpha == 0) return;
+  const zcplx *x = zcvec(X, M, incX), *y = zcvec(Y, N, incY);
+  for (ptrdiff_t j = 0; j < N; j++) {
+    const zcplx t = alpha * zconj_if(cjy, y[j * incY]);
+    zcplx *a = A + j * lda;
+    for (ptrdiff_t i = 0; i < M; i++) a[i] += t * zconj_if(cjx, x[i * incX]);
+  }
+}
+
+void LEANBLAS_NATIVE(zgeru)(const CBLAS_ORDER order, const int M, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda) {
+  const zcplx a = *(const zcplx *)alpha;
+  if (order == CblasColMajor)
+    zger_col(M, N, a, X, incX, 0, Y, incY, 0, (zcplx *)A, lda);
+  else
+    zger_col(N, M, a, Y, incY, 0, X, incX, 0, (zcplx *)A, lda);
+}
+
+void LEANBLAS_NATIVE(zgerc)(const CBLAS_ORDER order, const int M, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda) {
+  const zcplx a = *(const zcplx *)alpha;
+  // Row-major: Aᵀ += alpha*conj(y)*xᵀ.
+  if (order == CblasColMajor)
+    zger_col(M, N, a, X, incX, 0, Y, incY, 1, (zcplx *)A, lda);
+  else
+    zger_col(N, M, a, Y, incY, 1, X, incX, 0, (zcplx *)A, lda);
+}
+
+// A := alpha*x*yᴴ + conj(alpha)*y*xᴴ on one triangle, x and y conjugated first
+// when cj.  The diagonal is kept real, like the reference implementation.
+static void zher2_col(const int upper, const int cj, const int N, const zcplx alpha, const void *X, const int incX,
+                      const void *Y, const int incY, zcplx *A, const ptrdiff_t lda) {
+  if (N <= 0 || alpha == 0) return;
+  const zcplx *x = zcvec(X, N, incX), *y = zcvec(Y, N, incY);
+  for (ptrdiff_t j = 0; j < N; j++) {
+    const zcplx xj = zconj_if(cj, x[j * incX]), yj = zconj_if(cj, y[j * incY]);
+    const zcplx t1 = alpha * conj(yj), t2 = conj(alpha * xj);
+    zcplx *a = A + j * lda;
+    const ptrdiff_t lo = upper ? 0 : j + 1, hi = upper ? j : N;
+    for (ptrdiff_t i = lo; i < hi; i++)
+      a[i] += zconj_if(cj, x[i * incX]) * t1 + zconj_if(cj, y[i * incY]) * t2;
+    a[j] = creal(a[j]) + creal(xj * t1 + yj * t2);
+  }
+}
+
+void LEANBLAS_NATIVE(zher)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const double alpha,
+                           const void *X, const int incX, void *A, const int lda) {
+  // alpha*x*xᴴ = (alpha/2)*x*xᴴ + (alpha/2)*x*xᴴ.
+  const int col = order == CblasColMajor;
+  zher2_col((Uplo == CblasUpper) == col, !col, N, alpha / 2, X, incX, X, incX, (zcplx *)A, lda);
+}
+
+void LEANBLAS_NATIVE(zher2)(const CBLAS_ORDER order, const CBLAS_UPLO Uplo, const int N, const void *alpha,
+                            const void *X, const int incX, const void *Y, const int incY, void *A, const int lda) {
+  // Row-major: conj(A) += conj(alpha)*conj(x)*conj(y)ᴴ + alpha*conj(y)*conj(x)ᴴ.
+  const int col = order == CblasColMajor;
+  const zcplx a = *(const zcplx *)alpha;
+  zher2_col((Uplo == CblasUpper) == col, !col, N, col ? a : conj(a), X, incX, Y, incY, (zcplx *)A, lda);
+}
+
+// ---------------------------------------------------------------------------
+// Level 3
+// ---------------------------------------------------------------------------
+
+#define NATIVE_ZGEMM_BLOCK 512
+
+enum { ZOP_N, ZOP_T, ZOP_C };
+
+static int zop(const CBLAS_TRANSPOSE t) { return t == CblasNoTrans ? ZOP_N : t == CblasTrans ? ZOP_T : ZOP_C; }
+
+// Splits rows [r0, r0+m) × cols [c0, c0+n) of op(X) into column-major real and
+// imaginary parts with leading dimension m.
+static void zsplit(const int op, const zcplx *X, const ptrdiff_t ldx, const ptrdiff_t r0, const ptrdiff_t m,
+                   const ptrdiff_t c0, const ptrdiff_t n, double *re, double *im) {
+  const double sgn = op == ZOP_C ? -1 : 1;
+  for (ptrdiff_t j = 0; j < n; j++)
+    for (ptrdiff_t i = 0; i < m; i++) {
+      const zcplx v = op == ZOP_N ? X[(r0 + i) + (c0 + j) * ldx] : X[(c0 + j) + (r0 + i) * ldx];
+      re[i + j * m] = creal(v);
+      im[i + j * m] = sgn * cimag(v);
+    }
+}
+
+// C := alpha*op(A)*op(B) + beta*C, column-major.  Each block of the product is
+// formed as (Ar + i Ai)(Br + i Bi) with four real gemms.
+static void zgemm_col(const int opA, const int opB, const int M, const int N, const int K, const zcplx alpha,
+                      const zcplx *A, const ptrdiff_t lda, const zcplx *B, const ptrdiff_t ldb, const zcplx beta,
+                      zcplx *C, const ptrdiff_t ldc) {
+  if (M <= 0 || N <= 0) return;
+  if (alpha == 0 || K <= 0) {
+    for (ptrdiff_t j = 0; j < N; j++) zscale_vec(M, beta, C + j * ldc, 1);
+    return;
+  }
+  const ptrdiff_t bs = NATIVE_ZGEMM_BLOCK;
+  const ptrdiff_t mb = M < bs ? M : bs, nb = N < bs ? N : bs, kb = K < bs ? K : bs;
+  double *buf = (double *)malloc(sizeof(double) * 2 * (size_t)(mb * kb + kb * nb + mb * nb));
+  if (!buf) abort();
+  double *Ar = buf, *Ai = Ar + mb * kb, *Br = Ai + mb * kb, *Bi = Br + kb * nb, *Cr = Bi + kb * nb,
+         *Ci = Cr + mb * nb;
+
+  for (ptrdiff_t jc = 0; jc < N; jc += bs) {
+    const int n = (int)(N - jc < bs ? N - jc : bs);
+    for (ptrdiff_t ic = 0; ic < M; ic += bs) {
+      const int m = (int)(M - ic < bs ? M - ic : bs);
+      for (ptrdiff_t pc = 0; pc < K; pc += bs) {
+        const int k = (int)(K - pc < bs ? K - pc : bs);
+        const double b0 = pc == 0 ? 0 : 1;
+        zsplit(opA, A, lda, ic, m, pc, k, Ar, Ai);
+        zsplit(opB, B, ldb, pc, k, jc, n, Br, Bi);
+        LEANBLAS_NATIVE(dgemm)(CblasColMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1, Ar, m, Br, k, b0, Cr, m);
+        LEANBLAS_NATIVE(dgemm)(CblasColMajor, CblasNoTrans, CblasNoTrans, m, n, k, -1, Ai, m, Bi, k, 1, Cr, m);
+        LEANBLAS_NATIVE(dgemm)(CblasColMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1, Ar, m, Bi, k, b0, Ci, m);
+        LEANBLAS_NATIVE(dgemm)(CblasColMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1, Ai, m, Br, k, 1, Ci, m);
+      }
+      for (ptrdiff_t j = 0; j < n; j++) {
+        zcplx *c = C + ic + (jc + j) * ldc;
+        for (ptrdiff_t i = 0; i < m; i++) {
+          const zcplx p = alpha * CMPLX(Cr[i + j * m], Ci[i + j * m]);
+          c[i] = beta == 0 ? p : p + beta * c[i];
+        }
+      }
+    }
+  }
+  free(buf);
+}
+
+void LEANBLAS_NATIVE(zgemm)(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                            const int M, const int N, const int K, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc) {
+  const zcplx a = *(const zcplx *)alpha, b = *(const zcplx *)beta;
+  // Row-major C = op(A) op(B) is column-major Cᵀ = op(B)ᵀ op(A)ᵀ; the
+  // transpose kinds carry over unchanged.
+  if (Order == CblasColMajor)
+    zgemm_col(zop(TransA), zop(TransB), M, N, K, a, (const zcplx *)A, lda, (const zcplx *)B, ldb, b, (zcplx *)C,
+              ldc);
+  else
+    zgemm_col(zop(TransB), zop(TransA), N, M, K, a, (const zcplx *)B, ldb, (const zcplx *)A, lda, b, (zcplx *)C,
+              ldc);
+}
+
+// Symmetric (herm = 0) or Hermitian (herm = 1) multiply: the stored triangle is
+// expanded into a full square matrix and handed to zgemm.
+static void zsymm_col(const int herm, const int left, const int upper, const int M, const int N, const zcplx alpha,
+                      const zcplx *A, const ptrdiff_t lda, const zcplx *B, const ptrdiff_t ldb, const zcplx beta,
+                      zcplx *C, const ptrdiff_t ldc) {
+  if (M <= 0 || N <= 0) return;
+  const ptrdiff_t ka = left ? M : N;
+  zcplx *F = zalloc(ka * ka);
+  for (ptrdiff_t j = 0; j < ka; j++)
+    for (ptrdiff_t i = 0; i < ka; i++) {
+      if (herm) {
+        F[i + j * ka] = zherm_at(upper, 0, A, lda, i, j);
+      } else {
+        const int stored = upper ? i <= j : i >= j;
+        F[i + j * ka] = stored ? A[i + j * lda] : A[j + i * lda];
+      }
+    }
+  if (left)
+    zgemm_col(ZOP_N, ZOP_N, M, N, M, alpha, F, ka, B, ldb, beta, C, ldc);
+  else
+    zgemm_col(ZOP_N, ZOP_N, M, N, N, alpha, B, ldb, F, ka, beta, C, ldc);
+  free(F);
+}
+
+static void zsymm_any(const int herm, const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                      const int M, const int N, const void *alpha, const void *A, const int lda, const void *B,
+                      const int ldb, const void *beta, void *C, const int ldc) {
+  const int left = Side == CblasLeft, upper = Uplo == CblasUpper;
+  const zcplx a = *(const zcplx *)alpha, b = *(const zcplx *)beta;
+  if (Order == CblasColMajor)
+    zsymm_col(herm, left, upper, M, N, a, (const zcplx *)A, lda, (const zcplx *)B, ldb, b, (zcplx *)C, ldc);
+  else
+    zsymm_col(herm, !left, !upper, N, M, a, (const zcplx *)A, lda, (const zcplx *)B, ldb, b, (zcplx *)C, ldc);
+}
+
+void LEANBLAS_NATIVE(zsymm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc) {
+  zsymm_any(0, Order, Side, Uplo, M, N, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void LEANBLAS_NATIVE(zhemm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const int M, const int N, const void *alpha, const void *A, const int lda,
+                            const void *B, const int ldb, const void *beta, void *C, const int ldc) {
+  zsymm_any(1, Order, Side, Uplo, M, N, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+#define NATIVE_ZRANK_BLOCK 64
+
+// C := alpha*op(A)*op(B)ᵀ [+ alpha*op(B)*op(A)ᵀ] + beta*C on one triangle
+// (herm = 0), or the Hermitian variant with ᴴ and conj(alpha) on the second
+// term (herm = 1, diagonal kept real).  op(X) is N×K.  Off-diagonal blocks go
+// straight to zgemm; diagonal blocks go through a scratch tile.
+static void zsyr2k_col(const int herm, const int upper, const int trans, const int two, const int N, const int K,
+                       const zcplx alpha, const zcplx *A, const ptrdiff_t lda, const zcplx *B, const ptrdiff_t ldb,
+                       const zcplx beta, zcplx *C, const ptrdiff_t ldc) {
+  if (N <= 0 || ((alpha == 0 || K <= 0) && beta == 1)) return;
+  const int t = herm ? ZOP_C : ZOP_T;
+  const int opN = trans ? t : ZOP_N, opT = trans ? ZOP_N : t;
+  const zcplx alpha2 = herm ? conj(alpha) : alpha;
+#define OPROWS(X, ldx, r0) ((X) + (trans ? (ptrdiff_t)(r0) * (ldx) : (ptrdiff_t)(r0)))
+
+  zcplx *T = zalloc((ptrdiff_t)NATIVE_ZRANK_BLOCK * NATIVE_ZRANK_BLOCK);
+  for (ptrdiff_t jb = 0; jb < N; jb += NATIVE_ZRANK_BLOCK) {
+    const int nb = (int)(N - jb < NATIVE_ZRANK_BLOCK ? N - jb : NATIVE_ZRANK_BLOCK);
+
+    const ptrdiff_t r0 = upper ? 0 : jb + nb;
+    const int rn = (int)(upper ? jb : N - jb - nb);
+    if (rn > 0) {
+      zcplx *Cb = C + r0 + jb * ldc;
+      zgemm_col(opN, opT, rn, nb, K, alpha, OPROWS(A, lda, r0), lda, OPROWS(B, ldb, jb), ldb, beta, Cb, ldc);
+      if (two)
+        zgemm_col(opN, opT, rn, nb, K, alpha2, OPROWS(B, ldb, r0), ldb, OPROWS(A, lda, jb), lda, 1, Cb, ldc);
+    }
+
+    zgemm_col(opN, opT, nb, nb, K, alpha, OPROWS(A, lda, jb), lda, OPROWS(B, ldb, jb), ldb, 0, T, nb);
+    if (two) zgemm_col(opN, opT, nb, nb, K, alpha2, OPROWS(B, ldb, jb), ldb, OPROWS(A, lda, jb), lda, 1, T, nb);
+    for (ptrdiff_t j = 0; j < nb; j++) {
+      const ptrdiff_t lo = upper ? 0 : j, hi = upper ? j : nb - 1;
+      zcplx *c = C + jb + (jb + j) * ldc;
+      for (ptrdiff_t i = lo; i <= hi; i++) c[i] = T[i + j * nb] + (beta == 0 ? 0 : beta * c[i]);
+      if (herm) c[j] = creal(c[j]);
+    }
+  }
+  free(T);
+#undef OPROWS
+}
+
+void LEANBLAS_NATIVE(zsyrk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const void *alpha, const void *A, const int lda,
+                            const void *beta, void *C, const int ldc) {
+  const int col = Order == CblasColMajor;
+  zsyr2k_col(0, (Uplo == CblasUpper) == col, (Trans != CblasNoTrans) == col, 0, N, K, *(const zcplx *)alpha,
+             (const zcplx *)A, lda, (const zcplx *)A, lda, *(const zcplx *)beta, (zcplx *)C, ldc);
+}
+
+void LEANBLAS_NATIVE(zherk)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                            const int N, const int K, const double alpha, const void *A, const int lda,
+                            const double beta, void *C, const int ldc) {
+  const int col = Order == CblasColMajor;
+  zsyr2k_col(1, (Uplo == CblasUpper) == col, (Trans != CblasNoTrans) == col, 0, N, K, alpha, (const zcplx *)A, lda,
+             (const zcplx *)A, lda, beta, (zcplx *)C, ldc);
+}
+
+void LEANBLAS_NATIVE(zsyr2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const void *alpha, const void *A, const int lda,
+                             const void *B, const int ldb, const void *beta, void *C, const int ldc) {
+  const int col = Order == CblasColMajor;
+  zsyr2k_col(0, (Uplo == CblasUpper) == col, (Trans != CblasNoTrans) == col, 1, N, K, *(const zcplx *)alpha,
+             (const zcplx *)A, lda, (const zcplx *)B, ldb, *(const zcplx *)beta, (zcplx *)C, ldc);
+}
+
+void LEANBLAS_NATIVE(zher2k)(const CBLAS_ORDER Order, const CBLAS_UPLO Uplo, const CBLAS_TRANSPOSE Trans,
+                             const int N, const int K, const void *alpha, const void *A, const int lda,
+                             const void *B, const int ldb, const double beta, void *C, const int ldc) {
+  // Row-major: conj(C) = conj(alpha)*op'(A)*op'(B)ᴴ + alpha*op'(B)*op'(A)ᴴ.
+  const int col = Order == CblasColMajor;
+  const zcplx a = *(const zcplx *)alpha;
+  zsyr2k_col(1, (Uplo == CblasUpper) == col, (Trans != CblasNoTrans) == col, 1, N, K, col ? a : conj(a),
+             (const zcplx *)A, lda, (const zcplx *)B, ldb, beta, (zcplx *)C, ldc);
+}
+
+// B := alpha*op(A)*B or alpha*B*op(A) (solve = 0), or the same with op(A)⁻¹
+// (solve = 1), column-major.  Right-side calls run on a transposed copy of B,
+// where B*op(A) becomes op(A)ᵀ*Bᵀ.
+static void ztrxm_col(const int solve, const int left, const int upper, const int op, const int unit, const int M,
+                      const int N, const zcplx alpha, const zcplx *A, const ptrdiff_t lda, zcplx *B,
+                      const ptrdiff_t ldb) {
+  if (M <= 0 || N <= 0) return;
+  for (ptrdiff_t j = 0; j < N; j++) zscale_vec(M, alpha, B + j * ldb, 1);
+  if (alpha == 0) return;
+  if (left) {
+    for (ptrdiff_t j = 0; j < N; j++)
+      ztrxv_col(solve, upper, op != ZOP_N, op == ZOP_C, unit, M, A, lda, B + j * ldb, 1);
+    return;
+  }
+  zcplx *Bt = zalloc((ptrdiff_t)M * N);
+  for (ptrdiff_t j = 0; j < N; j++)
+    for (ptrdiff_t i = 0; i < M; i++) Bt[j + i * N] = B[i + j * ldb];
+  // op(A)ᵀ: Aᵀ for N, A for T, conj(A) for C.
+  for (ptrdiff_t i = 0; i < M; i++)
+    ztrxv_col(solve, upper, op == ZOP_N, op == ZOP_C, unit, N, A, lda, Bt + i * N, 1);
+  for (ptrdiff_t j = 0; j < N; j++)
+    for (ptrdiff_t i = 0; i < M; i++) B[i + j * ldb] = Bt[j + i * N];
+  free(Bt);
+}
+
+static void ztrxm(const int solve, const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                  const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N, const void *alpha,
+                  const void *A, const int lda, void *B, const int ldb) {
+  const int left = Side == CblasLeft, upper = Uplo == CblasUpper, unit = Diag == CblasUnit;
+  const zcplx a = *(const zcplx *)alpha;
+  if (Order == CblasColMajor)
+    ztrxm_col(solve, left, upper, zop(TransA), unit, M, N, a, (const zcplx *)A, lda, (zcplx *)B, ldb);
+  else
+    ztrxm_col(solve, !left, !upper, zop(TransA), unit, N, M, a, (const zcplx *)A, lda, (zcplx *)B, ldb);
+}
+
+void LEANBLAS_NATIVE(ztrmm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, void *B, const int ldb) {
+  ztrxm(0, Order, Side, Uplo, TransA, Diag, M, N, alpha, A, lda, B, ldb);
+}
+
+void LEANBLAS_NATIVE(ztrsm)(const CBLAS_ORDER Order, const CBLAS_SIDE Side, const CBLAS_UPLO Uplo,
+                            const CBLAS_TRANSPOSE TransA, const CBLAS_DIAG Diag, const int M, const int N,
+                            const void *alpha, const void *A, const int lda, void *B, const int ldb) {
+  ztrxm(1, Order, Side, Uplo, TransA, Diag, M, N, alpha, A, lda, B, ldb);
+}
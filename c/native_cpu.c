@@ -0,0 +1,268 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "native.h"
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#ifdef LEANBLAS_X86_DISPATCH
+#include <cpuid.h>
+#endif
+
+// Run-time CPU detection and the kernel dispatch registry of the native
+// backend.
+//
+// Features are read with cpuid and only reported when the OS also saves the
+// matching register state (xgetbv), so an AVX-512 CPU under a kernel that
+// does not enable zmm state reports AVX2 only.  Cache sizes and topology come
+// from sysfs on Linux and sysctl on macOS.
+
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static leanblas_cpu_info cpu_info;
+
+static const char *const feature_names[LEANBLAS_CPU_FEATURE_COUNT] = {
+    "sse4_1",   "sse4_2",   "avx",         "avx2",        "fma",      "avx512f", "avx512dq",
+    "avx512bw", "avx512vl", "avx512_vnni", "avx512_bf16", "avx_vnni", "neon",
+};
+
+const char *leanblas_cpu_feature_name(uint32_t feature) {
+  for (int i = 0; i < LEANBLAS_CPU_FEATURE_COUNT; i++)
+    if (feature == (1u << i)) return feature_names[i];
+  return "unknown";
+}
+
+#ifdef LEANBLAS_X86_DISPATCH
+static uint64_t xgetbv0(void) {
+  uint32_t lo, hi;
+  __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+static void detect_x86(leanblas_cpu_info *info) {
+  unsigned a, b, c, d;
+  if (!__get_cpuid(0, &a, &b, &c, &d)) return;
+  const unsigned max_leaf = a;
+  memcpy(info->vendor, &b, 4);
+  memcpy(info->vendor + 4, &d, 4);
+  memcpy(info->vendor + 8, &c, 4);
+  info->vendor[12] = 0;
+
+  __get_cpuid(1, &a, &b, &c, &d);
+  uint32_t f = 0;
+  if (c & (1u << 19)) f |= LEANBLAS_CPU_SSE4_1;
+  if (c & (1u << 20)) f |= LEANBLAS_CPU_SSE4_2;
+  const int osxsave = (c >> 27) & 1;
+  const uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+  const int ymm_ok = (xcr0 & 0x6) == 0x6;     // SSE + AVX state
+  const int zmm_ok = (xcr0 & 0xe6) == 0xe6;   // + opmask, ZMM_Hi256, Hi16_ZMM
+  if (ymm_ok && (c & (1u << 28))) f |= LEANBLAS_CPU_AVX;
+  if (ymm_ok && (c & (1u << 12))) f |= LEANBLAS_CPU_FMA;
+
+  if (max_leaf >= 7) {
+    __cpuid_count(7, 0, a, b, c, d);
+    const unsigned max_sub = a;
+    if (ymm_ok && (b & (1u << 5))) f |= LEANBLAS_CPU_AVX2;
+    if (zmm_ok) {
+      if (b & (1u << 16)) f |= LEANBLAS_CPU_AVX512F;
+      if (b & (1u << 17)) f |= LEANBLAS_CPU_AVX512DQ;
+      if (b & (1u << 30)) f |= LEANBLAS_CPU_AVX512BW;
+      if (b & (1u << 31)) f |= LEANBLAS_CPU_AVX512VL;
+      if (c & (1u << 11)) f |= LEANBLAS_CPU_AVX512_VNNI;
+    }
+    if (max_sub >= 1) {
+      __cpuid_count(7, 1, a, b, c, d);
+      if (ymm_ok && (a & (1u << 4))) f |= LEANBLAS_CPU_AVX_VNNI;
+      if (zmm_ok && (a & (1u << 5))) f |= LEANBLAS_CPU_AVX512_BF16;
+    }
+  }
+  info->features = f;
+}
+#endif
+
+#if defined(__linux__)
+static long read_sysfs_long(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return -1;
+  long v = -1;
+  if (fscanf(f, "%ld", &v) != 1) v = -1;
+  fclose(f);
+  return v;
+}
+
+// Sizes like "48K" or "32M" from /sys/devices/system/cpu/cpu0/cache/index*/.
+static void detect_caches_linux(leanblas_cpu_info *info) {
+  char path[128], buf[32];
+  for (int idx = 0; idx < 8; idx++) {
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+    const long level = read_sysfs_long(path);
+    if (level < 0) break;
+
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+    FILE *f = fopen(path, "r");
+    if (!f) continue;
+    const int ok = fscanf(f, "%31s", buf) == 1;
+    fclose(f);
+    if (!ok || strcmp(buf, "Instruction") == 0) continue;
+
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+    f = fopen(path, "r");
+    if (!f) continue;
+    long size = 0;
+    char unit = 0;
+    const int n = fscanf(f, "%ld%c", &size, &unit);
+    fclose(f);
+    if (n < 1) continue;
+    if (unit == 'K') size <<= 10;
+    if (unit == 'M') size <<= 20;
+    if (level == 1) info->l1d_bytes = (size_t)size;
+    if (level == 2) info->l2_bytes = (size_t)size;
+    if (level == 3) info->l3_bytes = (size_t)size;
+  }
+}
+
+// Distinct (package, core) pairs over the CPUs this process may run on, so a
+// container limited to a few CPUs does not size its thread pool for the host.
+static void detect_topology_linux(leanblas_cpu_info *info) {
+  enum { MAX_CORES = 1024 };
+  static long cores[MAX_CORES][2];
+  long packages[64];
+  int ncores = 0, npackages = 0;
+  cpu_set_t mask;
+  const int have_mask = sched_getaffinity(0, sizeof mask, &mask) == 0;
+  if (have_mask && CPU_COUNT(&mask) > 0) info->logical_cpus = CPU_COUNT(&mask);
+  const long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+  char path[128];
+  for (long cpu = 0; cpu < ncpu; cpu++) {
+    if (have_mask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &mask))) continue;
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%ld/topology/physical_package_id", cpu);
+    const long pkg = read_sysfs_long(path);
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%ld/topology/core_id", cpu);
+    const long core = read_sysfs_long(path);
+    if (pkg < 0 || core < 0) continue;
+    int seen = 0;
+    for (int i = 0; i < ncores && !seen; i++) seen = cores[i][0] == pkg && cores[i][1] == core;
+    if (!seen && ncores < MAX_CORES) {
+      cores[ncores][0] = pkg;
+      cores[ncores][1] = core;
+      ncores++;
+    }
+    seen = 0;
+    for (int i = 0; i < npackages && !seen; i++) seen = packages[i] == pkg;
+    if (!seen && npackages < 64) packages[npackages++] = pkg;
+  }
+  if (ncores > 0) info->physical_cores = ncores;
+  if (npackages > 0) info->packages = npackages;
+}
+#endif
+
+#if defined(__APPLE__)
+static long sysctl_long(const char *name) {
+  int64_t v = 0;
+  size_t len = sizeof v;
+  if (sysctlbyname(name, &v, &len, NULL, 0) != 0) return -1;
+  return len == sizeof(int32_t) ? (long)*(int32_t *)&v : (long)v;
+}
+#endif
+
+static void cpu_detect(void) {
+  leanblas_cpu_info *info = &cpu_info;
+  memset(info, 0, sizeof *info);
+  strcpy(info->vendor, "unknown");
+  info->logical_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (info->logical_cpus < 1) info->logical_cpus = 1;
+
+#ifdef LEANBLAS_X86_DISPATCH
+  detect_x86(info);
+#elif defined(__aarch64__)
+  strcpy(info->vendor, "arm64");
+  info->features = LEANBLAS_CPU_NEON;
+#endif
+
+#if defined(__linux__)
+  detect_caches_linux(info);
+  detect_topology_linux(info);
+#elif defined(__APPLE__)
+  long v;
+  if ((v = sysctl_long("hw.l1dcachesize")) > 0) info->l1d_bytes = (size_t)v;
+  if ((v = sysctl_long("hw.l2cachesize")) > 0) info->l2_bytes = (size_t)v;
+  if ((v = sysctl_long("hw.l3cachesize")) > 0) info->l3_bytes = (size_t)v;
+  if ((v = sysctl_long("hw.physicalcpu")) > 0) info->physical_cores = (int)v;
+  if ((v = sysctl_long("hw.packages")) > 0) info->packages = (int)v;
+#endif
+
+  if (info->physical_cores < 1) info->physical_cores = info->logical_cpus;
+  if (info->packages < 1) info->packages = 1;
+}
+
+const leanblas_cpu_info *leanblas_cpu(void) {
+  pthread_once(&cpu_once, cpu_detect);
+  return &cpu_info;
+}
+
+// ---------------------------------------------------------------------------
+// Dispatch registry
+// ---------------------------------------------------------------------------
+
+extern leanblas_kernel_family native_dvec_family, native_svec_family;
+extern leanblas_kernel_family native_dgemm_family, native_sgemm_family;
+extern leanblas_kernel_family repro_dbin_family, repro_dgemm_family;
+
+static leanblas_kernel_family *const families[] = {
+    &native_dvec_family,
+    &native_svec_family,
+    &native_dgemm_family,
+    &native_sgemm_family,
+    &repro_dbin_family,
+    &repro_dgemm_family,
+};
+
+// Variant named by `LEANBLAS_KERNEL_<FAMILY>` or `LEANBLAS_KERNEL`, if any.
+static const char *forced_variant(const char *family) {
+  char var[64] = "LEANBLAS_KERNEL_";
+  size_t n = strlen(var);
+  for (const char *p = family; *p && n + 1 < sizeof var; p++) {
+    const char ch = *p;
+    var[n++] = (ch >= 'a' && ch <= 'z') ? (char)(ch - 'a' + 'A') : ch;
+  }
+  var[n] = 0;
+  const char *v = getenv(var);
+  return v ? v : getenv("LEANBLAS_KERNEL");
+}
+
+const void *leanblas_kernel_select(leanblas_kernel_family *family) {
+  const leanblas_kernel_variant *sel = atomic_load_explicit(&family->selected, memory_order_acquire);
+  if (sel) return sel->impl;
+
+  // Racing threads all compute the same answer, so a plain store is enough.
+  const uint32_t have = leanblas_cpu()->features;
+  const char *forced = forced_variant(family->name);
+  for (int i = 0; i < family->nvariants && !sel; i++) {
+    const leanblas_kernel_variant *v = &family->variants[i];
+    if ((v->requires & have) != v->requires) continue;
+    if (!forced || strcasecmp(forced, v->name) == 0) sel = v;
+  }
+  // An unknown or unsupported forced variant falls back to the best one.
+  for (int i = 0; i < family->nvariants && !sel; i++)
+    if ((family->variants[i].requires & have) == family->variants[i].requires) sel = &family->variants[i];
+  if (!sel) sel = &family->variants[family->nvariants - 1];
+
+  atomic_store_explicit(&family->selected, sel, memory_order_release);
+  return sel->impl;
+}
+
+int leanblas_kernel_family_count(void) { return (int)(sizeof families / sizeof families[0]); }
+
+leanblas_kernel_family *leanblas_kernel_family_at(int i) {
+  if (i < 0 || i >= leanblas_kernel_family_count()) return NULL;
+  leanblas_kernel_select(families[i]);
+  return families[i];
+}
@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include "native.h"
+
+#ifdef LEANBLAS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Packed gemm for the native backend: register-blocked micro-kernels plus the
+// blocked driver in `native_gemm.inc`.
+//
+// A micro-kernel computes C[0:MR, 0:NR] += Ap * Bp where Ap is an MR×kc panel
+// stored column by column and Bp a kc×NR panel stored row by row, both as laid
+// out by the packing routines.  C is column-major with leading dimension ldc.
+
+#define LEANBLAS_MAX_TILE (32 * 12)
+
+typedef struct {
+  int mr, nr;      // register tile
+  int mc, kc, nc;  // cache blocking, mc a multiple of mr and nc of nr
+  void (*fn)(ptrdiff_t kc, const double *a, const double *b, double *c, ptrdiff_t ldc);
+} native_dkernel;
+
+typedef struct {
+  int mr, nr;
+  int mc, kc, nc;
+  void (*fn)(ptrdiff_t kc, const float *a, const float *b, float *c, ptrdiff_t ldc);
+} native_skernel;
+
+// ---------------------------------------------------------------------------
+// Portable kernels
+// ---------------------------------------------------------------------------
+
+static void dkernel_generic_4x4(ptrdiff_t kc, const double *a, const double *b, double *c, ptrdiff_t ldc) {
+  double acc[16] = {0};
+  for (ptrdiff_t p = 0; p < kc; p++, a += 4, b += 4)
+    for (int j = 0; j < 4; j++)
+      for (int i = 0; i < 4; i++) acc[i + 4 * j] += a[i] * b[j];
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++) c[i + j * ldc] += acc[i + 4 * j];
+}
+
+static void skernel_generic_8x4(ptrdiff_t kc, const float *a, const float *b, float *c, ptrdiff_t ldc) {
+  float acc[32] = {0};
+  for (ptrdiff_t p = 0; p < kc; p++, a += 8, b += 4)
+    for (int j = 0; j < 4; j++)
+      for (int i = 0; i < 8; i++) acc[i + 8 * j] += a[i] * b[j];
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 8; i++) c[i + j * ldc] += acc[i + 8 * j];
+}
+
+static const native_dkernel dkernel_generic = {4, 4, 64, 256, 1536, dkernel_generic_4x4};
+static const native_skernel skernel_generic = {8, 4, 128, 256, 1536, skernel_generic_8x4};
+
+// ---------------------------------------------------------------------------
+// x86-64 kernels
+// ---------------------------------------------------------------------------
+
+#ifdef LEANBLAS_X86_DISPATCH
+
+// The kernels below keep every accumulator in a named variable: GCC does not
+// promote a local array of vectors to registers and would otherwise store
+// the whole tile to the stack on every k iteration.
+#define NATIVE_ACC2(V, j) V c##j##0 = ZERO, c##j##1 = ZERO;
+#define NATIVE_FMA2(j)                      \
+  {                                         \
+    const BCAST_T bj = BCAST(b + j);        \
+    c##j##0 = FMADD(a0, bj, c##j##0);       \
+    c##j##1 = FMADD(a1, bj, c##j##1);       \
+  }
+#define NATIVE_STORE2(j)                                              \
+  {                                                                   \
+    STORE(c + j * ldc, ADD(LOAD(c + j * ldc), c##j##0));               \
+    STORE(c + j * ldc + W, ADD(LOAD(c + j * ldc + W), c##j##1));       \
+  }
+#define NATIVE_COLS6(M) M(0) M(1) M(2) M(3) M(4) M(5)
+#define NATIVE_COLS12(M) NATIVE_COLS6(M) M(6) M(7) M(8) M(9) M(10) M(11)
+#define NATIVE_ACC(j) NATIVE_ACC2(BCAST_T, j)
+
+// AVX2/FMA: 8×6 doubles in 12 ymm accumulators.
+#define BCAST_T __m256d
+#define ZERO _mm256_setzero_pd()
+#define BCAST(p) _mm256_broadcast_sd(p)
+#define FMADD _mm256_fmadd_pd
+#define LOAD _mm256_loadu_pd
+#define STORE _mm256_storeu_pd
+#define ADD _mm256_add_pd
+#define W 4
+LEANBLAS_TARGET_AVX2
+static void dkernel_avx2_8x6(ptrdiff_t kc, const double *a, const double *b, double *c, ptrdiff_t ldc) {
+  NATIVE_COLS6(NATIVE_ACC)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 8, b += 6) {
+    const __m256d a0 = LOAD(a), a1 = LOAD(a + W);
+    NATIVE_COLS6(NATIVE_FMA2)
+  }
+  NATIVE_COLS6(NATIVE_STORE2)
+}
+#undef BCAST_T
+#undef ZERO
+#undef BCAST
+#undef FMADD
+#undef LOAD
+#undef STORE
+#undef ADD
+#undef W
+
+// AVX2/FMA: 16×6 floats in 12 ymm accumulators.
+#define BCAST_T __m256
+#define ZERO _mm256_setzero_ps()
+#define BCAST(p) _mm256_broadcast_ss(p)
+#define FMADD _mm256_fmadd_ps
+#define LOAD _mm256_loadu_ps
+#define STORE _mm256_storeu_ps
+#define ADD _mm256_add_ps
+#define W 8
+LEANBLAS_TARGET_AVX2
+static void skernel_avx2_16x6(ptrdiff_t kc, const float *a, const float *b, float *c, ptrdiff_t ldc) {
+  NATIVE_COLS6(NATIVE_ACC)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 16, b += 6) {
+    const __m256 a0 = LOAD(a), a1 = LOAD(a + W);
+    NATIVE_COLS6(NATIVE_FMA2)
+  }
+  NATIVE_COLS6(NATIVE_STORE2)
+}
+#undef BCAST_T
+#undef ZERO
+#undef BCAST
+#undef FMADD
+#undef LOAD
+#undef STORE
+#undef ADD
+#undef W
+
+// AVX-512: 16×12 doubles in 24 zmm accumulators.
+#define BCAST_T __m512d
+#define ZERO _mm512_setzero_pd()
+#define BCAST(p) _mm512_set1_pd(*(p))
+#define FMADD _mm512_fmadd_pd
+#define LOAD _mm512_loadu_pd
+#define STORE _mm512_storeu_pd
+#define ADD _mm512_add_pd
+#define W 8
+LEANBLAS_TARGET_AVX512
+static void dkernel_avx512_16x12(ptrdiff_t kc, const double *a, const double *b, double *c, ptrdiff_t ldc) {
+  NATIVE_COLS12(NATIVE_ACC)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 16, b += 12) {
+    const __m512d a0 = LOAD(a), a1 = LOAD(a + W);
+    NATIVE_COLS12(NATIVE_FMA2)
+  }
+  NATIVE_COLS12(NATIVE_STORE2)
+}
+#undef BCAST_T
+#undef ZERO
+#undef BCAST
+#undef FMADD
+#undef LOAD
+#undef STORE
+#undef ADD
+#undef W
+
+// AVX-512: 32×12 floats in 24 zmm accumulators.
+#define BCAST_T __m512
+#define ZERO _mm512_setzero_ps()
+#define BCAST(p) _mm512_set1_ps(*(p))
+#define FMADD _mm512_fmadd_ps
+#define LOAD _mm512_loadu_ps
+#define STORE _mm512_storeu_ps
+#define ADD _mm512_add_ps
+#define W 16
+LEANBLAS_TARGET_AVX512
+static void skernel_avx512_32x12(ptrdiff_t kc, const float *a, const float *b, float *c, ptrdiff_t ldc) {
+  NATIVE_COLS12(NATIVE_ACC)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 32, b += 12) {
+    const __m512 a0 = LOAD(a), a1 = LOAD(a + W);
+    NATIVE_COLS12(NATIVE_FMA2)
+  }
+  NATIVE_COLS12(NATIVE_STORE2)
+}
+#undef BCAST_T
+#undef ZERO
+#undef BCAST
+#undef FMADD
+#undef LOAD
+#undef STORE
+#undef ADD
+#undef W
+
+static const native_dkernel dkernel_avx2 = {8, 6, 144, 256, 1536, dkernel_avx2_8x6};
+static const native_skernel skernel_avx2 = {16, 6, 192, 256, 1536, skernel_avx2_16x6};
+static const native_dkernel dkernel_avx512 = {16, 12, 192, 256, 1536, dkernel_avx512_16x12};
+static const native_skernel skernel_avx512 = {32, 12, 384, 256, 1536, skernel_avx512_32x12};
+
+#endif
+
+static const leanblas_kernel_variant dgemm_variants[] = {
+#ifdef LEANBLAS_X86_DISPATCH
+    {"avx512", LEANBLAS_CPU_AVX512F | LEANBLAS_CPU_AVX2 | LEANBLAS_CPU_FMA, &dkernel_avx512},
+    {"avx2", LEANBLAS_CPU_AVX2 | LEANBLAS_CPU_FMA, &dkernel_avx2},
+#endif
+    {"generic", 0, &dkernel_generic},
+};
+
+static const leanblas_kernel_variant sgemm_variants[] = {
+#ifdef LEANBLAS_X86_DISPATCH
+    {"avx512", LEANBLAS_CPU_AVX512F | LEANBLAS_CPU_AVX2 | LEANBLAS_CPU_FMA, &skernel_avx512},
+    {"avx2", LEANBLAS_CPU_AVX2 | LEANBLAS_CPU_FMA, &skernel_avx2},
+#endif
+    {"generic", 0, &skernel_generic},
+};
+
+leanblas_kernel_family native_dgemm_family = LEANBLAS_KERNEL_FAMILY("dgemm", dgemm_variants);
+leanblas_kernel_family native_sgemm_family = LEANBLAS_KERNEL_FAMILY("sgemm", sgemm_variants);
+
+static const native_dkernel *select_dkernel(void) {
+  return (const native_dkernel *)leanblas_kernel_select(&native_dgemm_family);
+}
+
+static const native_skernel *select_skernel(void) {
+  return (const native_skernel *)leanblas_kernel_select(&native_sgemm_family);
+}
+
+#define GREAL double
+#define GNAME LEANBLAS_NATIVE(dgemm)
+#define GLOCAL(name) native_dgemm_##name
+#define GKERNEL native_dkernel
+#define GSELECT select_dkernel
+#include "native_gemm.inc"
+#undef GREAL
+#undef GNAME
+#undef GLOCAL
+#undef GKERNEL
+#undef GSELECT
+
+#define GREAL float
+#define GNAME LEANBLAS_NATIVE(sgemm)
+#define GLOCAL(name) native_sgemm_##name
+#define GKERNEL native_skernel
+#define GSELECT select_skernel
+#include "native_gemm.inc"
+#undef GREAL
+#undef GNAME
+#undef GLOCAL
+#undef GKERNEL
+#undef GSELECT
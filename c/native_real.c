@@ -0,0 +1,38 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "native.h"
+
+// Real Level 1/2/3 kernels of the native backend, instantiated for both
+// precisions from `native_real.inc`.
+
+// Storage formats of the triangular Level 2 kernels.
+enum { TRI_FULL, TRI_BAND, TRI_PACKED };
+
+#define REAL double
+#define RNAME(name) LEANBLAS_NATIVE(d##name)
+#define RLOCAL(name) native_d_##name
+#define RIAMAX LEANBLAS_NATIVE(idamax)
+#define RFAMILY native_dvec_family
+#define RFAMILY_NAME "dvec"
+#include "native_real.inc"
+#undef REAL
+#undef RNAME
+#undef RLOCAL
+#undef RIAMAX
+#undef RFAMILY
+#undef RFAMILY_NAME
+
+#define REAL float
+#define RNAME(name) LEANBLAS_NATIVE(s##name)
+#define RLOCAL(name) native_s_##name
+#define RIAMAX LEANBLAS_NATIVE(isamax)
+#define RFAMILY native_svec_family
+#define RFAMILY_NAME "svec"
+#include "native_real.inc"
+#undef REAL
+#undef RNAME
+#undef RLOCAL
+#undef RIAMAX
+#undef RFAMILY
+#undef RFAMILY_NAME
@@ -0,0 +1,142 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "native.h"
+
+// A small persistent thread pool for the native kernels.
+//
+// Only one parallel region runs at a time.  The pool threads sleep on a
+// condition variable and wake up when `generation` changes; they then grab
+// task indices from a shared atomic counter until all tasks are handed out.
+// The caller grabs tasks too, so a pool of `n` threads has `n - 1` workers.
+
+#define LEANBLAS_MAX_THREADS 256
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t pool_owner = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+static int pool_size = 1;        // threads including the caller
+static int pool_active = 1;      // threads used for the next region
+static int pool_started = 0;     // workers created so far
+static unsigned long generation = 0;
+
+static leanblas_task_fn job_fn;
+static void *job_ctx;
+static int job_ntasks;
+static atomic_int job_next;
+static int job_workers;          // workers allowed to take tasks in this region
+static int job_running;          // workers still inside the current region
+
+// Generation each worker was created at, so a worker that gets scheduled late
+// still joins the region that was started right after it was spawned.
+static unsigned long worker_seen[LEANBLAS_MAX_THREADS];
+
+static _Thread_local int in_pool_thread = 0;
+
+static void run_tasks(void) {
+  for (;;) {
+    int t = atomic_fetch_add(&job_next, 1);
+    if (t >= job_ntasks) break;
+    job_fn(job_ctx, t, job_ntasks);
+  }
+}
+
+static void *worker_main(void *arg) {
+  const int index = (int)(intptr_t)arg;
+  in_pool_thread = 1;
+  pthread_mutex_lock(&pool_lock);
+  unsigned long seen = worker_seen[index];
+  for (;;) {
+    while (generation == seen) pthread_cond_wait(&pool_wake, &pool_lock);
+    seen = generation;
+    const int participate = index < job_workers;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (participate) run_tasks();
+
+    pthread_mutex_lock(&pool_lock);
+    if (--job_running == 0) pthread_cond_signal(&pool_done);
+  }
+  return NULL;
+}
+
+// One thread per physical core: the gemm kernels keep the FMA units busy, so
+// a second hyperthread on the same core only competes for them.
+static void pool_init(void) {
+  int n = leanblas_cpu()->physical_cores;
+  const char *env = getenv("LEANBLAS_NUM_THREADS");
+  if (env && atoi(env) > 0) n = atoi(env);
+  if (n < 1) n = 1;
+  if (n > LEANBLAS_MAX_THREADS) n = LEANBLAS_MAX_THREADS;
+  pool_size = n;
+  pool_active = n;
+}
+
+// Must be called with `pool_owner` held.
+static void pool_grow(int n) {
+  while (pool_started < n - 1) {
+    pthread_t tid;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    worker_seen[pool_started] = generation;
+    int err = pthread_create(&tid, &attr, worker_main, (void *)(intptr_t)pool_started);
+    pthread_attr_destroy(&attr);
+    if (err != 0) break;
+    pool_started++;
+  }
+}
+
+int leanblas_num_threads(void) {
+  pthread_once(&pool_once, pool_init);
+  return pool_active;
+}
+
+void leanblas_set_num_threads(int n) {
+  pthread_once(&pool_once, pool_init);
+  if (n < 1) n = 1;
+  if (n > LEANBLAS_MAX_THREADS) n = LEANBLAS_MAX_THREADS;
+  pthread_mutex_lock(&pool_owner);
+  pool_active = n;
+  pthread_mutex_unlock(&pool_owner);
+}
+
+void leanblas_parallel_for(int ntasks, leanblas_task_fn fn, void *ctx) {
+  if (ntasks <= 0) return;
+  pthread_once(&pool_once, pool_init);
+
+  if (ntasks == 1 || pool_active == 1 || in_pool_thread || pthread_mutex_trylock(&pool_owner) != 0) {
+    for (int t = 0; t < ntasks; t++) fn(ctx, t, ntasks);
+    return;
+  }
+
+  pool_grow(pool_active);
+  int workers = pool_active - 1;
+  if (workers > ntasks - 1) workers = ntasks - 1;
+
+  // Every started worker wakes up and acknowledges the region, but only the
+  // first `workers` of them take tasks.
+  pthread_mutex_lock(&pool_lock);
+  job_fn = fn;
+  job_ctx = ctx;
+  job_ntasks = ntasks;
+  job_workers = workers;
+  atomic_store(&job_next, 0);
+  job_running = pool_started;
+  generation++;
+  pthread_cond_broadcast(&pool_wake);
+  pthread_mutex_unlock(&pool_lock);
+
+  in_pool_thread = 1;
+  run_tasks();
+  in_pool_thread = 0;
+
+  pthread_mutex_lock(&pool_lock);
+  while (job_running > 0) pthread_cond_wait(&pool_done, &pool_lock);
+  pthread_mutex_unlock(&pool_lock);
+
+  pthread_mutex_unlock(&pool_owner);
+}
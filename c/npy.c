@@ -0,0 +1,775 @@
+#include <lean/lean.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef LEANBLAS_ZLIB  // set by the build when it links zlib (`-K zlib`)
+#include <zlib.h>
+#define LEANBLAS_HAVE_ZLIB 1
+#endif
+#include "util.h"
+
+// NumPy `.npy` and `.npz` files, see `BLAS.Npy`.
+//
+// Arrays travel as `BLAS.Npy.Raw`: a dtype ("f4", "f8" or "c16", always in
+// native byte order once read), the Fortran-order flag, the shape and the
+// element bytes.  Files in the other byte order are swapped while copying.
+//
+// Mapped loads build the `ByteArray` inside a private mapping of the file: the
+// array header goes into the 24 bytes just before the data, which are the end
+// of the `.npy` header's padding (`.npy` data starts at a multiple of 64), and
+// the object is persistent (reference count 0), so Lean never frees it and
+// every write through a wrapper copies it first.  The mapping is never
+// unmapped.  Uncompressed `.npz` entries are mapped the same way when their
+// data happens to be 8-byte aligned in the archive, and copied otherwise.
+// Compressed entries (`np.savez_compressed`) need zlib.
+
+#define NPY_MAX_DIMS 32
+
+typedef struct {
+  char dtype[4];    // "f4", "f8" or "c16"
+  size_t item;      // bytes per element
+  size_t swap;      // 0 if native, else the size of the words to byte-swap
+  int fortran;
+  size_t ndim;
+  size_t shape[NPY_MAX_DIMS];
+  size_t count;     // elements
+  size_t header;    // bytes before the data
+} npy_header;
+
+static void byte_swap(uint8_t *p, size_t bytes, size_t word) {
+  for (size_t i = 0; i + word <= bytes; i += word)
+    for (size_t a = i, b = i + word - 1; a < b; a++, b--) {
+      uint8_t t = p[a];
+      p[a] = p[b];
+      p[b] = t;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Header
+// ---------------------------------------------------------------------------
+
+// The value of `key` in the header dictionary, after the colon and spaces.
+static const char *dict_value(const char *dict, const char *key) {
+  char quoted[32];
+  for (int q = 0; q < 2; q++) {
+    snprintf(quoted, sizeof(quoted), q == 0 ? "'%s'" : "\"%s\"", key);
+    const char *p = strstr(dict, quoted);
+    if (!p) continue;
+    p += strlen(quoted);
+    while (*p == ' ') p++;
+    if (*p++ != ':') return NULL;
+    while (*p == ' ') p++;
+    return p;
+  }
+  return NULL;
+}
+
+// Length of the magic, version and header length fields, and of the whole
+// header, from its first 12 bytes.
+static const char *header_size(const uint8_t *p, size_t avail, size_t *size) {
+  if (avail < 10 || memcmp(p, "\x93NUMPY", 6) != 0) return "not a .npy file";
+  if (p[6] == 1) {
+    *size = 10 + (size_t)leanblas_get16(p + 8);
+  } else if (p[6] == 2 || p[6] == 3) {
+    if (avail < 12) return "truncated header";
+    *size = 12 + (size_t)leanblas_get32(p + 8);
+  } else {
+    return "unsupported .npy version";
+  }
+  return NULL;
+}
+
+// Parses a complete header of `size` bytes.
+static const char *parse_header(const uint8_t *p, size_t size, npy_header *h) {
+  size_t pre = p[6] == 1 ? 10 : 12;
+  char *dict = malloc(size - pre + 1);
+  if (!dict) return "out of memory";
+  memcpy(dict, p + pre, size - pre);
+  dict[size - pre] = 0;
+  const char *err = NULL;
+  memset(h, 0, sizeof(*h));
+  h->header = size;
+
+  const char *d = dict_value(dict, "descr");
+  if (!d || (*d != '\'' && *d != '"')) { err = "header has no 'descr'"; goto done; }
+  char quote = *d++;
+  const char *end = strchr(d, quote);
+  if (!end || end - d > 8) { err = "unsupported dtype (structured or malformed 'descr')"; goto done; }
+  char order = '|';
+  if (*d == '<' || *d == '>' || *d == '|' || *d == '=') order = *d++;
+  size_t len = (size_t)(end - d);
+  if (len == 2 && memcmp(d, "f4", 2) == 0) { strcpy(h->dtype, "f4"); h->item = 4; h->swap = 4; }
+  else if (len == 2 && memcmp(d, "f8", 2) == 0) { strcpy(h->dtype, "f8"); h->item = 8; h->swap = 8; }
+  else if (len == 3 && memcmp(d, "c16", 3) == 0) { strcpy(h->dtype, "c16"); h->item = 16; h->swap = 8; }
+  else { err = "unsupported dtype (expected float32, float64 or complex128)"; goto done; }
+  if (order == '|' || order == '=' || (order == '<') == leanblas_host_is_little()) h->swap = 0;
+
+  const char *f = dict_value(dict, "fortran_order");
+  if (f && strncmp(f, "True", 4) == 0) h->fortran = 1;
+  else if (f && strncmp(f, "False", 5) == 0) h->fortran = 0;
+  else { err = "header has no 'fortran_order'"; goto done; }
+
+  const char *s = dict_value(dict, "shape");
+  if (!s || *s++ != '(') { err = "header has no 'shape'"; goto done; }
+  h->count = 1;
+  for (;;) {
+    while (*s == ' ' || *s == ',') s++;
+    if (*s == ')') break;
+    if (*s < '0' || *s > '9') { err = "malformed 'shape'"; goto done; }
+    if (h->ndim == NPY_MAX_DIMS) { err = "too many dimensions"; goto done; }
+    char *next;
+    unsigned long long v = strtoull(s, &next, 10);
+    s = next;
+    if (v != 0 && h->count > SIZE_MAX / v) { err = "shape too large"; goto done; }
+    h->shape[h->ndim++] = (size_t)v;
+    h->count *= (size_t)v;
+  }
+  if (h->count > SIZE_MAX / h->item) err = "shape too large";
+done:
+  free(dict);
+  return err;
+}
+
+// Reads and parses the header of the `.npy` data at `base` in `fd`, which has
+// `avail` bytes from there on.
+static const char *read_header(int fd, uint64_t base, uint64_t avail, npy_header *h) {
+  uint8_t pre[12] = {0};
+  size_t size;
+  if (leanblas_read_at(fd, pre, avail < 12 ? (size_t)avail : 12, base) != 0) return strerror(errno);
+  const char *err = header_size(pre, avail < 12 ? (size_t)avail : 12, &size);
+  if (err) return err;
+  if (size > avail) return "truncated header";
+  uint8_t *buf = malloc(size);
+  if (!buf) return "out of memory";
+  if (leanblas_read_at(fd, buf, size, base) != 0) err = strerror(errno);
+  else err = parse_header(buf, size, h);
+  free(buf);
+  if (!err && h->count * h->item > avail - h->header) err = "truncated data";
+  return err;
+}
+
+// `BLAS.Npy.Raw`: objects `dtype`, `shape`, `data`, then the `fortranOrder` byte.
+static lean_obj_res mk_raw(const npy_header *h, lean_obj_arg data) {
+  lean_object *shape = lean_alloc_array(h->ndim, h->ndim);
+  for (size_t i = 0; i < h->ndim; i++) lean_array_set_core(shape, i, lean_usize_to_nat(h->shape[i]));
+  lean_object *r = lean_alloc_ctor(0, 3, 1);
+  lean_ctor_set(r, 0, lean_mk_string(h->dtype));
+  lean_ctor_set(r, 1, shape);
+  lean_ctor_set(r, 2, data);
+  lean_ctor_set_uint8(r, 3 * sizeof(void *), (uint8_t)h->fortran);
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+static lean_object *copy_bytes(int fd, uint64_t off, size_t bytes, size_t swap) {
+  lean_object *a = lean_alloc_sarray(1, bytes, bytes);
+  if (leanblas_read_at(fd, lean_sarray_cptr(a), bytes, off) != 0) {
+    lean_dec(a);
+    return NULL;
+  }
+  if (swap) byte_swap(lean_sarray_cptr(a), bytes, swap);
+  return a;
+}
+
+// The `Raw` of the `.npy` data at `base` in `fd`, of `avail` bytes.
+static lean_obj_res load_at(int fd, const char *path, b_lean_obj_arg lpath, uint64_t base, uint64_t avail,
+                            uint8_t map) {
+  npy_header h;
+  const char *err = read_header(fd, base, avail, &h);
+  if (err) return leanblas_file_error(path, "%s", err);
+  const uint64_t off = base + h.header;
+  const size_t bytes = h.count * h.item;
+  lean_object *data = map && !h.swap ? leanblas_map_sarray(fd, off, bytes, NULL, NULL) : NULL;
+  if (!data) data = copy_bytes(fd, off, bytes, h.swap);
+  if (!data) return leanblas_os_error(lpath);
+  return lean_io_result_mk_ok(mk_raw(&h, data));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_npy_read(b_lean_obj_arg lpath, uint8_t map, lean_obj_arg w) {
+  (void)w;
+  const char *path = lean_string_cstr(lpath);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  lean_obj_res r =
+      fstat(fd, &st) != 0 ? leanblas_os_error(lpath) : load_at(fd, path, lpath, 0, (uint64_t)st.st_size, map);
+  close(fd);
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Zip archives
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  char *name;
+  uint16_t flags, method;
+  uint32_t crc;
+  uint64_t csize, usize, local;
+} zip_entry;
+
+static void free_entries(zip_entry *es, size_t n) {
+  for (size_t i = 0; i < n; i++) free(es[i].name);
+  free(es);
+}
+
+// The entries of the central directory.
+static const char *zip_entries(int fd, uint64_t fsize, zip_entry **out, size_t *count) {
+  *out = NULL;
+  *count = 0;
+  const size_t tail = fsize < 65557 ? (size_t)fsize : 65557;
+  if (tail < 22) return "not a zip archive";
+  uint8_t *buf = malloc(tail);
+  if (!buf) return "out of memory";
+  const char *err = NULL;
+  uint8_t *cd = NULL;
+  if (leanblas_read_at(fd, buf, tail, fsize - tail) != 0) { err = strerror(errno); goto done; }
+  size_t e = tail - 22 + 1;
+  while (e-- > 0)
+    if (leanblas_get32(buf + e) == 0x06054b50) break;
+  if (e == (size_t)-1) { err = "not a zip archive (no end of central directory)"; goto done; }
+  uint64_t n = leanblas_get16(buf + e + 10);
+  uint64_t cdsize = leanblas_get32(buf + e + 12), cdoff = leanblas_get32(buf + e + 16);
+  if (n == 0xFFFF || cdsize == 0xFFFFFFFF || cdoff == 0xFFFFFFFF) {
+    uint8_t loc[20], rec[56];
+    if (e < 20 || leanblas_get32(buf + e - 20) != 0x07064b50) { err = "missing zip64 locator"; goto done; }
+    memcpy(loc, buf + e - 20, 20);
+    if (leanblas_read_at(fd, rec, 56, leanblas_get64(loc + 8)) != 0 || leanblas_get32(rec) != 0x06064b50) {
+      err = "bad zip64 end of central directory";
+      goto done;
+    }
+    n = leanblas_get64(rec + 32);
+    cdsize = leanblas_get64(rec + 40);
+    cdoff = leanblas_get64(rec + 48);
+  }
+  if (cdoff + cdsize > fsize || n > cdsize / 46) { err = "corrupt central directory"; goto done; }
+  cd = malloc(cdsize ? cdsize : 1);
+  *out = calloc(n ? n : 1, sizeof(zip_entry));
+  if (!cd || !*out) { err = "out of memory"; goto done; }
+  if (leanblas_read_at(fd, cd, cdsize, cdoff) != 0) { err = strerror(errno); goto done; }
+  size_t p = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    if (p + 46 > cdsize || leanblas_get32(cd + p) != 0x02014b50) { err = "corrupt central directory"; goto done; }
+    const uint8_t *c = cd + p;
+    zip_entry *z = &(*out)[i];
+    size_t nlen = leanblas_get16(c + 28), xlen = leanblas_get16(c + 30), clen = leanblas_get16(c + 32);
+    if (p + 46 + nlen + xlen + clen > cdsize) { err = "corrupt central directory"; goto done; }
+    z->flags = leanblas_get16(c + 8);
+    z->method = leanblas_get16(c + 10);
+    z->crc = leanblas_get32(c + 16);
+    z->csize = leanblas_get32(c + 20);
+    z->usize = leanblas_get32(c + 24);
+    z->local = leanblas_get32(c + 42);
+    z->name = malloc(nlen + 1);
+    if (!z->name) { err = "out of memory"; goto done; }
+    memcpy(z->name, c + 46, nlen);
+    z->name[nlen] = 0;
+    *count = (size_t)i + 1;
+    // zip64 extra field: the 64-bit values of the fields that are saturated
+    for (size_t x = 0; x + 4 <= xlen;) {
+      const uint8_t *f = c + 46 + nlen + x;
+      size_t id = leanblas_get16(f), len = leanblas_get16(f + 2), q = 4;
+      if (id == 0x0001) {
+        if (z->usize == 0xFFFFFFFF && q + 8 <= 4 + len) { z->usize = leanblas_get64(f + q); q += 8; }
+        if (z->csize == 0xFFFFFFFF && q + 8 <= 4 + len) { z->csize = leanblas_get64(f + q); q += 8; }
+        if (z->local == 0xFFFFFFFF && q + 8 <= 4 + len) { z->local = leanblas_get64(f + q); q += 8; }
+      }
+      x += 4 + len;
+    }
+    p += 46 + nlen + xlen + clen;
+  }
+done:
+  free(buf);
+  free(cd);
+  if (err) {
+    free_entries(*out, *count);
+    *out = NULL;
+    *count = 0;
+  }
+  return err;
+}
+
+// Offset of the entry's data, after its local header.
+static const char *zip_data_offset(int fd, uint64_t fsize, const zip_entry *z, uint64_t *off) {
+  uint8_t h[30];
+  if (z->local + 30 > fsize || leanblas_read_at(fd, h, 30, z->local) != 0 || leanblas_get32(h) != 0x04034b50)
+    return "corrupt local header";
+  *off = z->local + 30 + leanblas_get16(h + 26) + leanblas_get16(h + 28);
+  if (*off > fsize || z->csize > fsize - *off) return "truncated entry";
+  return NULL;
+}
+
+static int entry_matches(const char *name, const char *key) {
+  size_t k = strlen(key);
+  return strcmp(name, key) == 0 || (strncmp(name, key, k) == 0 && strcmp(name + k, ".npy") == 0);
+}
+
+LEAN_EXPORT lean_obj_res leanblas_npz_names(b_lean_obj_arg lpath, lean_obj_arg w) {
+  (void)w;
+  const char *path = lean_string_cstr(lpath);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    lean_obj_res r = leanblas_os_error(lpath);
+    close(fd);
+    return r;
+  }
+  zip_entry *es;
+  size_t n;
+  const char *err = zip_entries(fd, (uint64_t)st.st_size, &es, &n);
+  close(fd);
+  if (err) return leanblas_file_error(path, "%s", err);
+  lean_object *names = lean_alloc_array(0, n);
+  for (size_t i = 0; i < n; i++) {
+    size_t len = strlen(es[i].name);
+    if (len >= 4 && strcmp(es[i].name + len - 4, ".npy") == 0) len -= 4;
+    names = lean_array_push(names, lean_mk_string_from_bytes(es[i].name, len));
+  }
+  free_entries(es, n);
+  return lean_io_result_mk_ok(names);
+}
+
+#ifdef LEANBLAS_HAVE_ZLIB
+// Deflate expands data by at most 1032:1, so an entry claiming more than that
+// is forged; it is rejected before anything of its size is allocated.
+#define DEFLATE_MAX_RATIO 1032
+
+// Inflates up to `want` bytes into `out` from the input ending at `in_end`;
+// `*rc` carries the zlib status across calls.  Returns the bytes written.
+static uint64_t inflate_into(z_stream *s, int *rc, const uint8_t *in_end, uint8_t *out, uint64_t want) {
+  const uint64_t chunk = 1u << 30;
+  uint64_t done = 0;
+  while (*rc == Z_OK && done < want) {
+    const uint64_t left = (uint64_t)(in_end - s->next_in);
+    s->avail_in = (uInt)(left < chunk ? left : chunk);
+    s->next_out = out + done;
+    s->avail_out = (uInt)(want - done < chunk ? want - done : chunk);
+    const uInt ai = s->avail_in, ao = s->avail_out;
+    *rc = inflate(s, Z_NO_FLUSH);
+    done += ao - s->avail_out;
+    if (*rc == Z_OK && ai == s->avail_in && ao == s->avail_out) *rc = Z_DATA_ERROR;
+  }
+  return done;
+}
+
+static uLong crc_of(uLong crc, const uint8_t *p, uint64_t n) {
+  for (uint64_t i = 0; i < n; i += 1u << 30) crc = crc32(crc, p + i, (uInt)(n - i < (1u << 30) ? n - i : (1u << 30)));
+  return crc;
+}
+
+// Inflates a deflated entry whose compressed bytes start at `off`.  The `.npy`
+// header is inflated first, and only the data it describes is allocated, after
+// checking it against the entry's uncompressed size.
+static lean_obj_res load_deflated(int fd, const char *path, const zip_entry *z, uint64_t off) {
+  if (z->usize > z->csize * DEFLATE_MAX_RATIO + 64)
+    return leanblas_file_error(path, "uncompressed size %llu is impossible for %llu compressed bytes",
+                               (unsigned long long)z->usize, (unsigned long long)z->csize);
+  uint8_t *in = malloc(z->csize ? z->csize : 1);
+  if (!in) return leanblas_file_error(path, "out of memory");
+  if (leanblas_read_at(fd, in, z->csize, off) != 0) {
+    free(in);
+    return leanblas_file_error(path, "%s", strerror(errno));
+  }
+  z_stream s;
+  memset(&s, 0, sizeof(s));
+  s.next_in = in;
+  int rc = inflateInit2(&s, -MAX_WBITS);
+  const uint8_t *in_end = in + z->csize;
+  const char *err = NULL;
+  uint8_t pre[12], *hdr = NULL, extra;
+  lean_object *a = NULL;
+  npy_header h;
+  size_t size = 0, bytes = 0;
+  const uint64_t got = inflate_into(&s, &rc, in_end, pre, z->usize < 12 ? z->usize : 12);
+  if (rc != Z_OK && rc != Z_STREAM_END) err = "corrupt deflated entry";
+  if (!err) err = header_size(pre, (size_t)got, &size);
+  if (!err && (size > z->usize || size < got)) err = "truncated header";
+  if (!err && !(hdr = malloc(size))) err = "out of memory";
+  if (!err) {
+    memcpy(hdr, pre, got);
+    if (inflate_into(&s, &rc, in_end, hdr + got, size - got) != size - got) err = "truncated header";
+  }
+  if (!err) err = parse_header(hdr, size, &h);
+  if (!err) {
+    bytes = h.count * h.item;
+    if (bytes > z->usize - size) err = "truncated data";
+    else if (bytes < z->usize - size) err = "uncompressed size does not match the header";
+  }
+  if (!err) {
+    a = lean_alloc_sarray(1, bytes, bytes);
+    if (inflate_into(&s, &rc, in_end, lean_sarray_cptr(a), bytes) != bytes) err = "corrupt deflated entry";
+  }
+  // the stream must end exactly here
+  if (!err && (inflate_into(&s, &rc, in_end, &extra, 1) != 0 || rc != Z_STREAM_END)) err = "corrupt deflated entry";
+  if (!err && (uint32_t)crc_of(crc_of(crc32(0L, Z_NULL, 0), hdr, size), lean_sarray_cptr(a), bytes) != z->crc)
+    err = "CRC mismatch";
+  inflateEnd(&s);
+  free(in);
+  free(hdr);
+  if (err) {
+    if (a) lean_dec(a);
+    return leanblas_file_error(path, "%s", err);
+  }
+  if (h.swap) byte_swap(lean_sarray_cptr(a), bytes, h.swap);
+  return lean_io_result_mk_ok(mk_raw(&h, a));
+}
+#endif
+
+LEAN_EXPORT uint8_t leanblas_npz_compression_available(lean_obj_arg unit) {
+  (void)unit;
+#ifdef LEANBLAS_HAVE_ZLIB
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+LEAN_EXPORT lean_obj_res leanblas_npz_read(b_lean_obj_arg lpath, b_lean_obj_arg lkey, uint8_t map, lean_obj_arg w) {
+  (void)w;
+  const char *path = lean_string_cstr(lpath);
+  const char *key = lean_string_cstr(lkey);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    lean_obj_res r = leanblas_os_error(lpath);
+    close(fd);
+    return r;
+  }
+  const uint64_t fsize = (uint64_t)st.st_size;
+  zip_entry *es;
+  size_t n;
+  lean_obj_res r;
+  const char *err = zip_entries(fd, fsize, &es, &n);
+  if (err) {
+    close(fd);
+    return leanblas_file_error(path, "%s", err);
+  }
+  const zip_entry *z = NULL;
+  for (size_t i = 0; i < n && !z; i++)
+    if (entry_matches(es[i].name, key)) z = &es[i];
+  uint64_t off = 0;
+  if (!z) r = leanblas_file_error(path, "no array named '%s'", key);
+  else if (z->flags & 1) r = leanblas_file_error(path, "'%s' is encrypted", key);
+  else if ((err = zip_data_offset(fd, fsize, z, &off))) r = leanblas_file_error(path, "%s", err);
+  else if (z->method == 0 && z->csize != z->usize)
+    r = leanblas_file_error(path, "'%s': stored entry sizes differ", key);
+  // bounded by the archive so that a mapping never extends past the end of the file
+  else if (z->method == 0) r = load_at(fd, path, lpath, off, z->csize, map);
+#ifdef LEANBLAS_HAVE_ZLIB
+  else if (z->method == 8) r = load_deflated(fd, path, z, off);
+#endif
+  else r = leanblas_file_error(path, "'%s' uses compression method %u, which this build cannot read", key, z->method);
+  free_entries(es, n);
+  close(fd);
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crc_table[i] = c;
+  }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *p, size_t n) {
+  pthread_once(&crc_once, crc_init);
+  crc = ~crc;
+  while (n--) crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// Checks `raw` and formats its `.npy` header into a malloc'd buffer.
+static const char *format_header(b_lean_obj_arg raw, uint8_t **out, size_t *size) {
+  const char *dtype = lean_string_cstr(lean_ctor_get(raw, 0));
+  b_lean_obj_arg shape = lean_ctor_get(raw, 1);
+  b_lean_obj_arg data = lean_ctor_get(raw, 2);
+  const int fortran = lean_ctor_get_uint8(raw, 3 * sizeof(void *));
+  const size_t item = leanblas_raw_dtype_item(dtype);
+  if (!item) return "unsupported dtype (expected f4, f8 or c16)";
+  const size_t ndim = lean_array_size(shape);
+  if (ndim > NPY_MAX_DIMS) return "too many dimensions";
+  size_t count = 1;
+  char dims[NPY_MAX_DIMS * 22 + 4];
+  size_t d = 0;
+  dims[d++] = '(';
+  for (size_t i = 0; i < ndim; i++) {
+    b_lean_obj_arg v = lean_array_get_core(shape, i);
+    if (!lean_is_scalar(v)) return "shape too large";
+    const size_t k = lean_usize_of_nat(v);
+    if (k != 0 && count > SIZE_MAX / k) return "shape too large";
+    count *= k;
+    d += (size_t)snprintf(dims + d, sizeof(dims) - d, i == 0 ? "%zu" : ", %zu", k);
+  }
+  if (ndim == 1) dims[d++] = ',';
+  dims[d++] = ')';
+  dims[d] = 0;
+  if (count > SIZE_MAX / item || count * item != lean_sarray_size(data))
+    return "data size does not match the shape";
+
+  char dict[sizeof(dims) + 96];
+  int len = snprintf(dict, sizeof(dict), "{'descr': '%c%s', 'fortran_order': %s, 'shape': %s, }",
+                     leanblas_host_is_little() ? '<' : '>', dtype,
+                     fortran ? "True" : "False", dims);
+  // pad with spaces and a newline so that the data starts at a multiple of 64
+  size_t pre = 10;
+  size_t total = (pre + (size_t)len + 1 + 63) / 64 * 64;
+  if (total - pre > 0xFFFF) {
+    pre = 12;
+    total = (pre + (size_t)len + 1 + 63) / 64 * 64;
+  }
+  uint8_t *h = malloc(total);
+  if (!h) return "out of memory";
+  memcpy(h, "\x93NUMPY", 6);
+  h[6] = pre == 10 ? 1 : 2;
+  h[7] = 0;
+  if (pre == 10) leanblas_put16(h + 8, (uint16_t)(total - pre));
+  else leanblas_put32(h + 8, (uint32_t)(total - pre));
+  memcpy(h + pre, dict, (size_t)len);
+  memset(h + pre + len, ' ', total - pre - (size_t)len - 1);
+  h[total - 1] = '\n';
+  *out = h;
+  *size = total;
+  return NULL;
+}
+
+LEAN_EXPORT lean_obj_res leanblas_npy_write(b_lean_obj_arg lpath, b_lean_obj_arg raw, lean_obj_arg w) {
+  (void)w;
+  const char *path = lean_string_cstr(lpath);
+  uint8_t *header;
+  size_t hsize;
+  const char *err = format_header(raw, &header, &hsize);
+  if (err) return leanblas_file_error(path, "%s", err);
+  b_lean_obj_arg data = lean_ctor_get(raw, 2);
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    free(header);
+    return leanblas_os_error(lpath);
+  }
+  int ok = fwrite(header, 1, hsize, f) == hsize &&
+           fwrite(lean_sarray_cptr(data), 1, lean_sarray_size(data), f) == lean_sarray_size(data);
+  free(header);
+  if (fclose(f) != 0) ok = 0;
+  return ok ? lean_io_result_mk_ok(lean_box(0)) : leanblas_os_error(lpath);
+}
+
+typedef struct {
+  char *name;
+  uint16_t method;
+  uint32_t crc;
+  uint64_t csize, usize, local;
+} zip_record;
+
+static int write_bytes(FILE *f, const void *p, size_t n) { return fwrite(p, 1, n, f) == n; }
+
+#ifdef LEANBLAS_HAVE_ZLIB
+// Deflates `parts` into `f`; returns the compressed size, or -1.
+static int64_t deflate_parts(FILE *f, const uint8_t *const *parts, const size_t *sizes, int nparts) {
+  z_stream s;
+  memset(&s, 0, sizeof(s));
+  if (deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return -1;
+  uint8_t out[1 << 16];
+  int64_t total = 0;
+  int ok = 1;
+  for (int i = 0; i < nparts && ok; i++) {
+    size_t done = 0;
+    do {
+      const size_t chunk = sizes[i] - done < (1u << 30) ? sizes[i] - done : (1u << 30);
+      s.next_in = (Bytef *)(parts[i] + done);
+      s.avail_in = (uInt)chunk;
+      done += chunk;
+      const int flush = i == nparts - 1 && done == sizes[i] ? Z_FINISH : Z_NO_FLUSH;
+      int rc;
+      do {
+        s.next_out = out;
+        s.avail_out = sizeof(out);
+        rc = deflate(&s, flush);
+        const size_t have = sizeof(out) - s.avail_out;
+        if (rc == Z_STREAM_ERROR || !write_bytes(f, out, have)) { ok = 0; break; }
+        total += (int64_t)have;
+      } while (s.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+    } while (ok && done < sizes[i]);
+  }
+  deflateEnd(&s);
+  return ok ? total : -1;
+}
+#endif
+
+LEAN_EXPORT lean_obj_res leanblas_npz_write(b_lean_obj_arg lpath, b_lean_obj_arg entries, uint8_t compress,
+                                            lean_obj_arg w) {
+  (void)w;
+  const char *path = lean_string_cstr(lpath);
+#ifndef LEANBLAS_HAVE_ZLIB
+  if (compress) return leanblas_file_error(path, "this build has no zlib for compressed .npz files");
+#endif
+  const size_t n = lean_array_size(entries);
+  zip_record *rs = calloc(n ? n : 1, sizeof(zip_record));
+  if (!rs) return leanblas_file_error(path, "out of memory");
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    free(rs);
+    return leanblas_os_error(lpath);
+  }
+  const char *err = NULL;
+  int os = 0;
+  uint64_t pos = 0;
+  size_t done = 0;
+  for (; done < n && !err && !os; done++) {
+    b_lean_obj_arg e = lean_array_get_core(entries, done);
+    b_lean_obj_arg raw = lean_ctor_get(e, 1);
+    zip_record *z = &rs[done];
+    const char *key = lean_string_cstr(lean_ctor_get(e, 0));
+    z->name = malloc(strlen(key) + 5);
+    if (!z->name) { err = "out of memory"; break; }
+    sprintf(z->name, "%s.npy", key);
+    uint8_t *header;
+    size_t hsize;
+    if ((err = format_header(raw, &header, &hsize))) break;
+    b_lean_obj_arg data = lean_ctor_get(raw, 2);
+    const uint8_t *parts[2] = {header, lean_sarray_cptr(data)};
+    const size_t sizes[2] = {hsize, lean_sarray_size(data)};
+    z->usize = hsize + sizes[1];
+    z->crc = crc_update(crc_update(0, header, hsize), parts[1], sizes[1]);
+    z->method = compress ? 8 : 0;
+    z->local = pos;
+    // sizes go into a zip64 extra field when they might not fit in 32 bits
+    const int zip64 = z->usize > 0xF0000000u;
+    const size_t nlen = strlen(z->name);
+    uint8_t lh[30 + 20];
+    leanblas_put32(lh, 0x04034b50);
+    leanblas_put16(lh + 4, zip64 ? 45 : 20);
+    leanblas_put16(lh + 6, 0);
+    leanblas_put16(lh + 8, z->method);
+    leanblas_put16(lh + 10, 0);           // 00:00
+    leanblas_put16(lh + 12, 0x21);        // 1980-01-01
+    leanblas_put32(lh + 14, z->crc);
+    leanblas_put32(lh + 18, zip64 ? 0xFFFFFFFF : (uint32_t)(compress ? 0 : z->usize));
+    leanblas_put32(lh + 22, zip64 ? 0xFFFFFFFF : (uint32_t)z->usize);
+    leanblas_put16(lh + 26, (uint16_t)nlen);
+    leanblas_put16(lh + 28, zip64 ? 20 : 0);
+    leanblas_put16(lh + 30, 0x0001);
+    leanblas_put16(lh + 32, 16);
+    leanblas_put64(lh + 34, z->usize);
+    leanblas_put64(lh + 42, compress ? 0 : z->usize);
+    if (!write_bytes(f, lh, 30) || !write_bytes(f, z->name, nlen) || (zip64 && !write_bytes(f, lh + 30, 20))) {
+      os = 1;
+    } else if (!compress) {
+      z->csize = z->usize;
+      os = !write_bytes(f, header, hsize) || !write_bytes(f, parts[1], sizes[1]);
+    } else {
+#ifdef LEANBLAS_HAVE_ZLIB
+      const int64_t c = deflate_parts(f, parts, sizes, 2);
+      if (c < 0) {
+        os = 1;
+      } else {
+        // patch the compressed size into the local header
+        z->csize = (uint64_t)c;
+        uint8_t v[8];
+        const uint64_t end = pos + 30 + nlen + (zip64 ? 20 : 0) + z->csize;
+        if (zip64) {
+          leanblas_put64(v, z->csize);
+          os = fseeko(f, (off_t)(pos + 30 + nlen + 12), SEEK_SET) != 0 || !write_bytes(f, v, 8);
+        } else {
+          leanblas_put32(v, (uint32_t)z->csize);
+          os = fseeko(f, (off_t)(pos + 18), SEEK_SET) != 0 || !write_bytes(f, v, 4);
+        }
+        if (!os) os = fseeko(f, (off_t)end, SEEK_SET) != 0;
+      }
+#endif
+    }
+    free(header);
+    pos += 30 + nlen + (zip64 ? 20 : 0) + z->csize;
+  }
+
+  // central directory and end records
+  const uint64_t cdoff = pos;
+  for (size_t i = 0; i < n && !err && !os; i++) {
+    const zip_record *z = &rs[i];
+    const int zip64 = z->usize >= 0xFFFFFFFF || z->csize >= 0xFFFFFFFF || z->local >= 0xFFFFFFFF;
+    const size_t nlen = strlen(z->name);
+    uint8_t c[46 + 28];
+    leanblas_put32(c, 0x02014b50);
+    leanblas_put16(c + 4, 45 | 3 << 8);  // made by: zip 4.5 on Unix
+    leanblas_put16(c + 6, zip64 ? 45 : 20);
+    leanblas_put16(c + 8, 0);
+    leanblas_put16(c + 10, z->method);
+    leanblas_put16(c + 12, 0);
+    leanblas_put16(c + 14, 0x21);
+    leanblas_put32(c + 16, z->crc);
+    leanblas_put32(c + 20, zip64 ? 0xFFFFFFFF : (uint32_t)z->csize);
+    leanblas_put32(c + 24, zip64 ? 0xFFFFFFFF : (uint32_t)z->usize);
+    leanblas_put16(c + 28, (uint16_t)nlen);
+    leanblas_put16(c + 30, zip64 ? 28 : 0);
+    leanblas_put16(c + 32, 0);
+    leanblas_put16(c + 34, 0);
+    leanblas_put16(c + 36, 0);
+    leanblas_put32(c + 38, 0100644u << 16);
+    leanblas_put32(c + 42, zip64 ? 0xFFFFFFFF : (uint32_t)z->local);
+    leanblas_put16(c + 46, 0x0001);
+    leanblas_put16(c + 48, 24);
+    leanblas_put64(c + 50, z->usize);
+    leanblas_put64(c + 58, z->csize);
+    leanblas_put64(c + 66, z->local);
+    os = !write_bytes(f, c, 46) || !write_bytes(f, z->name, nlen) || (zip64 && !write_bytes(f, c + 46, 28));
+    pos += 46 + nlen + (zip64 ? 28 : 0);
+  }
+  if (!err && !os) {
+    const uint64_t cdsize = pos - cdoff;
+    const int zip64 = n >= 0xFFFF || cdoff >= 0xFFFFFFFF || cdsize >= 0xFFFFFFFF;
+    uint8_t end[56 + 20 + 22];
+    size_t len = 0;
+    if (zip64) {
+      leanblas_put32(end, 0x06064b50);
+      leanblas_put64(end + 4, 44);
+      leanblas_put16(end + 12, 45 | 3 << 8);
+      leanblas_put16(end + 14, 45);
+      leanblas_put32(end + 16, 0);
+      leanblas_put32(end + 20, 0);
+      leanblas_put64(end + 24, n);
+      leanblas_put64(end + 32, n);
+      leanblas_put64(end + 40, cdsize);
+      leanblas_put64(end + 48, cdoff);
+      leanblas_put32(end + 56, 0x07064b50);
+      leanblas_put32(end + 60, 0);
+      leanblas_put64(end + 64, pos);
+      leanblas_put32(end + 72, 1);
+      len = 76;
+    }
+    uint8_t *e = end + len;
+    leanblas_put32(e, 0x06054b50);
+    leanblas_put16(e + 4, 0);
+    leanblas_put16(e + 6, 0);
+    leanblas_put16(e + 8, zip64 ? 0xFFFF : (uint16_t)n);
+    leanblas_put16(e + 10, zip64 ? 0xFFFF : (uint16_t)n);
+    leanblas_put32(e + 12, zip64 ? 0xFFFFFFFF : (uint32_t)cdsize);
+    leanblas_put32(e + 16, zip64 ? 0xFFFFFFFF : (uint32_t)cdoff);
+    leanblas_put16(e + 20, 0);
+    os = !write_bytes(f, end, len + 22);
+  }
+  const int saved = errno;
+  if (fclose(f) != 0) os = 1;
+  errno = saved ? saved : errno;
+  for (size_t i = 0; i < n; i++) free(rs[i].name);
+  free(rs);
+  if (err) return leanblas_file_error(path, "%s", err);
+  return os ? leanblas_os_error(lpath) : lean_io_result_mk_ok(lean_box(0));
+}
@@ -0,0 +1,180 @@
+#include <lean/lean.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "native.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters around a region (`LeanBLAS/FFI/PerfCounters.lean`).
+//
+// A session opens one perf_event_open counter per event for the calling
+// thread only.  The native and OpenBLAS pool threads already exist when a
+// session opens, so `inherit` would not reach them either; work a threaded
+// call hands to them is not counted.  Counters are opened
+// individually rather than as a group, so an event the CPU or the kernel does
+// not offer (or that `perf_event_paranoid` forbids) only makes that event
+// unavailable.  When the kernel multiplexes counters, the counts are scaled
+// by enabled/running time.  Outside Linux every event is unavailable.
+
+// Same order as the fields of `BLAS.Perf.Counters`.
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_DTLB_MISSES, PERF_FP_OPS, PERF_NEVENTS };
+
+typedef struct {
+  int fd[PERF_NEVENTS];
+} leanblas_perf_session;
+
+static lean_external_class *session_class = NULL;
+static pthread_once_t session_once = PTHREAD_ONCE_INIT;
+
+static void session_finalize(void *data) {
+  leanblas_perf_session *s = (leanblas_perf_session *)data;
+#ifdef __linux__
+  for (int i = 0; i < PERF_NEVENTS; i++)
+    if (s->fd[i] >= 0) close(s->fd[i]);
+#endif
+  free(s);
+}
+
+static void session_foreach(void *data, b_lean_obj_arg f) {
+  (void)data;
+  (void)f;
+}
+
+static void session_init(void) { session_class = lean_register_external_class(session_finalize, session_foreach); }
+
+#ifdef __linux__
+
+// Retired floating point work has no generic event: AMD Zen counts retired
+// flops (PMCx003), Intel counts retired FP arithmetic instructions of every
+// width (FP_ARITH_INST_RETIRED).  Returns 0 on other CPUs.
+static uint64_t fp_ops_config(void) {
+  const char *vendor = leanblas_cpu()->vendor;
+  if (strcmp(vendor, "AuthenticAMD") == 0) return 0xff03;
+  if (strcmp(vendor, "GenuineIntel") == 0) return 0xffc7;
+  return 0;
+}
+
+static int open_event(int event) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  switch (event) {
+    case PERF_CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_LLC_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case PERF_DTLB_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case PERF_FP_OPS:
+      attr.type = PERF_TYPE_RAW;
+      attr.config = fp_ops_config();
+      if (attr.config == 0) return -1;
+      break;
+    default:
+      return -1;
+  }
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+/** leanblas_perf_session_open
+ * @return A session with every available counter opened and stopped.  Never fails;
+ *         unavailable events read as `none`.
+ */
+LEAN_EXPORT lean_obj_res leanblas_perf_session_open(lean_obj_arg w) {
+  pthread_once(&session_once, session_init);
+  leanblas_perf_session *s = malloc(sizeof *s);
+  if (!s) lean_internal_panic_out_of_memory();
+  for (int i = 0; i < PERF_NEVENTS; i++) {
+#ifdef __linux__
+    s->fd[i] = open_event(i);
+#else
+    s->fd[i] = -1;
+#endif
+  }
+  return lean_io_result_mk_ok(lean_alloc_external(session_class, s));
+}
+
+/** leanblas_perf_session_events
+ * @return Number of events the session could open.
+ */
+LEAN_EXPORT lean_obj_res leanblas_perf_session_events(b_lean_obj_arg session, lean_obj_arg w) {
+  leanblas_perf_session *s = (leanblas_perf_session *)lean_get_external_data(session);
+  size_t n = 0;
+  for (int i = 0; i < PERF_NEVENTS; i++)
+    if (s->fd[i] >= 0) n++;
+  return lean_io_result_mk_ok(lean_box_usize(n));
+}
+
+/** leanblas_perf_session_start
+ * Resets the counters of the session and starts them.
+ */
+LEAN_EXPORT lean_obj_res leanblas_perf_session_start(b_lean_obj_arg session, lean_obj_arg w) {
+#ifdef __linux__
+  leanblas_perf_session *s = (leanblas_perf_session *)lean_get_external_data(session);
+  for (int i = 0; i < PERF_NEVENTS; i++)
+    if (s->fd[i] >= 0) ioctl(s->fd[i], PERF_EVENT_IOC_RESET, 0);
+  for (int i = 0; i < PERF_NEVENTS; i++)
+    if (s->fd[i] >= 0) ioctl(s->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+/** leanblas_perf_session_stop
+ * Stops the counters of the session.
+ * @return One `Option UInt64` per event, `none` for events that could not be opened
+ *         or were never scheduled.
+ */
+LEAN_EXPORT lean_obj_res leanblas_perf_session_stop(b_lean_obj_arg session, lean_obj_arg w) {
+  uint64_t values[PERF_NEVENTS];
+  int valid[PERF_NEVENTS];
+  memset(valid, 0, sizeof valid);
+#ifdef __linux__
+  leanblas_perf_session *s = (leanblas_perf_session *)lean_get_external_data(session);
+  for (int i = 0; i < PERF_NEVENTS; i++)
+    if (s->fd[i] >= 0) ioctl(s->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  for (int i = 0; i < PERF_NEVENTS; i++) {
+    uint64_t buf[3];  // value, time enabled, time running
+    if (s->fd[i] < 0 || read(s->fd[i], buf, sizeof buf) != (ssize_t)sizeof buf || buf[2] == 0) continue;
+    values[i] = buf[2] < buf[1] ? (uint64_t)((double)buf[0] * ((double)buf[1] / (double)buf[2])) : buf[0];
+    valid[i] = 1;
+  }
+#else
+  (void)session;
+#endif
+  lean_obj_res arr = lean_alloc_array(0, PERF_NEVENTS);
+  for (int i = 0; i < PERF_NEVENTS; i++) {
+    if (valid[i]) {
+      lean_obj_res some = lean_alloc_ctor(1, 1, 0);
+      lean_ctor_set(some, 0, lean_box_uint64(values[i]));
+      arr = lean_array_push(arr, some);
+    } else {
+      arr = lean_array_push(arr, lean_box(0));
+    }
+  }
+  return lean_io_result_mk_ok(arr);
+}
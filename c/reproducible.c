@@ -0,0 +1,625 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "native.h"
+#include "reproducible.h"
+
+#ifdef LEANBLAS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Bitwise-reproducible reductions and products, see `reproducible.h`.
+//
+// Every product and sum in this file must round exactly once, on every
+// machine, so `a*b + c` may not be contracted into an FMA.  The x86 variants
+// are compiled for targets without the FMA extension, and the pragmas cover
+// compilers that contract by default on targets where FMA is baseline.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+static pthread_once_t mode_once = PTHREAD_ONCE_INIT;
+static atomic_int mode_on;
+
+static void mode_init(void) {
+  const char *env = getenv("LEANBLAS_REPRODUCIBLE");
+  atomic_store(&mode_on, env && atoi(env) > 0);
+}
+
+int leanblas_reproducible(void) {
+  pthread_once(&mode_once, mode_init);
+  return atomic_load_explicit(&mode_on, memory_order_relaxed);
+}
+
+void leanblas_set_reproducible(int on) {
+  pthread_once(&mode_once, mode_init);
+  atomic_store(&mode_on, on != 0);
+}
+
+// ---------------------------------------------------------------------------
+// Binned summation (ddot, dsum, dasum, dnrm2)
+// ---------------------------------------------------------------------------
+//
+// The terms are first scaled by a power of two so that |t| < 1, which is
+// exact.  With L = ceil(log2 n), fold f uses the boundary M_f = 1.5 * 2^E_f,
+// where E_0 = L + 1 and E_{f+1} = E_f - 51 + L.  Computing q = (M_f + t) - M_f
+// rounds t to a multiple of ulp(M_f), and t - q is exact and becomes the
+// input of the next fold.  All q of one fold are multiples of ulp(M_f), and
+// their sum stays below 2^(E_f + 1), so it is exact in any order.  This holds
+// no matter how the terms are split between threads, vector lanes or chunks.
+// The residual after the last fold is dropped.  Three folds keep at least
+// 3 * (51 - L) bits below the largest term.
+
+#define REPRO_FOLD 3
+#define REPRO_CHUNK ((ptrdiff_t)1 << 15)  // terms per task
+#define REPRO_BUF 512                     // terms staged at a time
+
+enum { REPRO_SUM, REPRO_ASUM, REPRO_DOT, REPRO_NRM2 };
+
+typedef struct {
+  int kind;
+  ptrdiff_t n;
+  const double *x, *y;
+  ptrdiff_t incx, incy;
+  double scale;
+  double bound[REPRO_FOLD];
+  double *max;   // per task: largest |term|
+  double *check; // per task: sum of term * 0, NaN iff a term is not finite
+  double *fold;  // per task: REPRO_FOLD exact partial sums
+} repro_reduction;
+
+// Terms [i0, i0+cnt) of the reduction, times `s`.  The first pass works on
+// |x| for dnrm2 (kind REPRO_ASUM), the second on (s*x)^2.  Inlined into each
+// variant so the loops are vectorized for its target.
+static inline __attribute__((always_inline)) void repro_terms(const repro_reduction *r, const int kind,
+                                                              const ptrdiff_t i0, const ptrdiff_t cnt,
+                                                              const double s, double *buf) {
+  const double *x = r->x + i0 * r->incx;
+  const ptrdiff_t incx = r->incx;
+  switch (kind) {
+    case REPRO_SUM:
+      for (ptrdiff_t i = 0; i < cnt; i++) buf[i] = x[i * incx] * s;
+      break;
+    case REPRO_ASUM:
+      for (ptrdiff_t i = 0; i < cnt; i++) buf[i] = fabs(x[i * incx]) * s;
+      break;
+    case REPRO_DOT: {
+      const double *y = r->y + i0 * r->incy;
+      const ptrdiff_t incy = r->incy;
+      for (ptrdiff_t i = 0; i < cnt; i++) buf[i] = (x[i * incx] * y[i * incy]) * s;
+      break;
+    }
+    case REPRO_NRM2:
+      for (ptrdiff_t i = 0; i < cnt; i++) {
+        const double t = x[i * incx] * s;
+        buf[i] = t * t;
+      }
+      break;
+  }
+}
+
+typedef struct {
+  void (*max)(const repro_reduction *r, ptrdiff_t lo, ptrdiff_t hi, double *max, double *check);
+  void (*fold)(const repro_reduction *r, ptrdiff_t lo, ptrdiff_t hi, double *fold);
+} repro_bin_kernels;
+
+#define KATTR
+#define KNAME(name) repro_bin_generic_##name
+#define VEC double
+#define VW 1
+#define VZERO 0.0
+#define VSET1(x) (x)
+#define VLOAD(p) (*(p))
+#define VSTORE(p, v) (*(p) = (v))
+#define VADD(a, b) ((a) + (b))
+#define VSUB(a, b) ((a) - (b))
+#define VMUL(a, b) ((a) * (b))
+#define VMAX(a, b) ((b) > (a) ? (b) : (a))
+#define VABS(a) fabs(a)
+#include "reproducible_bin.inc"
+#undef KATTR
+#undef KNAME
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMAX
+#undef VABS
+
+#ifdef LEANBLAS_X86_DISPATCH
+#define KATTR __attribute__((target("avx2")))
+#define KNAME(name) repro_bin_avx2_##name
+#define VEC __m256d
+#define VW 4
+#define VZERO _mm256_setzero_pd()
+#define VSET1 _mm256_set1_pd
+#define VLOAD _mm256_load_pd
+#define VSTORE _mm256_storeu_pd
+#define VADD _mm256_add_pd
+#define VSUB _mm256_sub_pd
+#define VMUL _mm256_mul_pd
+#define VMAX _mm256_max_pd
+#define VABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), (a))
+#include "reproducible_bin.inc"
+#undef KATTR
+#undef KNAME
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMAX
+#undef VABS
+
+#define KATTR __attribute__((target("avx512f")))
+#define KNAME(name) repro_bin_avx512_##name
+#define VEC __m512d
+#define VW 8
+#define VZERO _mm512_setzero_pd()
+#define VSET1 _mm512_set1_pd
+#define VLOAD _mm512_load_pd
+#define VSTORE _mm512_storeu_pd
+#define VADD _mm512_add_pd
+#define VSUB _mm512_sub_pd
+#define VMUL _mm512_mul_pd
+#define VMAX _mm512_max_pd
+#define VABS _mm512_abs_pd
+#include "reproducible_bin.inc"
+#undef KATTR
+#undef KNAME
+#undef VEC
+#undef VW
+#undef VZERO
+#undef VSET1
+#undef VLOAD
+#undef VSTORE
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMAX
+#undef VABS
+#endif
+
+static const leanblas_kernel_variant bin_variants[] = {
+#ifdef LEANBLAS_X86_DISPATCH
+    {"avx512", LEANBLAS_CPU_AVX512F | LEANBLAS_CPU_AVX2, &repro_bin_avx512_kernels},
+    {"avx2", LEANBLAS_CPU_AVX2, &repro_bin_avx2_kernels},
+#endif
+    {"generic", 0, &repro_bin_generic_kernels},
+};
+
+leanblas_kernel_family repro_dbin_family = LEANBLAS_KERNEL_FAMILY("dbin_repro", bin_variants);
+
+static void repro_range(const repro_reduction *r, const int task, ptrdiff_t *lo, ptrdiff_t *hi) {
+  *lo = (ptrdiff_t)task * REPRO_CHUNK;
+  *hi = *lo + REPRO_CHUNK < r->n ? *lo + REPRO_CHUNK : r->n;
+}
+
+static void repro_max_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const repro_reduction *r = (const repro_reduction *)ctx;
+  const repro_bin_kernels *k = (const repro_bin_kernels *)leanblas_kernel_select(&repro_dbin_family);
+  ptrdiff_t lo, hi;
+  repro_range(r, task, &lo, &hi);
+  k->max(r, lo, hi, &r->max[task], &r->check[task]);
+}
+
+static void repro_fold_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const repro_reduction *r = (const repro_reduction *)ctx;
+  const repro_bin_kernels *k = (const repro_bin_kernels *)leanblas_kernel_select(&repro_dbin_family);
+  ptrdiff_t lo, hi;
+  repro_range(r, task, &lo, &hi);
+  k->fold(r, lo, hi, r->fold + (ptrdiff_t)task * REPRO_FOLD);
+}
+
+// IEEE result of a reduction with an infinite or NaN term, which does not
+// depend on the order either: NaN if there is a NaN or infinities of both
+// signs, otherwise the infinity.
+static double repro_nonfinite(const repro_reduction *r) {
+  int nan = 0, pinf = 0, ninf = 0;
+  double buf[REPRO_BUF];
+  for (ptrdiff_t i0 = 0; i0 < r->n; i0 += REPRO_BUF) {
+    const ptrdiff_t cnt = r->n - i0 < REPRO_BUF ? r->n - i0 : REPRO_BUF;
+    repro_terms(r, r->kind == REPRO_NRM2 ? REPRO_ASUM : r->kind, i0, cnt, 1.0, buf);
+    for (ptrdiff_t i = 0; i < cnt; i++) {
+      nan |= isnan(buf[i]);
+      pinf |= buf[i] == INFINITY;
+      ninf |= buf[i] == -INFINITY;
+    }
+  }
+  if (nan || (pinf && ninf)) return NAN;
+  return pinf ? INFINITY : -INFINITY;
+}
+
+static double repro_reduce(repro_reduction *r) {
+  if (r->n <= 0) return 0.0;
+  const int ntasks = (int)((r->n + REPRO_CHUNK - 1) / REPRO_CHUNK);
+  double stack[2 + REPRO_FOLD];
+  double *scratch = ntasks <= 1 ? stack : (double *)malloc((size_t)ntasks * (2 + REPRO_FOLD) * sizeof(double));
+  if (!scratch) abort();
+  r->max = scratch;
+  r->check = scratch + ntasks;
+  r->fold = scratch + 2 * ntasks;
+
+  leanblas_parallel_for(ntasks, repro_max_task, r);
+  double m = 0, check = 0;
+  for (int t = 0; t < ntasks; t++) {
+    m = r->max[t] > m ? r->max[t] : m;
+    check += r->check[t];
+  }
+
+  double result;
+  if (check != check) {
+    result = repro_nonfinite(r);
+  } else if (m == 0) {
+    result = 0.0;
+  } else {
+    // m = f * 2^e with 0.5 <= f < 1.  Inputs below 2^-1022 are scaled by at
+    // most 2^1022 so the scale itself stays finite.
+    int e;
+    frexp(m, &e);
+    if (e < -1021) e = -1021;
+    r->scale = ldexp(1.0, -e);
+    int L = 0;
+    while (((ptrdiff_t)1 << L) < r->n) L++;
+    int E = L + 1;
+    for (int f = 0; f < REPRO_FOLD; f++) {
+      r->bound[f] = 1.5 * ldexp(1.0, E);
+      E = E - 51 + L;
+    }
+
+    leanblas_parallel_for(ntasks, repro_fold_task, r);
+    double total[REPRO_FOLD] = {0};
+    for (int t = 0; t < ntasks; t++)
+      for (int f = 0; f < REPRO_FOLD; f++) total[f] += r->fold[t * REPRO_FOLD + f];
+    const double sum = total[0] + (total[1] + total[2]);
+    result = r->kind == REPRO_NRM2 ? ldexp(sqrt(sum), e) : ldexp(sum, e);
+  }
+
+  if (scratch != stack) free(scratch);
+  return result;
+}
+
+double leanblas_repro_ddot(const ptrdiff_t N, const double *X, const ptrdiff_t incX, const double *Y,
+                           const ptrdiff_t incY) {
+  repro_reduction r = {.kind = REPRO_DOT, .n = N, .x = X, .y = Y, .incx = incX, .incy = incY};
+  return repro_reduce(&r);
+}
+
+double leanblas_repro_dsum(const ptrdiff_t N, const double *X, const ptrdiff_t incX) {
+  repro_reduction r = {.kind = REPRO_SUM, .n = N, .x = X, .incx = incX};
+  return repro_reduce(&r);
+}
+
+double leanblas_repro_dasum(const ptrdiff_t N, const double *X, const ptrdiff_t incX) {
+  repro_reduction r = {.kind = REPRO_ASUM, .n = N, .x = X, .incx = incX};
+  return repro_reduce(&r);
+}
+
+double leanblas_repro_dnrm2(const ptrdiff_t N, const double *X, const ptrdiff_t incX) {
+  repro_reduction r = {.kind = REPRO_NRM2, .n = N, .x = X, .incx = incX};
+  return repro_reduce(&r);
+}
+
+// ---------------------------------------------------------------------------
+// dgemv
+// ---------------------------------------------------------------------------
+//
+// y_i = alpha * (((a_i0 x_0 + a_i1 x_1) + a_i2 x_2) + ...) + beta * y_i.  The
+// order is part of the definition, so the storage order of A does not matter
+// either.
+
+#define REPRO_GEMV_ROWS 512
+#define REPRO_GEMV_COLS 8
+
+typedef struct {
+  int trans;
+  ptrdiff_t M, N;
+  double alpha, beta;
+  const double *A;
+  ptrdiff_t lda;
+  const double *X;
+  ptrdiff_t incX;
+  double *Y;
+  ptrdiff_t incY;
+} repro_gemv_job;
+
+static double repro_axpby(const double alpha, const double t, const double beta, const double y) {
+  return beta == 0 ? alpha * t : alpha * t + beta * y;
+}
+
+// Rows [i0, i0 + REPRO_GEMV_ROWS) of y = alpha*A*x + beta*y: the row sums run
+// side by side, one column of A at a time.
+static void repro_gemv_n_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const repro_gemv_job *g = (const repro_gemv_job *)ctx;
+  const ptrdiff_t i0 = (ptrdiff_t)task * REPRO_GEMV_ROWS;
+  const ptrdiff_t m = g->M - i0 < REPRO_GEMV_ROWS ? g->M - i0 : REPRO_GEMV_ROWS;
+  double t[REPRO_GEMV_ROWS];
+  for (ptrdiff_t i = 0; i < m; i++) t[i] = 0;
+  for (ptrdiff_t j = 0; j < g->N; j++) {
+    const double xj = g->X[j * g->incX];
+    const double *a = g->A + i0 + j * g->lda;
+    for (ptrdiff_t i = 0; i < m; i++) t[i] = t[i] + a[i] * xj;
+  }
+  for (ptrdiff_t i = 0; i < m; i++) {
+    double *y = g->Y + (i0 + i) * g->incY;
+    *y = repro_axpby(g->alpha, t[i], g->beta, *y);
+  }
+}
+
+// Entries [j0, j0 + REPRO_GEMV_ROWS) of y = alpha*Aᵀ*x + beta*y: each is a
+// column dot product, REPRO_GEMV_COLS of them interleaved.
+static void repro_gemv_t_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const repro_gemv_job *g = (const repro_gemv_job *)ctx;
+  const ptrdiff_t j0 = (ptrdiff_t)task * REPRO_GEMV_ROWS;
+  const ptrdiff_t n = g->N - j0 < REPRO_GEMV_ROWS ? g->N - j0 : REPRO_GEMV_ROWS;
+  for (ptrdiff_t jb = 0; jb < n; jb += REPRO_GEMV_COLS) {
+    const int cols = n - jb < REPRO_GEMV_COLS ? (int)(n - jb) : REPRO_GEMV_COLS;
+    const double *a = g->A + (j0 + jb) * g->lda;
+    double t[REPRO_GEMV_COLS] = {0};
+    for (ptrdiff_t i = 0; i < g->M; i++) {
+      const double xi = g->X[i * g->incX];
+      for (int c = 0; c < cols; c++) t[c] = t[c] + a[i + c * g->lda] * xi;
+    }
+    for (int c = 0; c < cols; c++) {
+      double *y = g->Y + (j0 + jb + c) * g->incY;
+      *y = repro_axpby(g->alpha, t[c], g->beta, *y);
+    }
+  }
+}
+
+void leanblas_repro_dgemv(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                          const double alpha, const double *A, const int lda, const double *X, const int incX,
+                          const double beta, double *Y, const int incY) {
+  // Row-major A is column-major Aᵀ.
+  const int trans = (TransA != CblasNoTrans) != (order == CblasRowMajor);
+  const ptrdiff_t rows = order == CblasColMajor ? M : N, cols = order == CblasColMajor ? N : M;
+  const ptrdiff_t leny = TransA == CblasNoTrans ? M : N, lenx = TransA == CblasNoTrans ? N : M;
+  if (leny <= 0) return;
+  // Lean passes non-negative increments; CBLAS walks negative ones backwards.
+  if (incX < 0) X += (lenx - 1) * (ptrdiff_t)-incX;
+  if (incY < 0) Y += (leny - 1) * (ptrdiff_t)-incY;
+
+  if (alpha == 0 || lenx == 0) {
+    for (ptrdiff_t i = 0; i < leny; i++) {
+      double *y = Y + i * incY;
+      *y = beta == 0 ? 0 : beta * *y;
+    }
+    return;
+  }
+  repro_gemv_job g = {trans, rows, cols, alpha, beta, A, lda, X, incX, Y, incY};
+  const int ntasks = (int)((leny + REPRO_GEMV_ROWS - 1) / REPRO_GEMV_ROWS);
+  leanblas_parallel_for(ntasks, trans ? repro_gemv_t_task : repro_gemv_n_task, &g);
+}
+
+// ---------------------------------------------------------------------------
+// dgemm
+// ---------------------------------------------------------------------------
+//
+// c_ij = alpha * (((a_i0 b_0j + a_i1 b_1j) + a_i2 b_2j) + ...) + beta * c_ij.
+// The driver packs op(A) and op(B) like the native gemm, but the running sums
+// live in a tile buffer T that every KC slab continues instead of restarting
+// from zero, so the k order is strictly sequential.  Tasks are MB×NB blocks
+// of C, each owned by a single thread.
+
+typedef struct {
+  int mr, nr;  // register tile
+  int mb, nb;  // block of C per task, multiples of mr and nr
+  int kc;
+  // T[0:mr, 0:nr] += Ap * Bp, one k at a time, with panels as in native_gemm.c.
+  void (*fn)(ptrdiff_t kc, const double *a, const double *b, double *t, ptrdiff_t ldt);
+} repro_gemm_kernel;
+
+static void rgemm_generic_4x4(ptrdiff_t kc, const double *a, const double *b, double *t, ptrdiff_t ldt) {
+  double acc[16];
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++) acc[i + 4 * j] = t[i + j * ldt];
+  for (ptrdiff_t p = 0; p < kc; p++, a += 4, b += 4)
+    for (int j = 0; j < 4; j++)
+      for (int i = 0; i < 4; i++) acc[i + 4 * j] = acc[i + 4 * j] + a[i] * b[j];
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++) t[i + j * ldt] = acc[i + 4 * j];
+}
+
+static const repro_gemm_kernel rgemm_generic = {4, 4, 128, 64, 256, rgemm_generic_4x4};
+
+#ifdef LEANBLAS_X86_DISPATCH
+
+// Same register tiles as the native kernels, with a separate multiply and add.
+#define REPRO_ACC2(j) BCAST_T c##j##0 = LOAD(t + j * ldt), c##j##1 = LOAD(t + j * ldt + W);
+#define REPRO_MULADD2(j)                        \
+  {                                             \
+    const BCAST_T bj = BCAST(b + j);            \
+    c##j##0 = ADD(c##j##0, MUL(a0, bj));        \
+    c##j##1 = ADD(c##j##1, MUL(a1, bj));        \
+  }
+#define REPRO_STORE2(j)             \
+  {                                 \
+    STORE(t + j * ldt, c##j##0);     \
+    STORE(t + j * ldt + W, c##j##1); \
+  }
+#define REPRO_COLS6(M) M(0) M(1) M(2) M(3) M(4) M(5)
+#define REPRO_COLS12(M) REPRO_COLS6(M) M(6) M(7) M(8) M(9) M(10) M(11)
+
+#define BCAST_T __m256d
+#define BCAST(p) _mm256_broadcast_sd(p)
+#define MUL _mm256_mul_pd
+#define ADD _mm256_add_pd
+#define LOAD _mm256_loadu_pd
+#define STORE _mm256_storeu_pd
+#define W 4
+__attribute__((target("avx2")))
+static void rgemm_avx2_8x6(ptrdiff_t kc, const double *a, const double *b, double *t, ptrdiff_t ldt) {
+  REPRO_COLS6(REPRO_ACC2)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 8, b += 6) {
+    const __m256d a0 = LOAD(a), a1 = LOAD(a + W);
+    REPRO_COLS6(REPRO_MULADD2)
+  }
+  REPRO_COLS6(REPRO_STORE2)
+}
+#undef BCAST_T
+#undef BCAST
+#undef MUL
+#undef ADD
+#undef LOAD
+#undef STORE
+#undef W
+
+#define BCAST_T __m512d
+#define BCAST(p) _mm512_set1_pd(*(p))
+#define MUL _mm512_mul_pd
+#define ADD _mm512_add_pd
+#define LOAD _mm512_loadu_pd
+#define STORE _mm512_storeu_pd
+#define W 8
+__attribute__((target("avx512f")))
+static void rgemm_avx512_16x12(ptrdiff_t kc, const double *a, const double *b, double *t, ptrdiff_t ldt) {
+  REPRO_COLS12(REPRO_ACC2)
+  for (ptrdiff_t p = 0; p < kc; p++, a += 16, b += 12) {
+    const __m512d a0 = LOAD(a), a1 = LOAD(a + W);
+    REPRO_COLS12(REPRO_MULADD2)
+  }
+  REPRO_COLS12(REPRO_STORE2)
+}
+#undef BCAST_T
+#undef BCAST
+#undef MUL
+#undef ADD
+#undef LOAD
+#undef STORE
+#undef W
+
+static const repro_gemm_kernel rgemm_avx2 = {8, 6, 144, 96, 256, rgemm_avx2_8x6};
+static const repro_gemm_kernel rgemm_avx512 = {16, 12, 192, 96, 256, rgemm_avx512_16x12};
+
+#endif
+
+// Every variant computes the same bits; they only differ in speed.
+static const leanblas_kernel_variant rgemm_variants[] = {
+#ifdef LEANBLAS_X86_DISPATCH
+    {"avx512", LEANBLAS_CPU_AVX512F | LEANBLAS_CPU_AVX2, &rgemm_avx512},
+    {"avx2", LEANBLAS_CPU_AVX2, &rgemm_avx2},
+#endif
+    {"generic", 0, &rgemm_generic},
+};
+
+leanblas_kernel_family repro_dgemm_family = LEANBLAS_KERNEL_FAMILY("dgemm_repro", rgemm_variants);
+
+typedef struct {
+  int transA, transB;
+  ptrdiff_t M, N, K;
+  double alpha, beta;
+  const double *A;
+  ptrdiff_t lda;
+  const double *B;
+  ptrdiff_t ldb;
+  double *C;
+  ptrdiff_t ldc;
+  const repro_gemm_kernel *kern;
+  ptrdiff_t mblocks;
+} repro_gemm_job;
+
+static _Thread_local double *rgemm_buf = NULL;
+static _Thread_local size_t rgemm_cap = 0;
+
+static double *rgemm_scratch(const size_t n) {
+  if (rgemm_cap < n) {
+    free(rgemm_buf);
+    void *p = NULL;
+    if (posix_memalign(&p, 64, n * sizeof(double)) != 0) abort();
+    rgemm_buf = (double *)p;
+    rgemm_cap = n;
+  }
+  return rgemm_buf;
+}
+
+static void repro_gemm_task(void *ctx, int task, int ntasks) {
+  (void)ntasks;
+  const repro_gemm_job *g = (const repro_gemm_job *)ctx;
+  const repro_gemm_kernel *kern = g->kern;
+  const int mr = kern->mr, nr = kern->nr;
+  const ptrdiff_t i0 = (task % g->mblocks) * kern->mb, j0 = (task / g->mblocks) * kern->nb;
+  const ptrdiff_t m = g->M - i0 < kern->mb ? g->M - i0 : kern->mb;
+  const ptrdiff_t n = g->N - j0 < kern->nb ? g->N - j0 : kern->nb;
+  const ptrdiff_t mp = (m + mr - 1) / mr * mr, np = (n + nr - 1) / nr * nr;
+
+  double *T = rgemm_scratch((size_t)(mp * np + (mp + np) * kern->kc));
+  double *Ap = T + mp * np, *Bp = Ap + mp * kern->kc;
+  for (ptrdiff_t i = 0; i < mp * np; i++) T[i] = 0;
+
+  for (ptrdiff_t pc = 0; pc < g->K; pc += kern->kc) {
+    const ptrdiff_t kc = g->K - pc < kern->kc ? g->K - pc : kern->kc;
+    // op(A) rows [i0, i0+m) in MR-row panels, op(B) cols [j0, j0+n) in NR-column
+    // panels, zero padded.  Padding only feeds rows and columns of T that are
+    // never stored.
+    double *dst = Ap;
+    for (ptrdiff_t ir = 0; ir < mp; ir += mr)
+      for (ptrdiff_t p = 0; p < kc; p++, dst += mr)
+        for (ptrdiff_t i = 0; i < mr; i++) {
+          const ptrdiff_t row = i0 + ir + i, k = pc + p;
+          dst[i] = ir + i >= m ? 0 : g->transA ? g->A[k + row * g->lda] : g->A[row + k * g->lda];
+        }
+    dst = Bp;
+    for (ptrdiff_t jr = 0; jr < np; jr += nr)
+      for (ptrdiff_t p = 0; p < kc; p++, dst += nr)
+        for (ptrdiff_t j = 0; j < nr; j++) {
+          const ptrdiff_t col = j0 + jr + j, k = pc + p;
+          dst[j] = jr + j >= n ? 0 : g->transB ? g->B[col + k * g->ldb] : g->B[k + col * g->ldb];
+        }
+    for (ptrdiff_t jr = 0; jr < np; jr += nr)
+      for (ptrdiff_t ir = 0; ir < mp; ir += mr) kern->fn(kc, Ap + ir * kc, Bp + jr * kc, T + ir + jr * mp, mp);
+  }
+
+  for (ptrdiff_t j = 0; j < n; j++) {
+    double *c = g->C + i0 + (j0 + j) * g->ldc;
+    for (ptrdiff_t i = 0; i < m; i++) c[i] = repro_axpby(g->alpha, T[i + j * mp], g->beta, c[i]);
+  }
+}
+
+// Below twice this many flops the pool costs more than it saves.
+#define REPRO_GEMM_MIN_FLOPS 4.0e6
+
+void leanblas_repro_dgemm(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                          const int M, const int N, const int K, const double alpha, const double *A, const int lda,
+                          const double *B, const int ldb, const double beta, double *C, const int ldc) {
+  if (M <= 0 || N <= 0) return;
+  const int ta = TransA != CblasNoTrans, tb = TransB != CblasNoTrans;
+  // Row-major C = op(A) op(B) is column-major Cᵀ = op(B)ᵀ op(A)ᵀ; b*a == a*b,
+  // so every element still sums the same products in the same order.
+  repro_gemm_job g = Order == CblasColMajor
+                         ? (repro_gemm_job){ta, tb, M, N, K, alpha, beta, A, lda, B, ldb, C, ldc, NULL, 0}
+                         : (repro_gemm_job){tb, ta, N, M, K, alpha, beta, B, ldb, A, lda, C, ldc, NULL, 0};
+
+  if (alpha == 0 || K <= 0) {
+    for (ptrdiff_t j = 0; j < g.N; j++)
+      for (ptrdiff_t i = 0; i < g.M; i++) {
+        double *c = g.C + i + j * g.ldc;
+        *c = beta == 0 ? 0 : beta * *c;
+      }
+    return;
+  }
+
+  g.kern = (const repro_gemm_kernel *)leanblas_kernel_select(&repro_dgemm_family);
+  g.mblocks = (g.M + g.kern->mb - 1) / g.kern->mb;
+  const int ntasks = (int)(g.mblocks * ((g.N + g.kern->nb - 1) / g.kern->nb));
+  if (2.0 * (double)g.M * (double)g.N * (double)g.K < 2 * REPRO_GEMM_MIN_FLOPS) {
+    for (int t = 0; t < ntasks; t++) repro_gemm_task(&g, t, ntasks);
+    return;
+  }
+  leanblas_parallel_for(ntasks, repro_gemm_task, &g);
+}
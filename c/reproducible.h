@@ -0,0 +1,42 @@
+#pragma once
+
+#include "cblas_compat.h"
+#include <stddef.h>
+
+// Bitwise-reproducible `ddot`, `dsum`, `dasum`, `dnrm2`, `dgemv` and `dgemm`
+// (reproducible.c).
+//
+// The Lean functions `BLAS.Reproducible.<op>` (`leanblas_reproducible_<op>`)
+// always call the routines below.  Their results depend only on the inputs:
+// not on the number of threads, the selected SIMD kernels or the backend the
+// library was built against.
+//
+// * The Level 1 reductions use binned summation in the style of ReproBLAS:
+//   every term is split against boundaries derived from the largest
+//   magnitude, and the pieces are added exactly, so the sum is the same in
+//   any order.  The result is also at least as accurate as a plain
+//   sequential sum.
+// * `dgemv` and `dgemm` compute each output element as alpha times the
+//   sequential sum over the reduction index (no FMA contraction) plus beta
+//   times the old value.  Threads only split the output elements.
+//
+// The process-wide mode makes the IO entry points that run these operations,
+// call graph replays and async jobs, use the routines below as well.  The pure
+// `leanblas_cblas_<op>` wrappers never read it.  The mode is off by default.
+// It starts enabled when the environment sets `LEANBLAS_REPRODUCIBLE=1`, and
+// can be toggled at any time.
+int leanblas_reproducible(void);
+void leanblas_set_reproducible(int on);
+
+double leanblas_repro_ddot(const ptrdiff_t N, const double *X, const ptrdiff_t incX, const double *Y,
+                           const ptrdiff_t incY);
+double leanblas_repro_dsum(const ptrdiff_t N, const double *X, const ptrdiff_t incX);
+double leanblas_repro_dasum(const ptrdiff_t N, const double *X, const ptrdiff_t incX);
+double leanblas_repro_dnrm2(const ptrdiff_t N, const double *X, const ptrdiff_t incX);
+
+void leanblas_repro_dgemv(const CBLAS_ORDER order, const CBLAS_TRANSPOSE TransA, const int M, const int N,
+                          const double alpha, const double *A, const int lda, const double *X, const int incX,
+                          const double beta, double *Y, const int incY);
+void leanblas_repro_dgemm(const CBLAS_ORDER Order, const CBLAS_TRANSPOSE TransA, const CBLAS_TRANSPOSE TransB,
+                          const int M, const int N, const int K, const double alpha, const double *A, const int lda,
+                          const double *B, const int ldb, const double beta, double *C, const int ldc);
@@ -0,0 +1,782 @@
+#include <lean/lean.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "native.h"
+#include "util.h"
+
+// Safetensors files (`LeanBLAS/FFI/Safetensors.lean`): a little-endian u64
+// header length, a JSON header mapping tensor names to their dtype, shape and
+// byte range in the data section, and the data section.
+//
+// The reader builds each tensor's `ByteArray` in place in its own private
+// mapping of the file: the tensors are packed back to back, so the persistent
+// array header that goes in the 24 bytes before the data would overwrite the
+// end of the previous tensor in a shared mapping, but only touches a private
+// copy of that page in a mapping of its own.  Tensors that are not 8-byte
+// aligned in the file are read instead.  `F16` and `BF16` tensors are widened
+// to `F32` on the native thread pool.  As for `.npy` files, the mapped arrays
+// are never freed and the mappings never unmapped.
+//
+// The writer takes every name, dtype and shape up front, writes the header,
+// and then streams the tensors in that order; the file is written as
+// `PATH.tmp` and renamed when complete.
+
+#define ST_MAX_HEADER (100u << 20)   // as the reference implementation
+#define ST_MAX_DIMS 64
+#define ST_CONVERT_CHUNK (1u << 20)   // elements per widening task
+
+static const struct {
+  const char *name;
+  size_t size;
+} dtypes[] = {
+    {"F64", 8}, {"F32", 4}, {"F16", 2}, {"BF16", 2}, {"I64", 8}, {"I32", 4},     {"I16", 2},     {"I8", 1},
+    {"U64", 8}, {"U32", 4}, {"U16", 2}, {"U8", 1},   {"BOOL", 1}, {"F8_E4M3", 1}, {"F8_E5M2", 1},
+};
+
+// Element size of a dtype, or 0.
+static size_t dtype_size(const char *name) {
+  for (size_t k = 0; k < sizeof(dtypes) / sizeof(dtypes[0]); k++)
+    if (strcmp(dtypes[k].name, name) == 0) return dtypes[k].size;
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// JSON header
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  const char *start, *p, *end;
+  const char *err;   // first error, with `p` where it happened
+} json;
+
+static void ws(json *j) {
+  while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')) j->p++;
+}
+
+static int fail(json *j, const char *err) {
+  if (!j->err) j->err = err;
+  return 0;
+}
+
+static int eat(json *j, char c) {
+  ws(j);
+  if (j->p < j->end && *j->p == c) {
+    j->p++;
+    return 1;
+  }
+  return 0;
+}
+
+static int hex4(json *j, uint32_t *out) {
+  if (j->end - j->p < 4) return fail(j, "bad escape");
+  uint32_t v = 0;
+  for (int k = 0; k < 4; k++) {
+    const char c = *j->p++;
+    v <<= 4;
+    if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+    else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+    else return fail(j, "bad escape");
+  }
+  *out = v;
+  return 1;
+}
+
+// A string, unescaped into a fresh NUL-terminated buffer (never longer than
+// its escaped form); `*out` is NULL on failure.
+static int parse_string(json *j, char **out) {
+  *out = NULL;
+  if (!eat(j, '"')) return fail(j, "expected a string");
+  const char *q = j->p;
+  while (q < j->end && *q != '"') q += *q == '\\' ? 2 : 1;
+  if (q >= j->end) return fail(j, "unterminated string");
+  char *s = malloc((size_t)(q - j->p) + 1), *o = s;
+  if (!s) lean_internal_panic_out_of_memory();
+  while (*j->p != '"') {
+    char c = *j->p++;
+    if ((unsigned char)c < 0x20) {
+      free(s);
+      return fail(j, "control character in string");
+    }
+    if (c != '\\') {
+      *o++ = c;
+      continue;
+    }
+    c = *j->p++;
+    uint32_t u;
+    switch (c) {
+      case '"': case '\\': case '/': *o++ = c; continue;
+      case 'b': *o++ = '\b'; continue;
+      case 'f': *o++ = '\f'; continue;
+      case 'n': *o++ = '\n'; continue;
+      case 'r': *o++ = '\r'; continue;
+      case 't': *o++ = '\t'; continue;
+      case 'u': break;
+      default: free(s); return fail(j, "bad escape");
+    }
+    if (!hex4(j, &u)) {
+      free(s);
+      return 0;
+    }
+    if (u >= 0xD800 && u < 0xDC00) {
+      uint32_t lo;
+      if (j->end - j->p < 2 || j->p[0] != '\\' || j->p[1] != 'u') {
+        free(s);
+        return fail(j, "unpaired surrogate");
+      }
+      j->p += 2;
+      if (!hex4(j, &lo) || lo < 0xDC00 || lo >= 0xE000) {
+        free(s);
+        return fail(j, "unpaired surrogate");
+      }
+      u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+    } else if (u >= 0xDC00 && u < 0xE000) {
+      free(s);
+      return fail(j, "unpaired surrogate");
+    }
+    // at most 4 bytes for the 6 or 12 characters of the escape
+    if (u < 0x80) *o++ = (char)u;
+    else if (u < 0x800) {
+      *o++ = (char)(0xC0 | u >> 6);
+      *o++ = (char)(0x80 | (u & 0x3F));
+    } else if (u < 0x10000) {
+      *o++ = (char)(0xE0 | u >> 12);
+      *o++ = (char)(0x80 | (u >> 6 & 0x3F));
+      *o++ = (char)(0x80 | (u & 0x3F));
+    } else {
+      *o++ = (char)(0xF0 | u >> 18);
+      *o++ = (char)(0x80 | (u >> 12 & 0x3F));
+      *o++ = (char)(0x80 | (u >> 6 & 0x3F));
+      *o++ = (char)(0x80 | (u & 0x3F));
+    }
+  }
+  j->p++;
+  *o = 0;
+  *out = s;
+  return 1;
+}
+
+static int parse_uint(json *j, uint64_t *out) {
+  ws(j);
+  if (j->p >= j->end || *j->p < '0' || *j->p > '9') return fail(j, "expected a non-negative integer");
+  uint64_t v = 0;
+  while (j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+    const uint64_t d = (uint64_t)(*j->p++ - '0');
+    if (v > (UINT64_MAX - d) / 10) return fail(j, "integer too large");
+    v = v * 10 + d;
+  }
+  *out = v;
+  return 1;
+}
+
+static int skip_value(json *j, int depth) {
+  if (depth > 64) return fail(j, "nested too deeply");
+  ws(j);
+  if (j->p >= j->end) return fail(j, "unexpected end");
+  const char c = *j->p;
+  if (c == '"') {
+    char *s;
+    if (!parse_string(j, &s)) return 0;
+    free(s);
+    return 1;
+  }
+  if (c == '{' || c == '[') {
+    const char close = c == '{' ? '}' : ']';
+    j->p++;
+    if (eat(j, close)) return 1;
+    do {
+      if (c == '{') {
+        char *key;
+        if (!parse_string(j, &key)) return 0;
+        free(key);
+        if (!eat(j, ':')) return fail(j, "expected ':'");
+      }
+      if (!skip_value(j, depth + 1)) return 0;
+    } while (eat(j, ','));
+    return eat(j, close) ? 1 : fail(j, "expected ',' or a closing bracket");
+  }
+  const char *q = j->p;
+  while (q < j->end && (strchr("+-.eE", *q) || (*q >= '0' && *q <= '9') || (*q >= 'a' && *q <= 'z'))) q++;
+  const size_t n = (size_t)(q - j->p);
+  const int lit = (n == 4 && (!memcmp(j->p, "true", 4) || !memcmp(j->p, "null", 4))) || (n == 5 && !memcmp(j->p, "false", 5));
+  if (n == 0 || (!lit && !(c == '-' || (c >= '0' && c <= '9')))) return fail(j, "unexpected character");
+  j->p = q;
+  return 1;
+}
+
+typedef struct {
+  char *name;
+  char dtype[16];
+  size_t item;
+  size_t ndim;
+  uint64_t shape[ST_MAX_DIMS];
+  uint64_t begin, end;
+} st_tensor;
+
+typedef struct {
+  st_tensor *tensors;
+  size_t ntensors, cap;
+  char **meta;   // key, value, key, value, ...
+  size_t nmeta;
+} st_header;
+
+static void header_free(st_header *h) {
+  for (size_t i = 0; i < h->ntensors; i++) free(h->tensors[i].name);
+  for (size_t i = 0; i < 2 * h->nmeta; i++) free(h->meta[i]);
+  free(h->tensors);
+  free(h->meta);
+}
+
+static int parse_metadata(json *j, st_header *h) {
+  if (!eat(j, '{')) return fail(j, "__metadata__ must be an object of strings");
+  if (eat(j, '}')) return 1;
+  do {
+    char **grown = realloc(h->meta, 2 * (h->nmeta + 1) * sizeof(char *));
+    if (!grown) lean_internal_panic_out_of_memory();
+    h->meta = grown;
+    if (!parse_string(j, &h->meta[2 * h->nmeta])) return 0;
+    h->meta[2 * h->nmeta + 1] = NULL;
+    h->nmeta++;
+    if (!eat(j, ':')) return fail(j, "expected ':'");
+    if (!parse_string(j, &h->meta[2 * h->nmeta - 1])) return fail(j, "__metadata__ must be an object of strings");
+  } while (eat(j, ','));
+  return eat(j, '}') ? 1 : fail(j, "expected ',' or '}'");
+}
+
+static int parse_tensor(json *j, st_tensor *t) {
+  int have_dtype = 0, have_shape = 0, have_offsets = 0;
+  if (!eat(j, '{')) return fail(j, "expected a tensor object");
+  if (!eat(j, '}')) do {
+      char *key;
+      if (!parse_string(j, &key)) return 0;
+      if (!eat(j, ':')) {
+        free(key);
+        return fail(j, "expected ':'");
+      }
+      int ok;
+      if (strcmp(key, "dtype") == 0) {
+        char *d;
+        ok = parse_string(j, &d);
+        if (ok) {
+          t->item = dtype_size(d);
+          if (!t->item) ok = fail(j, "unsupported dtype");
+          else strcpy(t->dtype, d);
+          free(d);
+        }
+        have_dtype = 1;
+      } else if (strcmp(key, "shape") == 0) {
+        ok = eat(j, '[') || fail(j, "expected '['");
+        t->ndim = 0;
+        if (ok && !eat(j, ']')) {
+          do {
+            if (t->ndim == ST_MAX_DIMS) ok = fail(j, "too many dimensions");
+            else ok = parse_uint(j, &t->shape[t->ndim++]);
+          } while (ok && eat(j, ','));
+          ok = ok && (eat(j, ']') || fail(j, "expected ',' or ']'"));
+        }
+        have_shape = 1;
+      } else if (strcmp(key, "data_offsets") == 0) {
+        ok = (eat(j, '[') || fail(j, "expected '['")) && parse_uint(j, &t->begin) && (eat(j, ',') || fail(j, "expected ','")) &&
+             parse_uint(j, &t->end) && (eat(j, ']') || fail(j, "expected ']'"));
+        have_offsets = 1;
+      } else {
+        ok = skip_value(j, 1);
+      }
+      free(key);
+      if (!ok) return 0;
+    } while (eat(j, ','));
+  if (!eat(j, '}')) return fail(j, "expected ',' or '}'");
+  if (!have_dtype || !have_shape || !have_offsets) return fail(j, "tensor without dtype, shape or data_offsets");
+  return 1;
+}
+
+// Parses the header; returns an error message or NULL.
+static const char *parse_header(const char *text, size_t n, st_header *h, size_t *where) {
+  json j = {text, text, text + n, NULL};
+  memset(h, 0, sizeof(*h));
+  if (!eat(&j, '{')) fail(&j, "header is not a JSON object");
+  else if (!eat(&j, '}')) {
+    do {
+      char *key;
+      if (!parse_string(&j, &key)) break;
+      if (!eat(&j, ':')) {
+        free(key);
+        fail(&j, "expected ':'");
+        break;
+      }
+      if (strcmp(key, "__metadata__") == 0) {
+        free(key);
+        if (!parse_metadata(&j, h)) break;
+        continue;
+      }
+      if (h->ntensors == h->cap) {
+        h->cap = h->cap ? 2 * h->cap : 64;
+        st_tensor *grown = realloc(h->tensors, h->cap * sizeof(st_tensor));
+        if (!grown) lean_internal_panic_out_of_memory();
+        h->tensors = grown;
+      }
+      st_tensor *t = &h->tensors[h->ntensors++];
+      memset(t, 0, sizeof(*t));
+      t->name = key;
+      if (!parse_tensor(&j, t)) break;
+    } while (eat(&j, ','));
+    if (!j.err && !eat(&j, '}')) fail(&j, "expected ',' or '}'");
+  }
+  if (!j.err) {
+    ws(&j);
+    if (j.p != j.end) fail(&j, "trailing characters after the header");
+  }
+  *where = (size_t)(j.p - j.start);
+  return j.err;
+}
+
+static int name_cmp(const void *a, const void *b) { return strcmp(*(char *const *)a, *(char *const *)b); }
+
+// A name that more than one tensor of the header has, or NULL.
+static const char *duplicate_name(const st_header *h) {
+  char **names = malloc((h->ntensors ? h->ntensors : 1) * sizeof(char *));
+  if (!names) lean_internal_panic_out_of_memory();
+  for (size_t i = 0; i < h->ntensors; i++) names[i] = h->tensors[i].name;
+  qsort(names, h->ntensors, sizeof(char *), name_cmp);
+  const char *dup = NULL;
+  for (size_t i = 1; i < h->ntensors && !dup; i++)
+    if (strcmp(names[i - 1], names[i]) == 0) dup = names[i];
+  free(names);
+  return dup;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+static float half_to_float(uint16_t h) {
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16, exp = h >> 10 & 0x1F, mant = h & 0x3FF;
+  uint32_t bits;
+  if (exp == 0x1F) bits = sign | 0x7F800000u | mant << 13;
+  else if (exp != 0) bits = sign | (exp + 112) << 23 | mant << 13;
+  else {
+    const float f = (float)mant * 0x1p-24f;   // zero or subnormal, exact
+    memcpy(&bits, &f, 4);
+    bits |= sign;
+  }
+  float f;
+  memcpy(&f, &bits, 4);
+  return f;
+}
+
+typedef struct {
+  const uint16_t *src;
+  float *dst;
+  size_t count;
+  int bf16;
+} widen_ctx;
+
+static void widen_task(void *p, int task, int ntasks) {
+  const widen_ctx *c = p;
+  const size_t lo = c->count * (size_t)task / (size_t)ntasks, hi = c->count * (size_t)(task + 1) / (size_t)ntasks;
+  if (c->bf16) {
+    for (size_t i = lo; i < hi; i++) {
+      const uint32_t bits = (uint32_t)c->src[i] << 16;
+      memcpy(&c->dst[i], &bits, 4);
+    }
+  } else {
+    for (size_t i = lo; i < hi; i++) c->dst[i] = half_to_float(c->src[i]);
+  }
+}
+
+typedef struct {
+  void *addr;
+  size_t len;
+} st_mapping;
+
+static lean_object *mk_tensor(const st_tensor *t, lean_object *data) {
+  lean_object *shape = lean_alloc_array(t->ndim, t->ndim);
+  for (size_t i = 0; i < t->ndim; i++) lean_array_set_core(shape, i, lean_uint64_to_nat(t->shape[i]));
+  lean_object *r = lean_alloc_ctor(0, 3, 0);
+  lean_ctor_set(r, 0, lean_mk_string(t->dtype));
+  lean_ctor_set(r, 1, shape);
+  lean_ctor_set(r, 2, data);
+  return r;
+}
+
+/**
+ * Reads every tensor of a file.
+ *
+ * @param map build the arrays in private mappings of the file where possible
+ * @return (Array (String × Tensor)) × (Array (String × String)), the tensors
+ *         in file order and the `__metadata__` entries
+ */
+LEAN_EXPORT lean_obj_res leanblas_safetensors_read(b_lean_obj_arg lpath, uint8_t map, lean_obj_arg world) {
+  (void)world;
+  const char *path = lean_string_cstr(lpath);
+  if (!leanblas_host_is_little())
+    return leanblas_file_error(path, "safetensors files are only read on little-endian machines");
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return leanblas_os_error(lpath);
+  struct stat st;
+  uint8_t len8[8];
+  char *text = NULL;
+  st_header h;
+  memset(&h, 0, sizeof(h));
+  st_mapping *maps = NULL;
+  size_t nmaps = 0;
+  lean_object *tensors = NULL;
+  lean_obj_res r = NULL;
+  if (fstat(fd, &st) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  if (st.st_size < 8) {
+    r = leanblas_file_error(path, "not a safetensors file");
+    goto done;
+  }
+  if (leanblas_read_at(fd, len8, 8, 0) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  const uint64_t hlen = leanblas_get64(len8);
+  if (hlen > ST_MAX_HEADER || hlen > (uint64_t)st.st_size - 8) {
+    r = leanblas_file_error(path, "not a safetensors file (header length %llu)", (unsigned long long)hlen);
+    goto done;
+  }
+  text = malloc(hlen + 1);
+  if (!text) lean_internal_panic_out_of_memory();
+  if (leanblas_read_at(fd, text, hlen, 8) != 0) {
+    r = leanblas_os_error(lpath);
+    goto done;
+  }
+  size_t where;
+  const char *err = parse_header(text, hlen, &h, &where);
+  if (err) {
+    r = leanblas_file_error(path, "header byte %zu: %s", where, err);
+    goto done;
+  }
+  const char *dup = duplicate_name(&h);
+  if (dup) {
+    r = leanblas_file_error(path, "duplicate tensor '%s'", dup);
+    goto done;
+  }
+  const uint64_t data_start = 8 + hlen, data_len = (uint64_t)st.st_size - data_start;
+  for (size_t i = 0; i < h.ntensors; i++) {
+    const st_tensor *t = &h.tensors[i];
+    uint64_t count = 1;
+    int overflow = 0;
+    for (size_t d = 0; d < t->ndim; d++) {
+      if (t->shape[d] != 0 && count > UINT64_MAX / t->shape[d]) overflow = 1;
+      else count *= t->shape[d];
+    }
+    if (t->end < t->begin || t->end > data_len) {
+      r = leanblas_file_error(path, "tensor '%s': data_offsets outside the file", t->name);
+      goto done;
+    }
+    if (overflow || count > UINT64_MAX / t->item || count * t->item != t->end - t->begin || count > SIZE_MAX / 4) {
+      r = leanblas_file_error(path, "tensor '%s': %llu bytes do not match the shape", t->name,
+                   (unsigned long long)(t->end - t->begin));
+      goto done;
+    }
+  }
+  maps = calloc(h.ntensors + 1, sizeof(st_mapping));
+  if (!maps) lean_internal_panic_out_of_memory();
+  tensors = lean_alloc_array(0, h.ntensors);
+  for (size_t i = 0; i < h.ntensors; i++) {
+    st_tensor *t = &h.tensors[i];
+    const uint64_t off = data_start + t->begin;
+    const size_t bytes = (size_t)(t->end - t->begin);
+    const int widen = strcmp(t->dtype, "F16") == 0 || strcmp(t->dtype, "BF16") == 0;
+    lean_object *data = NULL;
+    if (widen) {
+      const size_t count = bytes / 2;
+      uint16_t *src = malloc(bytes ? bytes : 1);
+      if (!src) lean_internal_panic_out_of_memory();
+      if (leanblas_read_at(fd, src, bytes, off) != 0) {
+        r = leanblas_os_error(lpath);
+        free(src);
+        goto done;
+      }
+      data = lean_alloc_sarray(1, 4 * count, 4 * count);
+      widen_ctx c = {src, (float *)lean_sarray_cptr(data), count, t->dtype[0] == 'B'};
+      const size_t tasks = count / ST_CONVERT_CHUNK + 1;
+      const size_t most = 4 * (size_t)leanblas_num_threads();
+      if (tasks > 1) leanblas_parallel_for((int)(tasks < most ? tasks : most), widen_task, &c);
+      else widen_task(&c, 0, 1);
+      free(src);
+      strcpy(t->dtype, "F32");
+    } else if (map) {
+      data = leanblas_map_sarray(fd, off, bytes, &maps[nmaps].addr, &maps[nmaps].len);
+      if (data) nmaps++;
+    }
+    if (!data) {
+      data = lean_alloc_sarray(1, bytes, bytes);
+      if (leanblas_read_at(fd, lean_sarray_cptr(data), bytes, off) != 0) {
+        r = leanblas_os_error(lpath);
+        lean_dec(data);
+        goto done;
+      }
+    }
+    lean_object *pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, lean_mk_string(t->name));
+    lean_ctor_set(pair, 1, mk_tensor(t, data));
+    tensors = lean_array_push(tensors, pair);
+  }
+  lean_object *meta = lean_alloc_array(h.nmeta, h.nmeta);
+  for (size_t i = 0; i < h.nmeta; i++) {
+    lean_object *pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, lean_mk_string(h.meta[2 * i]));
+    lean_ctor_set(pair, 1, lean_mk_string(h.meta[2 * i + 1]));
+    lean_array_set_core(meta, i, pair);
+  }
+  lean_object *res = lean_alloc_ctor(0, 2, 0);
+  lean_ctor_set(res, 0, tensors);
+  lean_ctor_set(res, 1, meta);
+  r = lean_io_result_mk_ok(res);
+  tensors = NULL;
+  nmaps = 0;   // the arrays live in the mappings from now on
+done:
+  if (tensors) lean_dec(tensors);
+  for (size_t i = 0; i < nmaps; i++) munmap(maps[i].addr, maps[i].len);
+  free(maps);
+  header_free(&h);
+  free(text);
+  close(fd);
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  int fd;
+  char *path, *tmp;
+  char **names;
+  uint64_t *sizes;
+  size_t count, next;
+} st_writer;
+
+static lean_external_class *writer_class = NULL;
+static pthread_once_t writer_once = PTHREAD_ONCE_INIT;
+
+static void writer_release(st_writer *w) {
+  if (w->fd >= 0) {
+    close(w->fd);
+    unlink(w->tmp);
+    w->fd = -1;
+  }
+}
+
+static void writer_finalize(void *data) {
+  st_writer *w = data;
+  writer_release(w);
+  for (size_t i = 0; i < w->count; i++) free(w->names[i]);
+  free(w->names);
+  free(w->sizes);
+  free(w->path);
+  free(w->tmp);
+  free(w);
+}
+
+static void writer_foreach(void *data, b_lean_obj_arg f) {
+  (void)data;
+  (void)f;
+}
+
+static void writer_init(void) { writer_class = lean_register_external_class(writer_finalize, writer_foreach); }
+
+// Fails with the current `errno` and gives up on the file.
+static lean_obj_res writer_os_error(st_writer *w) {
+  const int err = errno;
+  lean_object *lpath = lean_mk_string(w->path);
+  lean_obj_res r = lean_io_result_mk_error(lean_decode_io_error(err, lpath));
+  lean_dec(lpath);
+  writer_release(w);
+  return r;
+}
+
+typedef struct {
+  char *buf;
+  size_t len, cap;
+} st_buf;
+
+static void put(st_buf *b, const char *s, size_t n) {
+  if (b->len + n > b->cap) {
+    size_t cap = b->cap ? 2 * b->cap : 4096;
+    while (cap < b->len + n) cap *= 2;
+    char *grown = realloc(b->buf, cap);
+    if (!grown) lean_internal_panic_out_of_memory();
+    b->buf = grown;
+    b->cap = cap;
+  }
+  memcpy(b->buf + b->len, s, n);
+  b->len += n;
+}
+
+static void puts_json(st_buf *b, const char *s) {
+  put(b, "\"", 1);
+  for (; *s; s++) {
+    const unsigned char c = (unsigned char)*s;
+    char esc[8];
+    if (c == '"' || c == '\\') {
+      esc[0] = '\\';
+      esc[1] = (char)c;
+      put(b, esc, 2);
+    } else if (c < 0x20) {
+      snprintf(esc, sizeof(esc), "\\u%04x", c);
+      put(b, esc, 6);
+    } else {
+      put(b, s, 1);
+    }
+  }
+  put(b, "\"", 1);
+}
+
+/**
+ * Starts a file with the given tensors, written in order by
+ * `leanblas_safetensors_add`.
+ *
+ * @param tensors  Array (String × Info), `Info` being a dtype and a shape
+ * @param metadata Array (String × String), stored as `__metadata__`
+ */
+LEAN_EXPORT lean_obj_res leanblas_safetensors_create(b_lean_obj_arg lpath, b_lean_obj_arg tensors,
+                                                     b_lean_obj_arg metadata, lean_obj_arg world) {
+  (void)world;
+  pthread_once(&writer_once, writer_init);
+  const char *path = lean_string_cstr(lpath);
+  const size_t n = lean_array_size(tensors);
+  st_buf b = {NULL, 0, 0};
+  char num[32];
+  put(&b, "{", 1);
+  const size_t nmeta = lean_array_size(metadata);
+  if (nmeta > 0) {
+    put(&b, "\"__metadata__\":{", 16);
+    for (size_t i = 0; i < nmeta; i++) {
+      b_lean_obj_arg kv = lean_array_get_core(metadata, i);
+      if (i > 0) put(&b, ",", 1);
+      puts_json(&b, lean_string_cstr(lean_ctor_get(kv, 0)));
+      put(&b, ":", 1);
+      puts_json(&b, lean_string_cstr(lean_ctor_get(kv, 1)));
+    }
+    put(&b, "}", 1);
+  }
+  uint64_t *sizes = malloc((n ? n : 1) * sizeof(uint64_t));
+  if (!sizes) lean_internal_panic_out_of_memory();
+  uint64_t offset = 0;
+  for (size_t i = 0; i < n; i++) {
+    b_lean_obj_arg entry = lean_array_get_core(tensors, i);
+    const char *name = lean_string_cstr(lean_ctor_get(entry, 0));
+    b_lean_obj_arg info = lean_ctor_get(entry, 1);
+    const char *dtype = lean_string_cstr(lean_ctor_get(info, 0));
+    b_lean_obj_arg shape = lean_ctor_get(info, 1);
+    const size_t item = dtype_size(dtype);
+    const char *err = NULL;
+    if (!item) err = "unsupported dtype";
+    if (strcmp(name, "__metadata__") == 0) err = "reserved name";
+    for (size_t k = 0; !err && k < i; k++)
+      if (strcmp(lean_string_cstr(lean_ctor_get(lean_array_get_core(tensors, k), 0)), name) == 0) err = "duplicate name";
+    if (!err && lean_array_size(shape) > ST_MAX_DIMS) err = "too many dimensions";
+    uint64_t count = 1;
+    for (size_t d = 0; !err && d < lean_array_size(shape); d++) {
+      b_lean_obj_arg x = lean_array_get_core(shape, d);
+      const uint64_t k = lean_is_scalar(x) ? lean_unbox(x) : UINT64_MAX;
+      if (k == UINT64_MAX || (k != 0 && count > UINT64_MAX / k)) err = "shape too large";
+      else count *= k;
+    }
+    if (!err && count > UINT64_MAX / item) err = "shape too large";
+    if (err) {
+      free(b.buf);
+      free(sizes);
+      return leanblas_file_error(path, "tensor '%s': %s", name, err);
+    }
+    sizes[i] = count * item;
+    if (i > 0 || nmeta > 0) put(&b, ",", 1);
+    puts_json(&b, name);
+    put(&b, ":{\"dtype\":", 10);
+    puts_json(&b, dtype);
+    put(&b, ",\"shape\":[", 10);
+    for (size_t d = 0; d < lean_array_size(shape); d++) {
+      int len = snprintf(num, sizeof(num), "%s%llu", d ? "," : "",
+                         (unsigned long long)lean_unbox(lean_array_get_core(shape, d)));
+      put(&b, num, (size_t)len);
+    }
+    int len = snprintf(num, sizeof(num), "],\"data_offsets\":[%llu,", (unsigned long long)offset);
+    put(&b, num, (size_t)len);
+    offset += sizes[i];
+    len = snprintf(num, sizeof(num), "%llu]}", (unsigned long long)offset);
+    put(&b, num, (size_t)len);
+  }
+  put(&b, "}", 1);
+  // pad with spaces so that the data section starts 8-byte aligned
+  while ((8 + b.len) % 8 != 0) put(&b, " ", 1);
+
+  st_writer *w = calloc(1, sizeof(st_writer));
+  if (!w) lean_internal_panic_out_of_memory();
+  w->fd = -1;
+  w->sizes = sizes;
+  w->names = calloc(n ? n : 1, sizeof(char *));
+  w->path = strdup(path);
+  w->tmp = malloc(strlen(path) + 5);
+  if (!w->names || !w->path || !w->tmp) lean_internal_panic_out_of_memory();
+  w->count = n;
+  for (size_t i = 0; i < n; i++) {
+    w->names[i] = strdup(lean_string_cstr(lean_ctor_get(lean_array_get_core(tensors, i), 0)));
+    if (!w->names[i]) lean_internal_panic_out_of_memory();
+  }
+  sprintf(w->tmp, "%s.tmp", path);
+  w->fd = open(w->tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  uint8_t len8[8];
+  leanblas_put64(len8, (uint64_t)b.len);
+  if (w->fd < 0 || leanblas_write_all(w->fd, len8, 8) != 0 || leanblas_write_all(w->fd, b.buf, b.len) != 0) {
+    lean_obj_res r = writer_os_error(w);
+    writer_finalize(w);
+    free(b.buf);
+    return r;
+  }
+  free(b.buf);
+  return lean_io_result_mk_ok(lean_alloc_external(writer_class, w));
+}
+
+/**
+ * Writes the data of the next tensor, which must be `name`, in native
+ * (little-endian) byte order.
+ */
+LEAN_EXPORT lean_obj_res leanblas_safetensors_add(b_lean_obj_arg writer, b_lean_obj_arg lname, b_lean_obj_arg data,
+                                                  lean_obj_arg world) {
+  (void)world;
+  st_writer *w = lean_get_external_data(writer);
+  const char *name = lean_string_cstr(lname);
+  if (w->fd < 0) return leanblas_file_error(w->path, "file already finished or failed");
+  if (w->next == w->count)
+    return leanblas_file_error(w->path, "tensor '%s' was not declared or was already written", name);
+  if (strcmp(w->names[w->next], name) != 0)
+    return leanblas_file_error(w->path, "expected tensor '%s', got '%s'", w->names[w->next], name);
+  if (lean_sarray_size(data) != w->sizes[w->next])
+    return leanblas_file_error(w->path, "tensor '%s': %zu bytes, expected %llu", name, lean_sarray_size(data),
+                    (unsigned long long)w->sizes[w->next]);
+  if (leanblas_write_all(w->fd, lean_sarray_cptr(data), lean_sarray_size(data)) != 0) return writer_os_error(w);
+  w->next++;
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+LEAN_EXPORT lean_obj_res leanblas_safetensors_finish(b_lean_obj_arg writer, lean_obj_arg world) {
+  (void)world;
+  st_writer *w = lean_get_external_data(writer);
+  if (w->fd < 0) return leanblas_file_error(w->path, "file already finished or failed");
+  if (w->next < w->count) return leanblas_file_error(w->path, "tensor '%s' was never written", w->names[w->next]);
+  if (fsync(w->fd) != 0) return writer_os_error(w);
+  const int err = close(w->fd) != 0;
+  w->fd = -1;
+  if (err || rename(w->tmp, w->path) != 0) {
+    const int saved = errno;
+    unlink(w->tmp);
+    errno = saved;
+    return writer_os_error(w);
+  }
+  return lean_io_result_mk_ok(lean_box(0));
+}
@@ -0,0 +1,362 @@
+#include <lean/lean.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cblas_compat.h"
+#include "elementwise.h"
+#include "native.h"
+#include "util.h"
+
+// Streaming Level 1 pipelines over raw binary files (`LeanBLAS/FFI/Stream.lean`).
+//
+// `leanblas_stream_run` sweeps one or two files of native-endian doubles (x
+// and y) in chunks.  An I/O thread reads chunk k + 1 into one slot while the
+// calling thread computes on chunk k in the other, and writes each computed
+// chunk of the output vector back before reusing its slot, so reading,
+// computing and writing overlap.  Every chunk is split across the native
+// thread pool; each task applies all steps to blocks of STREAM_BLOCK elements
+// so that a block stays in cache from the first step to the last.
+//
+// Reductions carry their state from chunk to chunk: sums are added, and
+// `nrm2` keeps LAPACK's (scale, sum of squares) pair so that it neither
+// overflows nor underflows.  Partial results are combined in task order, so a
+// run is deterministic for a given chunk size and thread count.
+//
+// A step is STREAM_STEP_WORDS words of `code`: op, vector (0 for x, 1 for y);
+// its alpha and beta are consts[2i] and consts[2i + 1].
+
+#define STREAM_STEP_WORDS 2
+#define STREAM_BLOCK 2048
+#define STREAM_MIN_TASK 16384          // elements per task, at least
+#define STREAM_MAX_CHUNK (1u << 28)   // elements
+
+// Same order as `BLAS.Stream.Step` and `BLAS.CallGraph.Op`: the elementwise
+// ops of elementwise.h, then the reductions.
+enum { STREAM_DOT = LEANBLAS_EW_NOPS, STREAM_NRM2, STREAM_ASUM, STREAM_SUM, STREAM_NOPS };
+
+enum { SLOT_EMPTY, SLOT_READY, SLOT_DONE };
+
+typedef struct {
+  int op, vec;
+  double alpha, beta;
+  int result;   // reduction slot, -1 for maps
+} stream_step;
+
+typedef struct {
+  double *x, *y;
+  uint64_t first;
+  size_t n;
+  int state;
+} stream_slot;
+
+typedef struct {
+  int fd_x, fd_y, fd_out;
+  int out_vec;
+  uint64_t n, nchunks;
+  size_t chunk;
+  stream_slot slot[2];
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int err;    // errno of the first I/O failure, guarded by `lock`
+  int stop;   // the compute side gave up, guarded by `lock`
+  const char *err_path;
+
+  stream_step *steps;
+  int nsteps, nresults;
+  stream_slot *cur;
+  int ntasks;
+  double *partial;   // 2 doubles per result per task
+} stream;
+
+// ---------------------------------------------------------------------------
+// I/O thread
+// ---------------------------------------------------------------------------
+
+// Writes computed slots back (or just frees them) and refills empty ones, in
+// chunk order, until every chunk has been written or either side fails.
+static void *io_main(void *p) {
+  stream *s = p;
+  uint64_t next_read = 0, next_write = 0;
+  pthread_mutex_lock(&s->lock);
+  while (!s->stop && !s->err && next_write < s->nchunks) {
+    stream_slot *w = &s->slot[next_write % 2], *r = &s->slot[next_read % 2];
+    if (next_write < next_read && w->state == SLOT_DONE) {
+      int failed = 0;
+      if (s->fd_out >= 0) {
+        pthread_mutex_unlock(&s->lock);
+        failed = leanblas_write_at(s->fd_out, s->out_vec ? w->y : w->x, w->n * sizeof(double),
+                                   w->first * sizeof(double));
+        pthread_mutex_lock(&s->lock);
+      }
+      if (failed) {
+        s->err = errno;
+        s->err_path = "output";
+      }
+      w->state = SLOT_EMPTY;
+      next_write++;
+    } else if (next_read < s->nchunks && r->state == SLOT_EMPTY) {
+      r->first = next_read * s->chunk;
+      r->n = (size_t)(s->n - r->first < s->chunk ? s->n - r->first : s->chunk);
+      pthread_mutex_unlock(&s->lock);
+      const char *failed = NULL;
+      if (leanblas_read_at(s->fd_x, r->x, r->n * sizeof(double), r->first * sizeof(double)) != 0) failed = "x";
+      else if (s->fd_y < 0) memset(r->y, 0, r->n * sizeof(double));
+      else if (leanblas_read_at(s->fd_y, r->y, r->n * sizeof(double), r->first * sizeof(double)) != 0) failed = "y";
+      pthread_mutex_lock(&s->lock);
+      if (failed) {
+        s->err = errno;
+        s->err_path = failed;
+      }
+      r->state = SLOT_READY;
+      next_read++;
+    } else {
+      pthread_cond_wait(&s->cond, &s->lock);
+      continue;
+    }
+    pthread_cond_broadcast(&s->cond);
+  }
+  pthread_cond_broadcast(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Compute
+// ---------------------------------------------------------------------------
+
+// Adds the norm-2 state `b` to `a`, both (scale, sum of squares) with norm
+// scale * sqrt(ssq).
+static void nrm2_merge(double *a, const double *b) {
+  if (b[0] == 0) return;
+  if (a[0] < b[0]) {
+    const double r = a[0] / b[0];
+    a[1] = b[1] + a[1] * r * r;
+    a[0] = b[0];
+  } else {
+    const double r = b[0] / a[0];
+    a[1] += b[1] * r * r;
+  }
+}
+
+static void apply(const stream_step *st, double *x, double *y, size_t n, double *acc) {
+  double *v = st->vec ? y : x;
+  if (st->op < LEANBLAS_EW_NOPS) {
+    // the ops on two vectors have vec = x
+    leanblas_ew_kernels[st->op](n, st->alpha, st->beta, v, 1, y, 1);
+    return;
+  }
+  switch (st->op) {
+    case STREAM_DOT: acc[0] += cblas_ddot((int)n, x, 1, y, 1); break;
+    case STREAM_NRM2: {
+      const double block[2] = {cblas_dnrm2((int)n, v, 1), 1.0};
+      nrm2_merge(acc, block);
+      break;
+    }
+    case STREAM_ASUM: acc[0] += cblas_dasum((int)n, v, 1); break;
+    case STREAM_SUM:
+      for (size_t i = 0; i < n; i++) acc[0] += v[i];
+      break;
+  }
+}
+
+static void chunk_task(void *p, int task, int ntasks) {
+  const stream *s = p;
+  const stream_slot *slot = s->cur;
+  const size_t lo = slot->n * (size_t)task / (size_t)ntasks, hi = slot->n * (size_t)(task + 1) / (size_t)ntasks;
+  double *acc = s->partial + 2 * (size_t)s->nresults * (size_t)task;
+  for (int r = 0; r < 2 * s->nresults; r++) acc[r] = 0;
+  for (size_t b = lo; b < hi; b += STREAM_BLOCK) {
+    const size_t n = hi - b < STREAM_BLOCK ? hi - b : STREAM_BLOCK;
+    for (int k = 0; k < s->nsteps; k++) {
+      const stream_step *st = &s->steps[k];
+      apply(st, slot->x + b, slot->y + b, n, st->result >= 0 ? acc + 2 * st->result : NULL);
+    }
+  }
+}
+
+static void *alloc_aligned(size_t bytes) {
+  void *p = NULL;
+  return posix_memalign(&p, 64, bytes ? bytes : 64) == 0 ? p : NULL;
+}
+
+/** leanblas_stream_run
+ *
+ * @param paths  x, y and the output file; "" for no y or no output
+ * @param outVec 0 to write x to the output, 1 to write y
+ * @param code   STREAM_STEP_WORDS words per step, see the top of this file
+ * @param consts alpha and beta of every step
+ * @param chunk  elements per chunk
+ * @return the results of the reduction steps, in step order
+ */
+LEAN_EXPORT lean_obj_res leanblas_stream_run(b_lean_obj_arg paths, uint8_t outVec, b_lean_obj_arg code,
+                                             b_lean_obj_arg consts, size_t chunk, lean_obj_arg w) {
+  (void)w;
+  const size_t words = lean_array_size(code);
+  if (lean_array_size(paths) != 3 || words % STREAM_STEP_WORDS != 0 ||
+      lean_sarray_size(consts) != 2 * (words / STREAM_STEP_WORDS) || words / STREAM_STEP_WORDS > INT32_MAX)
+    return leanblas_file_error("LeanBLAS stream", "malformed pipeline");
+  if (chunk == 0 || chunk > STREAM_MAX_CHUNK)
+    return leanblas_file_error("LeanBLAS stream", "chunk must be 1 to %u elements", STREAM_MAX_CHUNK);
+  const char *path_x = lean_string_cstr(lean_array_get_core(paths, 0));
+  const char *path_y = lean_string_cstr(lean_array_get_core(paths, 1));
+  const char *path_out = lean_string_cstr(lean_array_get_core(paths, 2));
+
+  stream s;
+  memset(&s, 0, sizeof(s));
+  s.fd_x = s.fd_y = s.fd_out = -1;
+  s.out_vec = outVec;
+  s.chunk = chunk;
+  s.nsteps = (int)(words / STREAM_STEP_WORDS);
+  s.steps = calloc((size_t)s.nsteps + 1, sizeof(stream_step));
+  if (!s.steps) lean_internal_panic_out_of_memory();
+  const double *c = (const double *)lean_sarray_cptr(consts);
+  for (int k = 0; k < s.nsteps; k++) {
+    stream_step *st = &s.steps[k];
+    const size_t op = lean_unbox_usize(lean_array_get_core(code, STREAM_STEP_WORDS * (size_t)k));
+    const size_t vec = lean_unbox_usize(lean_array_get_core(code, STREAM_STEP_WORDS * (size_t)k + 1));
+    if (op >= STREAM_NOPS || vec > 1) {
+      free(s.steps);
+      return leanblas_file_error("LeanBLAS stream", "malformed pipeline");
+    }
+    st->op = (int)op;
+    st->vec = (int)vec;
+    st->alpha = c[2 * k];
+    st->beta = c[2 * k + 1];
+    st->result = st->op >= STREAM_DOT ? s.nresults++ : -1;
+  }
+
+  lean_obj_res res = NULL;
+  struct stat sx, sy, so;
+  s.fd_x = open(path_x, O_RDONLY | O_CLOEXEC);
+  if (s.fd_x < 0 || fstat(s.fd_x, &sx) != 0) {
+    res = leanblas_os_error(lean_array_get_core(paths, 0));
+    goto done;
+  }
+  if (sx.st_size % sizeof(double) != 0) {
+    res = leanblas_file_error(path_x, "size is not a multiple of 8 bytes");
+    goto done;
+  }
+  s.n = (uint64_t)sx.st_size / sizeof(double);
+  if (*path_y) {
+    s.fd_y = open(path_y, O_RDONLY | O_CLOEXEC);
+    if (s.fd_y < 0 || fstat(s.fd_y, &sy) != 0) {
+      res = leanblas_os_error(lean_array_get_core(paths, 1));
+      goto done;
+    }
+    if (sy.st_size != sx.st_size) {
+      res = leanblas_file_error(path_y, "%lld bytes, but %s has %lld", (long long)sy.st_size, path_x,
+                         (long long)sx.st_size);
+      goto done;
+    }
+  }
+  if (*path_out) {
+    // writing back into an input must not truncate it first
+    const int in_place = stat(path_out, &so) == 0 && ((so.st_dev == sx.st_dev && so.st_ino == sx.st_ino) ||
+                                                      (*path_y && so.st_dev == sy.st_dev && so.st_ino == sy.st_ino));
+    s.fd_out = open(path_out, O_WRONLY | O_CREAT | O_CLOEXEC | (in_place ? 0 : O_TRUNC), 0644);
+    if (s.fd_out < 0) {
+      res = leanblas_os_error(lean_array_get_core(paths, 2));
+      goto done;
+    }
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(s.fd_x, 0, 0, POSIX_FADV_SEQUENTIAL);
+  if (s.fd_y >= 0) posix_fadvise(s.fd_y, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  s.nchunks = (s.n + chunk - 1) / chunk;
+  const size_t bufn = s.n < chunk ? (size_t)s.n : chunk;
+  for (int i = 0; i < 2; i++) {
+    s.slot[i].x = alloc_aligned(bufn * sizeof(double));
+    s.slot[i].y = alloc_aligned(bufn * sizeof(double));
+    if (!s.slot[i].x || !s.slot[i].y) lean_internal_panic_out_of_memory();
+  }
+  const int threads = leanblas_num_threads() > 0 ? leanblas_num_threads() : 1;
+  double *acc = calloc(2 * (size_t)s.nresults + 1, sizeof(double));
+  s.partial = calloc(2 * (size_t)s.nresults * (size_t)threads + 1, sizeof(double));
+  if (!acc || !s.partial) lean_internal_panic_out_of_memory();
+
+  pthread_mutex_init(&s.lock, NULL);
+  pthread_cond_init(&s.cond, NULL);
+  pthread_t io;
+  const int rc = s.nchunks > 0 ? pthread_create(&io, NULL, io_main, &s) : 0;
+  const int io_started = s.nchunks > 0 && rc == 0;
+  if (rc != 0) {
+    s.err = rc;
+    s.err_path = "x";
+  }
+  for (uint64_t k = 0; io_started && k < s.nchunks; k++) {
+    stream_slot *slot = &s.slot[k % 2];
+    pthread_mutex_lock(&s.lock);
+    while (slot->state != SLOT_READY && !s.err) pthread_cond_wait(&s.cond, &s.lock);
+    const int failed = s.err != 0;
+    pthread_mutex_unlock(&s.lock);
+    if (failed) break;
+
+    s.cur = slot;
+    const size_t tasks = slot->n / STREAM_MIN_TASK + 1;
+    s.ntasks = (int)(tasks < (size_t)threads ? tasks : (size_t)threads);
+    if (s.ntasks > 1) leanblas_parallel_for(s.ntasks, chunk_task, &s);
+    else chunk_task(&s, 0, 1);
+    for (int t = 0; t < s.ntasks; t++) {
+      const double *part = s.partial + 2 * (size_t)s.nresults * (size_t)t;
+      for (int k2 = 0; k2 < s.nsteps; k2++) {
+        const int r = s.steps[k2].result;
+        if (r < 0) continue;
+        if (s.steps[k2].op == STREAM_NRM2) nrm2_merge(acc + 2 * r, part + 2 * r);
+        else acc[2 * r] += part[2 * r];
+      }
+    }
+
+    pthread_mutex_lock(&s.lock);
+    slot->state = SLOT_DONE;
+    pthread_cond_broadcast(&s.cond);
+    pthread_mutex_unlock(&s.lock);
+  }
+  if (io_started) {
+    pthread_mutex_lock(&s.lock);
+    s.stop = s.err != 0;
+    pthread_cond_broadcast(&s.cond);
+    pthread_mutex_unlock(&s.lock);
+    pthread_join(io, NULL);
+  }
+  pthread_cond_destroy(&s.cond);
+  pthread_mutex_destroy(&s.lock);
+
+  if (s.err) {
+    const char *p = strcmp(s.err_path, "x") == 0 ? path_x : strcmp(s.err_path, "y") == 0 ? path_y : path_out;
+    lean_object *lp = lean_mk_string(p);
+    res = lean_io_result_mk_error(lean_decode_io_error(s.err, lp));
+    lean_dec(lp);
+  } else if (s.fd_out >= 0 && (ftruncate(s.fd_out, (off_t)(s.n * sizeof(double))) != 0 || close(s.fd_out) != 0)) {
+    s.fd_out = -1;
+    res = leanblas_os_error(lean_array_get_core(paths, 2));
+  } else {
+    s.fd_out = -1;
+    lean_object *out = lean_alloc_sarray(sizeof(double), (size_t)s.nresults, (size_t)s.nresults);
+    double *o = (double *)lean_sarray_cptr(out);
+    for (int k = 0; k < s.nsteps; k++) {
+      const int r = s.steps[k].result;
+      if (r >= 0) o[r] = s.steps[k].op == STREAM_NRM2 ? acc[2 * r] * sqrt(acc[2 * r + 1]) : acc[2 * r];
+    }
+    res = lean_io_result_mk_ok(out);
+  }
+  free(acc);
+  free(s.partial);
+  for (int i = 0; i < 2; i++) {
+    free(s.slot[i].x);
+    free(s.slot[i].y);
+  }
+done:
+  if (s.fd_x >= 0) close(s.fd_x);
+  if (s.fd_y >= 0) close(s.fd_y);
+  if (s.fd_out >= 0) close(s.fd_out);
+  free(s.steps);
+  return res;
+}
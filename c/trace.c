@@ -0,0 +1,429 @@
+#include <lean/lean.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+// Per-call tracing, see `trace.h`.
+//
+// Every thread that records an event gets its own ring of TRACE_RING events,
+// linked into a global list the first time.  Only the owning thread writes to
+// a ring: it fills the next slot and then publishes it by advancing `head`
+// with a release store.  Rings are never freed, so the events of threads that
+// have exited can still be exported.  Exporting while other threads are still
+// calling BLAS is safe, but may skip events being overwritten at that moment.
+//
+// `clear` does not touch the rings either: it bumps the generation, and the
+// owner of a ring from an older generation marks its next event as the first
+// of the ring (`base`) before recording it.  The export ignores rings from an
+// older generation and the events before `base`, including calls that were
+// still running when `clear` was called.
+//
+// `LEANBLAS_TRACE=FILE` in the environment enables tracing at startup and
+// writes the Chrome trace to FILE when the process exits.
+//
+// The allocation profile below shares the scopes but not the rings.
+
+#define TRACE_RING 16384  // events per thread, a power of two
+
+typedef struct trace_ring {
+  leanblas_trace_event events[TRACE_RING];
+  _Atomic uint64_t head;  // events ever recorded; slot head % TRACE_RING is next
+  _Atomic uint64_t base;  // first event of the current generation
+  _Atomic uint32_t generation;
+  uint32_t tid;
+  struct trace_ring *next;
+} trace_ring;
+
+atomic_int leanblas_trace_on;
+
+static _Atomic(trace_ring *) rings;
+static atomic_uint trace_generation;
+static atomic_uint next_tid;
+static _Thread_local trace_ring *my_ring;
+
+static uint64_t trace_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static trace_ring *ring_for_thread(void) {
+  if (my_ring) return my_ring;
+  trace_ring *r = calloc(1, sizeof *r);
+  if (!r) return NULL;
+  atomic_store(&r->generation, atomic_load(&trace_generation));
+  r->tid = atomic_fetch_add(&next_tid, 1) + 1;
+  trace_ring *old = atomic_load(&rings);
+  do {
+    r->next = old;
+  } while (!atomic_compare_exchange_weak(&rings, &old, r));
+  my_ring = r;
+  return r;
+}
+
+static leanblas_trace_event *event_begin(const char *name, const char *arg_names, const int64_t *args,
+                                         uint32_t nargs) {
+  trace_ring *r = ring_for_thread();
+  if (!r) return NULL;
+  uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+  uint32_t gen = atomic_load_explicit(&trace_generation, memory_order_relaxed);
+  if (atomic_load_explicit(&r->generation, memory_order_relaxed) != gen) {
+    atomic_store_explicit(&r->base, h, memory_order_relaxed);
+    atomic_store_explicit(&r->generation, gen, memory_order_release);
+  }
+  leanblas_trace_event *ev = &r->events[h % TRACE_RING];
+  // An exporter that sees the slot before the release store below skips it as running.
+  ev->dur_ns = UINT64_MAX;
+  ev->name = name;
+  ev->arg_names = arg_names;
+  ev->nargs = nargs < LEANBLAS_TRACE_MAX_ARGS ? nargs : LEANBLAS_TRACE_MAX_ARGS;
+  memcpy(ev->args, args, ev->nargs * sizeof(int64_t));
+  ev->start_ns = trace_now();
+  atomic_store_explicit(&r->head, h + 1, memory_order_release);
+  return ev;
+}
+
+static leanblas_alloc_frame *frame_begin(const char *name);
+static void frame_end(leanblas_alloc_frame *f);
+
+leanblas_trace_scope leanblas_trace_begin(const char *name, const char *arg_names, const int64_t *args,
+                                          uint32_t nargs) {
+  int on = atomic_load_explicit(&leanblas_trace_on, memory_order_relaxed);
+  leanblas_trace_scope s = {NULL, NULL};
+  if (on & LEANBLAS_TRACE_EVENTS) s.ev = event_begin(name, arg_names, args, nargs);
+  if (on & LEANBLAS_TRACE_ALLOCS) s.frame = frame_begin(name);
+  return s;
+}
+
+void leanblas_trace_finish(leanblas_trace_scope *s) {
+  if (s->ev) s->ev->dur_ns = trace_now() - s->ev->start_ns;
+  if (s->frame) frame_end(s->frame);
+}
+
+int leanblas_trace_enabled(void) { return (atomic_load(&leanblas_trace_on) & LEANBLAS_TRACE_EVENTS) != 0; }
+
+void leanblas_set_trace_enabled(int on) {
+  if (on) atomic_fetch_or(&leanblas_trace_on, LEANBLAS_TRACE_EVENTS);
+  else atomic_fetch_and(&leanblas_trace_on, ~LEANBLAS_TRACE_EVENTS);
+}
+
+// ---------------------------------------------------------------------------
+// Allocation profile
+// ---------------------------------------------------------------------------
+
+// The outermost traced scope of a thread opens its frame, so the copies made
+// by `ensure_exclusive_*` inside a wrapper count towards that wrapper, and a
+// copy made outside of any wrapper is an operation `copy` of its own.  When
+// the frame closes it is added to the thread's table, which holds one entry
+// per operation name (by pointer, the names are string literals).
+//
+// Tables are owned and written by their thread only.  `clear` just bumps the
+// generation; a table from an older generation is ignored by the export and
+// zeroed by its thread before it is written again.
+
+#define ALLOC_SLOTS 512  // operations per thread, a power of two
+
+struct leanblas_alloc_frame {
+  const char *name;
+  uint64_t allocs, bytes, copies, copy_bytes;
+};
+
+typedef struct {
+  const char *name;
+  uint64_t calls, allocs, bytes, peak, copies, copy_bytes;
+} alloc_stat;
+
+typedef struct alloc_table {
+  alloc_stat stats[ALLOC_SLOTS];
+  _Atomic uint32_t generation;
+  struct alloc_table *next;
+} alloc_table;
+
+static _Atomic(alloc_table *) alloc_tables;
+static atomic_uint alloc_generation;
+static _Thread_local alloc_table *my_table;
+static _Thread_local leanblas_alloc_frame my_frame;
+static _Thread_local leanblas_alloc_frame *open_frame;
+
+static alloc_table *table_for_thread(void) {
+  uint32_t gen = atomic_load(&alloc_generation);
+  if (my_table) {
+    if (atomic_load_explicit(&my_table->generation, memory_order_relaxed) != gen) {
+      memset(my_table->stats, 0, sizeof my_table->stats);
+      atomic_store_explicit(&my_table->generation, gen, memory_order_release);
+    }
+    return my_table;
+  }
+  alloc_table *t = calloc(1, sizeof *t);
+  if (!t) return NULL;
+  atomic_store(&t->generation, gen);
+  alloc_table *old = atomic_load(&alloc_tables);
+  do {
+    t->next = old;
+  } while (!atomic_compare_exchange_weak(&alloc_tables, &old, t));
+  my_table = t;
+  return t;
+}
+
+static leanblas_alloc_frame *frame_begin(const char *name) {
+  if (open_frame) return NULL;
+  my_frame = (leanblas_alloc_frame){name, 0, 0, 0, 0};
+  open_frame = &my_frame;
+  return open_frame;
+}
+
+static void frame_end(leanblas_alloc_frame *f) {
+  open_frame = NULL;
+  alloc_table *t = table_for_thread();
+  if (!t) return;
+  size_t h = ((uintptr_t)f->name >> 3) & (ALLOC_SLOTS - 1);
+  for (size_t i = 0; i < ALLOC_SLOTS; i++, h = (h + 1) & (ALLOC_SLOTS - 1)) {
+    alloc_stat *st = &t->stats[h];
+    if (st->name && st->name != f->name) continue;
+    st->name = f->name;
+    st->calls++;
+    st->allocs += f->allocs;
+    st->bytes += f->bytes;
+    st->copies += f->copies;
+    st->copy_bytes += f->copy_bytes;
+    if (f->bytes > st->peak) st->peak = f->bytes;
+    return;
+  }
+}
+
+void leanblas_alloc_note(size_t bytes, int copy) {
+  leanblas_alloc_frame *f = open_frame;
+  if (!f) return;
+  f->allocs++;
+  f->bytes += bytes;
+  if (copy) {
+    f->copies++;
+    f->copy_bytes += bytes;
+  }
+}
+
+int leanblas_alloc_profile_enabled(void) { return (atomic_load(&leanblas_trace_on) & LEANBLAS_TRACE_ALLOCS) != 0; }
+
+void leanblas_set_alloc_profile_enabled(int on) {
+  if (on) atomic_fetch_or(&leanblas_trace_on, LEANBLAS_TRACE_ALLOCS);
+  else atomic_fetch_and(&leanblas_trace_on, ~LEANBLAS_TRACE_ALLOCS);
+}
+
+// ---------------------------------------------------------------------------
+// Chrome trace JSON
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  char *data;
+  size_t len, cap;
+} trace_buf;
+
+static void buf_printf(trace_buf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void buf_printf(trace_buf *b, const char *fmt, ...) {
+  for (;;) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data ? b->data + b->len : NULL, b->data ? b->cap - b->len : 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (b->data && b->len + (size_t)n < b->cap) {
+      b->len += (size_t)n;
+      return;
+    }
+    size_t cap = b->cap ? 2 * b->cap : 1 << 16;
+    while (cap <= b->len + (size_t)n) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) lean_internal_panic_out_of_memory();
+    b->data = data;
+    b->cap = cap;
+  }
+}
+
+// `"M": 64, "N": 64, "lda": 64` from the stringized argument list.
+static void buf_args(trace_buf *b, const leanblas_trace_event *ev) {
+  const char *p = ev->arg_names;
+  for (uint32_t i = 0; i < ev->nargs; i++) {
+    while (*p == ' ' || *p == ',') p++;
+    size_t len = strcspn(p, ",");
+    while (len > 0 && p[len - 1] == ' ') len--;
+    buf_printf(b, "%s\"%.*s\": %lld", i ? ", " : "", (int)len, p, (long long)ev->args[i]);
+    p += len;
+  }
+}
+
+static char *trace_chrome_json(size_t *len) {
+  trace_buf b = {0};
+  uint64_t dropped = 0;
+  int pid = (int)getpid();
+  int first = 1;
+  uint32_t gen = atomic_load(&trace_generation);
+  buf_printf(&b, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+  for (trace_ring *r = atomic_load(&rings); r; r = r->next) {
+    buf_printf(&b, "%s\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": %d, \"tid\": %u, "
+               "\"args\": {\"name\": \"leanblas-%u\"}}", first ? "" : ",", pid, r->tid, r->tid);
+    first = 0;
+    if (atomic_load_explicit(&r->generation, memory_order_acquire) != gen) continue;
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t begin = head > TRACE_RING ? head - TRACE_RING : 0;
+    uint64_t base = atomic_load_explicit(&r->base, memory_order_relaxed);
+    if (begin < base) begin = base;
+    else dropped += begin - base;
+    for (uint64_t i = begin; i < head; i++) {
+      const leanblas_trace_event *ev = &r->events[i % TRACE_RING];
+      if (ev->dur_ns == UINT64_MAX) continue;
+      buf_printf(&b, ",\n{\"ph\": \"X\", \"cat\": \"%s\", \"name\": \"%s\", \"pid\": %d, \"tid\": %u, "
+                 "\"ts\": %.3f, \"dur\": %.3f, \"args\": {", strcmp(ev->name, "copy") ? "blas" : "copy",
+                 ev->name, pid, r->tid, (double)ev->start_ns / 1e3, (double)ev->dur_ns / 1e3);
+      buf_args(&b, ev);
+      buf_printf(&b, "}}");
+    }
+  }
+  buf_printf(&b, "\n], \"otherData\": {\"dropped_events\": %llu}}\n", (unsigned long long)dropped);
+  *len = b.len;
+  return b.data;
+}
+
+/** leanblas_trace_clear
+ * Drops the events recorded so far by every thread.
+ */
+LEAN_EXPORT lean_obj_res leanblas_trace_clear(lean_obj_arg w) {
+  atomic_fetch_add(&trace_generation, 1);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+/** leanblas_trace_chrome_json
+ * @return The recorded events in the Chrome trace event format, for chrome://tracing and Perfetto.
+ */
+LEAN_EXPORT lean_obj_res leanblas_trace_chrome_json(lean_obj_arg w) {
+  size_t len;
+  char *json = trace_chrome_json(&len);
+  lean_obj_res s = lean_mk_string_from_bytes(json, len);
+  free(json);
+  return lean_io_result_mk_ok(s);
+}
+
+/** leanblas_trace_is_enabled
+ * @return Whether calls are currently being recorded.
+ */
+LEAN_EXPORT lean_obj_res leanblas_trace_is_enabled(lean_obj_arg w) {
+  return lean_io_result_mk_ok(lean_box(leanblas_trace_enabled()));
+}
+
+/** leanblas_trace_set_enabled
+ * Starts or stops recording.  Has no effect when built with `-K trace=off`.
+ */
+LEAN_EXPORT lean_obj_res leanblas_trace_set_enabled(uint8_t on, lean_obj_arg w) {
+  leanblas_set_trace_enabled(on);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+/** leanblas_trace_compiled
+ * @return Whether the wrappers were built with tracing (not `-K trace=off`).
+ */
+LEAN_EXPORT uint8_t leanblas_trace_compiled(lean_obj_arg unit) {
+#ifdef LEANBLAS_NO_TRACE
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+/** leanblas_alloc_profile_is_enabled
+ * @return Whether allocations of the wrappers are being counted.
+ */
+LEAN_EXPORT lean_obj_res leanblas_alloc_profile_is_enabled(lean_obj_arg w) {
+  return lean_io_result_mk_ok(lean_box(leanblas_alloc_profile_enabled()));
+}
+
+/** leanblas_alloc_profile_set_enabled
+ * Starts or stops counting.  Has no effect when built with `-K trace=off`.
+ */
+LEAN_EXPORT lean_obj_res leanblas_alloc_profile_set_enabled(uint8_t on, lean_obj_arg w) {
+  leanblas_set_alloc_profile_enabled(on);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+/** leanblas_alloc_profile_clear
+ * Drops the counts of every thread.
+ */
+LEAN_EXPORT lean_obj_res leanblas_alloc_profile_clear(lean_obj_arg w) {
+  atomic_fetch_add(&alloc_generation, 1);
+  return lean_io_result_mk_ok(lean_box(0));
+}
+
+/** leanblas_alloc_profile_stats
+ * @return One `(op, #[calls, allocations, bytes, peak bytes, copies, copy bytes])`
+ *         per operation, summed over the threads (the peak is the maximum).
+ */
+LEAN_EXPORT lean_obj_res leanblas_alloc_profile_stats(lean_obj_arg w) {
+  uint32_t gen = atomic_load(&alloc_generation);
+  alloc_stat *merged = NULL;
+  size_t n = 0, cap = 0;
+  for (alloc_table *t = atomic_load(&alloc_tables); t; t = t->next) {
+    if (atomic_load_explicit(&t->generation, memory_order_acquire) != gen) continue;
+    for (size_t i = 0; i < ALLOC_SLOTS; i++) {
+      const alloc_stat *st = &t->stats[i];
+      if (!st->name || !st->calls) continue;
+      size_t j = 0;
+      while (j < n && strcmp(merged[j].name, st->name) != 0) j++;
+      if (j == n) {
+        if (n == cap) {
+          cap = cap ? 2 * cap : 64;
+          alloc_stat *m = realloc(merged, cap * sizeof *m);
+          if (!m) lean_internal_panic_out_of_memory();
+          merged = m;
+        }
+        merged[n++] = (alloc_stat){st->name, 0, 0, 0, 0, 0, 0};
+      }
+      alloc_stat *m = &merged[j];
+      m->calls += st->calls;
+      m->allocs += st->allocs;
+      m->bytes += st->bytes;
+      m->copies += st->copies;
+      m->copy_bytes += st->copy_bytes;
+      if (st->peak > m->peak) m->peak = st->peak;
+    }
+  }
+  lean_object *out = lean_mk_empty_array_with_capacity(lean_box(n));
+  for (size_t j = 0; j < n; j++) {
+    const uint64_t counts[6] = {merged[j].calls,  merged[j].allocs, merged[j].bytes,
+                                merged[j].peak,   merged[j].copies, merged[j].copy_bytes};
+    lean_object *nums = lean_alloc_array(6, 6);
+    for (size_t k = 0; k < 6; k++) lean_array_set_core(nums, k, lean_uint64_to_nat(counts[k]));
+    lean_object *pair = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(pair, 0, lean_mk_string(merged[j].name));
+    lean_ctor_set(pair, 1, nums);
+    out = lean_array_push(out, pair);
+  }
+  free(merged);
+  return lean_io_result_mk_ok(out);
+}
+
+static const char *exit_path;
+
+static void trace_write_at_exit(void) {
+  size_t len;
+  char *json = trace_chrome_json(&len);
+  FILE *f = fopen(exit_path, "w");
+  if (f) {
+    fwrite(json, 1, len, f);
+    fclose(f);
+  } else {
+    fprintf(stderr, "leanblas: cannot write trace to %s\n", exit_path);
+  }
+  free(json);
+}
+
+__attribute__((constructor)) static void trace_init_from_env(void) {
+  const char *env = getenv("LEANBLAS_TRACE");
+  if (!env || !*env) return;
+  exit_path = env;
+  leanblas_set_trace_enabled(1);
+  atexit(trace_write_at_exit);
+}
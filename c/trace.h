@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-call tracing of the BLAS wrappers (trace.c, `LeanBLAS/FFI/Trace.lean`).
+//
+// `LEANBLAS_TRACE(M, N, lda, ...)` at the top of a wrapper records one event
+// for the enclosing call: the wrapper name without `leanblas_cblas_`, the
+// listed size and stride arguments by name, the start time and the duration
+// up to the end of the scope, whichever return it leaves by.  Copies made
+// by `ensure_exclusive_*` because an output array was shared are recorded as
+// `copy` events nested inside the call.
+//
+// Events go into a ring buffer owned by the calling thread, so recording
+// takes no lock; when a ring is full its oldest events are overwritten.
+//
+// The same scopes drive the allocation profiler (`LeanBLAS/FFI/AllocProfile.lean`):
+// the outermost scope on a thread opens an allocation frame, the objects the
+// wrapper allocates are noted in it with `LEANBLAS_ALLOC_NOTE`, and when the
+// scope ends the frame is added to the statistics of that operation.
+//
+// While both are off, the cost is one load of `leanblas_trace_on` and a
+// branch predicted not taken; the matching test at the end of the scope is on
+// locals that are then always NULL.  Building with `-K trace=off` defines
+// LEANBLAS_NO_TRACE and removes even that.
+
+#define LEANBLAS_TRACE_MAX_ARGS 8
+
+typedef struct {
+  const char *name;
+  const char *arg_names;  // the stringized argument list, e.g. "M, N, K, lda"
+  int64_t args[LEANBLAS_TRACE_MAX_ARGS];
+  uint32_t nargs;
+  uint64_t start_ns;
+  uint64_t dur_ns;  // UINT64_MAX while the call is running
+} leanblas_trace_event;
+
+// Bits of `leanblas_trace_on`.
+#define LEANBLAS_TRACE_EVENTS 1
+#define LEANBLAS_TRACE_ALLOCS 2
+
+extern atomic_int leanblas_trace_on;
+
+typedef struct leanblas_alloc_frame leanblas_alloc_frame;
+
+typedef struct {
+  leanblas_trace_event *ev;    // the event being recorded, if any
+  leanblas_alloc_frame *frame;  // the allocation frame this scope opened, if any
+} leanblas_trace_scope;
+
+leanblas_trace_scope leanblas_trace_begin(const char *name, const char *arg_names, const int64_t *args,
+                                          uint32_t nargs);
+void leanblas_trace_finish(leanblas_trace_scope *s);
+
+static inline void leanblas_trace_end(leanblas_trace_scope *s) {
+  if (__builtin_expect(s->ev != NULL || s->frame != NULL, 0)) leanblas_trace_finish(s);
+}
+
+int leanblas_trace_enabled(void);
+void leanblas_set_trace_enabled(int on);
+
+int leanblas_alloc_profile_enabled(void);
+void leanblas_set_alloc_profile_enabled(int on);
+
+// Adds an allocation of `bytes` to the open frame; `copy` marks copy-on-write copies.
+void leanblas_alloc_note(size_t bytes, int copy);
+
+#if defined(LEANBLAS_NO_TRACE)
+#define LEANBLAS_TRACE_NAMED(name, ...) ((void)0)
+#define LEANBLAS_ALLOC_NOTE(bytes, copy) ((void)0)
+#else
+// Only called when tracing is on, so the argument list is not materialized otherwise.
+#define LEANBLAS_TRACE_NAMED(name, ...)                                                                      \
+  leanblas_trace_scope leanblas_trace_ev __attribute__((cleanup(leanblas_trace_end))) =                    \
+      __builtin_expect(atomic_load_explicit(&leanblas_trace_on, memory_order_relaxed), 0)                  \
+          ? leanblas_trace_begin(name, #__VA_ARGS__, (const int64_t[]){0, ##__VA_ARGS__} + 1,              \
+                                 (uint32_t)(sizeof((const int64_t[]){0, ##__VA_ARGS__}) / sizeof(int64_t)) - 1) \
+          : (leanblas_trace_scope){NULL, NULL}
+#define LEANBLAS_ALLOC_NOTE(bytes, copy)                                                                     \
+  do {                                                                                                       \
+    if (__builtin_expect(atomic_load_explicit(&leanblas_trace_on, memory_order_relaxed) & LEANBLAS_TRACE_ALLOCS, 0)) \
+      leanblas_alloc_note(bytes, copy);                                                                      \
+  } while (0)
+#endif
+
+// Names the event after the enclosing `leanblas_cblas_*` function.
+#define LEANBLAS_TRACE(...) LEANBLAS_TRACE_NAMED(__func__ + sizeof("leanblas_cblas_") - 1, ##__VA_ARGS__)
@@ -1,20 +1,30 @@
 #include <lean/lean.h>
-#include <cblas.h>
+#include "cblas_compat.h"
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "util.h"
+#include "trace.h"
 
 
 void ensure_exclusive_float_array(lean_object ** X){
   if (!lean_is_exclusive(*X)) {
-    /* printf("warning: making array copy!\n"); */
+    const size_t bytes = lean_sarray_size(*X) * sizeof(double);
+    (void)bytes;  // only read by the trace macros
+    LEANBLAS_TRACE_NAMED("copy", bytes);
+    LEANBLAS_ALLOC_NOTE(sizeof(lean_sarray_object) + bytes, 1);
     *X = lean_copy_float_array(*X);
   }
 }
 
 void ensure_exclusive_byte_array(lean_object ** X){
   if (!lean_is_exclusive(*X)) {
-    /* printf("warning: making array copy!\n"); */
+    const size_t bytes = lean_sarray_size(*X);
+    (void)bytes;  // only read by the trace macros
+    LEANBLAS_TRACE_NAMED("copy", bytes);
+    LEANBLAS_ALLOC_NOTE(sizeof(lean_sarray_object) + bytes, 1);
     *X = lean_copy_byte_array(*X);
   }
 }
@@ -246,3 +256,89 @@ LEAN_EXPORT lean_obj_res leanblas_float32_array_set(lean_obj_arg arr, size_t idx
   ptr[idx] = (float)value;
   return arr;
 }
+
+// ---------------------------------------------------------------------------
+// File formats
+// ---------------------------------------------------------------------------
+
+lean_obj_res leanblas_file_error(const char* path, const char* fmt, ...) {
+  char msg[512];
+  int n = snprintf(msg, sizeof(msg), "%s: ", path);
+  if (n < 0 || (size_t)n >= sizeof(msg)) n = 0;
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(msg + n, sizeof(msg) - (size_t)n, fmt, ap);
+  va_end(ap);
+  return lean_io_result_mk_error(lean_mk_io_user_error(lean_mk_string(msg)));
+}
+
+size_t leanblas_raw_dtype_item(const char* dtype) {
+  if (strcmp(dtype, "f4") == 0) return 4;
+  if (strcmp(dtype, "f8") == 0) return 8;
+  if (strcmp(dtype, "c16") == 0) return 16;
+  return 0;
+}
+
+int leanblas_read_at(int fd, void* buf, size_t n, uint64_t off) {
+  uint8_t* p = buf;
+  while (n > 0) {
+    ssize_t r = pread(fd, p, n, (off_t)off);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) {
+      if (r == 0) errno = EIO;   // the file ends early, or shrank under us
+      return -1;
+    }
+    p += r;
+    n -= (size_t)r;
+    off += (uint64_t)r;
+  }
+  return 0;
+}
+
+int leanblas_write_at(int fd, const void* buf, size_t n, uint64_t off) {
+  const uint8_t* p = buf;
+  while (n > 0) {
+    ssize_t r = pwrite(fd, p, n, (off_t)off);
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0) return -1;
+    p += r;
+    n -= (size_t)r;
+    off += (uint64_t)r;
+  }
+  return 0;
+}
+
+int leanblas_write_all(int fd, const void* buf, size_t n) {
+  const uint8_t* p = buf;
+  while (n > 0) {
+    ssize_t r = write(fd, p, n);
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0) return -1;
+    p += r;
+    n -= (size_t)r;
+  }
+  return 0;
+}
+
+lean_object* leanblas_mapped_sarray(uint8_t* data, size_t bytes) {
+  lean_sarray_object* o = (lean_sarray_object*)(data - sizeof(lean_sarray_object));
+  lean_set_non_heap_header((lean_object*)o, 1, LeanScalarArray, 1);
+  o->m_size = bytes;
+  o->m_capacity = bytes;
+  return (lean_object*)o;
+}
+
+lean_object* leanblas_map_sarray(int fd, uint64_t off, size_t bytes, void** map, size_t* map_len) {
+  const size_t head = sizeof(lean_sarray_object);
+  if (bytes == 0 || off % 8 != 0 || off < head) return NULL;
+  const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  const uint64_t start = (off - head) / page * page;
+  const size_t len = (size_t)(off + bytes - start);
+  uint8_t* base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)start);
+  if (base == MAP_FAILED) return NULL;
+  if (map) {
+    *map = base;
+    *map_len = len;
+  }
+  return leanblas_mapped_sarray(base + (off - start), bytes);
+}
@@ -1,12 +1,26 @@
 #include <lean/lean.h>
+#include <errno.h>
 #include <stdio.h>
-#include <cblas.h>
+#include "cblas_compat.h"
 #include <stdint.h>
+#include "trace.h"
 
 
 void ensure_exclusive_float_array(lean_object ** X);
 void ensure_exclusive_byte_array(lean_object ** X);
 
+// `lean_alloc_ctor` and `lean_alloc_sarray` for objects a wrapper returns,
+// noted in the allocation profile (see trace.h).
+static inline lean_object* leanblas_alloc_ctor(unsigned tag, unsigned num_objs, unsigned scalar_sz) {
+    LEANBLAS_ALLOC_NOTE(sizeof(lean_ctor_object) + sizeof(void*) * num_objs + scalar_sz, 0);
+    return lean_alloc_ctor(tag, num_objs, scalar_sz);
+}
+
+static inline lean_object* leanblas_alloc_sarray(unsigned elem_size, size_t size, size_t capacity) {
+    LEANBLAS_ALLOC_NOTE(sizeof(lean_sarray_object) + elem_size * capacity, 0);
+    return lean_alloc_sarray(elem_size, size, capacity);
+}
+
 CBLAS_ORDER leanblas_cblas_order(const uint8_t order);
 CBLAS_TRANSPOSE leanblas_cblas_transpose(const uint8_t trans);
 CBLAS_UPLO leanblas_cblas_uplo(const uint8_t uplo);
@@ -69,3 +83,60 @@ static inline double* lean_float64_array_cptr(b_lean_obj_arg arr) {
         return NULL;
     }
 }
+
+// Helpers for the file formats (npy.c, matrix_market.c, checkpoint.c,
+// safetensors.c, stream.c).
+
+// The IO error "PATH: MESSAGE", with MESSAGE formatted like printf.
+lean_obj_res leanblas_file_error(const char* path, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// The IO error for the current `errno` on the file `path`.
+static inline lean_obj_res leanblas_os_error(b_lean_obj_arg path) {
+    return lean_io_result_mk_error(lean_decode_io_error(errno, path));
+}
+
+static inline int leanblas_host_is_little(void) {
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+// Little-endian header fields.
+static inline uint16_t leanblas_get16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static inline uint32_t leanblas_get32(const uint8_t* p) {
+    return (uint32_t)leanblas_get16(p) | (uint32_t)leanblas_get16(p + 2) << 16;
+}
+static inline uint64_t leanblas_get64(const uint8_t* p) {
+    return (uint64_t)leanblas_get32(p) | (uint64_t)leanblas_get32(p + 4) << 32;
+}
+static inline void leanblas_put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void leanblas_put32(uint8_t* p, uint32_t v) {
+    leanblas_put16(p, (uint16_t)v);
+    leanblas_put16(p + 2, (uint16_t)(v >> 16));
+}
+static inline void leanblas_put64(uint8_t* p, uint64_t v) {
+    leanblas_put32(p, (uint32_t)v);
+    leanblas_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+// Element size of a `BLAS.Npy.Raw` dtype ("f4", "f8" or "c16"), or 0.
+size_t leanblas_raw_dtype_item(const char* dtype);
+
+// Read or write exactly `n` bytes, retrying after signals.  They return -1 and
+// set `errno` on failure; reading past the end of the file fails with EIO.
+int leanblas_read_at(int fd, void* buf, size_t n, uint64_t off);
+int leanblas_write_at(int fd, const void* buf, size_t n, uint64_t off);
+int leanblas_write_all(int fd, const void* buf, size_t n);
+
+// A `ByteArray` over `bytes` bytes of a private writable mapping of a file,
+// starting at `data`.  The array header goes into the 24 bytes before `data`,
+// which must belong to the mapping and hold nothing else, and the object is
+// persistent (reference count 0): Lean never frees it, and every write
+// through a wrapper copies it first.  The mapping must never be unmapped.
+lean_object* leanblas_mapped_sarray(uint8_t* data, size_t bytes);
+
+// Maps the `bytes` bytes at `off` in `fd`, which must lie inside the file, as
+// by `leanblas_mapped_sarray`.  Returns NULL if they cannot be mapped in place
+// (when `off` is not a multiple of 8 or leaves no room for the header).  If
+// `map` is not NULL it receives the mapping, for `munmap` should the caller
+// fail before handing the array out.
+lean_object* leanblas_map_sarray(int fd, uint64_t off, size_t bytes, void** map, size_t* map_len);
@@ -2,13 +2,30 @@ import Lake
 
 open Lake DSL System Lean Elab
 
+-- `lake build -K blas=native` compiles the in-tree kernels in `c/native_*.c`
+-- as the BLAS backend instead of linking the system library.
+def nativeBLAS : Bool := get_config? blas == some "native"
+
+-- Compressed `.npz` archives need zlib. It is linked along with the system
+-- BLAS; `lake build -K zlib=on` adds it to `blas=native` builds too, which
+-- otherwise have no external dependency, and `-K zlib=off` leaves it out.
+def zlib : Bool :=
+  match get_config? zlib with
+  | some "on" => true
+  | some "off" => false
+  | _ => !nativeBLAS && !System.Platform.isWindows
+
+def zlibLinkArgs := if zlib then #["-lz"] else #[]
+
 def linkArgs := -- (#[] : Array String)
-  if System.Platform.isWindows then
+  (if System.Platform.isWindows then
     #[]
+  else if nativeBLAS then
+    #["-lpthread"]
   else if System.Platform.isOSX then
     #["-L/opt/homebrew/opt/openblas/lib", "-lblas"]
   else -- assuming linux
-    #["-L/usr/lib/x86_64-linux-gnu/", "-lblas"]
+    #["-L/usr/lib/x86_64-linux-gnu/", "-lblas"]) ++ zlibLinkArgs
 def inclArgs :=
   if System.Platform.isWindows then
     #[]
@@ -16,6 +33,13 @@ def inclArgs :=
     #["-I/opt/homebrew/opt/openblas/include"]
   else -- assuming linux
     #[]
+def backendArgs :=
+  (if nativeBLAS then #["-DLEANBLAS_NATIVE_BACKEND"] else #[]) ++ (if zlib then #["-DLEANBLAS_ZLIB"] else #[])
+
+-- `lake build -K trace=off` compiles the per-call tracing of the wrappers out
+-- (see `BLAS.Trace`).
+def traceArgs :=
+  if get_config? trace == some "off" then #["-DLEANBLAS_NO_TRACE"] else #[]
 
 package leanblas {
   moreLinkArgs := linkArgs
@@ -38,10 +62,34 @@ target libleanblasc pkg : FilePath := do
         let oFile := pkg.buildDir / "c" / (baseName ++ ".o")
         let srcJob ← inputTextFile file.path
         let weakArgs := #["-I", (← getLeanIncludeDir).toString]
-        oFiles := oFiles.push (← buildO oFile srcJob weakArgs (#["-DNDEBUG", "-O3", "-fPIC"] ++ inclArgs) "gcc" getLeanTrace)
+        oFiles := oFiles.push (← buildO oFile srcJob weakArgs (#["-DNDEBUG", "-O3", "-fPIC"] ++ inclArgs ++ backendArgs ++ traceArgs) "gcc" getLeanTrace)
     let name := nameToStaticLib "leanblasc"
     buildStaticLib (pkg.sharedLibDir / name) oFiles
 
+-- A plain C program timing the `cblas_*` calls benchmarked by `FFIOverhead`,
+-- as the baseline for the overhead of the Lean bindings.
+target ffiOverheadC pkg : FilePath := do
+  let srcJob ← inputTextFile (pkg.dir / "c" / "bench" / "ffi_overhead.c")
+  let oFile := pkg.buildDir / "c" / "bench" / "ffi_overhead.o"
+  let oJob ← buildO oFile srcJob #[] (#["-DNDEBUG", "-O3"] ++ inclArgs ++ backendArgs) "gcc" getLeanTrace
+  let libJob ← libleanblasc.fetch
+  let exeFile := pkg.buildDir / "bin" / "ffi_overhead_c"
+  buildFileAfterDep exeFile (Job.collectArray #[oJob, libJob]) fun files => do
+    createParentDirs exeFile
+    proc { cmd := "gcc", args := #["-o", exeFile.toString] ++ files.map (·.toString) ++ linkArgs ++ #["-lm"] }
+
+-- A plain C program measuring memory bandwidth and peak FMA throughput, the
+-- roofs `Roofline` places every operation under.
+target rooflinePeakC pkg : FilePath := do
+  let srcJob ← inputTextFile (pkg.dir / "c" / "bench" / "roofline_peak.c")
+  let oFile := pkg.buildDir / "c" / "bench" / "roofline_peak.o"
+  let oJob ← buildO oFile srcJob #[] (#["-DNDEBUG", "-O3"] ++ inclArgs ++ backendArgs) "gcc" getLeanTrace
+  let libJob ← libleanblasc.fetch
+  let exeFile := pkg.buildDir / "bin" / "roofline_peak_c"
+  buildFileAfterDep exeFile (Job.collectArray #[oJob, libJob]) fun files => do
+    createParentDirs exeFile
+    proc { cmd := "gcc", args := #["-o", exeFile.toString] ++ files.map (·.toString) ++ linkArgs ++ #["-lm", "-lpthread"] }
+
 ----------------------------------------------------------------------------------------------------
 
 -- Note: moreLinkObjs removed - dependents must link libleanblasc explicitly
@@ -96,6 +144,54 @@ lean_exe Level3Tests where
   root := `LeanBLASTest.Level3Tests
   moreLinkObjs := #[libleanblasc]
 
+lean_exe ReproducibleTests where
+  root := `LeanBLASTest.ReproducibleTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe TraceTests where
+  root := `LeanBLASTest.TraceTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe AllocProfileTests where
+  root := `LeanBLASTest.AllocProfileTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe AsyncTests where
+  root := `LeanBLASTest.AsyncTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe CallGraphTests where
+  root := `LeanBLASTest.CallGraphTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe MatrixViewTests where
+  root := `LeanBLASTest.MatrixViewTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe LazyTests where
+  root := `LeanBLASTest.LazyTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe NpyTests where
+  root := `LeanBLASTest.NpyTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe MatrixMarketTests where
+  root := `LeanBLASTest.MatrixMarketTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe CheckpointTests where
+  root := `LeanBLASTest.CheckpointTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe SafetensorsTests where
+  root := `LeanBLASTest.SafetensorsTests
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe StreamTests where
+  root := `LeanBLASTest.StreamTests
+  moreLinkObjs := #[libleanblasc]
+
 lean_exe BenchmarksQuickTest where
   root := `LeanBLASTest.BenchmarksQuick
   moreLinkObjs := #[libleanblasc]
@@ -144,6 +240,41 @@ lean_exe Level3Benchmarks where
   root := `LeanBLASTest.BenchmarksLevel3
   moreLinkObjs := #[libleanblasc]
 
+lean_exe Level2Benchmarks where
+  root := `LeanBLASTest.BenchmarksLevel2Main
+  moreLinkObjs := #[libleanblasc]
+  extraDepTargets := #[`rooflinePeakC]
+
+lean_exe ComplexBenchmarks where
+  root := `LeanBLASTest.BenchmarksComplex
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe LayoutBenchmarks where
+  root := `LeanBLASTest.BenchmarksLayout
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe PrecisionBenchmarks where
+  root := `LeanBLASTest.BenchmarksPrecision
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe ScalingBenchmarks where
+  root := `LeanBLASTest.BenchmarksScaling
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe BenchmarkSuite where
+  root := `LeanBLASTest.BenchmarkSuiteMain
+  moreLinkObjs := #[libleanblasc]
+
+lean_exe FFIOverhead where
+  root := `LeanBLASTest.FFIOverhead
+  moreLinkObjs := #[libleanblasc]
+  extraDepTargets := #[`ffiOverheadC]
+
+lean_exe Roofline where
+  root := `LeanBLASTest.RooflineMain
+  moreLinkObjs := #[libleanblasc]
+  extraDepTargets := #[`rooflinePeakC]
+
 lean_exe ComplexLevel1Comprehensive where
   root := `LeanBLASTest.ComplexLevel1ComprehensiveTests
   supportInterpreter := true